@@ -0,0 +1,1085 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C-
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free,
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU
+//C- | General Public License.   This grant only confers the right to
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to
+//C- | the extent such infringement is reasonably necessary to enable
+//C- | recipient to make, have made, practice, sell, or otherwise dispose
+//C- | of the LIZARDTECH ORIGINAL CODE, and not to infringe any patent
+//C- | claims of any other party.   In no event shall this grant
+//C- | constitute the rights to relicense this code or any part of it.
+//C- | See the GNU General Public License, Version 2, for more details.
+//C- +------------------------------------------------------------------
+
+
+/* Microbenchmarks for the codecs and the rendering pipeline.
+
+   Usage: codecbench [-seed=<n>] [-dpi=<dpi>,...] [-time=<seconds>]
+                     [-threads=<n>] [-mmr=<djvufile>] [<benchmark>...]
+
+   Generates synthetic text, photo, compound and fax pages (see
+   corpus.h) at each resolution and times the ZP coder, the BZZ
+   coder, IW44 and JB2 encoding, decoding and rendering, MMR
+   encoding and decoding, image scaling, color correction, color
+   quantization, the compositing of masks and colors, pixel format
+   conversion and complete page rendering with ddjvu_page_render.
+   Each benchmark runs at least three times and until <seconds> have
+   elapsed, after a warm-up run.
+   Option -threads=<n> sets the number of threads used by the GPixmap
+   resampling functions, with zero selecting the number of processors.
+   The conversion benchmarks only report the time spent converting
+   pixels, measured with the profiling counters of the ddjvu API.  When benchmark
+   names or prefixes are given, only the matching benchmarks run.
+
+   Option -mmr=<djvufile> also times the MMR decoder on the masks of
+   all the pages of a real document.  The masks are re-encoded with
+   our own MMREncoder, so this input is synthetic G4 data with the
+   shapes of real text, not the output of a fax machine or scanner.
+   Its results are reported with input name <djvufile>:reencoded.
+   Both the complete decoder and the scanline decoder must reproduce
+   the original masks.
+
+   The results are printed as one JSON object per line:
+     {"bench":"jb2-decode","input":"text-300","size":8415000,
+      "unit":"pixels","iterations":21,"seconds":0.0232,"min":0.0229,
+      "rate":362.7}
+   Field "seconds" is the median time per iteration, field "min" the
+   fastest iteration, and field "rate" the throughput in millions of
+   units per second computed from the median. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "corpus.h"
+#include "GContainer.h"
+#include "Arrays.h"
+#include "ZPCodec.h"
+#include "BSByteStream.h"
+#include "IW44Image.h"
+#include "MMRDecoder.h"
+#include "MMREncoder.h"
+#include "GScaler.h"
+#include "DjVuPalette.h"
+#include "GRect.h"
+#include "IFFByteStream.h"
+#include "DjVuProfile.h"
+#include "DjVuMessage.h"
+#include "ddjvuapi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef double (*BenchFunc)(void);
+
+static double mintime = 0.5;
+static GList<GUTF8String> selection;
+
+static double
+now(void)
+{
+  return DjVuProfile::now() * 1e-9;
+}
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static bool
+selected(const char *bench)
+{
+  if (selection.isempty())
+    return true;
+  for (GPosition p=selection; p; ++p)
+    if (!strncmp(bench, selection[p], selection[p].length()))
+      return true;
+  return false;
+}
+
+// Runs a benchmark function returning the time spent
+// in the measured code and prints the results.
+static void
+measure(const char *bench, const GUTF8String &input,
+        double size, const char *unit, BenchFunc func)
+{
+  if (! selected(bench))
+    return;
+  TArray<double> times(0, 0);
+  int n = 0;
+  // The first run warms the caches unless it is already long
+  double t = func();
+  if (t >= mintime)
+    times[n++] = t;
+  double start = now();
+  while (n < 3 || now() - start < mintime)
+    {
+      t = func();
+      times.touch(n);
+      times[n++] = t;
+      // Slow benchmarks need not run three times
+      if (now() - start > 10 * mintime)
+        break;
+    }
+  qsort(&times[0], n, sizeof(double), compare_doubles);
+  double median = times[n / 2];
+  printf("{\"bench\":\"%s\",\"input\":\"%s\",\"size\":%.0f,\"unit\":\"%s\","
+         "\"iterations\":%d,\"seconds\":%.6g,\"min\":%.6g,\"rate\":%.6g}\n",
+         bench, (const char*)input, size, unit,
+         n, median, times[0], size / median / 1e6);
+  fflush(stdout);
+}
+
+
+// ----------------------------------------
+// INPUTS
+
+static GUTF8String words;
+static GP<ByteStream> bzzdata;
+static GP<GBitmap> textbm;
+static GP<GBitmap> zpbm;
+static GP<ByteStream> zpdata;
+static GP<JB2Image> jb2;
+static GP<ByteStream> jb2data;
+static GP<ByteStream> smmrdata;
+static GList<GP<ByteStream> > smmrpages;
+static GP<GPixmap> photo;
+static GP<GPixmap> background;
+static GP<GPixmap> canvas;
+static GP<GPixmap> foreground;
+static GP<GBitmap> reducedbm;
+static GP<DjVuPalette> palette;
+static GList<GP<ByteStream> > iw44data;
+static GP<IW44Image> iw44;
+static int width;
+static int height;
+
+static ddjvu_context_t *ctx;
+static ddjvu_document_t *doc;
+static ddjvu_page_t *page;
+static ddjvu_format_t *format;
+static TArray<char> pagedata;
+static TArray<char> pixels;
+static int render_dpi;
+static int page_dpi;
+
+static const int iw44slices[] = { 74, 89, 99 };
+
+static void
+handle(int wait)
+{
+  const ddjvu_message_t *msg;
+  if (wait)
+    msg = ddjvu_message_wait(ctx);
+  while ((msg = ddjvu_message_peek(ctx)))
+    {
+      if (msg->m_any.tag == DDJVU_ERROR)
+        {
+          fprintf(stderr, "codecbench: %s\n", msg->m_error.message);
+          exit(10);
+        }
+      ddjvu_message_pop(ctx);
+    }
+}
+
+
+// ----------------------------------------
+// CODECS
+
+// Codes a bitmap with a small context model
+static void
+zp_code(ZPCodec &zp, GBitmap &bm, bool encoding)
+{
+  BitContext cx[32];
+  memset(cx, 0, sizeof(cx));
+  for (int row = bm.rows() - 1; row >= 0; row--)
+    {
+      const unsigned char *up = bm[row + 1];
+      unsigned char *cur = bm[row];
+      for (int x=0; x<(int)bm.columns(); x++)
+        {
+          int c = (up[x-1] << 4) | (up[x] << 3) | (up[x+1] << 2)
+            | (cur[x-2] << 1) | cur[x-1];
+          if (encoding)
+            zp.encoder(cur[x], cx[c]);
+          else
+            cur[x] = zp.decoder(cx[c]);
+        }
+    }
+}
+
+static double
+bench_zp_encode(void)
+{
+  GP<ByteStream> gbs = ByteStream::create();
+  double t = now();
+  {
+    GP<ZPCodec> zp = ZPCodec::create(gbs, true, true);
+    zp_code(*zp, *zpbm, true);
+  }
+  return now() - t;
+}
+
+static double
+bench_zp_decode(void)
+{
+  GP<GBitmap> bm = GBitmap::create(zpbm->rows(), zpbm->columns(), 2);
+  zpdata->seek(0);
+  double t = now();
+  GP<ZPCodec> zp = ZPCodec::create(zpdata, false, true);
+  zp_code(*zp, *bm, false);
+  return now() - t;
+}
+
+static double
+bench_bzz_encode(void)
+{
+  GP<ByteStream> gbs = ByteStream::create();
+  double t = now();
+  {
+    GP<ByteStream> bzz = BSByteStream::create(gbs, 1024);
+    bzz->writall((const char*)words, words.length());
+  }
+  return now() - t;
+}
+
+static double
+bench_bzz_decode(void)
+{
+  char buffer[65536];
+  bzzdata->seek(0);
+  double t = now();
+  GP<ByteStream> bzz = BSByteStream::create(bzzdata);
+  while (bzz->read(buffer, sizeof(buffer)) > 0)
+    continue;
+  return now() - t;
+}
+
+static double
+bench_iw44_encode(void)
+{
+  double t = now();
+  GP<IW44Image> iw = IW44Image::create_encode(*photo);
+  for (int i=0; i<3; i++)
+    {
+      IWEncoderParms parms;
+      parms.slices = iw44slices[i];
+      iw->encode_chunk(ByteStream::create(), parms);
+    }
+  return now() - t;
+}
+
+static double
+bench_iw44_decode(void)
+{
+  double t = now();
+  GP<IW44Image> iw = IW44Image::create_decode(IW44Image::COLOR);
+  for (GPosition p=iw44data; p; ++p)
+    {
+      iw44data[p]->seek(0);
+      iw->decode_chunk(iw44data[p]);
+    }
+  iw->close_codec();
+  return now() - t;
+}
+
+static double
+bench_iw44_pixmap(void)
+{
+  double t = now();
+  iw44->get_pixmap();
+  return now() - t;
+}
+
+static double
+bench_iw44_pixmap_4(void)
+{
+  double t = now();
+  iw44->get_pixmap(4, GRect(0, 0, (width + 3) / 4, (height + 3) / 4));
+  return now() - t;
+}
+
+static double
+bench_jb2_encode(void)
+{
+  GP<ByteStream> gbs = ByteStream::create();
+  double t = now();
+  jb2->encode(gbs);
+  return now() - t;
+}
+
+static double
+bench_jb2_decode(void)
+{
+  jb2data->seek(0);
+  double t = now();
+  GP<JB2Image> jimg = JB2Image::create();
+  jimg->decode(jb2data);
+  return now() - t;
+}
+
+static double
+bench_jb2_bitmap(void)
+{
+  double t = now();
+  jb2->get_bitmap();
+  return now() - t;
+}
+
+static double
+bench_jb2_bitmap_4(void)
+{
+  double t = now();
+  jb2->get_bitmap(4);
+  return now() - t;
+}
+
+static double
+bench_mmr_decode(void)
+{
+  smmrdata->seek(0);
+  double t = now();
+  MMRDecoder::decode(smmrdata);
+  return now() - t;
+}
+
+static double
+bench_mmr_encode(void)
+{
+  GP<ByteStream> gbs = ByteStream::create();
+  double t = now();
+  MMREncoder::encode_chunk(*textbm, gbs);
+  return now() - t;
+}
+
+static double
+bench_mmr_pages(void)
+{
+  double t = now();
+  for (GPosition p=smmrpages; p; ++p)
+    {
+      smmrpages[p]->seek(0);
+      MMRDecoder::decode(smmrpages[p]);
+    }
+  return now() - t;
+}
+
+// Checks that the MMR data decodes into the original
+// bitmap with both the complete and the scanline decoders.
+static void
+check_mmr(GP<ByteStream> smmr, const GBitmap &bm)
+{
+  int w = bm.columns();
+  int h = bm.rows();
+  smmr->seek(0);
+  GP<GBitmap> dbm = MMRDecoder::decode(smmr)->get_bitmap();
+  for (int y=0; y<h; y++)
+    if (memcmp((*dbm)[y], bm[y], w))
+      G_THROW("MMR decoding does not match the original bitmap");
+  smmr->seek(0);
+  int invert;
+  bool striped = MMRDecoder::decode_header(*smmr, w, h, invert);
+  GP<MMRDecoder> dcd = MMRDecoder::create(smmr, w, h, striped);
+  TArray<unsigned char> line(0, w - 1);
+  for (int y=h-1; y>=0; y--)
+    {
+      const unsigned char *runs = dcd->scanrle(!!invert);
+      if (! runs)
+        G_THROW("MMR scanline decoding stopped early");
+      unsigned char c = 0;
+      for (int x=0; x<w; c=1-c)
+        for (int n=GBitmap::read_run(runs); n>0 && x<w; n--)
+          line[x++] = c;
+      if (memcmp(&line[0], bm[y], w))
+        G_THROW("MMR scanline decoding does not match the original bitmap");
+    }
+  smmr->seek(0);
+}
+
+
+// ----------------------------------------
+// SCALING
+
+static double
+bench_scale_down(void)
+{
+  int w = width * 2 / 5;
+  int h = height * 2 / 5;
+  GP<GPixmap> output = GPixmap::create();
+  double t = now();
+  GP<GPixmapScaler> scaler = GPixmapScaler::create(width, height, w, h);
+  scaler->scale(GRect(0, 0, width, height), *photo, GRect(0, 0, w, h), *output);
+  return now() - t;
+}
+
+static double
+bench_scale_up(void)
+{
+  int w = background->columns();
+  int h = background->rows();
+  GP<GPixmap> output = GPixmap::create();
+  double t = now();
+  GP<GPixmapScaler> scaler = GPixmapScaler::create(w, h, width, height);
+  scaler->scale(GRect(0, 0, w, h), *background, 
+                GRect(0, 0, width, height), *output);
+  return now() - t;
+}
+
+static double
+bench_downsample_2(void)
+{
+  GP<GPixmap> output = GPixmap::create();
+  double t = now();
+  output->downsample(photo, 2);
+  return now() - t;
+}
+
+static double
+bench_downsample_3(void)
+{
+  GP<GPixmap> output = GPixmap::create();
+  double t = now();
+  output->downsample(photo, 3);
+  return now() - t;
+}
+
+static double
+bench_downsample43(void)
+{
+  GP<GPixmap> output = GPixmap::create();
+  double t = now();
+  output->downsample43(photo);
+  return now() - t;
+}
+
+static double
+bench_upsample_3(void)
+{
+  GP<GPixmap> output = GPixmap::create();
+  double t = now();
+  output->upsample(background, 3);
+  return now() - t;
+}
+
+static double
+bench_upsample23(void)
+{
+  GP<GPixmap> output = GPixmap::create();
+  double t = now();
+  output->upsample23(background);
+  return now() - t;
+}
+
+static double
+bench_scale_up_gamma(void)
+{
+  int w = background->columns();
+  int h = background->rows();
+  GP<GPixmap> output = GPixmap::create();
+  unsigned char gtable[256][3];
+  double t = now();
+  GPixmap::color_correction_table(2.2 / 1.8, GPixel::WHITE, gtable);
+  GP<GPixmapScaler> scaler = GPixmapScaler::create(w, h, width, height);
+  scaler->scale(GRect(0, 0, w, h), *background, 
+                GRect(0, 0, width, height), *output, gtable);
+  return now() - t;
+}
+
+static double
+bench_color_correct(void)
+{
+  double t = now();
+  photo->color_correct(2.2 / 1.8);
+  return now() - t;
+}
+
+static double
+bench_color_correct_white(void)
+{
+  static const GPixel white = { 232, 244, 255 };
+  double t = now();
+  photo->color_correct(2.2 / 1.8, white);
+  return now() - t;
+}
+
+static double
+bench_scale_bitmap(void)
+{
+  int w = width * 2 / 5;
+  int h = height * 2 / 5;
+  GP<GBitmap> output = GBitmap::create();
+  double t = now();
+  GP<GBitmapScaler> scaler = GBitmapScaler::create(width, height, w, h);
+  scaler->scale(GRect(0, 0, width, height), *textbm, GRect(0, 0, w, h), *output);
+  return now() - t;
+}
+
+
+// ----------------------------------------
+// COMPOSITING
+
+static double
+bench_attenuate(void)
+{
+  double t = now();
+  canvas->attenuate(textbm, 0, 0);
+  return now() - t;
+}
+
+static double
+bench_blit(void)
+{
+  static const GPixel color = { 40, 0, 160 };
+  double t = now();
+  canvas->blit(textbm, 0, 0, &color);
+  return now() - t;
+}
+
+static double
+bench_blend(void)
+{
+  // Blending the page into itself touches the same pixels as
+  // blending a separate color image of the same size
+  double t = now();
+  canvas->blend(textbm, 0, 0, canvas);
+  return now() - t;
+}
+
+static double
+bench_stencil(void)
+{
+  GRect rect(0, 0, width, height);
+  double t = now();
+  canvas->stencil(textbm, foreground, 12, &rect);
+  return now() - t;
+}
+
+static double
+bench_stencil_gamma(void)
+{
+  GRect rect(0, 0, width, height);
+  double t = now();
+  canvas->stencil(textbm, foreground, 12, &rect, 2.2 / 1.8);
+  return now() - t;
+}
+
+static double
+bench_stencil_4(void)
+{
+  // Antialiased preview: the mask and the canvas are reduced four times
+  GRect rect(0, 0, reducedbm->columns(), reducedbm->rows());
+  double t = now();
+  canvas->stencil(reducedbm, foreground, 3, &rect, 2.2 / 1.8);
+  return now() - t;
+}
+
+
+// ----------------------------------------
+// COLOR QUANTIZATION
+
+static double
+bench_palette(void)
+{
+  palette = DjVuPalette::create();
+  double t = now();
+  palette->compute_pixmap_palette(*photo, 256);
+  return now() - t;
+}
+
+static double
+bench_quantize(void)
+{
+  GP<GPixmap> copy = GPixmap::create(*photo);
+  double t = now();
+  palette->quantize(*copy);
+  return now() - t;
+}
+
+
+// ----------------------------------------
+// PAGE RENDERING
+
+static ddjvu_document_t *
+open_document(void)
+{
+  ddjvu_document_t *d = ddjvu_document_create(ctx, 0, FALSE);
+  ddjvu_stream_write(d, 0, &pagedata[0], pagedata.size());
+  ddjvu_stream_close(d, 0, FALSE);
+  while (! ddjvu_document_decoding_done(d))
+    handle(TRUE);
+  return d;
+}
+
+static ddjvu_page_t *
+open_page(ddjvu_document_t *d)
+{
+  ddjvu_page_t *p = ddjvu_page_create_by_pageno(d, 0);
+  while (! ddjvu_page_decoding_done(p))
+    handle(TRUE);
+  if (ddjvu_page_decoding_error(p))
+    {
+      handle(FALSE);
+      fprintf(stderr, "codecbench: cannot decode page\n");
+      exit(10);
+    }
+  return p;
+}
+
+static bool
+render(void)
+{
+  ddjvu_rect_t prect;
+  prect.x = prect.y = 0;
+  prect.w = (width * render_dpi + page_dpi / 2) / page_dpi;
+  prect.h = (height * render_dpi + page_dpi / 2) / page_dpi;
+  int rowsize = prect.w * 4;
+  pixels.resize(0, rowsize * prect.h);
+  return ddjvu_page_render(page, DDJVU_RENDER_COLOR, &prect, &prect,
+                           format, rowsize, &pixels[0]);
+}
+
+static double
+bench_page_decode(void)
+{
+  double t = now();
+  ddjvu_document_t *d = open_document();
+  ddjvu_page_release(open_page(d));
+  ddjvu_document_release(d);
+  return now() - t;
+}
+
+static double
+bench_page_render(void)
+{
+  double t = now();
+  if (! render())
+    G_THROW("Cannot render page");
+  return now() - t;
+}
+
+// Time spent in the pixel format conversion
+static double
+bench_convert(void)
+{
+  ddjvu_profile_t before, after;
+  ddjvu_page_get_profile(page, &before);
+  if (! render())
+    G_THROW("Cannot render page");
+  ddjvu_page_get_profile(page, &after);
+  return after.stage[DDJVU_PROFILE_CONVERT].seconds 
+    - before.stage[DDJVU_PROFILE_CONVERT].seconds;
+}
+
+
+// ----------------------------------------
+// ASSOCIATIVE MAPS
+
+static const int nkeys = 100000;
+static GArray<GUTF8String> keys;
+
+template <class MAP> static MAP &
+filled_map(void)
+{
+  static MAP map;
+  if (map.isempty())
+    for (int i=0; i<nkeys; i++)
+      map[keys[i]] = i;
+  return map;
+}
+
+template <class MAP> static double
+bench_map_insert(void)
+{
+  MAP map;
+  double t = now();
+  for (int i=0; i<nkeys; i++)
+    map[keys[i]] = i;
+  return now() - t;
+}
+
+template <class MAP> static double
+bench_map_lookup(void)
+{
+  const MAP &map = filled_map<MAP>();
+  long long sum = 0;
+  double t = now();
+  for (int i=0; i<nkeys; i++)
+    {
+      GPosition p = map.contains(keys[i]);
+      if (p)
+        sum += map[p];
+    }
+  t = now() - t;
+  if (sum != (long long)(nkeys - 1) * (nkeys / 2))
+    G_THROW("Map lookup failed");
+  return t;
+}
+
+template <class MAP> static double
+bench_map_iterate(void)
+{
+  const MAP &map = filled_map<MAP>();
+  long long sum = 0;
+  double t = now();
+  for (GPosition p=map; p; ++p)
+    sum += map[p];
+  t = now() - t;
+  if (sum != (long long)(nkeys - 1) * (nkeys / 2))
+    G_THROW("Map iteration failed");
+  return t;
+}
+
+
+// ----------------------------------------
+// MAIN
+
+static int
+usage(void)
+{
+  fprintf(stderr,
+          "Usage: codecbench [-seed=<n>] [-dpi=<dpi>,...] [-time=<seconds>]\n"
+          "                  [-threads=<n>] [-mmr=<djvufile>] [<benchmark>...]\n");
+  return 10;
+}
+
+static void
+run_maps(void)
+{
+  keys.resize(0, nkeys - 1);
+  for (int i=0; i<nkeys; i++)
+    keys[i].format("file:///home/user/library/book%03d/p%04d.djvu", i / 1000, i);
+  measure("map-insert", "GMap", nkeys, "keys", 
+          bench_map_insert<GMap<GUTF8String,int> >);
+  measure("map-insert", "GFlatMap", nkeys, "keys", 
+          bench_map_insert<GFlatMap<GUTF8String,int> >);
+  measure("map-lookup", "GMap", nkeys, "keys", 
+          bench_map_lookup<GMap<GUTF8String,int> >);
+  measure("map-lookup", "GFlatMap", nkeys, "keys", 
+          bench_map_lookup<GFlatMap<GUTF8String,int> >);
+  measure("map-iterate", "GMap", nkeys, "keys", 
+          bench_map_iterate<GMap<GUTF8String,int> >);
+  measure("map-iterate", "GFlatMap", nkeys, "keys", 
+          bench_map_iterate<GFlatMap<GUTF8String,int> >);
+}
+
+static void
+run_bzz(int seed)
+{
+  words = make_words(1 << 20, seed);
+  bzzdata = ByteStream::create();
+  {
+    GP<ByteStream> bzz = BSByteStream::create(bzzdata, 1024);
+    bzz->writall((const char*)words, words.length());
+  }
+  measure("bzz-encode", "words-1M", words.length(), "bytes", bench_bzz_encode);
+  measure("bzz-decode", "words-1M", words.length(), "bytes", bench_bzz_decode);
+}
+
+static void
+run_text(int dpi, int seed)
+{
+  GUTF8String input = GUTF8String("text-") + GUTF8String(dpi);
+  double npixels = (double)width * height;
+  // Text layer through JB2, the decoded image has compressed shapes
+  jb2data = ByteStream::create();
+  make_text(width, height, dpi, seed)->encode(jb2data);
+  jb2data->seek(0);
+  jb2 = JB2Image::create();
+  jb2->decode(jb2data);
+  textbm = jb2->get_bitmap();
+  zpbm = GBitmap::create(*textbm, 2);
+  zpdata = ByteStream::create();
+  {
+    GP<ZPCodec> zp = ZPCodec::create(zpdata, true, true);
+    zp_code(*zp, *zpbm, true);
+  }
+  check_mmr(make_smmr(*textbm, 64), *textbm);
+  smmrdata = make_smmr(*textbm);
+  check_mmr(smmrdata, *textbm);
+  measure("zp-encode", input, npixels, "pixels", bench_zp_encode);
+  measure("zp-decode", input, npixels, "pixels", bench_zp_decode);
+  measure("jb2-encode", input, npixels, "pixels", bench_jb2_encode);
+  measure("jb2-decode", input, npixels, "pixels", bench_jb2_decode);
+  measure("jb2-bitmap", input, npixels, "pixels", bench_jb2_bitmap);
+  measure("jb2-bitmap-4", input, npixels / 16, "pixels", bench_jb2_bitmap_4);
+  measure("mmr-encode", input, npixels, "pixels", bench_mmr_encode);
+  measure("mmr-decode", input, npixels, "pixels", bench_mmr_decode);
+  measure("scale-bitmap", input, npixels, "pixels", bench_scale_bitmap);
+}
+
+static void
+run_photo(int dpi, int seed)
+{
+  GUTF8String input = GUTF8String("photo-") + GUTF8String(dpi);
+  double npixels = (double)width * height;
+  photo = make_photo(width, height, seed);
+  iw44data.empty();
+  GP<IW44Image> iw = IW44Image::create_encode(*photo);
+  for (int i=0; i<3; i++)
+    {
+      IWEncoderParms parms;
+      parms.slices = iw44slices[i];
+      GP<ByteStream> chunk = ByteStream::create();
+      iw->encode_chunk(chunk, parms);
+      iw44data.append(chunk);
+    }
+  iw44 = IW44Image::create_decode(IW44Image::COLOR);
+  for (GPosition p=iw44data; p; ++p)
+    {
+      iw44data[p]->seek(0);
+      iw44->decode_chunk(iw44data[p]);
+    }
+  iw44->close_codec();
+  measure("iw44-encode", input, npixels, "pixels", bench_iw44_encode);
+  measure("iw44-decode", input, npixels, "pixels", bench_iw44_decode);
+  measure("iw44-pixmap", input, npixels, "pixels", bench_iw44_pixmap);
+  measure("iw44-pixmap-4", input, npixels / 16, "pixels", bench_iw44_pixmap_4);
+  measure("scale-down", input, npixels, "pixels", bench_scale_down);
+  measure("downsample-2", input, npixels, "pixels", bench_downsample_2);
+  measure("downsample-3", input, npixels, "pixels", bench_downsample_3);
+  measure("downsample43", input, npixels, "pixels", bench_downsample43);
+  measure("color-correct", input, npixels, "pixels", bench_color_correct);
+  measure("color-correct-white", input, npixels, "pixels", 
+          bench_color_correct_white);
+  palette = DjVuPalette::create();
+  palette->compute_pixmap_palette(*photo, 256);
+  measure("palette", input, npixels, "pixels", bench_palette);
+  measure("palette-quantize", input, npixels, "pixels", bench_quantize);
+  palette = 0;
+  // Background layer of a compound page
+  background = make_photo((width + 2) / 3, (height + 2) / 3, seed);
+  input = GUTF8String("background-") + GUTF8String(dpi);
+  measure("scale-up", input, npixels, "pixels", bench_scale_up);
+  measure("scale-up-gamma", input, npixels, "pixels", bench_scale_up_gamma);
+  measure("upsample-3", input, npixels, "pixels", bench_upsample_3);
+  measure("upsample23", input, npixels / 4, "pixels", bench_upsample23);
+  photo = background = 0;
+  iw44 = 0;
+}
+
+static void
+run_composite(int dpi, int seed)
+{
+  GUTF8String input = GUTF8String("text-") + GUTF8String(dpi);
+  double npixels = (double)width * height;
+  // Text mask over a photo, foreground colors at 1/12 resolution
+  canvas = make_photo(width, height, seed);
+  foreground = make_photo((width + 11) / 12, (height + 11) / 12, seed + 1);
+  measure("composite-attenuate", input, npixels, "pixels", bench_attenuate);
+  measure("composite-blit", input, npixels, "pixels", bench_blit);
+  measure("composite-blend", input, npixels, "pixels", bench_blend);
+  measure("composite-stencil", input, npixels, "pixels", bench_stencil);
+  measure("composite-stencil-gamma", input, npixels, "pixels", 
+          bench_stencil_gamma);
+  reducedbm = jb2->get_bitmap(4);
+  canvas = make_photo(reducedbm->columns(), reducedbm->rows(), seed);
+  measure("composite-stencil-4", input, npixels / 16, "pixels", 
+          bench_stencil_4);
+  canvas = foreground = 0;
+  reducedbm = 0;
+}
+
+static void
+run_page(PageKind kind, int dpi, int seed)
+{
+  static unsigned int cube[216];
+  for (int i=0; i<216; i++)
+    cube[i] = ((i / 36) * 0x33 << 16) | ((i / 6 % 6) * 0x33 << 8) | (i % 6 * 0x33);
+  static unsigned int masks[] = { 0xff0000, 0xff00, 0xff };
+  static const struct { const char *name; ddjvu_format_style_t style; 
+    int nargs; unsigned int *args; } formats[] = {
+    { "convert-rgb24",     DDJVU_FORMAT_RGB24,     0,   0 },
+    { "convert-rgbmask32", DDJVU_FORMAT_RGBMASK32, 3,   masks },
+    { "convert-grey8",     DDJVU_FORMAT_GREY8,     0,   0 },
+    { "convert-palette8",  DDJVU_FORMAT_PALETTE8,  216, cube },
+    { "convert-msbtolsb",  DDJVU_FORMAT_MSBTOLSB,  0,   0 }
+  };
+  GUTF8String input = page_kind_name(kind) + GUTF8String("-") + GUTF8String(dpi);
+  double npixels = (double)width * height;
+  pagedata = make_page(kind, dpi, seed)->get_data();
+  page_dpi = dpi;
+  measure("page-decode", input, npixels, "pixels", bench_page_decode);
+  doc = open_document();
+  page = open_page(doc);
+  format = ddjvu_format_create(DDJVU_FORMAT_RGB24, 0, 0);
+  render_dpi = dpi;
+  measure("page-render", input, npixels, "pixels", bench_page_render);
+  render_dpi = 100;
+  measure("page-render-100dpi", input, npixels * 100 * 100 / dpi / dpi, 
+          "pixels", bench_page_render);
+  render_dpi = dpi;
+  ddjvu_format_set_gamma(format, 1.8);
+  measure("page-render-gamma", input, npixels, "pixels", bench_page_render);
+  ddjvu_format_release(format);
+  render_dpi = dpi;
+  ddjvu_profile_enable(ctx, DDJVU_PROFILE_COUNTERS);
+  for (unsigned int i=0; i<sizeof(formats)/sizeof(formats[0]); i++)
+    {
+      format = ddjvu_format_create(formats[i].style, formats[i].nargs, 
+                                   formats[i].args);
+      measure(formats[i].name, input, npixels, "pixels", bench_convert);
+      ddjvu_format_release(format);
+    }
+  ddjvu_profile_enable(ctx, 0);
+  ddjvu_page_release(page);
+  ddjvu_document_release(doc);
+  page = 0;
+  doc = 0;
+}
+
+// Masks of all the pages of a document, re-encoded with MMREncoder
+static void
+run_mmr(const char *filename)
+{
+  const char *base = strrchr(filename, '/');
+  GUTF8String input = GUTF8String((base) ? base + 1 : filename) + ":reencoded";
+  ddjvu_document_t *d = ddjvu_document_create_by_filename(ctx, filename, TRUE);
+  if (! d)
+    G_THROW("Cannot open the MMR benchmark document");
+  while (! ddjvu_document_decoding_done(d))
+    handle(TRUE);
+  if (ddjvu_document_decoding_error(d))
+    G_THROW("Cannot decode the MMR benchmark document");
+  ddjvu_format_t *fmt = ddjvu_format_create(DDJVU_FORMAT_GREY8, 0, 0);
+  ddjvu_format_set_row_order(fmt, 1);
+  double npixels = 0;
+  smmrpages.empty();
+  for (int i=0; i<ddjvu_document_get_pagenum(d); i++)
+    {
+      ddjvu_page_t *p = ddjvu_page_create_by_pageno(d, i);
+      while (! ddjvu_page_decoding_done(p))
+        handle(TRUE);
+      ddjvu_rect_t rect;
+      rect.x = rect.y = 0;
+      rect.w = ddjvu_page_get_width(p);
+      rect.h = ddjvu_page_get_height(p);
+      pixels.resize(0, rect.w * rect.h);
+      if (! ddjvu_page_decoding_error(p) &&
+          ddjvu_page_render(p, DDJVU_RENDER_MASKONLY, &rect, &rect,
+                            fmt, rect.w, &pixels[0]))
+        {
+          GP<GBitmap> bm = GBitmap::create(rect.h, rect.w);
+          for (int y=0; y<(int)rect.h; y++)
+            {
+              const char *s = &pixels[y * rect.w];
+              unsigned char *row = (*bm)[y];
+              for (int x=0; x<(int)rect.w; x++)
+                row[x] = ((unsigned char)s[x] < 128);
+            }
+          GP<ByteStream> smmr = make_smmr(*bm);
+          check_mmr(smmr, *bm);
+          smmrpages.append(smmr);
+          npixels += (double)rect.w * rect.h;
+        }
+      ddjvu_page_release(p);
+    }
+  ddjvu_format_release(fmt);
+  ddjvu_document_release(d);
+  if (! smmrpages.isempty())
+    measure("mmr-decode", input, npixels, "pixels", bench_mmr_pages);
+  smmrpages.empty();
+}
+
+int
+main(int argc, char **argv)
+{
+  int seed = 1;
+  GUTF8String dpis = "150,300,600";
+  const char *mmrfile = 0;
+  for (int i=1; i<argc; i++)
+    {
+      if (!strncmp(argv[i], "-seed=", 6))
+        seed = atoi(argv[i] + 6);
+      else if (!strncmp(argv[i], "-dpi=", 5))
+        dpis = argv[i] + 5;
+      else if (!strncmp(argv[i], "-time=", 6))
+        mintime = atof(argv[i] + 6);
+      else if (!strncmp(argv[i], "-threads=", 9))
+        GPixmap::set_threads(atoi(argv[i] + 9));
+      else if (!strncmp(argv[i], "-mmr=", 5))
+        mmrfile = argv[i] + 5;
+      else if (argv[i][0] == '-')
+        return usage();
+      else
+        selection.append(argv[i]);
+    }
+  G_TRY
+    {
+      ctx = ddjvu_context_create("codecbench");
+      printf("{\"suite\":\"codecbench\",\"version\":\"%s\",\"seed\":%d,"
+             "\"dpi\":[%s],\"time\":%g,\"threads\":%d}\n", 
+             PACKAGE_VERSION, seed, (const char*)dpis, mintime,
+             GPixmap::get_threads());
+      run_maps();
+      run_bzz(seed);
+      const char *s = dpis;
+      while (*s)
+        {
+          int dpi = atoi(s);
+          if (dpi < 25 || dpi > 1200)
+            G_THROW("Resolution must be between 25 and 1200 dpi");
+          page_size(dpi, width, height);
+          run_text(dpi, seed);
+          run_photo(dpi, seed);
+          run_composite(dpi, seed);
+          for (int k=TEXT; k<=FAX; k++)
+            run_page((PageKind)k, dpi, seed);
+          while (*s && *s != ',')
+            s++;
+          if (*s)
+            s++;
+        }
+      if (mmrfile && selected("mmr-decode"))
+        run_mmr(mmrfile);
+      ddjvu_context_release(ctx);
+    }
+  G_CATCH(ex)
+    {
+      ex.perror();
+      return 10;
+    }
+  G_ENDCATCH;
+  return 0;
+}
@@ -0,0 +1,425 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C-
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free,
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU
+//C- | General Public License.   This grant only confers the right to
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to
+//C- | the extent such infringement is reasonably necessary to enable
+//C- | recipient to make, have made, practice, sell, or otherwise dispose
+//C- | of the LIZARDTECH ORIGINAL CODE, and not to infringe any patent
+//C- | claims of any other party.   In no event shall this grant
+//C- | constitute the rights to relicense this code or any part of it.
+//C- | See the GNU General Public License, Version 2, for more details.
+//C- +------------------------------------------------------------------
+
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "corpus.h"
+#include "GRect.h"
+#include "Arrays.h"
+#include "IFFByteStream.h"
+#include "IW44Image.h"
+#include "DjVuInfo.h"
+#include "MMREncoder.h"
+
+#include <math.h>
+#include <string.h>
+
+
+// ----------------------------------------
+// PAGES
+
+const char *
+page_kind_name(PageKind kind)
+{
+  switch (kind)
+    {
+    case TEXT:     return "text";
+    case PHOTO:    return "photo";
+    case COMPOUND: return "compound";
+    case FAX:      return "fax";
+    }
+  return "unknown";
+}
+
+void
+page_size(int dpi, int &width, int &height)
+{
+  width = (dpi * 85 + 5) / 10;
+  height = dpi * 11;
+}
+
+
+// ----------------------------------------
+// TEXT
+
+// Draws a thick segment into a glyph bitmap
+static void
+draw_stroke(GBitmap &bm, int x0, int y0, int x1, int y1, int thick)
+{
+  int dx = x1 - x0;
+  int dy = y1 - y0;
+  int steps = (abs(dx) > abs(dy)) ? abs(dx) : abs(dy);
+  if (steps < 1)
+    steps = 1;
+  for (int s=0; s<=steps; s++)
+    {
+      int x = x0 + (dx * s) / steps;
+      int y = y0 + (dy * s) / steps;
+      for (int j=y; j<y+thick && j<(int)bm.rows(); j++)
+        for (int i=x; i<x+thick && i<(int)bm.columns(); i++)
+          if (i >= 0 && j >= 0)
+            bm[j][i] = 1;
+    }
+}
+
+static GP<GBitmap>
+make_glyph(Random &rng, int gh)
+{
+  int gw = gh * (4 + rng.uniform(6)) / 10;
+  int thick = (gh >= 8) ? gh / 8 : 1;
+  GP<GBitmap> gbm = GBitmap::create(gh, gw);
+  GBitmap &bm = *gbm;
+  int nstrokes = 2 + rng.uniform(3);
+  int x = rng.uniform(gw - thick + 1);
+  int y = rng.uniform(gh - thick + 1);
+  for (int s=0; s<nstrokes; s++)
+    {
+      int nx = rng.uniform(gw - thick + 1);
+      int ny = rng.uniform(gh - thick + 1);
+      draw_stroke(bm, x, y, nx, ny, thick);
+      x = nx;
+      y = ny;
+    }
+  return gbm;
+}
+
+GP<JB2Image>
+make_text(int width, int height, int dpi, int seed)
+{
+  Random rng(seed);
+  GP<JB2Image> gjimg = JB2Image::create();
+  JB2Image &jimg = *gjimg;
+  jimg.set_dimension(width, height);
+  // Font
+  const int nglyphs = 72;
+  int gh = dpi * 14 / 100;
+  if (gh < 8)
+    gh = 8;
+  TArray<int> widths(0, nglyphs - 1);
+  for (int g=0; g<nglyphs; g++)
+    {
+      JB2Shape shape;
+      shape.parent = -1;
+      shape.bits = make_glyph(rng, gh);
+      shape.userdata = 0;
+      widths[g] = shape.bits->columns();
+      jimg.add_shape(shape);
+    }
+  // Lines of words
+  int margin = dpi * 3 / 4;
+  int spacing = gh * 3 / 2;
+  for (int y = height - margin - gh; y >= margin; y -= spacing)
+    {
+      if (rng.uniform(12) == 0)
+        continue;  // paragraph break
+      int x = margin;
+      for (;;)
+        {
+          int nletters = 1 + rng.uniform(9);
+          if (x + nletters * gh * 7 / 10 > width - margin)
+            break;
+          for (int l=0; l<nletters; l++)
+            {
+              // Frequent glyphs have small numbers
+              int g = rng.uniform(rng.uniform(nglyphs) + 1);
+              JB2Blit blit;
+              blit.left = x;
+              blit.bottom = y;
+              blit.shapeno = g;
+              jimg.add_blit(blit);
+              x += widths[g] + gh / 10;
+            }
+          x += gh / 2;
+        }
+    }
+  return gjimg;
+}
+
+GUTF8String
+make_words(int size, int seed)
+{
+  Random rng(seed);
+  const int nwords = 2000;
+  static const char letters[] = "etaoinshrdlcumwfgypbvkjxqz";
+  GArray<GUTF8String> vocabulary(0, nwords - 1);
+  for (int w=0; w<nwords; w++)
+    {
+      char word[16];
+      int len = 2 + rng.uniform(9);
+      for (int i=0; i<len; i++)
+        word[i] = letters[rng.uniform(rng.uniform(26) + 1)];
+      word[len] = 0;
+      vocabulary[w] = word;
+    }
+  GUTF8String text;
+  char *buf = text.getbuf(size);
+  int pos = 0;
+  while (pos < size)
+    {
+      const GUTF8String &word = vocabulary[rng.uniform(rng.uniform(nwords) + 1)];
+      for (int i=0; i<(int)word.length() && pos<size; i++)
+        buf[pos++] = word[i];
+      if (pos < size)
+        buf[pos++] = (rng.uniform(15) == 0) ? '\n' : ' ';
+    }
+  return text;
+}
+
+
+// ----------------------------------------
+// PHOTO
+
+static inline unsigned char
+clip(int x)
+{
+  return (x < 0) ? 0 : (x > 255) ? 255 : x;
+}
+
+GP<GPixmap>
+make_photo(int width, int height, int seed)
+{
+  Random rng(seed);
+  GP<GPixmap> gpm = GPixmap::create(height, width);
+  GPixmap &pm = *gpm;
+  // Smooth separable gradients
+  TArray<int> gx(0, 3 * width - 1);
+  TArray<int> gy(0, 3 * height - 1);
+  for (int c=0; c<3; c++)
+    {
+      double fx = (1 + rng.uniform(4)) * 3.14159 / width;
+      double fy = (1 + rng.uniform(4)) * 3.14159 / height;
+      double px = rng.uniform(360) * 3.14159 / 180;
+      double py = rng.uniform(360) * 3.14159 / 180;
+      for (int x=0; x<width; x++)
+        gx[3 * x + c] = (int)(64 * sin(fx * x + px));
+      for (int y=0; y<height; y++)
+        gy[3 * y + c] = 128 + (int)(48 * cos(fy * y + py));
+    }
+  for (int y=0; y<height; y++)
+    {
+      GPixel *row = pm[y];
+      for (int x=0; x<width; x++)
+        {
+          row[x].b = clip(gx[3 * x + 0] + gy[3 * y + 0]);
+          row[x].g = clip(gx[3 * x + 1] + gy[3 * y + 1]);
+          row[x].r = clip(gx[3 * x + 2] + gy[3 * y + 2]);
+        }
+    }
+  // Flat rectangles with sharp edges
+  for (int n=0; n<6; n++)
+    {
+      GRect rect(rng.uniform(width), rng.uniform(height),
+                 1 + rng.uniform(width / 4 + 1), 1 + rng.uniform(height / 4 + 1));
+      rect.intersect(rect, GRect(0, 0, width, height));
+      GPixel color;
+      color.b = rng.uniform(256);
+      color.g = rng.uniform(256);
+      color.r = rng.uniform(256);
+      for (int y=rect.ymin_; y<rect.ymax_; y++)
+        for (int x=rect.xmin_; x<rect.xmax_; x++)
+          pm[y][x] = color;
+    }
+  // Shaded blobs
+  for (int n=0; n<12; n++)
+    {
+      int cx = rng.uniform(width);
+      int cy = rng.uniform(height);
+      int r = width / 20 + rng.uniform(width / 6 + 1);
+      int cb = rng.uniform(256);
+      int cg = rng.uniform(256);
+      int cr = rng.uniform(256);
+      for (int y=cy-r; y<=cy+r; y++)
+        {
+          if (y < 0 || y >= height)
+            continue;
+          GPixel *row = pm[y];
+          for (int x=cx-r; x<=cx+r; x++)
+            {
+              int d = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+              if (x < 0 || x >= width || d >= r * r)
+                continue;
+              int a = 256 - (int)((256.0 * d) / (r * r));
+              row[x].b += ((cb - row[x].b) * a) >> 8;
+              row[x].g += ((cg - row[x].g) * a) >> 8;
+              row[x].r += ((cr - row[x].r) * a) >> 8;
+            }
+        }
+    }
+  // Sensor noise
+  for (int y=0; y<height; y++)
+    {
+      GPixel *row = pm[y];
+      for (int x=0; x<width; x++)
+        {
+          unsigned int bits = rng.next();
+          row[x].b = clip(row[x].b + (int)(bits & 15) - 8);
+          row[x].g = clip(row[x].g + (int)((bits >> 4) & 15) - 8);
+          row[x].r = clip(row[x].r + (int)((bits >> 8) & 15) - 8);
+        }
+    }
+  return gpm;
+}
+
+
+// ----------------------------------------
+// DJVU PAGES
+
+static void
+put_info(IFFByteStream &iff, int width, int height, int dpi)
+{
+  GP<DjVuInfo> ginfo = DjVuInfo::create();
+  ginfo->width = width;
+  ginfo->height = height;
+  ginfo->dpi = dpi;
+  ginfo->gamma = 2.2;
+  iff.put_chunk("INFO");
+  ginfo->encode(*iff.get_bytestream());
+  iff.close_chunk();
+}
+
+static void
+put_iw44(IFFByteStream &iff, const char *id, const GPixmap &pm,
+         const int *slices, int nchunks)
+{
+  GP<IW44Image> iw = IW44Image::create_encode(pm);
+  int flag = 1;
+  for (int i=0; flag && i<nchunks; i++)
+    {
+      IWEncoderParms parms;
+      parms.slices = slices[i];
+      iff.put_chunk(id);
+      flag = iw->encode_chunk(iff.get_bytestream(), parms);
+      iff.close_chunk();
+    }
+}
+
+GP<ByteStream>
+make_page(PageKind kind, int dpi, int seed)
+{
+  static const int bgslices[] = { 74, 89, 99 };
+  static const int fgslices[] = { 100 };
+  int width, height;
+  page_size(dpi, width, height);
+  GP<ByteStream> gbs = ByteStream::create();
+  GP<IFFByteStream> giff = IFFByteStream::create(gbs);
+  IFFByteStream &iff = *giff;
+  iff.put_chunk("FORM:DJVU", 1);
+  put_info(iff, width, height, dpi);
+  if (kind == TEXT || kind == COMPOUND)
+    {
+      GP<JB2Image> jimg = make_text(width, height, dpi, seed);
+      iff.put_chunk("Sjbz");
+      jimg->encode(iff.get_bytestream());
+      iff.close_chunk();
+    }
+  if (kind == FAX)
+    {
+      GP<JB2Image> jimg = make_text(width, height, dpi, seed);
+      GP<ByteStream> smmr = make_smmr(*jimg->get_bitmap());
+      iff.put_chunk("Smmr");
+      iff.get_bytestream()->copy(*smmr);
+      iff.close_chunk();
+    }
+  if (kind == PHOTO)
+    {
+      GP<GPixmap> pm = make_photo(width, height, seed);
+      put_iw44(iff, "BG44", *pm, bgslices, 3);
+    }
+  if (kind == COMPOUND)
+    {
+      // Foreground colors: black text with coloured headings
+      int fw = (width + 11) / 12;
+      int fh = (height + 11) / 12;
+      GP<GPixmap> fg = GPixmap::create(fh, fw, &GPixel::BLACK);
+      Random rng(seed);
+      for (int n=0; n<6; n++)
+        {
+          GPixel color;
+          color.b = rng.uniform(256);
+          color.g = rng.uniform(128);
+          color.r = rng.uniform(256);
+          int y = rng.uniform(fh);
+          for (int j=y; j<y+3 && j<fh; j++)
+            for (int i=0; i<fw; i++)
+              (*fg)[j][i] = color;
+        }
+      put_iw44(iff, "FG44", *fg, fgslices, 1);
+      // Background: a photo in the upper part of a white page
+      int bw = (width + 2) / 3;
+      int bh = (height + 2) / 3;
+      GP<GPixmap> bg = make_photo(bw, bh, seed);
+      GRect photo(bw / 10, bh / 2, bw * 8 / 10, bh * 4 / 10);
+      for (int y=0; y<bh; y++)
+        for (int x=0; x<bw; x++)
+          if (! photo.contains(x, y))
+            (*bg)[y][x] = GPixel::WHITE;
+      put_iw44(iff, "BG44", *bg, bgslices, 3);
+    }
+  iff.close_chunk();
+  gbs->seek(0);
+  return gbs;
+}
+
+
+// ----------------------------------------
+// SMMR CHUNKS
+
+GP<ByteStream>
+make_smmr(const GBitmap &bm, int rowsperstrip)
+{
+  GP<ByteStream> gbs = ByteStream::create();
+  MMREncoder::encode_chunk(bm, gbs, rowsperstrip);
+  gbs->seek(0);
+  return gbs;
+}
@@ -0,0 +1,114 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C-
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free,
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU
+//C- | General Public License.   This grant only confers the right to
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to
+//C- | the extent such infringement is reasonably necessary to enable
+//C- | recipient to make, have made, practice, sell, or otherwise dispose
+//C- | of the LIZARDTECH ORIGINAL CODE, and not to infringe any patent
+//C- | claims of any other party.   In no event shall this grant
+//C- | constitute the rights to relicense this code or any part of it.
+//C- | See the GNU General Public License, Version 2, for more details.
+//C- +------------------------------------------------------------------
+
+
+#ifndef _CORPUS_H
+#define _CORPUS_H
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+/* Synthetic test images for the benchmarks.
+
+   All images are generated from a seed with a private random number
+   generator, so that the same corpus is produced on every platform.
+   Page sizes correspond to a US letter page at the requested
+   resolution.  Text pages contain lines of words made of random
+   glyphs.  Photo pages contain smooth gradients, blobs and noise.
+   Compound pages contain text over a photo background with
+   coloured headings.  Fax pages contain the text layer coded
+   with MMR (CCITT G4) instead of JB2. */
+
+#include "GString.h"
+#include "GBitmap.h"
+#include "GPixmap.h"
+#include "JB2Image.h"
+#include "ByteStream.h"
+
+class Random
+{
+public:
+  Random(unsigned int seed) : state(seed * 2654435761u + 1) {}
+  // Returns 31 random bits
+  unsigned int next(void)
+    { state = state * 1103515245u + 12345u; return (state >> 1); }
+  // Returns a random integer in range [0, n)
+  int uniform(int n)
+    { return (int)((next() >> 7) % (unsigned int)n); }
+private:
+  unsigned int state;
+};
+
+enum PageKind { TEXT, PHOTO, COMPOUND, FAX };
+
+// Name of a page kind
+extern const char *page_kind_name(PageKind kind);
+
+// Size of a US letter page at resolution dpi
+extern void page_size(int dpi, int &width, int &height);
+
+// Text layer: lines of words made of random glyphs
+extern GP<JB2Image> make_text(int width, int height, int dpi, int seed);
+
+// Photo: smooth gradients, blobs and noise
+extern GP<GPixmap> make_photo(int width, int height, int seed);
+
+// Pseudo english text of the given size
+extern GUTF8String make_words(int size, int seed);
+
+// Encodes a complete DjVu page into a memory stream
+extern GP<ByteStream> make_page(PageKind kind, int dpi, int seed);
+
+// Encodes a bitmap as the contents of a Smmr chunk,
+// using stripes when rowsperstrip is positive
+extern GP<ByteStream> make_smmr(const GBitmap &bm, int rowsperstrip = 0);
+
+#endif
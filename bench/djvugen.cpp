@@ -0,0 +1,154 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C-
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free,
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU
+//C- | General Public License.   This grant only confers the right to
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to
+//C- | the extent such infringement is reasonably necessary to enable
+//C- | recipient to make, have made, practice, sell, or otherwise dispose
+//C- | of the LIZARDTECH ORIGINAL CODE, and not to infringe any patent
+//C- | claims of any other party.   In no event shall this grant
+//C- | constitute the rights to relicense this code or any part of it.
+//C- | See the GNU General Public License, Version 2, for more details.
+//C- +------------------------------------------------------------------
+
+
+/* Generates the synthetic benchmark corpus.
+
+   Usage: djvugen [-seed=<n>] [-dpi=<dpi>,...] <directory>
+
+   Writes into <directory> one DjVu page of each kind (text, photo,
+   compound and fax) for each resolution, named <kind>-<dpi>.djvu, the
+   source images text-<dpi>.pbm and photo-<dpi>.ppm, and a bundled
+   document corpus.djvu containing all the pages.  The same seed
+   always produces the same files.  The default resolutions are 150,
+   300 and 600 dpi. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "corpus.h"
+#include "GURL.h"
+#include "GOS.h"
+#include "DjVmDoc.h"
+#include "DjVuMessage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int
+usage(void)
+{
+  fprintf(stderr,
+          "Usage: djvugen [-seed=<n>] [-dpi=<dpi>,...] <directory>\n");
+  return 10;
+}
+
+static GP<ByteStream>
+create_file(const GURL &dir, const GUTF8String &name)
+{
+  return ByteStream::create(GURL::UTF8(name, dir), "wb");
+}
+
+int
+main(int argc, char **argv)
+{
+  int seed = 1;
+  GUTF8String dpis = "150,300,600";
+  GUTF8String dirname;
+  for (int i=1; i<argc; i++)
+    {
+      if (!strncmp(argv[i], "-seed=", 6))
+        seed = atoi(argv[i] + 6);
+      else if (!strncmp(argv[i], "-dpi=", 5))
+        dpis = argv[i] + 5;
+      else if (argv[i][0] == '-' || dirname.length())
+        return usage();
+      else
+        dirname = argv[i];
+    }
+  if (! dirname)
+    return usage();
+  G_TRY
+    {
+      GURL dir = GURL::Filename::UTF8(dirname);
+      if (! dir.is_dir())
+        dir.mkdir();
+      GP<DjVmDoc> doc = DjVmDoc::create();
+      const char *s = dpis;
+      while (*s)
+        {
+          int dpi = atoi(s);
+          if (dpi < 25 || dpi > 1200)
+            G_THROW("Resolution must be between 25 and 1200 dpi");
+          // Source images
+          int width, height;
+          page_size(dpi, width, height);
+          GUTF8String suffix = GUTF8String("-") + GUTF8String(dpi);
+          make_text(width, height, dpi, seed)->get_bitmap()
+            ->save_pbm(*create_file(dir, "text" + suffix + ".pbm"));
+          make_photo(width, height, seed)
+            ->save_ppm(*create_file(dir, "photo" + suffix + ".ppm"));
+          // DjVu pages
+          for (int k=TEXT; k<=FAX; k++)
+            {
+              GUTF8String name = page_kind_name((PageKind)k) + suffix + ".djvu";
+              GP<ByteStream> page = make_page((PageKind)k, dpi, seed);
+              create_file(dir, name)->copy(*page);
+              page->seek(0);
+              doc->insert_file(*page, DjVmDir::File::PAGE, name, name);
+            }
+          while (*s && *s != ',')
+            s++;
+          if (*s)
+            s++;
+        }
+      doc->write(create_file(dir, "corpus.djvu"));
+    }
+  G_CATCH(ex)
+    {
+      ex.perror();
+      return 10;
+    }
+  G_ENDCATCH;
+  return 0;
+}
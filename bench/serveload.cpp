@@ -0,0 +1,358 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C-
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free,
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU
+//C- | General Public License.   This grant only confers the right to
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to
+//C- | the extent such infringement is reasonably necessary to enable
+//C- | recipient to make, have made, practice, sell, or otherwise dispose
+//C- | of the LIZARDTECH ORIGINAL CODE, and not to infringe any patent
+//C- | claims of any other party.   In no event shall this grant
+//C- | constitute the rights to relicense this code or any part of it.
+//C- | See the GNU General Public License, Version 2, for more details.
+//C- +------------------------------------------------------------------
+
+/* Load test for the standalone mode of djvuserve.
+
+   Usage: serveload [-c <connections>] [-n <requests>] [-r] [-close]
+                    [<host>:]<port> <path>...
+
+   Sends <requests> GET requests for the given paths, in turn, over
+   <connections> concurrent connections.  Connections are kept alive
+   unless option -close is given.  Option -r requests random 4KB byte
+   ranges.  Prints the throughput and the latency distribution. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "GString.h"
+#include "GContainer.h"
+#include "Arrays.h"
+#include "DjVuMessage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+static double
+now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+struct Client
+{
+  int fd;
+  bool sent;
+  double start;
+  long size;            // file size from Content-Range, for -r
+  GUTF8String request;
+  int reqpos;
+  char head[8192];
+  int headlen;
+  long body;            // bytes of body still expected, -1 while in header
+  bool keepalive;
+};
+
+static struct addrinfo *address;
+static bool keepalive = true;
+static bool ranges = false;
+static GList<GUTF8String> paths;
+static GPosition nextpath;
+
+static int
+usage(void)
+{
+  fprintf(stderr,
+          "Usage: serveload [-c <connections>] [-n <requests>] [-r] [-close]\n"
+          "                 [<host>:]<port> <path>...\n");
+  return 10;
+}
+
+static void
+connect_client(Client &c)
+{
+  c.fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+  if (c.fd < 0)
+    G_THROW(strerror(errno));
+  int one = 1;
+  setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  if (connect(c.fd, address->ai_addr, address->ai_addrlen) < 0)
+    G_THROW(strerror(errno));
+  fcntl(c.fd, F_SETFL, fcntl(c.fd, F_GETFL) | O_NONBLOCK);
+}
+
+static void
+start_request(Client &c)
+{
+  if (! nextpath)
+    nextpath = paths;
+  c.request = "GET " + paths[nextpath] + " HTTP/1.1\r\nHost: localhost\r\n";
+  ++nextpath;
+  if (ranges && c.size > 4096)
+    {
+      long first = (long)(rand() % (c.size - 4096));
+      c.request += GUTF8String("Range: bytes=") + GUTF8String((int)first)
+        + "-" + GUTF8String((int)(first + 4095)) + "\r\n";
+    }
+  else if (ranges)
+    c.request += "Range: bytes=0-4095\r\n";
+  if (! keepalive)
+    c.request += "Connection: close\r\n";
+  c.request += "\r\n";
+  c.reqpos = 0;
+  c.sent = false;
+  c.headlen = 0;
+  c.body = -1;
+  c.start = now();
+}
+
+// Parses the response header. Returns the status code.
+static int
+parse_header(Client &c)
+{
+  c.head[c.headlen] = 0;
+  int status = 0;
+  sscanf(c.head, "HTTP/%*d.%*d %d", &status);
+  c.body = 0;
+  c.keepalive = keepalive;
+  for (char *line = strchr(c.head, '\n'); line; line = strchr(line, '\n'))
+    {
+      line += 1;
+      if (! strncasecmp(line, "Content-Length:", 15))
+        c.body = atol(line + 15);
+      else if (! strncasecmp(line, "Content-Range:", 14))
+        {
+          const char *s = strchr(line, '/');
+          if (s)
+            c.size = atol(s + 1);
+        }
+      else if (! strncasecmp(line, "Connection: close", 17))
+        c.keepalive = false;
+    }
+  return status;
+}
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  int nclients = 16;
+  int nrequests = 10000;
+  GUTF8String server;
+  for (int i=1; i<argc; i++)
+    {
+      if (!strcmp(argv[i], "-c") && i+1 < argc)
+        nclients = atoi(argv[++i]);
+      else if (!strcmp(argv[i], "-n") && i+1 < argc)
+        nrequests = atoi(argv[++i]);
+      else if (!strcmp(argv[i], "-r"))
+        ranges = true;
+      else if (!strcmp(argv[i], "-close"))
+        keepalive = false;
+      else if (argv[i][0] == '-')
+        return usage();
+      else if (! server)
+        server = argv[i];
+      else
+        paths.append(argv[i]);
+    }
+  if (!server || paths.isempty() || nclients < 1 || nrequests < 1)
+    return usage();
+  if (nclients > nrequests)
+    nclients = nrequests;
+  G_TRY
+    {
+      // Resolve the server address
+      GUTF8String host = "127.0.0.1";
+      GUTF8String port = server;
+      int colon = server.rsearch(':');
+      if (colon >= 0)
+        {
+          host = server.substr(0, colon);
+          port = server.substr(colon + 1, -1);
+        }
+      struct addrinfo hints;
+      memset(&hints, 0, sizeof(hints));
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      int err = getaddrinfo(host, port, &hints, &address);
+      if (err)
+        G_THROW(gai_strerror(err));
+      signal(SIGPIPE, SIG_IGN);
+      // Run
+      TArray<double> latency(0, nrequests - 1);
+      GArray<Client> clients(0, nclients - 1);
+      TArray<struct pollfd> fds(0, nclients - 1);
+      int started = 0;
+      int done = 0;
+      int errors = 0;
+      int connects = 0;
+      double bytes = 0;
+      char buffer[65536];
+      nextpath = paths;
+      double t0 = now();
+      for (int i=0; i<nclients; i++)
+        {
+          clients[i].size = 0;
+          connect_client(clients[i]);
+          connects += 1;
+          start_request(clients[i]);
+          started += 1;
+        }
+      while (done < nrequests)
+        {
+          for (int i=0; i<nclients; i++)
+            {
+              fds[i].fd = clients[i].fd;
+              fds[i].events = (clients[i].sent) ? POLLIN : POLLOUT;
+              fds[i].revents = 0;
+            }
+          if (poll(&fds[0], nclients, 10000) <= 0)
+            G_THROW("Timeout while waiting for the server");
+          for (int i=0; i<nclients; i++)
+            {
+              Client &c = clients[i];
+              if (c.fd < 0 || !fds[i].revents)
+                continue;
+              if (! c.sent)
+                {
+                  ssize_t n = send(c.fd, (const char*)c.request + c.reqpos,
+                                   c.request.length() - c.reqpos, 0);
+                  if (n > 0 && (c.reqpos += n) >= (int)c.request.length())
+                    c.sent = true;
+                  continue;
+                }
+              ssize_t n = recv(c.fd, buffer, sizeof(buffer), 0);
+              if (n <= 0)
+                {
+                  if (n < 0 && errno == EAGAIN)
+                    continue;
+                  G_THROW("Connection closed by the server");
+                }
+              bytes += n;
+              char *p = buffer;
+              if (c.body < 0)
+                {
+                  // Accumulate the header
+                  int k;
+                  for (k=0; k<n && c.body<0; k++)
+                    {
+                      if (c.headlen >= (int)sizeof(c.head) - 1)
+                        G_THROW("Response header too long");
+                      c.head[c.headlen++] = p[k];
+                      if (c.headlen >= 4 && !memcmp(c.head + c.headlen - 4, "\r\n\r\n", 4))
+                        {
+                          int status = parse_header(c);
+                          if (status != 200 && status != 206)
+                            errors += 1;
+                        }
+                    }
+                  p += k;
+                  n -= k;
+                }
+              if (c.body >= 0)
+                c.body -= n;
+              if (c.body != 0)
+                continue;
+              // Response complete
+              latency[done++] = now() - c.start;
+              if (started >= nrequests)
+                {
+                  close(c.fd);
+                  c.fd = -1;
+                  continue;
+                }
+              if (! c.keepalive)
+                {
+                  close(c.fd);
+                  connect_client(c);
+                  connects += 1;
+                }
+              start_request(c);
+              started += 1;
+            }
+        }
+      double elapsed = now() - t0;
+      freeaddrinfo(address);
+      // Report
+      qsort(&latency[0], nrequests, sizeof(double), compare_doubles);
+      double sum = 0;
+      for (int i=0; i<nrequests; i++)
+        sum += latency[i];
+      printf("requests:    %d (%d errors) over %d connections\n",
+             nrequests, errors, connects);
+      printf("elapsed:     %.3f s\n", elapsed);
+      printf("throughput:  %.1f requests/s, %.2f MB/s\n",
+             nrequests / elapsed, bytes / elapsed / 1e6);
+      printf("latency:     mean %.3f ms, median %.3f ms, 99%% %.3f ms, max %.3f ms\n",
+             sum / nrequests * 1e3, latency[nrequests / 2] * 1e3,
+             latency[(nrequests * 99) / 100] * 1e3, latency[nrequests - 1] * 1e3);
+      return (errors) ? 1 : 0;
+    }
+  G_CATCH(ex)
+    {
+      ex.perror();
+      return 10;
+    }
+  G_ENDCATCH;
+  return 0;
+}
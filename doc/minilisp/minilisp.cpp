@@ -944,7 +944,7 @@ private:
   static void start(void *arg) {
     thread_t *pth = (thread_t*) arg;
     try { 
-      pth->res = evaluate(pth->exp, pth->env); 
+      miniexp_mutate(0, &pth->res, evaluate(pth->exp, pth->env)); 
       pth->run = miniexp_symbol("finished");
     } catch(...) { 
       pth->run = miniexp_symbol("error");
@@ -990,7 +990,7 @@ private:
   static void* start(void *arg) {
     thread_t *pth = (thread_t*) arg;
     try { 
-      pth->res = evaluate(pth->exp, pth->env); 
+      miniexp_mutate(0, &pth->res, evaluate(pth->exp, pth->env)); 
       pth->run = miniexp_symbol("finished");
       return 0; } 
     catch(...) { 
@@ -65,6 +65,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "BSByteStream.h"
+#include "DjVuProfile.h"
 #undef BSORT_TIMER
 #ifdef BSORT_TIMER
 #include "GOS.h"
@@ -168,6 +169,7 @@ decode_binary(ZPCodec &zp, BitContext *ctx, int bits)
 unsigned int
 BSByteStream::Decode::decode(void)
 {
+  DjVuProfile::Timer timer(DjVuProfile::BZZ_DECODE);
   /////////////////////////////////
   ////////////  Decode input stream
   
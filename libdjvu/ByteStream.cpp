@@ -71,6 +71,7 @@
 #include "GOS.h"
 #include "GURL.h"
 #include "DjVuMessage.h"
+#include "GThreads.h"
 #include <stddef.h>
 #include <fcntl.h>
 #if defined(_WIN32) || defined(__CYGWIN32__)
@@ -84,6 +85,14 @@
 # ifndef HAS_MEMMAP
 #  define HAS_MEMMAP 1
 # endif
+# ifndef HAS_PREAD
+#  define HAS_PREAD 1
+# endif
+# ifndef HAS_PREADV
+#  if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#   define HAS_PREADV 1
+#  endif
+# endif
 #endif
 
 #ifdef UNIX
@@ -94,6 +103,9 @@
 # ifdef HAS_MEMMAP
 #  include <sys/mman.h>
 # endif
+# ifdef HAS_PREADV
+#  include <sys/uio.h>
+# endif
 #endif
 
 #ifdef macintosh
@@ -198,6 +210,7 @@ public:
   virtual size_t write(const void *buffer, size_t size);
   virtual int    seek(long offset, int whence=SEEK_SET, bool nothrow=false);
   virtual long   tell(void) const;
+  virtual size_t readview(const void *&ptr, size_t size);
   /** Erases everything in the Memory.
       The current location is reset to zero. */
   void empty();
@@ -272,6 +285,8 @@ public:
   virtual size_t read(void *buffer, size_t sz);
   virtual int    seek(long offset, int whence = SEEK_SET, bool nothrow=false);
   virtual long tell(void) const;
+  virtual size_t readview(const void *&ptr, size_t sz);
+  virtual size_t readat(void *buffer, size_t sz, long pos);
   /** Returns the total number of bytes contained in the buffer, file, etc.
       Valid offsets for function #seek# range from 0 to the value returned
       by this function. */
@@ -308,6 +323,53 @@ private:
 };
 #endif
 
+#if HAS_PREAD
+/** ByteStream interface to a file using positional I/O.
+    Class #PreadByteStream# reads and writes with #pread# and #pwrite#
+    at a position kept by the object itself.  Function #readat# does not
+    use this position and may be called from several threads at the same
+    time. */
+
+class PreadByteStream : public ByteStream
+{
+public:
+  PreadByteStream(void);
+  virtual ~PreadByteStream();
+  virtual size_t read(void *buffer, size_t size);
+  virtual size_t write(const void *buffer, size_t size);
+  virtual int seek(long offset, int whence = SEEK_SET, bool nothrow=false);
+  virtual long tell(void) const;
+  virtual long size(void) const;
+  virtual size_t readat(void *buffer, size_t sz, long pos);
+#if HAS_PREADV
+  virtual size_t readatv(void * const *buffers, const size_t *sizes, 
+                         int n, long pos);
+#endif
+private:
+  GUTF8String init(const GURL &url, const char * const mode);
+  int fd;
+  bool can_read;
+  bool can_write;
+  long where;
+  friend class ByteStream;
+};
+#endif
+
+/** ByteStream serializing calls to function #readat#.
+    Class #LockedByteStream# wraps a ByteStream without positional I/O so
+    that function #readat# may be called from several threads. */
+
+class LockedByteStream : public ByteStream::Wrapper
+{
+public:
+  LockedByteStream(const GP<ByteStream> &bs) : ByteStream::Wrapper(bs) {}
+  virtual size_t readat(void *buffer, size_t sz, long pos);
+  virtual size_t readatv(void * const *buffers, const size_t *sizes, 
+                         int n, long pos);
+private:
+  GCriticalSection lock;
+};
+
 //// CLASS BYTESTREAM
 
 
@@ -475,12 +537,44 @@ ByteStream::writall(const void *buffer, size_t size)
   return total;
 }
 
+size_t
+ByteStream::readatv(void * const *buffers, const size_t *sizes, 
+                    int n, long pos)
+{
+  size_t total = 0;
+  for (int i=0; i<n; i++)
+    {
+      const size_t sz = readat(buffers[i], sizes[i], pos + total);
+      total += sz;
+      if (sz < sizes[i])
+        break;
+    }
+  return total;
+}
+
 size_t 
 ByteStream::copy(ByteStream &bsfrom, size_t size)
 {
   size_t total = 0;
   const size_t max_buffer_size=200*1024;
   const size_t buffer_size=(size>0 && size<max_buffer_size)?size:max_buffer_size;
+  // Copy directly from the source buffers when possible
+  for(;;)
+    {
+      size_t bytes = buffer_size;
+      if (size>0 && bytes+total>size)
+        bytes = size - total;
+      if (bytes == 0)
+        return total;
+      const void *ptr;
+      bytes = bsfrom.readview(ptr, bytes);
+      if (! ptr)
+        break;
+      if (bytes == 0)
+        return total;
+      writall(ptr, bytes);
+      total += bytes;
+    }
   char *buffer;
   GPBuffer<char> gbuf(buffer,buffer_size);
   for(;;)
@@ -948,6 +1042,25 @@ ByteStream::Memory::read(void *buffer, size_t sz)
   return sz;
 }
 
+size_t 
+ByteStream::Memory::readview(const void *&ptr, size_t sz)
+{
+  // Views do not extend beyond the current block
+  long nsz = (where|0xfff) + 1 - where;
+  if (nsz > (long)sz)
+    nsz = (long)sz;
+  if (nsz > bsize - where)
+    nsz = bsize - where;
+  if (nsz <= 0)
+    {
+      ptr = (const void*)"";
+      return 0;
+    }
+  ptr = (const void*)&blocks[where>>12][where&0xfff];
+  where += nsz;
+  return nsz;
+}
+
 long 
 ByteStream::Memory::tell(void) const
 {
@@ -1008,6 +1121,31 @@ ByteStream::Static::read(void *buffer, size_t sz)
   return nsz;
 }
 
+size_t 
+ByteStream::Static::readat(void *buffer, size_t sz, long pos)
+{
+  long nsz = (long)sz;
+  if (nsz > bsize - pos)
+    nsz = bsize - pos;
+  if (nsz <= 0)
+    return 0;
+  memcpy(buffer, data+pos, nsz);
+  return nsz;
+}
+
+size_t 
+ByteStream::Static::readview(const void *&ptr, size_t sz)
+{
+  long nsz = (long)sz;
+  if (nsz > bsize - where)
+    nsz = bsize - where;
+  if (nsz < 0)
+    nsz = 0;
+  ptr = data+where;
+  where += nsz;
+  return nsz;
+}
+
 int
 ByteStream::Static::seek(long offset, int whence, bool nothrow)
 {
@@ -1210,12 +1348,224 @@ ByteStream::create(FILE * const f,char const * const mode,const bool closeme)
   return retval;
 }
 
+GP<ByteStream>
+ByteStream::create_positional(const GURL &url, char const * const xmode)
+{
+  const char *mode = ((xmode) ? xmode : "rb");
+#if HAS_PREAD
+  if (url.fname() != "-")
+    {
+      PreadByteStream *pbs = new PreadByteStream();
+      GP<ByteStream> retval = pbs;
+      GUTF8String errmessage = pbs->init(url, mode);
+      if (errmessage.length())
+        G_THROW(errmessage);
+      return retval;
+    }
+#endif
+  return new LockedByteStream(ByteStream::create(url, mode));
+}
+
 GP<ByteStream>
 ByteStream::create_static(const void * buffer, size_t sz)
 {
   return new Static(buffer, sz);
 }
 
+#if HAS_PREAD
+PreadByteStream::PreadByteStream(void)
+  : fd(-1), can_read(false), can_write(false), where(0)
+{
+}
+
+PreadByteStream::~PreadByteStream()
+{
+  if (fd >= 0)
+    close(fd);
+}
+
+GUTF8String
+PreadByteStream::init(const GURL &url, const char * const mode)
+{
+  GUTF8String retval;
+  int flags = 0;
+  bool plus = !!strchr(mode, '+');
+  switch (mode[0])
+    {
+    case 'r':
+      flags = plus ? O_RDWR : O_RDONLY;
+      break;
+    case 'w':
+      flags = (plus ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC;
+      break;
+    case 'a':
+      flags = (plus ? O_RDWR : O_WRONLY) | O_CREAT;
+      break;
+    default:
+      G_THROW( ERR_MSG("ByteStream.bad_mode") );
+    }
+  can_read = (mode[0] == 'r' || plus);
+  can_write = (mode[0] != 'r' || plus);
+  fd = urlopen(url, flags, 0666);
+  if (fd < 0)
+    //  Failed to open '%s': %s
+    retval = ERR_MSG("ByteStream.open_fail") "\t" + url.name()
+      +"\t"+GNativeString(strerror(errno)).getNative2UTF8();
+  else if (mode[0] == 'a')
+    where = size();
+  return retval;
+}
+
+size_t
+PreadByteStream::readat(void *buffer, size_t sz, long pos)
+{
+  if (!can_read)
+    G_THROW( ERR_MSG("ByteStream.no_read") );
+  size_t total = 0;
+  while (total < sz)
+    {
+      ssize_t n = pread(fd, (char*)buffer+total, sz-total, pos+total);
+      if (n < 0)
+        {
+#ifdef EINTR
+          if (errno == EINTR)
+            continue;
+#endif
+          G_THROW(strerror(errno)); //  (No error in the DjVuMessageFile)
+        }
+      if (n == 0)
+        break;
+      total += n;
+    }
+  return total;
+}
+
+#if HAS_PREADV
+size_t
+PreadByteStream::readatv(void * const *buffers, const size_t *sizes, 
+                         int n, long pos)
+{
+  if (!can_read)
+    G_THROW( ERR_MSG("ByteStream.no_read") );
+  // Submit at most 64 buffers per system call.
+  struct iovec iov[64];
+  size_t total = 0;
+  size_t skip = 0;
+  int i = 0;
+  while (i < n)
+    {
+      int k = 0;
+      for (; k < 64 && i + k < n; k++)
+        {
+          iov[k].iov_base = (char*)buffers[i+k] + (k ? 0 : skip);
+          iov[k].iov_len = sizes[i+k] - (k ? 0 : skip);
+        }
+      ssize_t m = preadv(fd, iov, k, pos + total);
+      if (m < 0)
+        {
+#ifdef EINTR
+          if (errno == EINTR)
+            continue;
+#endif
+          G_THROW(strerror(errno)); //  (No error in the DjVuMessageFile)
+        }
+      if (m == 0)
+        break;
+      total += m;
+      // Skip the buffers filled by this call.
+      size_t left = (size_t)m;
+      while (i < n && left >= sizes[i] - skip)
+        {
+          left -= sizes[i] - skip;
+          skip = 0;
+          i++;
+        }
+      skip += left;
+    }
+  return total;
+}
+#endif
+
+size_t
+PreadByteStream::read(void *buffer, size_t sz)
+{
+  sz = readat(buffer, sz, where);
+  where += sz;
+  return sz;
+}
+
+size_t
+PreadByteStream::write(const void *buffer, size_t sz)
+{
+  if (!can_write)
+    G_THROW( ERR_MSG("ByteStream.no_write") );
+  ssize_t n;
+  do
+    n = pwrite(fd, buffer, sz, where);
+#ifdef EINTR
+  while (n < 0 && errno == EINTR);
+#else
+  while (0);
+#endif
+  if (n < 0)
+    G_THROW(strerror(errno)); //  (No error in the DjVuMessageFile)
+  where += n;
+  return n;
+}
+
+int
+PreadByteStream::seek(long offset, int whence, bool nothrow)
+{
+  long nwhere = 0;
+  switch (whence)
+    {
+    case SEEK_SET: nwhere = 0; break;
+    case SEEK_CUR: nwhere = where; break;
+    case SEEK_END: nwhere = size(); break;
+    default: G_THROW("bad_arg\tPreadByteStream::seek()");
+    }
+  nwhere += offset;
+  if (nwhere < 0)
+    {
+      if (nothrow)
+        return -1;
+      G_THROW( ERR_MSG("ByteStream.seek_error2") );
+    }
+  where = nwhere;
+  return 0;
+}
+
+long
+PreadByteStream::tell(void) const
+{
+  return where;
+}
+
+long
+PreadByteStream::size(void) const
+{
+  struct stat statbuf;
+  if (fstat(fd, &statbuf) < 0)
+    return -1;
+  return statbuf.st_size;
+}
+#endif
+
+size_t
+LockedByteStream::readat(void *buffer, size_t sz, long pos)
+{
+  GCriticalSectionLock lk(&lock);
+  return bs->readat(buffer, sz, pos);
+}
+
+size_t
+LockedByteStream::readatv(void * const *buffers, const size_t *sizes, 
+                          int n, long pos)
+{
+  GCriticalSectionLock lk(&lock);
+  return bs->readatv(buffers, sizes, n, pos);
+}
+
 #if HAS_MEMMAP
 MemoryMapByteStream::MemoryMapByteStream(void)
 : ByteStream::Static(0,0)
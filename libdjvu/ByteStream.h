@@ -267,6 +267,22 @@ public:
       bytes at position #pos# into #buffer# and returns the actual number of
       bytes read.  The current position is unchanged. */
   virtual size_t readat(void *buffer, size_t sz, long pos);
+  /** Reads data from a random position into several buffers.  This
+      function fills the #n# buffers #buffers[i]# of #sizes[i]# bytes in
+      sequence with the data located at position #pos#, and returns the
+      total number of bytes read.  The current position is unchanged.
+      File streams using positional I/O do this with a single vectored
+      read (#preadv#) when the system provides it. */
+  virtual size_t readatv(void * const *buffers, const size_t *sizes, 
+                         int n, long pos);
+  /** Reads data without copying.  ByteStreams keeping their data in memory
+      set #ptr# to the data located at the current position, advance the
+      current position by at most #size# bytes, and return the number of
+      bytes available at address #ptr#.  These bytes remain accessible
+      until the next call to a function of this ByteStream.  Other
+      ByteStreams set #ptr# to zero and return zero without changing the
+      current position.  The caller must then use function #read#. */
+  virtual size_t readview(const void *&ptr, size_t size);
   //@}
 protected:
   ByteStream(void) : cp(AUTO) {};
@@ -319,6 +335,13 @@ public:
       access this memory area.  The user must therefore make sure that its
       content remain valid long enough.  */
   static GP<ByteStream> create_static(void const *buffer, size_t size);
+  /** Constructs a ByteStream for random access to the file named #url#.
+      Argument #mode# is similar to the argument of the stdio function
+      #fopen#.  Function #readat# of the returned ByteStream may be called
+      from several threads at the same time.  It uses positional reads
+      (#pread#) on systems providing them and does not need to lock
+      anything.  Other functions must not be called concurrently. */
+  static GP<ByteStream> create_positional(const GURL &url, char const * const mode);
   
   /** Easy access to preallocated stdin/stdout/stderr bytestreams */
   static GP<ByteStream> get_stdin(char const * mode=0);
@@ -344,6 +367,13 @@ ByteStream::readat(void *buffer, size_t sz, long pos)
   return retval;
 }
 
+inline size_t
+ByteStream::readview(const void *&ptr, size_t)
+{
+  ptr = 0;
+  return 0;
+}
+
 inline long
 ByteStream::size(void) const
 {
@@ -382,6 +412,8 @@ public:
     { return bs->seek(offset,whence,nothrow); }
   virtual void flush(void)
     { bs->flush(); }
+  virtual size_t readview(const void *&ptr, size_t size)
+    { return bs->readview(ptr,size); }
 private:
   // Cancel C++ default stuff
   Wrapper(const Wrapper &);
@@ -63,6 +63,7 @@
 #include "GString.h"
 #include "GOS.h"
 #include "GURL.h"
+#include "DjVuProfile.h"
 #include "debug.h"
 
 #ifndef macintosh
@@ -152,7 +153,7 @@ DataPool::OpenFiles_File::OpenFiles_File(const GURL &xurl, GP<DataPool> &pool) :
    DEBUG_MAKE_INDENT(3);
    
    open_time=GOS::ticks();
-   stream=ByteStream::create(url,"rb");
+   stream=ByteStream::create_positional(url,"rb");
    add_pool(pool);
 }
 
@@ -695,6 +696,17 @@ public:
    virtual ~Trigger() {};
 };
 
+// Memory copy of the data of a DataPool made by DataPool::prefetch()
+class DataPool::Cache : public GPEnabled
+{
+public:
+   Cache(int xsize) : size(xsize), data(0), gdata(data, xsize) {};
+   const int	size;
+   char		*data;
+private:
+   GPBuffer<char> gdata;
+};
+
 class DataPool::Counter
 {
 private:
@@ -1102,6 +1114,46 @@ public:
    ~Incrementor() {counter.dec();}
 };
 
+int
+DataPool::get_view(const void *&ptr, int offset, int sz)
+{
+   ptr = 0;
+   if (stop_flag || offset < 0 || sz <= 0)
+     return 0;
+   GP<Cache> cache;
+   {
+     GCriticalSectionLock lock(&cache_lock);
+     cache=this->cache;
+   }
+   if (cache)
+     {
+       // The cache is never replaced and lives as long as this DataPool
+       if (offset+sz>cache->size)
+         sz=cache->size-offset;
+       if (sz <= 0)
+         return 0;
+       ptr = cache->data+offset;
+       return sz;
+     }
+   GP<DataPool> pool = this->pool;
+   if (pool)
+     {
+       if (length>0 && offset+sz>length)
+         sz=length-offset;
+       if (sz <= 0)
+         return 0;
+       return pool->get_view(ptr, start+offset, sz);
+     }
+   if (furl.is_local_file_url())
+     return 0;
+   const int size=block_list->get_range(offset, sz);
+   if (size <= 0)
+     return 0;
+   GCriticalSectionLock lock(&data_lock);
+   data->seek(offset, SEEK_SET);
+   return data->readview(ptr, size);
+}
+
 int
 DataPool::get_data(void * buffer, int offset, int sz, int level)
 {
@@ -1121,6 +1173,22 @@ DataPool::get_data(void * buffer, int offset, int sz, int level)
    if (! sz)
      return 0;
 
+   GP<Cache> cache;
+   {
+     GCriticalSectionLock lock(&cache_lock);
+     cache=this->cache;
+   }
+   if (cache)
+     {
+       DEBUG_MSG("DataPool::get_data(): from prefetched data\n");
+       if (offset+sz>cache->size)
+         sz=cache->size-offset;
+       if (sz<=0)
+         return 0;
+       memcpy(buffer, cache->data+offset, sz);
+       return sz;
+     }
+
    GP<DataPool> pool = this->pool;
    if (pool)
      {
@@ -1177,9 +1245,8 @@ DataPool::get_data(void * buffer, int offset, int sz, int level)
                fstream=f=OpenFiles::get()->request_stream(furl, this);
              }
          }
-       GCriticalSectionLock lock2(&(f->stream_lock));
-       f->stream->seek(start+offset, SEEK_SET); 
-       return f->stream->readall(buffer, sz);
+       // Positional reads let several threads share the stream
+       return f->stream->readat(buffer, sz, start+offset);
      } 
    else
      {
@@ -1280,6 +1347,7 @@ DataPool::wait_for_data(const GP<Reader> & reader)
         G_THROW( DataPool::Stop );
 
       DEBUG_MSG("calling event.wait()...\n");
+      DjVuProfile::Timer timer(DjVuProfile::DATA_WAIT);
       reader->event.wait();
    }
    
@@ -1398,13 +1466,17 @@ DataPool::load_file(void)
          FCPools::get()->del_pool(furl, this);
          furl=GURL();
 
-         const GP<ByteStream> gbs = f->stream;
-         gbs->seek(0, SEEK_SET);
-         
-         char buffer[1024];
+         // Read large blocks to keep the number of system calls low
+         const int buffer_size=65536;
+         char *buffer;
+         GPBuffer<char> gbuffer(buffer,buffer_size);
+         long pos=0;
          int length;
-         while((length = f->stream->read(buffer, 1024)))
+         while((length = f->stream->readat(buffer, buffer_size, pos)))
+         {
            add_data(buffer, length);
+           pos+=length;
+         }
          set_eof();
          
          OpenFiles::get()->stream_released(f->stream, this);
@@ -1419,6 +1491,119 @@ DataPool::load_file(const GURL &url )
    FCPools::get()->load_file(url);
 }
 
+// Location of the data of a DataPool in a file
+struct DataPool_Range
+{
+   GP<DataPool>	pool;
+   GP<DataPool>	file;
+   int		pos;
+   int		size;
+};
+
+void
+DataPool::prefetch(const GPList<DataPool> &pools)
+{
+   DEBUG_MSG("DataPool::prefetch() called\n");
+   DEBUG_MAKE_INDENT(3);
+
+      // Find where the data of each pool is located, and sort
+      // the ranges by file and position.
+   GList<DataPool_Range> ranges;
+   for(GPosition pos=pools;pos;++pos)
+   {
+      DataPool_Range r;
+      r.pool=pools[pos];
+      r.file=r.pool;
+      r.pos=0;
+      r.size=r.pool->get_length();
+      bool cached=false;
+      for(;;)
+      {
+         {
+            GCriticalSectionLock lock(&r.file->cache_lock);
+            cached=(r.file->cache!=0);
+         }
+         if (cached || !r.file->pool)
+            break;
+         r.pos+=r.file->start;
+         r.file=r.file->pool;
+         const int flength=r.file->get_length();
+         if (flength>=0 && r.pos+r.size>flength)
+            r.size=flength-r.pos;
+      }
+      if (cached || !r.file->furl.is_local_file_url() || r.size<=0)
+         continue;
+      r.pos+=r.file->start;
+      GPosition rpos=ranges;
+      for(;rpos;++rpos)
+      {
+         const DataPool_Range &q=ranges[rpos];
+         if (q.file==r.file ? q.pos>r.pos : (DataPool*)q.file>(DataPool*)r.file)
+            break;
+      }
+      ranges.insert_before(rpos, r);
+   }
+
+      // Read each group of neighboring ranges with a single vectored read.
+      // The small gaps between the ranges are read into a scratch buffer.
+   const int max_gap=4096;
+   char *scratch;
+   GPBuffer<char> gscratch(scratch, max_gap);
+   GPosition rpos=ranges;
+   while (rpos)
+   {
+      const GP<DataPool> file=ranges[rpos].file;
+      const int first=ranges[rpos].pos;
+      int end=first;
+      GTArray<void*> buffers;
+      GTArray<size_t> sizes;
+      GPArray<DataPool> group;
+      GPArray<Cache> caches;
+      int n=0, ncaches=0;
+      for(;rpos;++rpos)
+      {
+         const DataPool_Range &r=ranges[rpos];
+         if (r.file!=file || r.pos<end || r.pos>end+max_gap)
+            break;
+         if (r.pos>end)
+         {
+            buffers.touch(n);
+            sizes.touch(n);
+            buffers[n]=scratch;
+            sizes[n++]=r.pos-end;
+         }
+         group.touch(ncaches);
+         caches.touch(ncaches);
+         GP<Cache> cache=new Cache(r.size);
+         group[ncaches]=r.pool;
+         caches[ncaches++]=cache;
+         buffers.touch(n);
+         sizes.touch(n);
+         buffers[n]=cache->data;
+         sizes[n++]=r.size;
+         end=r.pos+r.size;
+      }
+      DEBUG_MSG("reading " << ncaches << " pools with " << n 
+                << " buffers at " << first << "\n");
+      GP<OpenFiles_File> f=file->fstream;
+      if (!f)
+      {
+         GCriticalSectionLock lock(&file->class_stream_lock);
+         f=file->fstream;
+         if (!f)
+            file->fstream=f=OpenFiles::get()->request_stream(file->furl, file);
+      }
+      if (f->stream->readatv(buffers, sizes, n, first)!=(size_t)(end-first))
+         continue;
+      for(int i=0;i<ncaches;i++)
+      {
+         GCriticalSectionLock lock(&group[i]->cache_lock);
+         if (!group[i]->cache)
+            group[i]->cache=caches[i];
+      }
+   }
+}
+
 void
 DataPool::check_triggers(void)
       // This function is for not connected DataPools only
@@ -1657,6 +1842,7 @@ public:
    virtual size_t write(const void *buffer, size_t size);
    virtual long tell(void) const ;
    virtual int seek(long offset, int whence = SEEK_SET, bool nothrow=false);
+   virtual size_t readview(const void *&ptr, size_t size);
 private:
       // Don't make data_pool GP<>. The problem is that DataPool creates
       // and soon destroys this ByteStream from the constructor. Since
@@ -1709,6 +1895,22 @@ PoolByteStream::read(void *data, size_t size)
   return size;
 }
 
+size_t
+PoolByteStream::readview(const void *&ptr, size_t size)
+{
+  if (buffer_pos < buffer_size) {
+    if (buffer_pos + size >= buffer_size)
+      size = buffer_size - buffer_pos;
+    ptr = buffer + buffer_pos;
+    buffer_pos += size;
+    position += size;
+    return size;
+  }
+  size = data_pool->get_view(ptr, position, size);
+  position += size;
+  return size;
+}
+
 size_t
 PoolByteStream::write(const void *buffer, size_t size)
 {
@@ -224,6 +224,7 @@ public: // Classes used internally by DataPool
    class OpenFiles_File;
    class BlockList;
    class Counter;
+   class Cache;
 protected:
    DataPool(void);
 
@@ -413,6 +414,15 @@ public:
       */
    int		get_data(void * buffer, int offset, int size);
 
+      /** Returns a pointer to the data at offset #offset# without
+	  copying. This function does not wait: it succeeds only when
+	  the data is already kept in memory by this #DataPool# or by its
+	  master. It then sets #ptr# and returns the number of bytes, at
+	  most #size#, available at this address. The data remains valid
+	  as long as the #DataPool# exists. Otherwise #ptr# is set to
+	  #ZERO# and the caller should use \Ref{get_data}(). */
+   int		get_view(const void *&ptr, int offset, int size);
+
       /** Returns a \Ref{ByteStream} to access contents of the #DataPool#
 	  sequentially. By reading from the returned stream you basically
           call \Ref{get_data}() function. Thus, everything said for it
@@ -536,6 +546,15 @@ public:
 	  not affecting the rest of the program. */
    static void	load_file(const GURL &url);
 
+      /** Reads the data of several #DataPool#s into memory at once.
+	  Only #DataPool#s getting their data from a local file, directly
+	  or through their masters, are affected.  Their data ranges are
+	  sorted by file position and the ranges located next to each other
+	  are read with a single vectored read.  Subsequent calls to
+	  \Ref{get_data}() are then served from memory.  This is useful
+	  before decoding several components of a bundled document. */
+   static void	prefetch(const GPList<DataPool> &pools);
+
       /** This function will remove OpenFiles filelist. */
    static void	close_all(void);
 
@@ -562,6 +581,8 @@ private:
    GP<ByteStream>	data;
    GCriticalSection	data_lock;
    BlockList		*block_list;
+   GP<Cache>		cache;
+   GCriticalSection	cache_lock;
    int			add_at;
    int			start, length;
 
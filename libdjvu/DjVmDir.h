@@ -208,8 +208,8 @@ private:
    GCriticalSection class_lock;
    GPList<File>	files_list;
    GPArray<File> page2file;
-   GPMap<GUTF8String, File> name2file;
-   GPMap<GUTF8String, File> id2file;
+   GFlatPMap<GUTF8String, File> name2file;
+   GFlatPMap<GUTF8String, File> id2file;
 private: //dummy stuff
    static void decode(ByteStream *);
    static void encode(ByteStream *);
@@ -60,6 +60,7 @@
 
 #include "DjVuDocEditor.h"
 #include "DjVuImage.h"
+#include "DjVuInfo.h"
 #include "IFFByteStream.h"
 #include "DataPool.h"
 #include "IW44Image.h"
@@ -117,6 +118,7 @@ DjVuDocEditor::check(void)
 DjVuDocEditor::DjVuDocEditor(void)
 {
    initialized=false;
+   incremental=false;
    refresh_cb=0;
    refresh_cl_data=0;
 }
@@ -1671,6 +1673,60 @@ DjVuDocEditor::file_thumbnails(void)
    }
 }
 
+GP<DataPool>
+DjVuDocEditor::make_thumbnail(int thumb_size, int page_num)
+      // Renders and encodes the thumbnail for one page. This function
+      // may be called by several threads at the same time.
+{
+      // Find the page width to decode no more than the thumbnail needs
+   int subsample=1;
+   G_TRY
+   {
+      const GP<DataPool> pool(request_data(this, page_to_url(page_num)));
+      const GP<IFFByteStream> iff(IFFByteStream::create(pool->get_stream()));
+      GUTF8String chkid;
+      if (iff->get_chunk(chkid) && chkid=="FORM:DJVU")
+      {
+         while (iff->get_chunk(chkid) && chkid!="INFO")
+            iff->close_chunk();
+         if (chkid=="INFO")
+         {
+            const GP<DjVuInfo> info(DjVuInfo::create());
+            info->decode(*iff->get_bytestream());
+            const int width=(info->orientation&1) ? info->height : info->width;
+            subsample=width/thumb_size;
+         }
+      }
+   }
+   G_CATCH_ALL
+   {
+      subsample=1;
+   }
+   G_ENDCATCH;
+   const GP<DjVuImage> dimg(get_preview_page(page_num, subsample, true));
+
+   GRect rect(0, 0, thumb_size, dimg->get_height()*thumb_size/dimg->get_width());
+   GP<GPixmap> pm=dimg->get_pixmap(rect, rect, get_thumbnails_gamma());
+   if (!pm)
+     {
+       const GP<GBitmap> bm(dimg->get_bitmap(rect, rect, sizeof(int)));
+       if (bm) 
+         pm = GPixmap::create(*bm);
+       else
+         pm = GPixmap::create(rect.height(), rect.width(), &GPixel::WHITE);
+     }
+   // Store and compress the pixmap
+   const GP<IW44Image> iwpix(IW44Image::create_encode(*pm));
+   const GP<ByteStream> gstr(ByteStream::create());
+   IWEncoderParms parms;
+   parms.slices=97;
+   parms.bytes=0;
+   parms.decibels=0;
+   iwpix->encode_chunk(gstr, parms);
+   gstr->seek(0L);
+   return DataPool::create(gstr);
+}
+
 int
 DjVuDocEditor::generate_thumbnails(int thumb_size, int page_num)
 {
@@ -1681,30 +1737,7 @@ DjVuDocEditor::generate_thumbnails(int thumb_size, int page_num)
    {
       const GUTF8String id(page_to_id(page_num));
       if (!thumb_map.contains(id))
-        {
-          const GP<DjVuImage> dimg(get_page(page_num, true));
-         
-          GRect rect(0, 0, thumb_size, dimg->get_height()*thumb_size/dimg->get_width());
-          GP<GPixmap> pm=dimg->get_pixmap(rect, rect, get_thumbnails_gamma());
-          if (!pm)
-            {
-              const GP<GBitmap> bm(dimg->get_bitmap(rect, rect, sizeof(int)));
-              if (bm) 
-                pm = GPixmap::create(*bm);
-              else
-                pm = GPixmap::create(rect.height(), rect.width(), &GPixel::WHITE);
-            }
-          // Store and compress the pixmap
-          const GP<IW44Image> iwpix(IW44Image::create_encode(*pm));
-          const GP<ByteStream> gstr(ByteStream::create());
-          IWEncoderParms parms;
-          parms.slices=97;
-          parms.bytes=0;
-          parms.decibels=0;
-          iwpix->encode_chunk(gstr, parms);
-          gstr->seek(0L);
-          thumb_map[id]=DataPool::create(gstr);
-        }
+        thumb_map[id]=make_thumbnail(thumb_size, page_num);
       ++page_num;
    }
    else
@@ -1714,17 +1747,99 @@ DjVuDocEditor::generate_thumbnails(int thumb_size, int page_num)
    return page_num;
 }
 
+// Worker threads making thumbnails for a list of pages.  Each worker
+// takes the next page from the list, decodes it and encodes its
+// thumbnail into a memory pool.  The results are collected in the
+// order of the list and do not depend on the number of threads.
+// Workers do not run more than two pages per thread ahead of the
+// collected results in order to bound the memory used by decoded pages.
+
+class DjVuDocEditor::Thumbnailer : public GPEnabled, protected GPipeline
+{
+public:
+  Thumbnailer(DjVuDocEditor &editor, int thumb_size,
+              const GTArray<int> &pages, int nthreads);
+  ~Thumbnailer();
+  GP<DataPool> get(void);
+protected:
+  virtual void work(int k, int worker);
+private:
+  DjVuDocEditor &editor;
+  int thumb_size;
+  const GTArray<int> &pages;
+  GPArray<DataPool> results;
+};
+
+DjVuDocEditor::Thumbnailer::
+Thumbnailer(DjVuDocEditor &editor, int thumb_size,
+            const GTArray<int> &pages, int nthreads)
+  : editor(editor), thumb_size(thumb_size), pages(pages)
+{
+  const int njobs=pages.size();
+  results.resize(0, njobs-1);
+  start((nthreads < njobs) ? nthreads : njobs);
+  add(njobs);
+}
+
+DjVuDocEditor::Thumbnailer::
+~Thumbnailer()
+{
+  stop();
+}
+
+void
+DjVuDocEditor::Thumbnailer::
+work(int k, int)
+{
+  results[k] = editor.make_thumbnail(thumb_size, pages[k]);
+}
+
+GP<DataPool>
+DjVuDocEditor::Thumbnailer::
+get(void)
+{
+  const int k=GPipeline::get();
+  if (k < 0)
+    return 0;
+  GP<DataPool> pool=results[k];
+  results[k]=0;
+  return pool;
+}
+
 void
 DjVuDocEditor::generate_thumbnails(int thumb_size,
                                    bool (* cb)(int page_num, void *),
                                    void * cl_data)
 {
-   int page_num=0;
-   do
-   {
-     page_num=generate_thumbnails(thumb_size,page_num);
-     if (cb && page_num>0) if (cb(page_num-1, cl_data)) return;
-   } while(page_num>=0);
+   DEBUG_MSG("DjVuDocEditor::generate_thumbnails(): all pages\n");
+   DEBUG_MAKE_INDENT(3);
+
+   const int pages_num=djvm_dir->get_pages_num();
+   GTArray<int> pages;
+   int page_num;
+   for(page_num=0;page_num<pages_num;page_num++)
+     if (!thumb_map.contains(page_to_id(page_num)))
+       {
+         pages.touch(pages.size());
+         pages[pages.size()-1]=page_num;
+       }
+   GP<Thumbnailer> thumbnailer;
+   const int nthreads=GThread::ncpus();
+   if (nthreads>1 && pages.size()>1)
+     thumbnailer=new Thumbnailer(*this, thumb_size, pages, nthreads);
+   int k=0;
+   for(page_num=0;page_num<pages_num;page_num++)
+     {
+       if (thumbnailer && k<pages.size() && pages[k]==page_num)
+         {
+           thumb_map[page_to_id(page_num)]=thumbnailer->get();
+           k++;
+         }
+       else
+         generate_thumbnails(thumb_size, page_num);
+       if (cb && cb(page_num, cl_data))
+         return;
+     }
 }
 
 static void
@@ -1773,29 +1888,281 @@ DjVuDocEditor::save_pages_as(
    djvm_doc->write(str);
 }
 
+bool
+DjVuDocEditor::is_file_modified(const GUTF8String &id)
+      // Files, which have never been opened, are not in files_map[].
+      // Their data is still where the document says it is.
+{
+  GCriticalSectionLock lock(&files_lock);
+  const GPosition pos(files_map.contains(id));
+  if (!pos)
+    return false;
+  const GP<File> file_rec(files_map[pos]);
+  return file_rec->pool || (file_rec->file && file_rec->file->is_modified());
+}
+
+static bool
+same_data(const GP<DataPool> &pool, ByteStream &str, int offset)
+      // Compares the DataPool contents with what we have at the offset
+{
+  const GP<ByteStream> gin(pool->get_stream());
+  char buffer1[4096];
+  char buffer2[4096];
+  str.seek(offset, SEEK_SET);
+  int length;
+  while((length=gin->readall(buffer1, sizeof(buffer1))))
+  {
+    if (str.readall(buffer2, length)!=(size_t)length ||
+        memcmp(buffer1, buffer2, length))
+      return false;
+  }
+  return true;
+}
+
 void
-DjVuDocEditor::save_file(const GUTF8String &file_id, const GURL &codebase,
-  const bool only_modified, GMap<GUTF8String,GUTF8String> & map)
+DjVuDocEditor::map_unmodified_files(const GURL &codebase,
+  GMap<GUTF8String,GUTF8String> & map)
+      // Marks files, which do not need to be saved into an INDIRECT
+      // document again. Regenerated thumbnails are compared with
+      // the files on disk, which is cheaper than writing them.
 {
-  if(only_modified)
+  GPList<DjVmDir::File> files_list=djvm_dir->get_files_list();
+  for(GPosition pos=files_list;pos;++pos)
   {
-    for(GPosition pos=files_map;pos;++pos)
+    const GP<DjVmDir::File> file(files_list[pos]);
+    const GUTF8String id(file->get_load_name());
+    if (id != file->get_save_name())
+      continue;
+    GP<DataPool> pool;
+    {
+      GCriticalSectionLock lock(&files_lock);
+      const GPosition fpos(files_map.contains(id));
+      if (fpos && !files_map[fpos]->file)
+        pool=files_map[fpos]->pool;
+    }
+    if (pool)
     {
-      const GP<File> file_rec(files_map[pos]);
-      const bool file_modified=file_rec->pool ||
-        (file_rec->file && file_rec->file->is_modified());
-      if(!file_modified)
+      bool same=false;
+      const GURL url=GURL::UTF8(id, codebase);
+      G_TRY
       {
-        const GUTF8String id=files_map.key(pos);
-        const GUTF8String save_name(djvm_dir->id_to_file(id)->get_save_name());
-        if(id == save_name)
+        if (url.is_file())
         {
-          map[id]=id;
+          const GP<ByteStream> gstr(ByteStream::create(url, "rb"));
+          char magic[4];
+          same=(gstr->size()==pool->get_length()+4 &&
+                gstr->readall(magic, 4)==4 && !memcmp(magic, octets, 4) &&
+                same_data(pool,*gstr,4));
         }
       }
+      G_CATCH_ALL
+      {
+        same=false;
+      }
+      G_ENDCATCH;
+      if (same)
+        map[id]=id;
+    } else if (!is_file_modified(id))
+    {
+      map[id]=id;
+    }
+  }
+}
+
+bool
+DjVuDocEditor::save_in_place(const GP<DjVmDoc> &doc)
+      // Saves a BUNDLED document into the file it has been read from.
+      // Components, which have not changed, stay where they are. The
+      // others are appended at the end of the file. The new directory
+      // is written over the old one at the very end. This last write is
+      // not atomic: if it gets interrupted, the file is left damaged.
+      // Returns FALSE if the file should rather be rewritten completely.
+{
+  DEBUG_MSG("DjVuDocEditor::save_in_place(): url='" << doc_url << "'\n");
+  DEBUG_MAKE_INDENT(3);
+
+  if (!doc_url.is_local_file_url())
+    return false;
+  const GP<ByteStream> gstr(ByteStream::create(doc_url, "r+b"));
+  ByteStream &str=*gstr;
+
+     // Read the directory, which is currently on disk
+  const GP<DjVmDir> odir(DjVmDir::create());
+  {
+    const GP<IFFByteStream> giff(IFFByteStream::create(gstr));
+    IFFByteStream &iff=*giff;
+    GUTF8String chkid;
+    if (!iff.get_chunk(chkid) || chkid!="FORM:DJVM")
+      return false;
+    if (!iff.get_chunk(chkid) || chkid!="DIRM")
+      return false;
+    odir->decode(iff.get_bytestream());
+    if (!odir->is_bundled())
+      return false;
+  }
+  const int old_end=str.size();
+
+     // Find components, which can stay where they are.
+     // The others get a temporary offset at the end of the file.
+  const GP<DjVmDir> dir(doc->get_djvm_dir());
+  const GP<DjVmNav> nav(djvm_nav);
+  GPList<DjVmDir::File> files_list=dir->resolve_duplicates(true);
+  GPList<DjVmDir::File> kept_list;
+  int live=0;
+  for(GPosition pos=files_list;pos;++pos)
+  {
+    const GP<DjVmDir::File> file(files_list[pos]);
+    const GUTF8String id(file->get_load_name());
+    const GP<DataPool> pool(doc->get_data(id));
+    file->size=pool->get_length();
+    if (!file->size)
+      G_THROW( ERR_MSG("DjVmDoc.zero_file") );
+    live+=file->size;
+    file->offset=old_end;
+    const GP<DjVmDir::File> ofile(odir->id_to_file(id));
+    if (ofile && ofile->size==file->size && ofile->offset>0 &&
+        ofile->offset+ofile->size<=old_end &&
+        (!is_file_modified(id) || same_data(pool, str, ofile->offset)))
+    {
+      file->offset=ofile->offset;
+      GPosition kpos=kept_list;
+      for(;kpos;++kpos)
+        if (kept_list[kpos]->offset>file->offset)
+          break;
+      kept_list.insert_before(kpos, file);
+    }
+  }
+
+     // Measure the new DIRM and NAVM chunks. Their size does not
+     // depend on the offsets.
+  int header_size;
+  {
+    const GP<ByteStream> tmp_str(ByteStream::create());
+    const GP<IFFByteStream> gtmp_iff(IFFByteStream::create(tmp_str));
+    IFFByteStream &tmp_iff=*gtmp_iff;
+    tmp_iff.put_chunk("DIRM");
+    dir->encode(tmp_iff.get_bytestream());
+    tmp_iff.close_chunk();
+    if (nav)
+      {
+        tmp_iff.put_chunk("NAVM");
+        nav->encode(tmp_iff.get_bytestream());
+        tmp_iff.close_chunk();
+      }
+    header_size=(tmp_iff.tell()+1) & ~1;
+  }
+  live+=header_size+16;
+
+     // The directory must fit in front of the first kept component.
+     // The gap after it, if any, is covered with a JUNK chunk, which
+     // takes at least 8 bytes. Move components out of the way if needed.
+  for(;;)
+  {
+    const int start=kept_list.size() ? kept_list[kept_list]->offset : old_end;
+    const int gap=start-16-header_size;
+    if (gap==0 || gap>=8 || !kept_list.size())
+      break;
+    GPosition kpos=kept_list;
+    kept_list[kpos]->offset=old_end;
+    kept_list.del(kpos);
+  }
+
+     // Place the remaining components at the end of the file
+  int offset=old_end;
+  for(GPosition pos=files_list;pos;++pos)
+  {
+    const GP<DjVmDir::File> file(files_list[pos]);
+    if (file->offset>=old_end)
+    {
+      if (offset & 1)
+        offset++;
+      file->offset=offset;
+      offset+=file->size;
+    }
+  }
+  const int new_end=(offset>16+header_size)?offset:(16+header_size);
+  const int dir_end=kept_list.size() ? kept_list[kept_list]->offset : new_end;
+
+     // Do not let the file grow forever
+  if (new_end-live>live)
+    return false;
+
+  DEBUG_MSG("keeping " << kept_list.size() << " of " << files_list.size()
+            << " components, " << (new_end-old_end) << " bytes appended\n");
+
+     // The new directory overwrites the bytes in front of the first
+     // kept component. Components moved away from there are still read
+     // from the file by their DataPools: read just them into memory.
+  {
+    GPList<DataPool> pools;
+    for(GPosition pos=files_list;pos;++pos)
+    {
+      const GP<DjVmDir::File> file(files_list[pos]);
+      const GUTF8String id(file->get_load_name());
+      const GP<DjVmDir::File> ofile(odir->id_to_file(id));
+      if (file->offset>=old_end && (!ofile || ofile->offset<dir_end))
+        pools.append(doc->get_data(id));
     }
+    DataPool::prefetch(pools);
   }
-  save_file(file_id,codebase,map);
+
+     // Append the components
+  str.seek(old_end, SEEK_SET);
+  for(GPosition pos=files_list;pos;++pos)
+  {
+    const GP<DjVmDir::File> file(files_list[pos]);
+    if (file->offset>=old_end)
+    {
+      while (str.tell()<file->offset)
+        str.write8(0);
+      const GP<ByteStream> str_in(doc->get_data(file->get_load_name())->get_stream());
+      str.copy(*str_in);
+    }
+  }
+  str.flush();
+
+     // Update the FORM length first: extra data at the end of the
+     // FORM does not hurt the old directory.
+  str.seek(8, SEEK_SET);
+  str.write32(new_end-12);
+  str.flush();
+
+     // Now write the directory and cover the gap after it
+  {
+    const GP<ByteStream> hdr_str(ByteStream::create());
+    const GP<IFFByteStream> ghdr_iff(IFFByteStream::create(hdr_str));
+    IFFByteStream &hdr_iff=*ghdr_iff;
+    hdr_iff.put_chunk("DIRM");
+    dir->encode(hdr_iff.get_bytestream());
+    hdr_iff.close_chunk();
+    if (nav)
+      {
+        hdr_iff.put_chunk("NAVM");
+        nav->encode(hdr_iff.get_bytestream());
+        hdr_iff.close_chunk();
+      }
+    const int gap=dir_end-16-header_size;
+    if (gap>=8)
+      {
+        hdr_iff.put_chunk("JUNK");
+        hdr_iff.close_chunk();
+      }
+    hdr_str->seek(0, SEEK_SET);
+    str.seek(16, SEEK_SET);
+    str.copy(*hdr_str);
+    if (gap>=8)
+      {
+        str.seek(16+header_size+4, SEEK_SET);
+        str.write32(gap-8);
+      }
+    str.flush();
+  }
+
+     // The open file streams may have cached the old directory
+  DataPool::close_all();
+  doc_pool=DataPool::create(doc_url, 0, new_end);
+  init_data_pool=doc_pool;
+  return true;
 }
 
 void
@@ -1853,6 +2220,28 @@ DjVuDocEditor::save(void)
    save_as(GURL(), orig_doc_type!=INDIRECT);
 }
 
+void
+DjVuDocEditor::save_incremental(void)
+{
+   DEBUG_MSG("DjVuDocEditor::save_incremental(): saving the file\n");
+   DEBUG_MAKE_INDENT(3);
+
+   if (!can_be_saved())
+     G_THROW( ERR_MSG("DjVuDocEditor.cant_save") );
+   incremental=true;
+   G_TRY
+   {
+     save_as(GURL(), orig_doc_type!=INDIRECT);
+   }
+   G_CATCH_ALL
+   {
+     incremental=false;
+     G_RETHROW;
+   }
+   G_ENDCATCH;
+   incremental=false;
+}
+
 void
 DjVuDocEditor::write(const GP<ByteStream> &gbs, bool force_djvm)
 {
@@ -2015,16 +2404,18 @@ DjVuDocEditor::save_as(const GURL &where, bool bundled)
        const GURL codebase=save_doc_url.base();
        int pages_num=djvm_dir->get_pages_num();
        GMap<GUTF8String, GUTF8String> map;
+       if (save_only_modified)
+         map_unmodified_files(codebase, map);
        // First go thru the pages
        for(int page_num=0;page_num<pages_num;page_num++)
        {
          const GUTF8String id(djvm_dir->page_to_file(page_num)->get_load_name());
-         save_file(id, codebase, save_only_modified, map);
+         save_file(id, codebase, map);
        }
        // Next go thru thumbnails and similar stuff
        GPosition pos;
        for(pos=xfiles_list;pos;++pos)
-         save_file(xfiles_list[pos]->get_load_name(), codebase, save_only_modified, map);
+         save_file(xfiles_list[pos]->get_load_name(), codebase, map);
 
          // Finally - save the top-level index file
        for(pos=xfiles_list;pos;++pos)
@@ -2061,16 +2452,20 @@ DjVuDocEditor::save_as(const GURL &where, bool bundled)
      {
         DEBUG_MSG("Saving in BUNDLED format to '" << save_doc_url << "'\n");
 
-         // Can't be very smart here. Simply overwrite the file.
         const GP<DjVmDoc> doc(get_djvm_doc());
-        DataPool::load_file(save_doc_url);
-        const GP<ByteStream> gstr(ByteStream::create(save_doc_url, "wb"));
-        doc->write(gstr);
-        gstr->flush();
-
-         // Update the document data pool (not required, but will save memory)
-        doc_pool=DataPool::create(save_doc_url);
-        init_data_pool=doc_pool;
+        if (!incremental || save_doc_url!=doc_url ||
+            orig_doc_type!=BUNDLED || !save_in_place(doc))
+        {
+             // Simply overwrite the file.
+           DataPool::load_file(save_doc_url);
+           const GP<ByteStream> gstr(ByteStream::create(save_doc_url, "wb"));
+           doc->write(gstr);
+           gstr->flush();
+
+             // Update the document data pool (not required, but will save memory)
+           doc_pool=DataPool::create(save_doc_url);
+           init_data_pool=doc_pool;
+        }
 
          // Also update DjVmDir (to reflect changes in offsets)
         djvm_dir=doc->get_djvm_dir();
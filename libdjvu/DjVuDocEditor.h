@@ -163,6 +163,18 @@ public:
 	  See \Ref{can_be_saved}() for details. */
    void		save(void);
 
+      /** Saves the document in place, writing only what has changed.
+	  For #BUNDLED# documents the modified components are appended
+	  at the end of the file and the directory at the beginning of
+	  the file is patched to point to them. The previous versions
+	  of the modified components stay in the file as unreferenced
+	  data until the wasted space exceeds the size of the live data,
+	  at which point the file is compacted by a full \Ref{save}().
+	  For #INDIRECT# documents only the modified component files and
+	  the index file are rewritten. Any other document is saved
+	  with \Ref{save}(). */
+   void		save_incremental(void);
+
       /** Saves the document. */
    virtual void	save_as(const GURL &where, bool bundled);
 
@@ -334,6 +346,9 @@ public:
       /** Generates thumbnails for those pages, which do not have them yet.
 	  If you want to regenerate thumbnails for all pages, call
 	  \Ref{remove_thumbnails}() prior to calling this function.
+	  On multiprocessor machines several pages are decoded and
+	  encoded at the same time by worker threads. The thumbnails
+	  are identical to those generated one page at a time.
 
 	  @param thumb_size The size of the thumbnails in pixels. DjVu viewer
 	         is able to rescale the thumbnail images if necessary, so this
@@ -389,11 +404,14 @@ protected:
 public:
    class File;
 private:
+   class Thumbnailer;
+   friend class Thumbnailer;
    bool		initialized;
    GURL		doc_url;
    GP<DataPool>	doc_pool;
    int		orig_doc_type;
    int		orig_doc_pages;
+   bool		incremental;
 
    GPMap<GUTF8String, File>	files_map; 	// files_map[id]=GP<File>
    GCriticalSection	files_lock;
@@ -430,9 +448,12 @@ private:
    void		move_file(const GUTF8String &id, int & file_pos,
 			  GMap<GUTF8String, void *> & map);
    void		unfile_thumbnails(void);
+   GP<DataPool>	make_thumbnail(int thumb_size, int page_num);
    void		file_thumbnails(void);
-   void	save_file(const GUTF8String &id, const GURL &codebase,
-     const bool only_modified, GMap<GUTF8String, GUTF8String> & map);
+   bool		is_file_modified(const GUTF8String &id);
+   void		map_unmodified_files(const GURL &codebase,
+                  GMap<GUTF8String, GUTF8String> & map);
+   bool		save_in_place(const GP<DjVmDoc> &doc);
    void	save_file(const GUTF8String &id, const GURL &codebase,
      GMap<GUTF8String, GUTF8String> & map);
 };
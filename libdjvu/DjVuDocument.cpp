@@ -70,6 +70,7 @@
 #include "DataPool.h"
 #include "IW44Image.h"
 #include "GRect.h"
+#include "DjVuProfile.h"
 
 #include "debug.h"
 
@@ -198,6 +199,7 @@ DjVuDocument::start_init(
 
    init_thread_flags=STARTED;
    init_life_saver=this;
+   init_profile=DjVuProfile::current();
    init_thr.create(static_init_thread, this);
 }
 
@@ -273,6 +275,7 @@ DjVuDocument::static_init_thread(void * cl_data)
   DjVuDocument * th=(DjVuDocument *) cl_data;
   GP<DjVuDocument> life_saver=th;
   th->init_life_saver=0;
+  DjVuProfile::Attach attach(th->init_profile);
   G_TRY {
     th->init_thread();
   } G_CATCH(exc) {
@@ -864,6 +867,7 @@ DjVuDocument::url_to_file(const GURL & url, bool dont_create) const
       if (port && port->inherits("DjVuFile"))
       {
 	 DEBUG_MSG("found fully decoded file using DjVuPortcaster\n");
+	 DjVuProfile::count(DjVuProfile::CACHE_HIT);
 	 return (DjVuFile *) (DjVuPort *) port;
       }
    }
@@ -881,6 +885,8 @@ DjVuDocument::url_to_file(const GURL & url, bool dont_create) const
    if (!dont_create)
    {
       DEBUG_MSG("creating a new file\n");
+      if (cache)
+        DjVuProfile::count(DjVuProfile::CACHE_MISS);
       file=DjVuFile::create(url,const_cast<DjVuDocument *>(this),recover_errors,verbose_eof);
       const_cast<DjVuDocument *>(this)->set_file_aliases(file);
    }
@@ -1067,6 +1073,35 @@ DjVuDocument::get_page(int page_num, bool sync, DjVuPort * port) const
    return dimg;
 }
 
+GP<DjVuImage>
+DjVuDocument::get_preview_page(int page_num, int subsample,
+                               bool sync, DjVuPort * port) const
+{
+   check();
+   DEBUG_MSG("DjVuDocument::get_preview_page(): page " << page_num
+             << ", subsample " << subsample << "\n");
+   DEBUG_MAKE_INDENT(3);
+
+   if (subsample <= 1 || !is_init_complete())
+     return get_page(page_num, sync, port);
+   GP<DjVuFile> file(get_djvu_file(page_num, true));
+   if (file && (file->is_decode_ok() || file->is_modified()))
+     return get_page(page_num, sync, port);
+   const GURL url(page_to_url(page_num));
+   if (url.is_empty())
+     return 0;
+   file = DjVuFile::create(url, const_cast<DjVuDocument *>(this),
+                           recover_errors, verbose_eof);
+   file->set_min_subsample(subsample);
+   GP<DjVuImage> dimg = DjVuImage::create(file);
+   if (port)
+     DjVuPort::get_portcaster()->add_route(dimg, port);
+   file->resume_decode();
+   if (dimg && sync)
+     dimg->wait_for_complete_decode();
+   return dimg;
+}
+
 GP<DjVuImage>
 DjVuDocument::get_page(const GUTF8String &id, bool sync, DjVuPort * port)
 {
@@ -1372,7 +1407,7 @@ DjVuDocument::get_thumbnail(int page_num, bool dont_decode)
 }
 
 static void
-add_to_cache(const GP<DjVuFile> & f, GMap<GURL, void *> & map,
+add_to_cache(const GP<DjVuFile> & f, GFlatMap<GURL, void *> & map,
 	     DjVuFileCache * cache)
 {
    GURL url=f->get_url();
@@ -1395,7 +1430,7 @@ DjVuDocument::add_to_cache(const GP<DjVuFile> & f)
 {
    if (cache)
    {
-      GMap<GURL, void *> map;
+      GFlatMap<GURL, void *> map;
       ::add_to_cache(f, map, cache);
    }
 }
@@ -1409,8 +1444,12 @@ DjVuDocument::notify_file_flags_changed(const DjVuFile * source,
       // check();
    if (set_mask & DjVuFile::DECODE_OK)
    {
-      set_file_aliases(source);
-      if (cache) add_to_cache((DjVuFile *) source);
+         // Reduced resolution previews are private to their image
+      if (source->get_min_subsample() <= 1)
+      {
+         set_file_aliases(source);
+         if (cache) add_to_cache((DjVuFile *) source);
+      }
       if(!needs_compression_flag)
       {
         if(source->needs_compression())
@@ -1531,7 +1570,7 @@ DjVuDocument::request_data(const DjVuPort * source, const GURL & url)
 
 static void
 add_file_to_djvm(const GP<DjVuFile> & file, bool page,
-		 DjVmDoc & doc, GMap<GURL, void *> & map)
+		 DjVmDoc & doc, GFlatMap<GURL, void *> & map)
       // This function is used only for obsolete formats.
       // For new formats there is no need to process files recursively.
       // All information is already available from the DJVM chunk
@@ -1573,7 +1612,7 @@ add_file_to_djvm(const GP<DjVuFile> & file, bool page,
 
 static void
 add_file_to_djvm(const GP<DjVuFile> & file, bool page,
-		 DjVmDoc & doc, GMap<GURL, void *> & map, 
+		 DjVmDoc & doc, GFlatMap<GURL, void *> & map, 
                  bool &needs_compression_flag, bool &can_compress_flag )
 {
   if(!needs_compression_flag)
@@ -1591,7 +1630,7 @@ add_file_to_djvm(const GP<DjVuFile> & file, bool page,
 }
 
 static void
-local_get_url_names(DjVuFile * f,const GMap<GURL, void *> & map,GMap<GURL,void *> &tmpmap)
+local_get_url_names(DjVuFile * f,const GFlatMap<GURL, void *> & map,GFlatMap<GURL,void *> &tmpmap)
 {
    GURL url=f->get_url();
    if (!map.contains(url) && !tmpmap.contains(url))
@@ -1605,9 +1644,9 @@ local_get_url_names(DjVuFile * f,const GMap<GURL, void *> & map,GMap<GURL,void *
 }
 
 static void
-local_get_url_names(DjVuFile * f, GMap<GURL, void *> & map)
+local_get_url_names(DjVuFile * f, GFlatMap<GURL, void *> & map)
 {
-   GMap<GURL,void *> tmpmap;
+   GFlatMap<GURL,void *> tmpmap;
    local_get_url_names(f,map,tmpmap);
    for(GPosition pos=tmpmap;pos;++pos)
      map[tmpmap.key(pos)]=0;
@@ -1622,7 +1661,7 @@ DjVuDocument::get_url_names(void)
   if(has_url_names)
     return url_names;
 
-  GMap<GURL, void *> map;
+  GFlatMap<GURL, void *> map;
   int i;
   if (doc_type==BUNDLED || doc_type==INDIRECT)
   {
@@ -1702,7 +1741,7 @@ DjVuDocument::get_djvm_doc()
    else if (doc_type==SINGLE_PAGE)
      {
        DEBUG_MSG("Creating: djvm for a single page document.\n");
-       GMap<GURL, void *> map_add;
+       GFlatMap<GURL, void *> map_add;
        GP<DjVuFile> file=get_djvu_file(0);
        add_file_to_djvm(file, true, *doc, map_add,
                         needs_compression_flag,can_compress_flag);
@@ -1710,7 +1749,7 @@ DjVuDocument::get_djvm_doc()
    else
      {
        DEBUG_MSG("Converting: the document is in an old format.\n");
-       GMap<GURL, void *> map_add;
+       GFlatMap<GURL, void *> map_add;
        if(recover_errors == ABORT)
          {
            for(int page_num=0;page_num<ndir->get_pages_num();page_num++)
@@ -75,6 +75,7 @@ class DjVuImage;
 class DjVuFile;
 class DjVuFileCache;
 class DjVuNavDir;
+class DjVuProfile;
 class ByteStream;
 
 /** @name DjVuDocument.h
@@ -608,6 +609,19 @@ public:
 	  #ZERO# or just empty, page number #-1# is assumed. Otherwise
 	  the ID is translated to the URL using \Ref{id_to_url}(). */
    GP<DjVuImage> get_page(const GUTF8String &id, bool sync=true, DjVuPort * port=0);
+
+      /** Returns a \Ref{DjVuImage} suitable for rendering page #page_num#
+	  with subsampling #subsample# or larger. The wavelet decoder skips
+	  background data that does not affect the image at this resolution,
+	  which makes this much faster than \Ref{get_page}() for thumbnails
+	  and previews. Rendering the result at a smaller subsampling
+	  produces a blurry image. The underlying \Ref{DjVuFile} is private
+	  to the returned image and is never entered into the cache.
+	  Pages already decoded or modified in memory are returned as by
+	  \Ref{get_page}(). Arguments #sync# and #port# are the same as for
+	  \Ref{get_page}(). */
+   GP<DjVuImage> get_preview_page(int page_num, int subsample,
+                                  bool sync=true, DjVuPort * port=0) const;
    
       /** Returns \Ref{DjVuFile} corresponding to the specified page.
 	  Normally it translates the page number to the URL using
@@ -854,6 +868,7 @@ protected:
    GCriticalSection	threqs_lock;
 
    GP<DjVuDocument>	init_life_saver;
+   GP<DjVuProfile>	init_profile;
 
    static const float	thumb_gamma;
 
@@ -73,6 +73,7 @@
 #include "DjVuNavDir.h"
 #ifndef NEED_DECODER_ONLY
 #include "BSByteStream.h"
+#include "DjVuProfile.h"
 #endif // NEED_DECODER_ONLY
 
 #include "debug.h"
@@ -140,10 +141,58 @@ private:
   ProgressByteStream & operator=(const ProgressByteStream &);
 };
 
+// Lets a decoder look at the first bytes of a chunk before deciding
+// how to decode it.  The bytes read by peek() are returned again by
+// read(), followed by the rest of the chunk.
+class PeekByteStream : public ByteStream
+{
+public:
+  PeekByteStream(const GP<ByteStream> & xstr) : str(xstr),
+    head_size(0), pos(0) {}
+  virtual ~PeekByteStream() {}
+
+  // Returns a pointer to at most size bytes from the start of the stream.
+  size_t peek(const void *&ptr, size_t size)
+  {
+    if (size > head_size && !pos)
+    {
+      head.resize(0, size-1);
+      head_size += str->readall((char*)head+head_size, size-head_size);
+    }
+    ptr=(const char*)head;
+    return (size < head_size) ? size : head_size;
+  }
+  virtual size_t read(void *buffer, size_t size)
+  {
+    size_t rc;
+    if (pos < head_size)
+    {
+      rc=head_size-pos;
+      if (rc > size)
+        rc=size;
+      memcpy(buffer, (const char*)head+pos, rc);
+    } else
+    {
+      rc=str->read(buffer, size);
+    }
+    pos+=rc;
+    return rc;
+  }
+  virtual long tell(void ) const { return pos; }
+private:
+  GP<ByteStream> str;
+  GTArray<char> head;
+  size_t head_size;
+  size_t pos;
+
+  // Cancel C++ default stuff
+  PeekByteStream & operator=(const PeekByteStream &);
+};
+
 
 DjVuFile::DjVuFile()
 : file_size(0), recover_errors(ABORT), verbose_eof(false), chunks_number(-1),
-initialized(false)
+min_subsample(1), initialized(false)
 {
 }
 
@@ -453,6 +502,7 @@ DjVuFile::static_decode_func(void * cl_data)
   from the decoding thread) or coredump. */
   GP<DjVuFile> life_saver=th;
   th->decode_life_saver=0;
+  DjVuProfile::Attach attach(th->decode_profile);
   G_TRY {
     th->decode_func();
   } G_CATCH_ALL {
@@ -469,6 +519,13 @@ DjVuFile::decode_func(void)
   DjVuPortcaster * pcaster=get_portcaster();
   
   G_TRY {
+    // Read this file with as few system calls as possible.  The data
+    // is attached to decode_data_pool and goes away with it.  Included
+    // files prefetch their own data when they are decoded.
+    GPList<DataPool> pools;
+    pools.append(decode_data_pool);
+    DataPool::prefetch(pools);
+
     const GP<ByteStream> decode_stream(decode_data_pool->get_stream());
     ProgressByteStream *pstr=new ProgressByteStream(decode_stream);
     const GP<ByteStream> gpstr(pstr);
@@ -526,6 +583,8 @@ DjVuFile::decode_func(void)
   } G_ENDCATCH;
 
   decode_data_pool->clear_stream();
+  // Release the data read by DataPool::prefetch()
+  decode_data_pool=0;
   G_TRY {
     if (flags.test_and_modify(DECODING, 0, DECODE_OK | INCL_FILES_CREATED, DECODING))
       pcaster->notify_file_flags_changed(this, DECODE_OK | INCL_FILES_CREATED, 
@@ -804,6 +863,38 @@ DjVuFile::get_dpi(int w, int h)
   return (dpi ? dpi : 300)/red;
 }
 
+#ifdef NEED_JPEG_DECODER
+// Decodes a JPEG layer.  Pages that are never rendered at full
+// resolution use the DCT scaling of the JPEG library, as long as
+// the layer reduction stays within the range allowed by DjVuImage.
+static GP<GPixmap>
+decode_jpeg(const GP<ByteStream> &gbs, const GP<DjVuInfo> &info, 
+            int subsample)
+{
+  int scale = 1;
+  GP<ByteStream> bs = gbs;
+  if (subsample>1 && info && info->width>0 && info->height>0)
+    {
+      // Peek at the JPEG header for the layer size.  Headers larger
+      // than this are unusual and just disable the scaling.
+      PeekByteStream *pbs = new PeekByteStream(gbs);
+      bs = pbs;
+      const void *head;
+      const size_t head_size = pbs->peek(head, 65536);
+      int w, h;
+      GP<ByteStream> hbs = ByteStream::create_static(head, head_size);
+      if (JPEGDecoder::get_size(*hbs, w, h) && w>0 && h>0)
+        {
+          int red = (info->width+w-1)/w;
+          if ((info->width+red-1)/red==w && (info->height+red-1)/red==h)
+            while (scale<8 && red*scale*2<=subsample && red*scale*2<=12)
+              scale += scale;
+        }
+    }
+  return JPEGDecoder::decode(*bs, scale);
+}
+#endif
+
 static inline bool
 is_info(const GUTF8String &chkid)
 {
@@ -950,7 +1041,22 @@ DjVuFile::decode_chunk( const GUTF8String &id, const GP<ByteStream> &gbs,
         G_THROW( ERR_MSG("DjVuFile.dupl_backgrnd") );
       // First chunk
       GP<IW44Image> bg44=IW44Image::create_decode(IW44Image::COLOR);
-      bg44->decode_chunk(gbs);
+      GP<ByteStream> bs = gbs;
+      if (min_subsample>1 && info && info->width>0)
+        {
+          // Peek at the primary header for the background width
+          PeekByteStream *pbs = new PeekByteStream(gbs);
+          bs = pbs;
+          const void *ptr;
+          if (pbs->peek(ptr, 8) == 8)
+            {
+              const unsigned char *head = (const unsigned char*)ptr;
+              int bgw = (head[4]<<8) | head[5];
+              if (!head[0] && bgw > 0)
+                bg44->parm_subsample(min_subsample*bgw/info->width);
+            }
+        }
+      bg44->decode_chunk(bs);
       this->bg44 = bg44;
       desc.format( ERR_MSG("DjVuFile.IW44_bg1") "\t%d\t%d\t%d",
 		      bg44->get_width(), bg44->get_height(),
@@ -1007,7 +1113,7 @@ DjVuFile::decode_chunk( const GUTF8String &id, const GP<ByteStream> &gbs,
       G_THROW( ERR_MSG("DjVuFile.dupl_backgrnd") );
     set_can_compress(true);
 #ifdef NEED_JPEG_DECODER
-    this->bgpm = JPEGDecoder::decode(bs);
+    this->bgpm = decode_jpeg(gbs, info, min_subsample);
     desc.format( ERR_MSG("DjVuFile.JPEG_bg1") "\t%d\t%d\t%d",
       bgpm->columns(), bgpm->rows(),
       get_dpi(bgpm->columns(), bgpm->rows()));
@@ -1022,7 +1128,7 @@ DjVuFile::decode_chunk( const GUTF8String &id, const GP<ByteStream> &gbs,
     if (fgpm || fgbc)
       G_THROW( ERR_MSG("DjVuFile.dupl_foregrnd") );
 #ifdef NEED_JPEG_DECODER
-    this->fgpm = JPEGDecoder::decode(bs);
+    this->fgpm = decode_jpeg(gbs, info, min_subsample);
     desc.format( ERR_MSG("DjVuFile.JPEG_fg1") "\t%d\t%d\t%d",
       fgpm->columns(), fgpm->rows(),
       get_dpi(fgpm->columns(), fgpm->rows()));
@@ -1066,6 +1172,7 @@ DjVuFile::decode_chunk( const GUTF8String &id, const GP<ByteStream> &gbs,
     {
       // First chunk
       GP<IW44Image> bg44 = IW44Image::create_decode(IW44Image::COLOR);
+      bg44->parm_subsample(min_subsample);
       bg44->decode_chunk(gbs);
       GP<DjVuInfo> info = DjVuInfo::create();
       info->width = bg44->get_width();
@@ -1329,6 +1436,8 @@ DjVuFile::start_decode(void)
       // decoding thread even before its function is called (it starts)
       decode_data_pool=DataPool::create(data_pool);
       decode_life_saver=this;
+      // Charge the decoding time to the profile of the calling thread
+      decode_profile=DjVuProfile::current();
       
       decode_thread=new GThread();
       decode_thread->create(static_decode_func, this);
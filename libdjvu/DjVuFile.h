@@ -76,6 +76,7 @@ class IW44Image;
 class IFFByteStream;
 class GPixmap;
 class DjVuNavDir;
+class DjVuProfile;
 
 
 /** @name DjVuFile.h
@@ -371,6 +372,16 @@ public:
           wait for decode to complete.  Returns true of start_decode is called.
           */
    bool   resume_decode(const bool sync=false);
+      /** Sets the smallest subsampling factor, relative to the page
+	  resolution, the page will be rendered with. Call this before
+	  starting the decode. Values larger than #1# let the wavelet
+	  decoder stop early and skip background data not needed at this
+	  resolution (see \Ref{IW44Image::parm_subsample}), and let the
+	  JPEG decoder produce reduced layers using DCT scaling. Such files
+	  are not shared through the document cache. */
+   void		set_min_subsample(int subsample);
+      /// Returns the value set with \Ref{set_min_subsample}.
+   int		get_min_subsample(void) const;
       /** Stops decode. If #sync# is 1 then the function will not return
 	  until the decoding thread actually dies. Otherwise it will
 	  just signal the thread to stop and will return immediately.
@@ -619,6 +630,7 @@ protected:
    ErrorRecoveryAction	recover_errors;
    bool			verbose_eof;
    int			chunks_number;
+   int			min_subsample;
 private:
    bool                 initialized;
    GSafeFlags		flags;
@@ -626,6 +638,7 @@ private:
    GThread		* decode_thread;
    GP<DataPool>		decode_data_pool;
    GP<DjVuFile>		decode_life_saver;
+   GP<DjVuProfile>	decode_profile;
 
    GP<DjVuPort>		simple_port;
 
@@ -820,6 +833,18 @@ DjVuFile::set_recover_errors
   recover_errors=action;
 }
 
+inline void
+DjVuFile::set_min_subsample(int subsample)
+{
+  min_subsample=(subsample>1)?subsample:1;
+}
+
+inline int
+DjVuFile::get_min_subsample(void) const
+{
+  return min_subsample;
+}
+
 //@}
 
 
@@ -678,6 +678,11 @@ DjVuImage::get_bg_pixmap(const GRect &rect,
     gamma_correction = 0.1;
   else if (gamma_correction > 10)
     gamma_correction = 10;
+  // Compute color correction table. The pixmap scaler applies 
+  // the correction to its output lines; other cases need a final pass.
+  unsigned char gtable[256][3];
+  bool correct = GPixmap::color_correction_table(gamma_correction, 
+                                                 white, gtable);
   
   // CASE1: Incremental BG IW44Image
   GP<IW44Image> bg44 = get_bg44();
@@ -740,12 +745,12 @@ DjVuImage::get_bg_pixmap(const GRect &rect,
           ps.get_input_rect(rect,xrect);
           GP<GPixmap> ipm = bg44->get_pixmap(po2,xrect);
           pm = GPixmap::create();
-          ps.scale(xrect, *ipm, rect, *pm);
+          ps.scale(xrect, *ipm, rect, *pm, correct ? gtable : 0);
+          correct = false;
         }
       // Apply gamma correction
-      if (pm)
-        if (gamma_correction!=1.0 || white != GPixel::WHITE)
-          pm->color_correct(gamma_correction, white);
+      if (pm && correct)
+        pm->color_correct(gtable);
       return pm;
     }
 
@@ -785,12 +790,12 @@ DjVuImage::get_bg_pixmap(const GRect &rect,
           // run pixmap scaler
           pm = GPixmap::create();
           GRect xrect(0,0,w,h);
-          ps.scale(xrect, *bgpm, rect, *pm);
+          ps.scale(xrect, *bgpm, rect, *pm, correct ? gtable : 0);
+          correct = false;
         }
       // Apply gamma correction
-      if (pm)
-        if (gamma_correction!=1.0 || white != GPixel::WHITE)
-          pm->color_correct(gamma_correction, white);
+      if (pm && correct)
+        pm->color_correct(gtable);
       return pm;
     }
 
@@ -62,8 +62,10 @@
 #include "ByteStream.h"
 #include "BSByteStream.h"
 #include "DjVuPalette.h"
+#include "GThreads.h"
 
 #include <stddef.h>
+#include <string.h>
 #include <stdlib.h>
 #include <math.h>
 
@@ -109,7 +111,7 @@ DjVuPalette::DjVuPalette()
 DjVuPalette::~DjVuPalette()
 {
   delete hist;
-  delete pmap;
+  free_pmap();
 }
 
 DjVuPalette& 
@@ -118,7 +120,8 @@ DjVuPalette::operator=(const DjVuPalette &ref)
   if (this != &ref)
     {
       delete hist;
-      delete pmap;
+      hist = 0;
+      free_pmap();
       mask = 0;
       palette = ref.palette;
       colordata = ref.colordata;
@@ -343,27 +346,204 @@ DjVuPalette::compute_palette(int maxcolors, int minboxsize)
   qsort((PColor*)palette, ncolors, sizeof(PColor), lcomp);
   // Clear invalid data
   colordata.empty();
-  delete pmap;
-  pmap = 0;
+  free_pmap();
   // Return dominant color
   return color_to_index_slow(dcolor.p);
 }
 
 
 
+// Pixmap histograms are built by chunks of rows in an open addressing
+// table that follows the rules of histogram_add: the colors are masked
+// with the current mask, and the mask is widened when the table holds
+// 0x4000 colors.  Each chunk is added to the total in the order of
+// first appearance, so that the palette does not depend on the number
+// of threads, and is the same as with histogram_add unless some colors
+// were merged.
+
+#define HISTSIZE   0x4000
+#define HISTSLOTS  0x8000
+#define HISTROWS   64
+#define HISTCHUNKS 16
+
+static int histogram_threads = 1;
+
+void
+DjVuPalette::set_threads(int threads)
+{
+  histogram_threads = (threads > 0) ? threads : GThread::ncpus();
+}
+
+int
+DjVuPalette::get_threads(void)
+{
+  return histogram_threads;
+}
+
+namespace {
+  class PHist
+  {
+  public:
+    PHist();
+    void add(int key, int weight);
+    void widen();
+    void add_rows(const GPixmap &pm, int ymin, int ymax);
+    int mask;
+    int size;
+    int *keys;
+    int *weights;
+  private:
+    int find(int key);
+    int *slots;
+    GPBuffer<int> gkeys;
+    GPBuffer<int> gweights;
+    GPBuffer<int> gslots;
+  };
+}
+
+PHist::PHist()
+  : mask(0), size(0), 
+    gkeys(keys, HISTSIZE + 1), gweights(weights, HISTSIZE + 1),
+    gslots(slots, HISTSLOTS)
+{
+  gslots.clear();
+}
+
+// Returns the entry for masked color #key#, possibly a new one.
+inline int
+PHist::find(int key)
+{
+  unsigned int h = ((unsigned int)key * 0x9e3779b1u) >> 17;
+  for (;; h = (h + 1) & (HISTSLOTS - 1))
+    {
+      int e = slots[h] - 1;
+      if (e < 0)
+        {
+          slots[h] = size + 1;
+          keys[size] = key;
+          weights[size] = 0;
+          return size++;
+        }
+      if (keys[e] == key)
+        return e;
+    }
+}
+
+inline void
+PHist::add(int key, int weight)
+{
+  if (size >= HISTSIZE)
+    widen();
+  weights[find(key | mask)] += weight;
+}
+
+void
+PHist::widen()
+{
+  const int osize = size;
+  int *okeys;
+  int *oweights;
+  GPBuffer<int> gokeys(okeys, osize);
+  GPBuffer<int> goweights(oweights, osize);
+  memcpy(okeys, keys, osize * sizeof(int));
+  memcpy(oweights, weights, osize * sizeof(int));
+  gslots.clear();
+  size = 0;
+  mask = (mask<<1)|(0x010101);
+  for (int i=0; i<osize; i++)
+    weights[find(okeys[i] | mask)] += oweights[i];
+}
+
+void
+PHist::add_rows(const GPixmap &pm, int ymin, int ymax)
+{
+  const int w = pm.columns();
+  for (int j=ymin; j<ymax; j++)
+    {
+      const GPixel *p = pm[j];
+      int last = -1;
+      int e = 0;
+      for (int i=0; i<w; i++)
+        {
+          int key = (p[i].b<<16)|(p[i].g<<8)|(p[i].r);
+          if (key != last || size >= HISTSIZE)
+            {
+              if (size >= HISTSIZE)
+                widen();
+              e = find(key | mask);
+              last = key;
+            }
+          weights[e] += 1;
+        }
+    }
+}
+
+namespace {
+  class HistJob : public GParallel
+  {
+  public:
+    const GPixmap *pm;
+    PHist *chunks;
+    int nchunks;
+  protected:
+    virtual void work(int c);
+  };
+}
+
+void
+HistJob::work(int c)
+{
+  const int nrows = pm->rows();
+  chunks[c].add_rows(*pm, nrows * c / nchunks, nrows * (c + 1) / nchunks);
+}
+
 int 
 DjVuPalette::compute_pixmap_palette(const GPixmap &pm, int ncolors, int minboxsize)
 {
   // Prepare histogram
   histogram_clear();
-  { // extra nesting for windows
-    for (int j=0; j<(int)pm.rows(); j++)
+  const int nrows = pm.rows();
+  int nchunks = (nrows + HISTROWS - 1) / HISTROWS;
+  if (nchunks > HISTCHUNKS)
+    nchunks = HISTCHUNKS;
+  if (nchunks > 0)
     {
-      const GPixel *p = pm[j];
-      for (int i=0; i<(int)pm.columns(); i++)
-        histogram_add(p[i], 1);
+      HistJob job;
+      job.pm = &pm;
+      job.chunks = new PHist[nchunks];
+      job.nchunks = nchunks;
+      int nthreads = histogram_threads;
+      if (nrows * (int)pm.columns() < 512*512)
+        nthreads = 1;
+      G_TRY
+        {
+          job.run(nchunks, nthreads);
+        }
+      G_CATCH_ALL
+        {
+          delete [] job.chunks;
+          G_RETHROW;
+        }
+      G_ENDCATCH;
+      // Add the chunks in order
+      PHist &total = job.chunks[0];
+      for (int c=1; c<nchunks; c++)
+        {
+          PHist &chunk = job.chunks[c];
+          while (total.mask < chunk.mask)
+            total.widen();
+          for (int i=0; i<chunk.size; i++)
+            total.add(chunk.keys[i], chunk.weights[i]);
+        }
+      if (total.size > 0)
+        {
+          hist = new GMap<int,int>;
+          mask = total.mask;
+          for (int i=0; i<total.size; i++)
+            (*hist)[total.keys[i]] = total.weights[i];
+        }
+      delete [] job.chunks;
     }
-  }
   // Compute palette
   return compute_palette(ncolors, minboxsize);
 }
@@ -381,7 +561,40 @@ void
 DjVuPalette::allocate_pmap()
 {
   if (! pmap)
-    pmap = new GMap<int,int>;
+    {
+      pmap = new int[CUBESIZE];
+      for (int i=0; i<CUBESIZE; i++)
+        pmap[i] = -1;
+      pcand.empty();
+    }
+}
+
+void
+DjVuPalette::free_pmap()
+{
+  delete [] pmap;
+  pmap = 0;
+  pcand.empty();
+}
+
+// Squared distances from palette color #p# to the closest and
+// the farthest points of the cube starting at #lo#.
+static inline void
+cube_dist(const unsigned char *p, const int *lo, int &dmin, int &dmax)
+{
+  dmin = dmax = 0;
+  for (int c=0; c<3; c++)
+    {
+      int dlo = p[c] - lo[c];
+      int dhi = p[c] - (lo[c] + CUBESIDE - 1);
+      if (dlo < 0)
+        dmin += dlo * dlo;
+      else if (dhi > 0)
+        dmin += dhi * dhi;
+      dlo = dlo * dlo;
+      dhi = dhi * dhi;
+      dmax += (dlo > dhi) ? dlo : dhi;
+    }
 }
 
 int 
@@ -391,12 +604,60 @@ DjVuPalette::color_to_index_slow(const unsigned char *bgr)
   const int ncolors = palette.size();
   if (! ncolors)
     G_THROW( ERR_MSG("DjVuPalette.not_init") );
-  // Should be able to do better
+  if (! pmap)
+    allocate_pmap();
+  // List the candidates for the cube containing this color.  The
+  // nearest color of any point in the cube is no farther than the
+  // farthest point of the cube from the best guaranteed color.
+  int &cube = pmap[cube_index(bgr)];
+  if (cube == -1)
+    {
+      int lo[3];
+      lo[0] = bgr[0] & ~(CUBESIDE - 1);
+      lo[1] = bgr[1] & ~(CUBESIDE - 1);
+      lo[2] = bgr[2] & ~(CUBESIDE - 1);
+      int bound = 3*256*256;
+      int i, dmin, dmax;
+      for (i=0; i<ncolors; i++)
+        {
+          cube_dist(pal[i].p, lo, dmin, dmax);
+          if (dmax < bound)
+            bound = dmax;
+        }
+      int n = pcand.size();
+      int count = 0;
+      pcand.touch(n);
+      for (i=0; i<ncolors; i++)
+        {
+          cube_dist(pal[i].p, lo, dmin, dmax);
+          if (dmin <= bound)
+            {
+              count += 1;
+              pcand.touch(n + count);
+              pcand[n + count] = i;
+            }
+        }
+      if (count == 1)
+        {
+          cube = pcand[n + 1];
+          pcand.resize(n - 1);
+        }
+      else
+        {
+          pcand[n] = count;
+          cube = -2 - n;
+        }
+    }
+  if (cube >= 0)
+    return cube;
+  // Search the candidates in index order
+  const int *cand = &pcand[-2 - cube];
   int found = 0;
   int founddist = 3*256*256;
   { // extra nesting for windows
-    for (int i=0; i<ncolors; i++)
+    for (int j=1; j<=cand[0]; j++)
     {
+      const int i = cand[j];
       int bd = bgr[0] - pal[i].p[0];
       int gd = bgr[1] - pal[i].p[1];
       int rd = bgr[2] - pal[i].p[2];
@@ -408,17 +669,12 @@ DjVuPalette::color_to_index_slow(const unsigned char *bgr)
         }
     }
   }
-  // Store in pmap
-  if (pmap && pmap->size()<0x8000)
-    {
-      int key = (bgr[0]<<16)|(bgr[1]<<8)|(bgr[2]);
-      (*pmap)[key] = found;
-    }
   // Return
   return found;
 }
 
 
+
 #ifndef NEED_DECODER_ONLY
 
 void 
@@ -428,8 +684,17 @@ DjVuPalette::quantize(GPixmap &pm)
     for (int j=0; j<(int)pm.rows(); j++)
     {
       GPixel *p = pm[j];
+      GPixel last, color;
       for (int i=0; i<(int)pm.columns(); i++)
-        index_to_color(color_to_index(p[i]), p[i]);
+        {
+          // Runs of identical pixels are common
+          if (i == 0 || p[i] != last)
+            {
+              last = p[i];
+              index_to_color(color_to_index(last), color);
+            }
+          p[i] = color;
+        }
     }
   }
 }
@@ -468,6 +733,7 @@ DjVuPalette::color_correct(double corr)
           q[i].p[1] = r[i].g;
           q[i].p[2] = r[i].r;
         }
+      free_pmap();
     }
 }
 
@@ -530,6 +796,7 @@ DjVuPalette::encode(GP<ByteStream> gbs) const
 void 
 DjVuPalette::decode_rgb_entries(ByteStream &bs, const int palettesize)
 {
+  free_pmap();
   palette.resize(0,palettesize-1);
   { // extra nesting for windows
     for (int c=0; c<palettesize; c++)
@@ -550,9 +817,8 @@ DjVuPalette::decode(GP<ByteStream> gbs)
   ByteStream &bs=*gbs;
   // Make sure that everything is clear
   delete hist;
-  delete pmap;
   hist = 0;
-  pmap = 0;
+  free_pmap();
   mask = 0;
   // Code version
   int version = bs.read8();
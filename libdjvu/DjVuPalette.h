@@ -146,8 +146,17 @@ public:
   int compute_palette(int maxcolors, int minboxsize=0);
   /** Computes the optimal palette for pixmap #pm#.  This function builds the
       histogram for pixmap #pm# and computes the optimal palette using
-      \Ref{compute_palette}. */
+      \Ref{compute_palette}.  Large pixmaps are scanned by chunks of rows
+      in the number of threads selected with \Ref{set_threads}. */
   int compute_pixmap_palette(const GPixmap &pm, int ncolors, int minboxsize=0);
+  /** Sets how many chunks of rows of a large pixmap
+      \Ref{compute_pixmap_palette} may count concurrently (default 1, or
+      the processor count when #threads# is zero).  Since the chunk
+      histograms are merged in row order, the palette is the same for
+      any value. */
+  static void set_threads(int threads);
+  /** Returns the number of threads used to build histograms. */
+  static int get_threads(void);
   // CONVERSION
   /** Returns the number of colors in the palette. */
   int size() const;
@@ -205,10 +214,16 @@ private:
   // Quantization data
   struct PColor { unsigned char p[4]; };
   GTArray<PColor> palette;
-  GMap<int,int> *pmap;
+  // Nearest colors by cubes of 16x16x16 colors: either the palette index
+  // shared by the whole cube, or -1 for an unknown cube, or -2-n for the
+  // list of candidate indices starting at #pcand[n]# with its length.
+  int *pmap;
+  GTArray<int> pcand;
   // Helpers
   void allocate_hist();
   void allocate_pmap();
+  void free_pmap();
+  static int cube_index(const unsigned char *bgr);
   static int CALLINGCONVENTION bcomp (const void*, const void*);
   static int CALLINGCONVENTION gcomp (const void*, const void*);
   static int CALLINGCONVENTION rcomp (const void*, const void*);
@@ -272,15 +287,21 @@ DjVuPalette::size() const
   return palette.size();
 }
 
+inline int
+DjVuPalette::cube_index(const unsigned char *bgr)
+{
+  return ((bgr[0]&0xf0)<<4)|(bgr[1]&0xf0)|(bgr[2]>>4);
+}
+
 inline int 
 DjVuPalette::color_to_index(const unsigned char *bgr)
 {
-  if (! pmap)
-    allocate_pmap();
-  int key = (bgr[0]<<16)|(bgr[1]<<8)|(bgr[2]);
-  GPosition p = pmap->contains(key);
-  if ( p)
-    return (*pmap)[p];
+  if (pmap)
+    {
+      int index = pmap[cube_index(bgr)];
+      if (index >= 0)
+        return index;
+    }
   return color_to_index_slow(bgr);
 }
 
@@ -418,7 +418,7 @@ DjVuPortcaster::copy_routes(DjVuPort * dst, const DjVuPort * src)
 }
 
 void
-DjVuPortcaster::add_to_closure(GMap<const void *, void *> & set,
+DjVuPortcaster::add_to_closure(GFlatMap<const void *, void *> & set,
 			       const DjVuPort * dst, int distance)
 {
   // Assuming that the map's already locked
@@ -440,7 +440,7 @@ void
 DjVuPortcaster::compute_closure(const DjVuPort * src, GPList<DjVuPort> &list, bool sorted)
 {
    GCriticalSectionLock lock(&map_lock);
-   GMap<const void*, void*> set;
+   GFlatMap<const void*, void*> set;
    if (route_map.contains(src))
    {
       GList<void *> & list=*(GList<void *> *) route_map[src];
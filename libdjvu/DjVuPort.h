@@ -313,7 +313,7 @@ public:
    void		add_data(const GURL & url, const GP<DataPool> & pool);
 private:
    GCriticalSection	lock;
-   GPMap<GURL, DataPool>map;
+   GFlatPMap<GURL, DataPool>map;
 };
 
 
@@ -474,10 +474,10 @@ private:
       // We use these 'void *' to minimize template instantiations.
    friend class DjVuPort;
    GCriticalSection		map_lock;
-   GMap<const void *, void *>	route_map;	// GMap<DjVuPort *, GList<DjVuPort *> *>
-   GMap<const void *, void *>	cont_map;	// GMap<DjVuPort *, DjVuPort *>
-   GMap<GUTF8String, const void *>	a2p_map;	// GMap<GUTF8String, DjVuPort *>
-   void add_to_closure(GMap<const void*, void*> & set,
+   GFlatMap<const void *, void *>	route_map;	// GMap<DjVuPort *, GList<DjVuPort *> *>
+   GFlatMap<const void *, void *>	cont_map;	// GMap<DjVuPort *, DjVuPort *>
+   GFlatMap<GUTF8String, const void *>	a2p_map;	// GMap<GUTF8String, DjVuPort *>
+   void add_to_closure(GFlatMap<const void*, void*> & set,
                        const DjVuPort *dst, int distance);
    void compute_closure(const DjVuPort *src, GPList<DjVuPort> &list,
                         bool sorted=false);
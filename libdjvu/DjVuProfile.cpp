@@ -0,0 +1,379 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C- 
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free, 
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of 
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the 
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU 
+//C- | General Public License.   This grant only confers the right to 
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to 
+//C- | the extent such infringement is reasonably necessary to enable 
+//C- | recipient to make, have made, practice, sell, or otherwise dispose 
+//C- | of the LIZARDTECH ORIGINAL CODE (or portions thereof) and not to 
+//C- | any greater extent that may be necessary to utilize further 
+//C- | modifications or combinations.
+//C- |
+//C- | The LIZARDTECH ORIGINAL CODE is provided "AS IS" WITHOUT WARRANTY
+//C- | OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//C- | TO ANY WARRANTY OF NON-INFRINGEMENT, OR ANY IMPLIED WARRANTY OF
+//C- | MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+//C- +------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include "DjVuProfile.h"
+#include "GThreads.h"
+#include "GContainer.h"
+#include "Arrays.h"
+#include "ByteStream.h"
+
+#include <string.h>
+
+#if defined(_WIN32) && !defined(__CYGWIN32__)
+# include <windows.h>
+#else
+# include <time.h>
+# include <sys/time.h>
+#endif
+
+
+namespace DJVU {
+
+
+// Maximal number of recorded trace events
+static const int max_events = 1 << 20;
+
+int DjVuProfile::flags = 0;
+
+static const char *stage_names[DjVuProfile::NUM_STAGES] = {
+  "iw44-decode",
+  "iw44-reconstruct",
+  "jb2-decode",
+  "jb2-blit",
+  "bzz-decode",
+  "scale",
+  "composite",
+  "convert",
+  "data-wait",
+  "cache-hit",
+  "cache-miss",
+};
+
+// Profile attached to the current thread, and small thread number.
+static thread_local DjVuProfile *attached = 0;
+static thread_local int threadno = 0;
+static int nthreads = 0;
+
+struct TraceEvent
+{
+  int stage;
+  int label;
+  int thread;
+  long long start;
+  long long duration;
+};
+
+// Protects the counters and the trace data.
+static GCriticalSection &
+profile_lock(void)
+{
+  static GCriticalSection lock;
+  return lock;
+}
+
+// Trace data (protected by profile_lock)
+struct TraceData
+{
+  TArray<TraceEvent> events;
+  int nevents;
+  int dropped;
+  long long origin;
+  GArray<GUTF8String> labels;
+  GMap<GUTF8String,int> labelids;
+  TraceData() : nevents(0), dropped(0), origin(0) {}
+};
+
+static TraceData &
+trace(void)
+{
+  static TraceData data;
+  return data;
+}
+
+DjVuProfile::DjVuProfile(const GP<DjVuProfile> &xparent, 
+                         const GUTF8String &name)
+  : parent(xparent), label(-1)
+{
+  memset(counts, 0, sizeof(counts));
+  memset(times, 0, sizeof(times));
+  if (name.length())
+    {
+      GCriticalSectionLock lock(&profile_lock());
+      TraceData &t = trace();
+      GPosition p = t.labelids.contains(name);
+      if (p)
+        label = t.labelids[p];
+      else
+        {
+          label = t.labels.size();
+          t.labels.touch(label);
+          t.labels[label] = name;
+          t.labelids[name] = label;
+        }
+    }
+}
+
+GP<DjVuProfile>
+DjVuProfile::create(const GP<DjVuProfile> &parent, const GUTF8String &name)
+{
+  return new DjVuProfile(parent, name);
+}
+
+void
+DjVuProfile::enable(int xflags)
+{
+  GCriticalSectionLock lock(&profile_lock());
+  if ((xflags & TRACE) && !(flags & TRACE) && !trace().nevents)
+    trace().origin = now();
+  flags = xflags;
+}
+
+const char *
+DjVuProfile::stage_name(int stage)
+{
+  if (stage < 0 || stage >= NUM_STAGES)
+    return 0;
+  return stage_names[stage];
+}
+
+unsigned long
+DjVuProfile::get_count(int stage) const
+{
+  if (stage < 0 || stage >= NUM_STAGES)
+    return 0;
+  GCriticalSectionLock lock(&profile_lock());
+  return counts[stage];
+}
+
+double
+DjVuProfile::get_time(int stage) const
+{
+  if (stage < 0 || stage >= NUM_STAGES)
+    return 0;
+  GCriticalSectionLock lock(&profile_lock());
+  return times[stage] * 1e-9;
+}
+
+void
+DjVuProfile::reset(void)
+{
+  GCriticalSectionLock lock(&profile_lock());
+  memset(counts, 0, sizeof(counts));
+  memset(times, 0, sizeof(times));
+}
+
+GP<DjVuProfile>
+DjVuProfile::current(void)
+{
+  return attached;
+}
+
+DjVuProfile::Attach::Attach(DjVuProfile *profile)
+  : saved(attached)
+{
+  attached = profile;
+}
+
+DjVuProfile::Attach::~Attach()
+{
+  attached = saved;
+}
+
+void
+DjVuProfile::Timer::stop(void)
+{
+  add(stage, start, now() - start);
+}
+
+void
+DjVuProfile::add(Stage s, long long start, long long duration)
+{
+  DjVuProfile *p = attached;
+  GCriticalSectionLock lock(&profile_lock());
+  for (DjVuProfile *q = p; q; q = q->parent)
+    {
+      q->counts[s] += 1;
+      q->times[s] += duration;
+    }
+  if (flags & TRACE)
+    {
+      TraceData &t = trace();
+      if (t.nevents >= max_events)
+        {
+          t.dropped += 1;
+          return;
+        }
+      if (! threadno)
+        threadno = ++nthreads;
+      if (t.nevents >= t.events.size())
+        t.events.resize(0, (t.nevents > 0) ? 2 * t.nevents - 1 : 1023);
+      TraceEvent &e = t.events[t.nevents++];
+      e.stage = s;
+      e.label = (p) ? p->label : -1;
+      e.thread = threadno;
+      e.start = start;
+      e.duration = duration;
+    }
+}
+
+// Writes a JSON string.
+static void
+write_json_string(ByteStream &bs, const char *s)
+{
+  GUTF8String out = "\"";
+  for (; *s; s++)
+    {
+      unsigned char c = (unsigned char)*s;
+      if (c == '"' || c == '\\')
+        {
+          char buf[3] = { '\\', (char)c, 0 };
+          out += buf;
+        }
+      else if (c < 0x20)
+        {
+          char buf[8];
+          sprintf(buf, "\\u%04x", c);
+          out += buf;
+        }
+      else
+        {
+          char buf[2] = { (char)c, 0 };
+          out += buf;
+        }
+    }
+  out += "\"";
+  bs.writestring(out);
+}
+
+void
+DjVuProfile::save_trace(const GP<ByteStream> &gbs)
+{
+  ByteStream &bs = *gbs;
+  GCriticalSectionLock lock(&profile_lock());
+  TraceData &t = trace();
+  GMap<int,int> threads;
+  bs.writestring(GUTF8String("{\"traceEvents\":[\n"));
+  for (int i=0; i<t.nevents; i++)
+    {
+      const TraceEvent &e = t.events[i];
+      GUTF8String line;
+      if (e.duration > 0)
+        line.format("{\"name\":\"%s\",\"cat\":\"djvu\",\"ph\":\"X\","
+                    "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d",
+                    stage_names[e.stage], (e.start - t.origin) * 1e-3,
+                    e.duration * 1e-3, e.thread);
+      else
+        line.format("{\"name\":\"%s\",\"cat\":\"djvu\",\"ph\":\"i\",\"s\":\"t\","
+                    "\"ts\":%.3f,\"pid\":1,\"tid\":%d",
+                    stage_names[e.stage], (e.start - t.origin) * 1e-3,
+                    e.thread);
+      bs.writestring(line);
+      if (e.label >= 0)
+        {
+          bs.writestring(GUTF8String(",\"args\":{\"profile\":"));
+          write_json_string(bs, t.labels[e.label]);
+          bs.writestring(GUTF8String("}"));
+        }
+      bs.writestring(GUTF8String("},\n"));
+      threads[e.thread] = 1;
+    }
+  for (GPosition p = threads; p; ++p)
+    {
+      GUTF8String line;
+      line.format("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                  "\"args\":{\"name\":\"thread %d\"}},\n",
+                  threads.key(p), threads.key(p));
+      bs.writestring(line);
+    }
+  GUTF8String tail;
+  tail.format("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+              "\"args\":{\"name\":\"djvulibre\"}}\n],"
+              "\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%d}}\n",
+              t.dropped);
+  bs.writestring(tail);
+  t.events.empty();
+  t.nevents = 0;
+  t.dropped = 0;
+  t.origin = now();
+}
+
+void
+DjVuProfile::clear_trace(void)
+{
+  GCriticalSectionLock lock(&profile_lock());
+  TraceData &t = trace();
+  t.events.empty();
+  t.nevents = 0;
+  t.dropped = 0;
+  t.origin = now();
+}
+
+long long
+DjVuProfile::now(void)
+{
+#if defined(_WIN32) && !defined(__CYGWIN32__)
+  static LARGE_INTEGER freq;
+  LARGE_INTEGER count;
+  if (! freq.QuadPart)
+    QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return (long long)((double)count.QuadPart * 1e9 / freq.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return (long long)tv.tv_sec * 1000000000 + tv.tv_usec * 1000;
+#endif
+}
+
+
+}
+using namespace DJVU;
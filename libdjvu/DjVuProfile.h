@@ -0,0 +1,187 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C- 
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free, 
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of 
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the 
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU 
+//C- | General Public License.   This grant only confers the right to 
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to 
+//C- | the extent such infringement is reasonably necessary to enable 
+//C- | recipient to make, have made, practice, sell, or otherwise dispose 
+//C- | of the LIZARDTECH ORIGINAL CODE (or portions thereof) and not to 
+//C- | any greater extent that may be necessary to utilize further 
+//C- | modifications or combinations.
+//C- |
+//C- | The LIZARDTECH ORIGINAL CODE is provided "AS IS" WITHOUT WARRANTY
+//C- | OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//C- | TO ANY WARRANTY OF NON-INFRINGEMENT, OR ANY IMPLIED WARRANTY OF
+//C- | MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+//C- +------------------------------------------------------------------
+
+#ifndef _DJVUPROFILE_H
+#define _DJVUPROFILE_H
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/** @name DjVuProfile.h
+
+    Files #"DjVuProfile.h"# and #"DjVuProfile.cpp"# implement the
+    counters that measure the time spent in the main decoding and
+    rendering stages.  The timers are compiled in all builds but do
+    nothing until profiling is enabled with \Ref{DjVuProfile::enable}.
+
+    Each thread can be attached to a #DjVuProfile# object using
+    \Ref{DjVuProfile::Attach}.  Timed stages executed by this thread are
+    then added to this profile and to all its parents.  The decoding
+    thread of a #DjVuFile# inherits the profile attached to the thread
+    that started the decoding.  This is how the ddjvuapi accumulates
+    counters per page, per document and per context.
+
+    When tracing is enabled, each timed stage is also recorded as an event
+    which can be saved in the Chrome trace event format with
+    \Ref{DjVuProfile::save_trace}.
+
+    @memo Decoding and rendering profiling counters. */
+//@{
+
+
+#include "GSmartPointer.h"
+#include "GString.h"
+
+namespace DJVU {
+
+class ByteStream;
+
+/** Profiling counters. */
+
+class DJVUAPI DjVuProfile : public GPEnabled
+{
+protected:
+  DjVuProfile(const GP<DjVuProfile> &parent, const GUTF8String &name);
+public:
+  /** Creates a profile whose counters are also added to profile #parent#.
+      Argument #name# identifies the profile in the trace events. */
+  static GP<DjVuProfile> create(const GP<DjVuProfile> &parent = 0,
+                                const GUTF8String &name = GUTF8String());
+  /** Profiled stages.  The ddjvuapi enumeration
+      #ddjvu_profile_stage_t# uses the same numbers. */
+  enum Stage {
+    IW44_DECODE,       // ZP decoding of IW44 wavelet coefficients
+    IW44_RECONSTRUCT,  // IW44 wavelet reconstruction
+    JB2_DECODE,        // JB2 shape and dictionary decoding
+    JB2_BLIT,          // rendering JB2 shapes into a bitmap
+    BZZ_DECODE,        // BZZ decoding of text, annotations and directories
+    SCALE,             // scaling bitmaps and pixmaps
+    COMPOSITE,         // stenciling the foreground over the background
+    CONVERT,           // dithering and pixel format conversion
+    DATA_WAIT,         // waiting for data that has not arrived yet
+    CACHE_HIT,         // page files found in the decoded file cache
+    CACHE_MISS,        // page files created
+    NUM_STAGES
+  };
+  /** Profiling flags for \Ref{enable}. */
+  enum {
+    COUNTERS = 1,      // accumulate counters
+    TRACE = 2          // also record trace events
+  };
+  /** Enables profiling for the whole process.  Argument #flags# is a
+      combination of #COUNTERS# and #TRACE#.  Zero disables profiling. */
+  static void enable(int flags);
+  /** Returns the current profiling flags. */
+  static int get_flags(void) 
+    { return flags; }
+  /** Returns the name of stage #stage#. */
+  static const char *stage_name(int stage);
+  /** Returns the number of times stage #stage# was executed. */
+  unsigned long get_count(int stage) const;
+  /** Returns the time spent in stage #stage# in seconds.  Stages may be
+      nested.  The times are inclusive. */
+  double get_time(int stage) const;
+  /** Resets the counters of this profile. */
+  void reset(void);
+  /** Returns the profile attached to the current thread. */
+  static GP<DjVuProfile> current(void);
+  /** Attaches a profile to the current thread during its lifetime. */
+  class DJVUAPI Attach
+  {
+  public:
+    Attach(DjVuProfile *profile);
+    ~Attach();
+  private:
+    DjVuProfile *saved;
+  };
+  /** Times a stage during its lifetime. */
+  class DJVUAPI Timer
+  {
+  public:
+    Timer(Stage s) : stage(s), start(flags ? now() : 0) {}
+    ~Timer() { if (start) stop(); }
+  private:
+    Stage stage;
+    long long start;
+    void stop(void);
+  };
+  /** Counts an occurrence of a stage that is not timed. */
+  static void count(Stage s)
+    { if (flags) add(s, now(), 0); }
+  /** Writes the recorded trace events in the Chrome trace event format
+      (JSON) and clears them. */
+  static void save_trace(const GP<ByteStream> &bs);
+  /** Discards the recorded trace events. */
+  static void clear_trace(void);
+  /** Returns a monotonic time in nanoseconds. */
+  static long long now(void);
+private:
+  GP<DjVuProfile> parent;
+  int label;
+  unsigned long counts[NUM_STAGES];
+  long long times[NUM_STAGES];
+  static int flags;
+  static void add(Stage s, long long start, long long duration);
+};
+
+
+//@}
+
+// ----- THE END
+
+}
+using namespace DJVU;
+#endif
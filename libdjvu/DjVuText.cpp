@@ -61,6 +61,7 @@
 #include "DjVuText.h"
 #include "IFFByteStream.h"
 #include "BSByteStream.h"
+#include "GThreads.h"
 #include "debug.h"
 #include <ctype.h>
 
@@ -87,6 +88,9 @@ const char DjVuTXT::end_of_line      = 012;      // LF: Line Feed
 
 const int DjVuTXT::Zone::version  = 1;
 
+// Protects the lazy construction of the zone index
+static GCriticalSection zindex_lock;
+
 DjVuTXT::Zone::Zone()
   : ztype(DjVuTXT::PAGE), text_start(0), text_length(0), zone_parent(0)
 {
@@ -296,6 +300,7 @@ DjVuTXT::normalize_text()
   GUTF8String newtextUTF8;
   page_zone.normtext( (const char*)textUTF8, newtextUTF8 );
   textUTF8 = newtextUTF8;
+  clear_index();
 }
 
 int 
@@ -333,6 +338,7 @@ void
 DjVuTXT::decode(const GP<ByteStream> &gbs)
 {
   ByteStream &bs=*gbs;
+  clear_index();
   // Read text
   textUTF8.empty();
   int textsize = bs.read24();
@@ -354,7 +360,9 @@ DjVuTXT::decode(const GP<ByteStream> &gbs)
 GP<DjVuTXT> 
 DjVuTXT::copy(void) const
 {
-  return new DjVuTXT(*this);
+  GP<DjVuTXT> txt = new DjVuTXT(*this);
+  txt->zindex = 0;
+  return txt;
 }
 
 
@@ -370,6 +378,23 @@ intersects_zone(GRect box, const GRect &zone)
       :(box.ymin_ <= zone.ymax_));
 }
 
+static inline void
+merge_text_range(const int text_start, const int text_end,
+                 int &string_start, int &string_end)
+{
+  if(string_start == string_end)
+  {
+    string_start=text_start;
+    string_end=text_end;
+  }else
+  {
+    if (string_end < text_end)
+      string_end=text_end;
+    if(text_start < string_start)
+      string_start=text_start;
+  }
+}
+
 void
 DjVuTXT::Zone::get_text_with_rect(const GRect &box, 
                                   int &string_start, int &string_end) const
@@ -377,18 +402,8 @@ DjVuTXT::Zone::get_text_with_rect(const GRect &box,
   GPosition pos=children;
   if(pos?box.contains(rect):intersects_zone(box,rect))
   {
-    const int text_end=text_start+text_length;
-    if(string_start == string_end)
-    {
-      string_start=text_start;
-      string_end=text_end;
-    }else
-    {
-      if (string_end < text_end)
-        string_end=text_end;
-      if(text_start < string_start)
-        string_start=text_start;
-    }
+    merge_text_range(text_start,text_start+text_length,
+                     string_start,string_end);
   }else if(pos&&intersects_zone(box,rect))
   {
     do
@@ -500,6 +515,385 @@ DjVuTXT::get_zones(int zone_type, const Zone *parent,
    }
 }
 
+//***************************************************************************
+//****************************** ZoneIndex **********************************
+//***************************************************************************
+
+// The zone index is a packed R-tree over all zones of the hierarchy.  
+// Zones are stored in preorder (that is, in reading order), which makes
+// it possible to sort query results back into the order produced by 
+// the recursive functions.  The tree nodes are built bottom-up using the
+// sort-tile-recursive packing.  Leaf nodes list zone numbers.
+
+class DjVuTXT::ZoneIndex : public GPEnabled
+{
+public:
+  ZoneIndex(const Zone &page);
+  /** Computes the text range selected by #box# exactly as 
+      #Zone::get_text_with_rect# does on the page zone. */
+  void get_text_with_rect(const GRect &box, int &start, int &end) const;
+  /** Collects the numbers of the zones of type #ztype# below zone number
+      #parent#, as function #get_zones# would do, whose rectangle has a
+      non empty intersection with #box#. Results are in reading order. */
+  int get_zones(int ztype, int parent, const GRect &box, 
+                GTArray<int> &result) const;
+  /** Tells whether function #get_zones# finds any zone of type #ztype#
+      when called on the page zone. */
+  bool has_zones(int ztype) const
+    { return ztype > 0 && ztype < 8 && reachable[ztype]; }
+  Zone *zone(int n) const 
+    { return entries[n].zone; }
+  unsigned int memuse() const;
+private:
+  struct Entry {
+    Zone *zone;
+    int parent;
+    int depth;          // highest zone type among the ancestors
+  };
+  struct Node {
+    int xmin, ymin, xmax, ymax;
+    int first, count;
+  };
+  enum { nodesize = 8 };
+  GTArray<Entry> entries;
+  GTArray<int> items;
+  GTArray<Node> nodes;
+  GTArray<int> empties;
+  int nentries;
+  int nleaves;
+  int nnodes;
+  int nempties;
+  bool reachable[8];
+  int count(const Zone &zone);
+  void add(const Zone &zone, int parent, int depth);
+  int query(const GRect &box, GTArray<int> &result) const;
+  bool under(int n, int ztype, int parent) const;
+};
+
+struct zindex_key_s { int key; int item; };
+
+static int
+zindex_key_cmp(const void *a, const void *b)
+{
+  const zindex_key_s *ka = (const zindex_key_s*)a;
+  const zindex_key_s *kb = (const zindex_key_s*)b;
+  if (ka->key != kb->key)
+    return (ka->key < kb->key) ? -1 : 1;
+  return ka->item - kb->item;
+}
+
+static int
+zindex_int_cmp(const void *a, const void *b)
+{
+  return *(const int*)a - *(const int*)b;
+}
+
+// Function intersects_zone() accepts zones whose coordinates
+// xmin (resp. ymin) are larger than xmax (resp. ymax).  The bounds
+// of such zones range from xmin to xmin (resp. ymin to ymin).
+static inline int zmax(int a, int b) { return (a > b) ? a : b; }
+
+int
+DjVuTXT::ZoneIndex::count(const Zone &zone)
+{
+  int n = 1;
+  for (GPosition pos=zone.children; pos; ++pos)
+    n += count(zone.children[pos]);
+  return n;
+}
+
+void
+DjVuTXT::ZoneIndex::add(const Zone &zone, int parent, int depth)
+{
+  int n = nentries++;
+  Entry &e = entries[n];
+  e.zone = const_cast<Zone*>(&zone);
+  e.parent = parent;
+  e.depth = depth;
+  if (parent >= 0 && zone.ztype > 0 && zone.ztype < 8 && zone.ztype > depth)
+    reachable[zone.ztype] = true;
+  if (zone.children.size() && zone.rect.isempty())
+    empties[nempties++] = n;
+  if (zone.ztype > depth)
+    depth = zone.ztype;
+  for (GPosition pos=zone.children; pos; ++pos)
+    add(zone.children[pos], n, depth);
+}
+
+DjVuTXT::ZoneIndex::ZoneIndex(const Zone &page)
+  : nentries(0), nleaves(0), nnodes(0), nempties(0)
+{
+  for (int i=0; i<8; i++)
+    reachable[i] = false;
+  int n = count(page);
+  entries.resize(0, n-1);
+  empties.resize(0, n-1);
+  add(page, -1, 0);
+  empties.resize(0, nempties-1);
+  // Sort-tile-recursive packing of the leaves
+  GTArray<zindex_key_s> keys(0, n-1);
+  for (int i=0; i<n; i++)
+    {
+      const GRect &r = entries[i].zone->rect;
+      keys[i].key = (r.xmin_ + zmax(r.xmin_,r.xmax_)) / 2;
+      keys[i].item = i;
+    }
+  qsort(&keys[0], n, sizeof(zindex_key_s), zindex_key_cmp);
+  nleaves = (n + nodesize - 1) / nodesize;
+  int slices = 1;
+  while (slices * slices < nleaves)
+    slices += 1;
+  int slice = slices * nodesize;
+  for (int s=0; s<n; s+=slice)
+    {
+      int m = (n - s < slice) ? n - s : slice;
+      for (int i=s; i<s+m; i++)
+        {
+          const GRect &r = entries[keys[i].item].zone->rect;
+          keys[i].key = (r.ymin_ + zmax(r.ymin_,r.ymax_)) / 2;
+        }
+      qsort(&keys[s], m, sizeof(zindex_key_s), zindex_key_cmp);
+    }
+  items.resize(0, n-1);
+  for (int i=0; i<n; i++)
+    items[i] = keys[i].item;
+  // Count nodes
+  int total = 0;
+  for (int m=nleaves; ; m=(m+nodesize-1)/nodesize)
+    {
+      total += m;
+      if (m <= 1)
+        break;
+    }
+  nodes.resize(0, total-1);
+  // Leaves
+  for (int j=0; j<nleaves; j++)
+    {
+      Node &node = nodes[nnodes++];
+      node.first = j * nodesize;
+      node.count = (n - node.first < nodesize) ? n - node.first : nodesize;
+      for (int i=node.first; i<node.first+node.count; i++)
+        {
+          const GRect &r = entries[items[i]].zone->rect;
+          int xmin = r.xmin_;
+          int xmax = zmax(r.xmin_,r.xmax_);
+          int ymin = r.ymin_;
+          int ymax = zmax(r.ymin_,r.ymax_);
+          if (i == node.first || xmin < node.xmin) node.xmin = xmin;
+          if (i == node.first || ymin < node.ymin) node.ymin = ymin;
+          if (i == node.first || xmax > node.xmax) node.xmax = xmax;
+          if (i == node.first || ymax > node.ymax) node.ymax = ymax;
+        }
+    }
+  // Upper levels
+  int lo = 0;
+  int hi = nnodes;
+  while (hi - lo > 1)
+    {
+      for (int first=lo; first<hi; first+=nodesize)
+        {
+          Node &node = nodes[nnodes++];
+          node.first = first;
+          node.count = (hi - first < nodesize) ? hi - first : nodesize;
+          node.xmin = nodes[first].xmin;
+          node.ymin = nodes[first].ymin;
+          node.xmax = nodes[first].xmax;
+          node.ymax = nodes[first].ymax;
+          for (int i=first+1; i<first+node.count; i++)
+            {
+              const Node &c = nodes[i];
+              if (c.xmin < node.xmin) node.xmin = c.xmin;
+              if (c.ymin < node.ymin) node.ymin = c.ymin;
+              if (c.xmax > node.xmax) node.xmax = c.xmax;
+              if (c.ymax > node.ymax) node.ymax = c.ymax;
+            }
+        }
+      lo = hi;
+      hi = nnodes;
+    }
+}
+
+int
+DjVuTXT::ZoneIndex::query(const GRect &box, GTArray<int> &result) const
+{
+  // Returns a superset of the zones for which intersects_zone() 
+  // returns true, in no particular order.
+  int nresult = 0;
+  int stack[32 * nodesize];
+  int sp = 0;
+  stack[sp++] = nnodes - 1;
+  while (sp > 0)
+    {
+      int k = stack[--sp];
+      const Node &node = nodes[k];
+      if (box.xmax_ < node.xmin || box.xmin_ > node.xmax ||
+          box.ymax_ < node.ymin || box.ymin_ > node.ymax )
+        continue;
+      if (k < nleaves)
+        {
+          for (int i=node.first; i<node.first+node.count; i++)
+            {
+              if (nresult > result.hbound())
+                result.resize(0, 2 * nresult + nodesize);
+              result[nresult++] = items[i];
+            }
+        }
+      else
+        {
+          for (int i=node.first; i<node.first+node.count; i++)
+            stack[sp++] = i;
+        }
+    }
+  return nresult;
+}
+
+bool
+DjVuTXT::ZoneIndex::under(int n, int ztype, int parent) const
+{
+  // Tells whether get_zones(ztype, parent) finds zone number n.
+  if (n == parent || entries[n].zone->ztype != ztype)
+    return false;
+  if (parent == 0)
+    return entries[n].depth < ztype;
+  if (entries[parent].zone->ztype >= ztype)
+    return false;
+  for (int p=entries[n].parent; p>=0; p=entries[p].parent)
+    if (p == parent)
+      return true;
+    else if (entries[p].zone->ztype >= ztype)
+      return false;
+  return false;
+}
+
+int
+DjVuTXT::ZoneIndex::get_zones(int ztype, int parent, const GRect &box,
+                              GTArray<int> &result) const
+{
+  if (box.isempty())
+    return 0;
+  int nfound = query(box, result);
+  int nresult = 0;
+  for (int k=0; k<nfound; k++)
+    {
+      int n = result[k];
+      GRect rect;
+      if (under(n, ztype, parent) && rect.intersect(entries[n].zone->rect, box))
+        result[nresult++] = n;
+    }
+  if (nresult > 1)
+    qsort(&result[0], nresult, sizeof(int), zindex_int_cmp);
+  return nresult;
+}
+
+void
+DjVuTXT::ZoneIndex::get_text_with_rect(const GRect &box, 
+                                       int &start, int &end) const
+{
+  // The recursive algorithm stops on inner zones contained in the
+  // box and remains preferable when the box covers a large part of 
+  // the page.  The index wins for small boxes on dense pages.
+  const Zone &page = *entries[0].zone;
+  if (box.xmax_ < box.xmin_ || box.ymax_ < box.ymin_ || 
+      !page.children.size() || box.contains(page.rect) ||
+      !intersects_zone(box, page.rect) ||
+      (double)box.area() * 16 > (double)page.rect.area() )
+    {
+      page.get_text_with_rect(box, start, end);
+      return;
+    }
+  // Find the zones selected by the recursive algorithm:
+  // leaves intersecting the box and inner zones contained in the box,
+  // whose ancestors intersect the box without being contained in it.
+  // Inner zones with empty rectangles are always contained.
+  GTArray<int> found;
+  int nfound = query(box, found);
+  if (nempties)
+    {
+      found.resize(0, nfound + nempties - 1);
+      for (int i=0; i<nempties; i++)
+        found[nfound++] = empties[i];
+    }
+  int nsel = 0;
+  for (int k=0; k<nfound; k++)
+    {
+      int n = found[k];
+      const Zone &zone = *entries[n].zone;
+      if (n == 0)
+        continue;
+      if (zone.children.size() ? !box.contains(zone.rect) 
+                               : !intersects_zone(box, zone.rect))
+        continue;
+      int p = entries[n].parent;
+      while (p > 0)
+        {
+          const GRect &prect = entries[p].zone->rect;
+          if (box.contains(prect) || !intersects_zone(box, prect))
+            break;
+          p = entries[p].parent;
+        }
+      if (p == 0)
+        found[nsel++] = n;
+    }
+  if (nsel > 1)
+    qsort(&found[0], nsel, sizeof(int), zindex_int_cmp);
+  for (int k=0; k<nsel; k++)
+    if (k == 0 || found[k] != found[k-1])
+      {
+        const Zone &zone = *entries[found[k]].zone;
+        merge_text_range(zone.text_start, zone.text_start+zone.text_length,
+                         start, end);
+      }
+}
+
+unsigned int
+DjVuTXT::ZoneIndex::memuse() const
+{
+  return sizeof(*this) 
+    + entries.size() * sizeof(Entry)
+    + items.size() * sizeof(int)
+    + nodes.size() * sizeof(Node)
+    + empties.size() * sizeof(int);
+}
+
+GP<DjVuTXT::ZoneIndex>
+DjVuTXT::get_index() const
+{
+  GCriticalSectionLock lock(&zindex_lock);
+  if (! zindex)
+    const_cast<DjVuTXT*>(this)->zindex = new ZoneIndex(page_zone);
+  return zindex;
+}
+
+void
+DjVuTXT::clear_index()
+{
+  GCriticalSectionLock lock(&zindex_lock);
+  zindex = 0;
+}
+
+void
+DjVuTXT::get_zones(int zone_type, const GRect &box, 
+                   GList<Zone *> & zone_list) const
+{
+  GP<ZoneIndex> index = get_index();
+  GTArray<int> found;
+  int nfound = index->get_zones(zone_type, 0, box, found);
+  for (int k=0; k<nfound; k++)
+    zone_list.append(index->zone(found[k]));
+}
+
+DjVuTXT::Zone *
+DjVuTXT::get_zone_at(int x, int y, int zone_type) const
+{
+  GP<ZoneIndex> index = get_index();
+  GTArray<int> found;
+  int nfound = index->get_zones(zone_type, 0, GRect(x, y, 1, 1), found);
+  for (int k=0; k<nfound; k++)
+    if (index->zone(found[k])->rect.contains(x, y))
+      return index->zone(found[k]);
+  return 0;
+}
+
 GList<GRect>
 DjVuTXT::find_text_with_rect(const GRect &box, GUTF8String &text, 
                              const int padding) const
@@ -507,7 +901,7 @@ DjVuTXT::find_text_with_rect(const GRect &box, GUTF8String &text,
   GList<GRect> retval;
   int text_start=0;
   int text_end=0;
-  page_zone.get_text_with_rect(box,text_start,text_end);
+  get_index()->get_text_with_rect(box,text_start,text_end);
   if(text_start != text_end)
   {
     GList<Zone *> zones;
@@ -538,30 +932,32 @@ DjVuTXT::find_text_in_rect(GRect target_rect, GUTF8String &text) const
 {
    GList<Zone *> zone_list;
    GList<Zone *> lines;
+   GP<ZoneIndex> index = get_index();
+   GTArray<int> found;
 
-   get_zones((int)PARAGRAPH, &page_zone, zone_list);
    // it's possible that no paragraph structure exists for reasons that  
    // 1) ocr engine is not capable 2) file was modified by user. In such case, 
    // we can only make a rough guess, i.e., select all the lines intersected with
    // target_rect
-   if (zone_list.isempty())
+   if (!index->has_zones((int)PARAGRAPH))
    {
-      get_zones((int)LINE, &page_zone, zone_list);
-      GPosition pos;
-      for(pos=zone_list; pos; ++pos)
+      int nfound=index->get_zones((int)LINE, 0, target_rect, found);
+      for(int k=0; k<nfound; k++)
       {
-	 GRect rect=zone_list[pos]->rect;
+	 Zone *zone=index->zone(found[k]);
+	 GRect rect=zone->rect;
 	 int h0=rect.height()/2;
 	 if(rect.intersect(rect,target_rect) && rect.height()>h0)
-	    lines.append(zone_list[pos]);
+	    lines.append(zone);
       }
    } else 
    {
-      GPosition pos, pos_sel=zone_list;
+      int nfound=index->get_zones((int)PARAGRAPH, 0, target_rect, found);
+      int sel=-1;
       float ar=0;
-      for(pos=zone_list; pos; ++pos)
+      for(int k=0; k<nfound; k++)
       {
-	 GRect rect=zone_list[pos]->rect;
+	 GRect rect=index->zone(found[k])->rect;
 	 int area=rect.area();
 	 if (rect.intersect(rect, target_rect))
 	 {
@@ -569,25 +965,20 @@ DjVuTXT::find_text_in_rect(GRect target_rect, GUTF8String &text) const
 	    if ( !ar || ar<ftmp )
 	    {
 	       ar=ftmp;
-	       pos_sel=pos;
+	       sel=found[k];
 	    }
 	 }
       }
-      Zone *parag = 0;
-      if ( ar>0 ) parag=zone_list[pos_sel];
-      zone_list.empty();
       if ( ar>0 ) 
       {
-	 get_zones((int)LINE, parag, zone_list);
-	 if ( !zone_list.isempty() )
+	 nfound=index->get_zones((int)LINE, sel, target_rect, found);
+	 for(int k=0; k<nfound; k++)
 	 {
-	    for(GPosition pos=zone_list; pos; ++pos)
-	    {
-	       GRect rect=zone_list[pos]->rect;
-	       int h0=rect.height()/2;
-	       if(rect.intersect(rect,target_rect) && rect.height()>h0)
-		  lines.append(zone_list[pos]);
-	    }
+	    Zone *zone=index->zone(found[k]);
+	    GRect rect=zone->rect;
+	    int h0=rect.height()/2;
+	    if(rect.intersect(rect,target_rect) && rect.height()>h0)
+	       lines.append(zone);
 	 }
       }
    }
@@ -665,7 +1056,12 @@ DjVuTXT::find_text_in_rect(GRect target_rect, GUTF8String &text) const
 unsigned int 
 DjVuTXT::get_memory_usage() const
 {
-  return sizeof(*this) + textUTF8.length() + page_zone.memuse() - sizeof(page_zone); 
+  unsigned int usage = sizeof(*this) + textUTF8.length() 
+    + page_zone.memuse() - sizeof(page_zone); 
+  GCriticalSectionLock lock(&zindex_lock);
+  if (zindex)
+    usage += zindex->memuse();
+  return usage;
 }
 
 
@@ -201,9 +201,27 @@ public:
   /** Get all zones of zone type zone_type under node parent. 
       zone_list contains the return value. */
   void get_zones(int zone_type, const Zone *parent, GList<Zone *> & zone_list) const;
+  /** Get all zones of zone type #zone_type# whose rectangle intersects
+      rectangle #box#, in reading order.  This function uses the spatial
+      index and does not visit the whole zone hierarchy. */
+  void get_zones(int zone_type, const GRect &box, GList<Zone *> & zone_list) const;
+  /** Returns the first zone of type #zone_type# (in reading order) 
+      whose rectangle contains pixel (#x#,#y#), or zero if there is none.
+      This function uses the spatial index. */
+  Zone *get_zone_at(int x, int y, int zone_type=WORD) const;
+  /** Discards the spatial index.  The functions that search zones by
+      location use a spatial index that is built the first time it is
+      needed.  This function must be called after modifying the zone 
+      hierarchy of an object that has already been searched.
+      Functions #decode# and #normalize_text# call it automatically. */
+  void clear_index();
   /** Returns the number of bytes needed by this data structure. It's
       used by caching routines to estimate the size of a \Ref{DjVuImage}. */
   unsigned int get_memory_usage() const;
+private:
+  class ZoneIndex;
+  GP<ZoneIndex> zindex;
+  GP<ZoneIndex> get_index() const;
 };
 
 inline const DjVuTXT::Zone *
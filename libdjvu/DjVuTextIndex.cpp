@@ -0,0 +1,390 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C- 
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free, 
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of 
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the 
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU 
+//C- | General Public License.   This grant only confers the right to 
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to 
+//C- | the extent such infringement is reasonably necessary to enable 
+//C- | recipient to make, have made, practice, sell, or otherwise dispose 
+//C- | of the LIZARDTECH ORIGINAL CODE (or portions thereof) and not to 
+//C- | any greater extent that may be necessary to utilize further 
+//C- | modifications or combinations.
+//C- |
+//C- | The LIZARDTECH ORIGINAL CODE is provided "AS IS" WITHOUT WARRANTY
+//C- | OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//C- | TO ANY WARRANTY OF NON-INFRINGEMENT, OR ANY IMPLIED WARRANTY OF
+//C- | MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+//C- +------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "DjVuTextIndex.h"
+#include "DjVuDocument.h"
+#include "DjVuFile.h"
+#include "IFFByteStream.h"
+#include "BSByteStream.h"
+#include "ByteStream.h"
+#include "debug.h"
+#include <ctype.h>
+
+
+namespace DJVU {
+
+
+static const int tidx_version = 2;
+
+DjVuTextIndex::DjVuTextIndex(void)
+  : npages(0)
+{
+}
+
+// ---------------------------------------- POSTINGS
+
+void
+DjVuTextIndex::Postings::append(const Posting &p)
+{
+  if (count >= list.size())
+    list.resize(0, count + (count < 8 ? 8 : count) - 1);
+  list[count++] = p;
+}
+
+int
+DjVuTextIndex::Postings::find(int page, int word) const
+{
+  // Postings are sorted by page and word number.
+  int lo = 0;
+  int hi = count - 1;
+  while (lo <= hi)
+    {
+      int mid = (lo + hi) >> 1;
+      const Posting &p = list[mid];
+      if (p.page < page || (p.page == page && p.word < word))
+        lo = mid + 1;
+      else if (p.page == page && p.word == word)
+        return mid;
+      else
+        hi = mid - 1;
+    }
+  return -1;
+}
+
+// ---------------------------------------- BUILDING
+
+GUTF8String
+DjVuTextIndex::normalize(const GUTF8String &word)
+{
+  const char *s = (const char*)word;
+  int beg = 0;
+  int end = word.length();
+  while (beg < end && (unsigned char)s[beg] < 0x80 
+         && (isspace(s[beg]) || ispunct(s[beg])))
+    beg++;
+  while (end > beg && (unsigned char)s[end-1] < 0x80 
+         && (isspace(s[end-1]) || ispunct(s[end-1])))
+    end--;
+  if (beg >= end)
+    return GUTF8String();
+  return word.substr(beg, end-beg).downcase();
+}
+
+void
+DjVuTextIndex::add_word(const GUTF8String &word, int page, int &rank,
+                        int text_start, const GRect &rect)
+{
+  GUTF8String term = normalize(word);
+  if (! term.length())
+    return;
+  GPosition pos;
+  if (! terms.contains(term, pos))
+    {
+      terms[term] = new Postings;
+      terms.contains(term, pos);
+    }
+  Posting p;
+  p.page = page;
+  p.word = rank++;
+  p.text_start = text_start;
+  p.rect = rect;
+  terms[pos]->append(p);
+}
+
+void
+DjVuTextIndex::add_zone(const DjVuTXT &txt, const DjVuTXT::Zone &zone,
+                        int page, int &rank)
+{
+  if (zone.ztype >= DjVuTXT::WORD)
+    {
+      // One token per word zone
+      add_word(txt.textUTF8.substr(zone.text_start, zone.text_length),
+               page, rank, zone.text_start, zone.rect);
+    }
+  else if (zone.children.size())
+    {
+      for (GPosition pos=zone.children; pos; ++pos)
+        add_zone(txt, zone.children[pos], page, rank);
+    }
+  else
+    {
+      // Leaf zone above word level: split the text on blanks
+      // and give each word the rectangle of the zone.
+      const char *s = (const char*)txt.textUTF8;
+      int end = zone.text_start + zone.text_length;
+      if (end > (int)txt.textUTF8.length())
+        end = txt.textUTF8.length();
+      int i = zone.text_start;
+      while (i < end)
+        {
+          while (i < end && (unsigned char)s[i] <= ' ')
+            i++;
+          int start = i;
+          while (i < end && (unsigned char)s[i] > ' ')
+            i++;
+          if (i > start)
+            add_word(txt.textUTF8.substr(start, i-start),
+                     page, rank, start, zone.rect);
+        }
+    }
+}
+
+void
+DjVuTextIndex::add_page(int page, const DjVuTXT &txt)
+{
+  if (page < npages)
+    G_THROW( ERR_MSG("DjVuTextIndex.page_order") );
+  int rank = 0;
+  add_zone(txt, txt.page_zone, page, rank);
+  if (page >= npages)
+    npages = page + 1;
+}
+
+void
+DjVuTextIndex::add_document(DjVuDocument &doc)
+{
+  int pages = doc.get_pages_num();
+  for (int page=0; page<pages; page++)
+    {
+      GP<DjVuFile> file = doc.get_djvu_file(page);
+      if (! file)
+        continue;
+      GP<ByteStream> bs = file->get_text();
+      if (bs)
+        {
+          GP<DjVuText> text = DjVuText::create();
+          text->decode(bs);
+          if (text->txt)
+            add_page(page, *text->txt);
+        }
+      if (page >= npages)
+        npages = page + 1;
+    }
+}
+
+// ---------------------------------------- SEARCHING
+
+void
+DjVuTextIndex::search(const GUTF8String &phrase, 
+                      GList<Hit> &hits, int maxhits) const
+{
+  hits.empty();
+  // Split and normalize the phrase
+  GPArray<Postings> words;
+  int nwords = 0;
+  const char *s = (const char*)phrase;
+  int len = phrase.length();
+  int i = 0;
+  while (i < len)
+    {
+      while (i < len && (unsigned char)s[i] <= ' ')
+        i++;
+      int start = i;
+      while (i < len && (unsigned char)s[i] > ' ')
+        i++;
+      if (i > start)
+        {
+          GUTF8String term = normalize(phrase.substr(start, i-start));
+          if (! term.length())
+            continue;
+          GPosition pos = terms.contains(term);
+          if (! pos)
+            return;
+          words.touch(nwords);
+          words[nwords++] = terms[pos];
+        }
+    }
+  if (! nwords)
+    return;
+  // Anchor the search on the rarest word
+  int r = 0;
+  for (i=1; i<nwords; i++)
+    if (words[i]->count < words[r]->count)
+      r = i;
+  const Postings &anchor = *words[r];
+  for (int k=0; k<anchor.count; k++)
+    {
+      if (maxhits >= 0 && hits.size() >= maxhits)
+        break;
+      const Posting &p = anchor.list[k];
+      int first = p.word - r;
+      GRect rect = p.rect;
+      for (i=0; i<nwords; i++)
+        if (i != r)
+          {
+            int n = words[i]->find(p.page, first + i);
+            if (n < 0)
+              break;
+            rect.recthull(GRect(rect), words[i]->list[n].rect);
+          }
+      if (i >= nwords)
+        {
+          Hit hit;
+          hit.page = p.page;
+          hit.rect = rect;
+          hits.append(hit);
+        }
+    }
+}
+
+// ---------------------------------------- ENCODING
+
+void
+DjVuTextIndex::encode(const GP<ByteStream> &gbs) const
+{
+  GP<IFFByteStream> giff = IFFByteStream::create(gbs);
+  IFFByteStream &iff = *giff;
+  iff.put_chunk("FORM:TIDX");
+  iff.put_chunk("TIDz");
+  {
+    GP<ByteStream> gzbs = BSByteStream::create(iff.get_bytestream(), 1024);
+    ByteStream &zbs = *gzbs;
+    zbs.write8(tidx_version);
+    zbs.write24(npages);
+    zbs.write24(terms.size());
+    for (GPosition pos=terms; pos; ++pos)
+      {
+        const GUTF8String &term = terms.key(pos);
+        const Postings &postings = *terms[pos];
+        zbs.write16(term.length());
+        zbs.writall((const char*)term, term.length());
+        zbs.write24(postings.count);
+        for (int k=0; k<postings.count; k++)
+          {
+            const Posting &p = postings.list[k];
+            zbs.write24(p.page);
+            zbs.write24(p.word);
+            zbs.write24(p.text_start);
+            zbs.write32(p.rect.xmin_);
+            zbs.write32(p.rect.ymin_);
+            zbs.write32(p.rect.width());
+            zbs.write32(p.rect.height());
+          }
+      }
+  }
+  iff.close_chunk();
+  iff.close_chunk();
+}
+
+void
+DjVuTextIndex::decode(const GP<ByteStream> &gbs)
+{
+  GP<IFFByteStream> giff = IFFByteStream::create(gbs);
+  IFFByteStream &iff = *giff;
+  GUTF8String chkid;
+  if (! iff.get_chunk(chkid) || chkid != "FORM:TIDX")
+    G_THROW( ERR_MSG("DjVuTextIndex.not_index") );
+  terms.empty();
+  npages = 0;
+  while (iff.get_chunk(chkid))
+    {
+      if (chkid == "TIDz")
+        {
+          GP<ByteStream> gzbs = BSByteStream::create(iff.get_bytestream());
+          ByteStream &zbs = *gzbs;
+          int version = zbs.read8();
+          if (version != tidx_version)
+            G_THROW( ERR_MSG("DjVuTextIndex.bad_version") "\t" 
+                     + GUTF8String(version) );
+          npages = zbs.read24();
+          int nterms = zbs.read24();
+          for (int t=0; t<nterms; t++)
+            {
+              int len = zbs.read16();
+              GUTF8String term;
+              char *buf = term.getbuf(len);
+              zbs.readall(buf, len);
+              GP<Postings> postings = new Postings;
+              int count = zbs.read24();
+              postings->list.resize(0, count-1);
+              for (int k=0; k<count; k++)
+                {
+                  Posting &p = postings->list[k];
+                  p.page = zbs.read24();
+                  p.word = zbs.read24();
+                  p.text_start = zbs.read24();
+                  int xmin = (int)zbs.read32();
+                  int ymin = (int)zbs.read32();
+                  int w = (int)zbs.read32();
+                  int h = (int)zbs.read32();
+                  p.rect = GRect(xmin, ymin, w, h);
+                }
+              postings->count = count;
+              terms[term] = postings;
+            }
+        }
+      iff.close_chunk();
+    }
+  iff.close_chunk();
+}
+
+unsigned int
+DjVuTextIndex::get_memory_usage(void) const
+{
+  unsigned int usage = sizeof(*this);
+  for (GPosition pos=terms; pos; ++pos)
+    {
+      usage += sizeof(Postings) + terms.key(pos).length() + 32;
+      usage += terms[pos]->list.size() * sizeof(Posting);
+    }
+  return usage;
+}
+
+
+}
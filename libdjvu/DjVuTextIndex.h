@@ -0,0 +1,169 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C- 
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free, 
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of 
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the 
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU 
+//C- | General Public License.   This grant only confers the right to 
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to 
+//C- | the extent such infringement is reasonably necessary to enable 
+//C- | recipient to make, have made, practice, sell, or otherwise dispose 
+//C- | of the LIZARDTECH ORIGINAL CODE (or portions thereof) and not to 
+//C- | any greater extent that may be necessary to utilize further 
+//C- | modifications or combinations.
+//C- |
+//C- | The LIZARDTECH ORIGINAL CODE is provided "AS IS" WITHOUT WARRANTY
+//C- | OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//C- | TO ANY WARRANTY OF NON-INFRINGEMENT, OR ANY IMPLIED WARRANTY OF
+//C- | MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+//C- +------------------------------------------------------------------
+
+#ifndef _DJVUTEXTINDEX_H
+#define _DJVUTEXTINDEX_H
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/** @name DjVuTextIndex.h
+
+    Files #"DjVuTextIndex.h"# and #"DjVuTextIndex.cpp"# implement a full
+    text index for the hidden text of a whole document.  Searching the text
+    of a document otherwise requires decoding the #TXTz# chunk of every page
+    and scanning the text sequentially.  The index maps each normalized word
+    to the list of its occurrences (page number, word number, text offset
+    and word rectangle).  Phrase queries are then answered without decoding
+    any page data.
+
+    The index is stored in a separate file containing a #FORM:TIDX#
+    with a single BZZ compressed #TIDz# chunk.  It is created by
+    command #save-txt-index# of program #djvused# and can be queried with
+    \Ref{ddjvu_document_search_text}.
+
+    @memo Full text index for document hidden text. */
+//@{
+
+
+#include "DjVuText.h"
+
+namespace DJVU {
+
+class ByteStream;
+class DjVuDocument;
+
+/** Full text index for a document. */
+
+class DJVUAPI DjVuTextIndex : public GPEnabled
+{
+protected:
+  DjVuTextIndex(void);
+public:
+  /// Default creator.
+  static GP<DjVuTextIndex> create(void) {return new DjVuTextIndex();}
+  /** Occurrence of a word. */
+  struct Posting
+  {
+    /// Page number (starting with 0).
+    int page;
+    /// Rank of the word in the page reading order.
+    int word;
+    /// Offset of the word text in the page text #DjVuTXT::textUTF8#.
+    int text_start;
+    /// Rectangle of the word.
+    GRect rect;
+  };
+  /** Occurrence of a phrase. */
+  struct Hit
+  {
+    /// Page number (starting with 0).
+    int page;
+    /// Rectangle covering the words of the phrase.
+    GRect rect;
+  };
+  /** Adds the words of the hidden text #txt# of page #page#.  Pages
+      must be added in increasing order. */
+  void add_page(int page, const DjVuTXT &txt);
+  /** Adds the hidden text of all pages of document #doc#. */
+  void add_document(DjVuDocument &doc);
+  /** Returns the number of pages covered by the index. */
+  int get_pages_num(void) const 
+    { return npages; }
+  /** Returns the number of distinct words. */
+  int get_words_num(void) const 
+    { return terms.size(); }
+  /** Searches the occurrences of a phrase.  The phrase is split into words
+      which are normalized with \Ref{normalize}.  Stores into #hits# at
+      most #maxhits# hits (all hits when #maxhits# is negative) in page
+      order. */
+  void search(const GUTF8String &phrase, 
+              GList<Hit> &hits, int maxhits=-1) const;
+  /** Normalizes a word: converts it to lower case and removes the
+      leading and trailing punctuation. */
+  static GUTF8String normalize(const GUTF8String &word);
+  /** Writes the index file. */
+  void encode(const GP<ByteStream> &bs) const;
+  /** Reads an index file. */
+  void decode(const GP<ByteStream> &bs);
+  /** Returns the number of bytes needed by this data structure. */
+  unsigned int get_memory_usage(void) const;
+private:
+  class Postings : public GPEnabled
+  {
+  public:
+    Postings() : count(0) {}
+    GTArray<Posting> list;
+    int count;
+    void append(const Posting &p);
+    int find(int page, int word) const;
+  };
+  int npages;
+  GFlatPMap<GUTF8String, Postings> terms;
+  void add_word(const GUTF8String &word, int page, int &rank, 
+                int text_start, const GRect &rect);
+  void add_zone(const DjVuTXT &txt, const DjVuTXT::Zone &zone, 
+                int page, int &rank);
+};
+
+
+//@}
+
+// ----- THE END
+
+}
+using namespace DJVU;
+#endif
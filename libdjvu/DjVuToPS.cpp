@@ -61,6 +61,7 @@
 #include "DjVuToPS.h"
 #include "IFFByteStream.h"
 #include "BSByteStream.h"
+#include "FlateByteStream.h"
 #include "DjVuImage.h"
 #include "DjVuText.h"
 #include "DataPool.h"
@@ -73,6 +74,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include <math.h>
 #ifdef UNIX
@@ -109,7 +111,8 @@ Options(void)
   bookletmax(0),
   bookletalign(0),
   bookletfold(18),
-  bookletxfold(200)
+  bookletxfold(200),
+  threads(1)
 {}
 
 void
@@ -247,6 +250,13 @@ set_bookletfold(int fold, int xfold)
     bookletxfold = xfold;
 }
 
+void 
+DjVuToPS::Options::
+set_threads(int xthreads)
+{
+  threads = (xthreads < 0) ? 0 : xthreads;
+}
+
 
 // ***************************************************************************
 // ******************************* DjVuToPS **********************************
@@ -414,7 +424,7 @@ store_doc_setup(ByteStream &str)
                   "%%%%EndFeature\n"
                   "} stopped cleartomark\n");
         }
-      if (options.get_color())
+      if (options.get_color() && options.get_level()<3)
         write(str, 
               "%% -- procs for reading color image\n"
               "/readR () def\n"
@@ -446,6 +456,16 @@ store_doc_setup(ByteStream &str)
               "   readB length 0 eq { ReadData } if\n"
               "   readB /readB () def\n"
               "} bind def\n");
+      if (options.get_level()>=3)
+        write(str, 
+              "%% -- procs for reading compressed image\n"
+              "/FlateImage {\n"
+              "   currentfile /ASCII85Decode filter\n"
+              "   dup 3 -1 roll /FlateDecode filter\n"
+              "   2 index /DataSource 2 index put\n"
+              "   3 -1 roll image\n"
+              "   flushfile flushfile\n"
+              "} bind def\n");
       write(str,
             "%% -- procs for foreground layer\n"
             "/g {gsave 0 0 0 0 5 index 5 index setcachedevice\n"
@@ -550,6 +570,18 @@ store_doc_trailer(ByteStream &str)
 // ***************************** PAGE LEVEL ******************************
 // ***********************************************************************
 
+static inline unsigned char *
+ASCII85_group(unsigned char *dst, const unsigned char *ptr)
+{
+  unsigned int num = (ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3];
+  dst[4] = num % 85 + 33; num /= 85;
+  dst[3] = num % 85 + 33; num /= 85;
+  dst[2] = num % 85 + 33; num /= 85;
+  dst[1] = num % 85 + 33;
+  dst[0] = num / 85 + 33;
+  return dst + 5;
+}
+
 static unsigned char *
 ASCII85_encode(unsigned char * dst, 
                const unsigned char * src_start,
@@ -560,9 +592,18 @@ ASCII85_encode(unsigned char * dst,
      output the result into the destination buffer pointed by #dst#.  The
      function returns pointer to the first unused byte in the destination
      buffer. */
+  const unsigned char * ptr = src_start;
+  // Fast path: complete lines of 15 groups followed by more data.
+  // The line loop has no data dependent branches.
+  while (src_end - ptr > 60)
+    {
+      for (int i=0; i<15; i++, ptr+=4)
+        dst = ASCII85_group(dst, ptr);
+      *dst++ = '\n';
+    }
+  // Last line.
   int symbols=0;
-  const unsigned char * ptr;
-  for(ptr=src_start;ptr<src_end;ptr+=4)
+  for(;ptr<src_end;ptr+=4)
     {
       unsigned int num=0;
       if (ptr+3<src_end)
@@ -604,6 +645,183 @@ ASCII85_encode(unsigned char * dst,
   return dst;
 }
 
+// A ByteStream encoding data in ASCII85 into another ByteStream.
+// Function #close# encodes the last bytes and the end marker.
+class ASCII85ByteStream : public ByteStream
+{
+public:
+  ASCII85ByteStream(ByteStream &out) : out(out), n(0), offset(0) {}
+  virtual size_t write(const void *buffer, size_t size);
+  virtual long tell(void) const { return offset; }
+  void close(void);
+private:
+  ByteStream &out;
+  unsigned char in[3000];
+  unsigned char enc[3900];
+  int n;
+  long offset;
+};
+
+size_t
+ASCII85ByteStream::write(const void *buffer, size_t size)
+{
+  const unsigned char *data = (const unsigned char*)buffer;
+  size_t copied = 0;
+  while (copied < size)
+    {
+      int bytes = (int)sizeof(in) - n;
+      if (bytes > (int)(size - copied))
+        bytes = size - copied;
+      memcpy(in+n, data+copied, bytes);
+      n += bytes;
+      copied += bytes;
+      if (n == (int)sizeof(in))
+        {
+          unsigned char *end = ASCII85_encode(enc, in, in+n);
+          *end++ = '\n';
+          out.writall(enc, end-enc);
+          n = 0;
+        }
+    }
+  offset += copied;
+  return copied;
+}
+
+void
+ASCII85ByteStream::close(void)
+{
+  unsigned char *end = ASCII85_encode(enc, in, in+n);
+  *end++ = '~'; 
+  *end++ = '>'; 
+  *end++ = '\n';
+  out.writall(enc, end-enc);
+  n = 0;
+}
+
+static void
+write_flate_string(ByteStream &str, const unsigned char *data, int size)
+{
+  /* Outputs a PostScript expression producing a string with the #size#
+     bytes pointed by #data#.  The expression decodes deflate compressed
+     data when this saves space, and is a plain ASCII85 string otherwise. */
+  GP<ByteStream> mem = ByteStream::create();
+  {
+    GP<ByteStream> z = FlateByteStream::create(mem);
+    z->writall(data, size);
+  }
+  int zsize = mem->tell();
+  bool compress = (zsize + 40 < size);
+  unsigned char *zdata;
+  GPBuffer<unsigned char> gzdata(zdata, (compress) ? zsize : 0);
+  const unsigned char *src = data;
+  int srcsize = size;
+  if (compress)
+    {
+      mem->seek(0);
+      mem->readall(zdata, zsize);
+      src = zdata;
+      srcsize = zsize;
+    }
+  unsigned char *enc;
+  GPBuffer<unsigned char> genc(enc, srcsize*2+8);
+  unsigned char *end = enc;
+  *end++ = '<'; 
+  *end++ = '~';
+  end = ASCII85_encode(end, src, src+srcsize);
+  *end++ = '~'; 
+  *end++ = '>';
+  str.writall(enc, end-enc);
+  if (compress)
+    write(str, " /FlateDecode filter %d string readstring pop", size);
+}
+
+static const unsigned char *
+PNG_predict(unsigned char *buf, const unsigned char *row, 
+            const unsigned char *prev, int bytes, int bpp)
+{
+  /* Applies the PNG predictor that minimizes the sum of the absolute
+     residuals among filters Sub, Up and Paeth.  Argument #buf# must
+     have room for #2*bytes+2# bytes. Returns a pointer to the filter
+     type byte followed by the residuals. */
+  unsigned char *best = 0;
+  unsigned int bestcost = 0;
+  static const int types[3] = { 1, 2, 4 };
+  for (int t=0; t<3; t++)
+    {
+      int type = types[t];
+      unsigned char *out = (best == buf) ? buf + bytes + 1 : buf;
+      unsigned int cost = 0;
+      out[0] = type;
+      for (int i=0; i<bytes; i++)
+        {
+          int a = (i >= bpp) ? row[i-bpp] : 0;
+          int b = prev[i];
+          int p = a;
+          if (type == 2)
+            p = b;
+          else if (type == 4)
+            {
+              int c = (i >= bpp) ? prev[i-bpp] : 0;
+              int pa = abs(b - c);
+              int pb = abs(a - c);
+              int pc = abs(a + b - 2*c);
+              p = (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+            }
+          unsigned char r = row[i] - p;
+          out[i+1] = r;
+          cost += (r < 128) ? r : 256 - r;
+        }
+      if (!best || cost < bestcost)
+        {
+          best = out;
+          bestcost = cost;
+        }
+    }
+  return best;
+}
+
+// Tests whether a 64 bits word contains a zero byte.
+#define HASZERO(x) \
+  (((x) - (uint64_t)0x0101010101010101ULL) & ~(x) & (uint64_t)0x8080808080808080ULL)
+
+static inline const unsigned char *
+RLE_find_pair(const unsigned char *ptr, const unsigned char *lim)
+{
+  // Returns the first ptr in [ptr,lim) such that ptr[0]==ptr[1], or lim.
+  // Compares eight pairs at once.
+  while (lim - ptr >= 8)
+    {
+      uint64_t a, b;
+      memcpy(&a, ptr, 8);
+      memcpy(&b, ptr+1, 8);
+      uint64_t x = a ^ b;
+      if (HASZERO(x))
+        break;
+      ptr += 8;
+    }
+  while (ptr < lim && ptr[0] != ptr[1])
+    ptr++;
+  return ptr;
+}
+
+static inline const unsigned char *
+RLE_find_change(const unsigned char *ptr, const unsigned char *lim)
+{
+  // Returns the first ptr in [ptr,lim) such that ptr[0]!=ptr[1], or lim.
+  while (lim - ptr >= 8)
+    {
+      uint64_t a, b;
+      memcpy(&a, ptr, 8);
+      memcpy(&b, ptr+1, 8);
+      if (a != b)
+        break;
+      ptr += 8;
+    }
+  while (ptr < lim && ptr[0] == ptr[1])
+    ptr++;
+  return ptr;
+}
+
 static unsigned char *
 RLE_encode(unsigned char * dst,
            const unsigned char * src_start,
@@ -624,21 +842,23 @@ RLE_encode(unsigned char * dst,
       else if (ptr[0]!=ptr[1])
         {
           // Guess how many non repeating bytes we have
-          const unsigned char * ptr1;
-          for(ptr1=ptr+1;ptr1<src_end-1;ptr1++)
-            if (ptr1[0]==ptr1[1] || ptr1-ptr>=128) break;
+          const unsigned char * lim = src_end-1;
+          if (lim - ptr > 128)
+            lim = ptr + 128;
+          const unsigned char * ptr1 = RLE_find_pair(ptr+1, lim);
           int pixels=ptr1-ptr;
           *dst++=pixels-1;
-          for(int cnt=0;cnt<pixels;cnt++)
-            *dst++=*ptr++;
-          ptr--;
+          memcpy(dst, ptr, pixels);
+          dst+=pixels;
+          ptr+=pixels-1;
         } 
       else
         {
           // Get the number of repeating bytes
-          const unsigned char * ptr1;
-          for(ptr1=ptr+1;ptr1<src_end-1;ptr1++)
-            if (ptr1[0]!=ptr1[1] || ptr1-ptr+1>=128) break;
+          const unsigned char * lim = src_end-1;
+          if (lim - ptr > 127)
+            lim = ptr + 127;
+          const unsigned char * ptr1 = RLE_find_change(ptr+1, lim);
           int pixels=ptr1-ptr+1;
           *dst++=257-pixels;
           *dst++=*ptr;
@@ -1049,7 +1269,6 @@ print_fg_3layer(ByteStream &str,
               continue;
             // Setup pattern
             write(str,"gsave %d %d translate\n", currentx, currenty);
-            write(str,"<~");
             unsigned char *q = s;
             for(int current_row = y; current_row<y+h; current_row++)
               { 
@@ -1069,11 +1288,19 @@ print_fg_3layer(ByteStream &str,
                       }
                   }
               }
-            unsigned char *stop_ascii = 
-              ASCII85_encode(s_ascii_encoded,s,s+w*h*color_nb);
-            *stop_ascii++='\0';
-            write(str,"%s",s_ascii_encoded);
-            write(str,"~> %d %d P\n", w, h);
+            if (options.get_level() >= 3)
+              {
+                write_flate_string(str,s,w*h*color_nb);
+                write(str," %d %d P\n", w, h);
+              }
+            else
+              {
+                unsigned char *stop_ascii = 
+                  ASCII85_encode(s_ascii_encoded,s,s+w*h*color_nb);
+                *stop_ascii++='\0';
+                write(str,"<~%s",s_ascii_encoded);
+                write(str,"~> %d %d P\n", w, h);
+              }
             // Keep performing blits
             for(; current_blit<num_blits; current_blit++)
               if (blit_list[current_blit])
@@ -1105,6 +1332,7 @@ print_fg(ByteStream &str,
 {
   GP<JB2Image> jb2=dimg->get_fgjb();
   if (! jb2) return;
+  bool lev3 = (options.get_level() >= 3);
   int num_blits = jb2->get_blit_count();
   int num_shapes = jb2->get_shape_count();
   unsigned char *dict_shapes = 0;
@@ -1152,6 +1380,8 @@ print_fg(ByteStream &str,
     {
       JB2Shape *shape = & jb2->get_shape(current_shape);
       GP<GBitmap> bitmap = shape->bits;
+      // Shapes of a shared dictionary may be printed by other threads
+      GMonitorLock lock(bitmap->monitor());
       int rows = bitmap->rows();
       int columns = bitmap->columns();
       int nbytes = (columns+7)/8*rows+1;
@@ -1166,7 +1396,7 @@ print_fg(ByteStream &str,
       GPBuffer<unsigned char> gs_start(s_start,nbytes);
       unsigned char *s_ascii;
       GPBuffer<unsigned char> gs_ascii(s_ascii,nbytes*2);
-      write(str,"/%d {",current_shape);
+      write(str,(lev3 ? "/%d [" : "/%d {"),current_shape);
 
       unsigned char *s = s_start;
       for(int current_row=0; current_row<rows; current_row++)
@@ -1195,21 +1425,41 @@ print_fg(ByteStream &str,
         }
         if (!((current_row+1)%nrows))
         {
-          unsigned char *stop_ascii = ASCII85_encode(s_ascii,s_start,s); 
-          *stop_ascii++='\0';
-          write(str,"<~%s~> ",s_ascii);
+          if (lev3)
+          {
+            write_flate_string(str,s_start,s-s_start);
+            write(str," ");
+          }
+          else
+          {
+            unsigned char *stop_ascii = ASCII85_encode(s_ascii,s_start,s); 
+            *stop_ascii++='\0';
+            write(str,"<~%s~> ",s_ascii);
+          }
           s=s_start;
           nstrings++;
         }
       }
       if (s!=s_start)
       {
-        unsigned char *stop_ascii = ASCII85_encode(s_ascii,s_start,s);
-        *stop_ascii++='\0';
-        write(str,"<~%s~> ",s_ascii);
-          nstrings++;
+        if (lev3)
+        {
+          write_flate_string(str,s_start,s-s_start);
+          write(str," ");
+        }
+        else
+        {
+          unsigned char *stop_ascii = ASCII85_encode(s_ascii,s_start,s);
+          *stop_ascii++='\0';
+          write(str,"<~%s~> ",s_ascii);
+        }
+        nstrings++;
       }
-      if (nstrings==1)
+      if (lev3 && nstrings==1)
+        write(str," %d %d /g cvx] cvx def\n", columns, rows);
+      else if (lev3)
+        write(str," %d %d %d /gn cvx] cvx def\n", columns, rows,nstrings);
+      else if (nstrings==1)
         write(str," %d %d g} def\n", columns, rows);                  
       else
         write(str," %d %d %d gn} def\n", columns, rows,nstrings);
@@ -1273,6 +1523,91 @@ print_bg(ByteStream &str,
        !dimg->is_legal_compound())
       || options.get_mode()==Options::BW)
     do_color = false;
+  if (options.get_level() >= 3)
+    {
+      // Interleaved samples with deflate compression.
+      write(str, 
+            "DjVuColorSpace setcolorspace\n"
+            "<< /ImageType 1\n"
+            "   /Width %d\n"
+            "   /Height %d\n"
+            "   /BitsPerComponent 8\n"
+            "   /Decode [%s]\n"
+            "   /ImageMatrix [1 0 0 1 0 0]\n"
+            "   /Interpolate false >>\n"
+            "<< /Predictor 15\n"
+            "   /Colors %d\n"
+            "   /BitsPerComponent 8\n"
+            "   /Columns %d >> FlateImage\n",
+            prn_rect.width(), prn_rect.height(),
+            (do_color) ? "0 1 0 1 0 1" : "0 1",
+            (do_color) ? 3 : 1, prn_rect.width());
+      int ncomp = (do_color) ? 3 : 1;
+      int bytes = prn_rect.width()*ncomp;
+      unsigned char *line;
+      GPBuffer<unsigned char> gline(line, bytes);
+      unsigned char *prev;
+      GPBuffer<unsigned char> gprev(prev, bytes);
+      unsigned char *pred;
+      GPBuffer<unsigned char> gpred(pred, 2*bytes+2);
+      memset(prev, 0, bytes);
+      ASCII85ByteStream *a85 = new ASCII85ByteStream(str);
+      GP<ByteStream> ga85 = a85;
+      // Moderate level: higher levels only save a few percent.
+      GP<ByteStream> z = FlateByteStream::create(ga85, 4);
+      GRect grectBand = prn_rect;
+      grectBand.ymax_ = grectBand.ymin_;
+      while(grectBand.ymax_ < prn_rect.ymax_)
+        {
+          grectBand.ymin_=grectBand.ymax_;
+          grectBand.ymax_=grectBand.ymin_+band_bytes/grectBand.width();
+          if (grectBand.ymax_>prn_rect.ymax_)
+            grectBand.ymax_=prn_rect.ymax_;
+          GP<GPixmap> pm = get_bg_pixmap(dimg, grectBand);
+          for (int y=0; y<grectBand.height(); y++)
+            {
+              unsigned char *ptr = line;
+              if (! pm)
+                memset(line, 0xff, grectBand.width()*ncomp);
+              else if (do_color)
+                {
+                  GPixel *pix = (*pm)[y];
+                  for (int x=grectBand.width(); x>0; x--,pix++)
+                    {
+                      *ptr++ = ramp[pix->r];
+                      *ptr++ = ramp[pix->g];
+                      *ptr++ = ramp[pix->b];
+                    }
+                }
+              else
+                {
+                  GPixel *pix = (*pm)[y];
+                  for (int x=grectBand.width(); x>0; x--,pix++)
+                    *ptr++ = ramp[GRAY(pix->r,pix->g,pix->b)];
+                }
+              const unsigned char *out = 
+                PNG_predict(pred, line, prev, bytes, ncomp);
+              z->writall(out, bytes+1);
+              memcpy(prev, line, bytes);
+            }
+          if (refresh_cb) 
+            refresh_cb(refresh_cl_data);
+          if (prn_progress_cb)
+            {
+              double done=(double)(grectBand.ymax_ 
+                                   - prn_rect.ymin_)/prn_rect.height();
+              if ((int) (20*print_done)!=(int) (20*done))
+                {
+                  print_done=done;
+                  prn_progress_cb(done, prn_progress_cl_data);
+                }
+            }
+        }
+      z = 0;
+      a85->close();
+      write(str, "grestore\n");
+      return;
+    }
   if (do_color) 
     buffer_size *= 3;
   if (do_color)
@@ -2351,6 +2686,139 @@ decode_page(GP<DjVuDocument> doc,
   return dimg;
 }
 
+// ***********************************************************************
+// **************************** PAGE PIPELINE ****************************
+// ***********************************************************************
+
+// When a document is printed with several threads, worker threads decode
+// and convert the pages into memory buffers ahead of the output.  The
+// printing loop is first run with a pipeline that records the calls to
+// process_single_page() without producing output.  The workers then
+// convert the recorded pages in this order, each with its own DjVuToPS
+// object, while the second run of the printing loop copies the buffers
+// into the output stream.  Since pages are converted independently, the
+// output is identical to the output of the sequential code.
+
+class DjVuToPS::Pipeline : public GPEnabled, protected GPipeline
+{
+public:
+  Pipeline(DjVuToPS &ps, GP<DjVuDocument> doc, int nthreads);
+  ~Pipeline();
+  void start(void);
+  void page(ByteStream &str, int page_num, int cnt, int todo, int magic);
+protected:
+  virtual void work(int k, int worker);
+  virtual void waiting(void);
+private:
+  struct Job {
+    int page_num, cnt, todo, magic;
+  };
+  DjVuToPS &ps;
+  GP<DjVuDocument> doc;
+  int nthreads;
+  bool recording;
+  GTArray<Job> jobs;
+  int njobs;
+  GPArray<ByteStream> results;
+  DjVuToPS *converters;
+};
+
+DjVuToPS::Pipeline::
+Pipeline(DjVuToPS &ps, GP<DjVuDocument> doc, int nthreads)
+  : ps(ps), doc(doc), nthreads(nthreads), 
+    recording(true), njobs(0), converters(0)
+{
+}
+
+DjVuToPS::Pipeline::
+~Pipeline()
+{
+  stop();
+  delete [] converters;
+}
+
+void 
+DjVuToPS::Pipeline::
+start(void)
+{
+  // Stop recording and start the workers.
+  recording = false;
+  results.resize(0, njobs-1);
+  if (nthreads > njobs)
+    nthreads = njobs;
+  // The converter objects are constructed here because
+  // the constructor of DjVuToPS initializes static tables.
+  converters = new DjVuToPS[nthreads];
+  for (int i=0; i<nthreads; i++)
+    {
+      converters[i].options = ps.options;
+      converters[i].options.set_threads(1);
+    }
+  GPipeline::start(nthreads);
+  add(njobs);
+}
+
+void
+DjVuToPS::Pipeline::
+work(int k, int worker)
+{
+  const Job &job = jobs[k];
+  GP<ByteStream> out = ByteStream::create();
+  if (worker >= 0)
+    converters[worker].process_single_page(*out, doc, job.page_num, 
+                                           job.cnt, job.todo, job.magic);
+  else
+    {
+      // Workers could not be started.
+      DjVuToPS converter;
+      converter.options = ps.options;
+      converter.process_single_page(*out, doc, job.page_num, 
+                                    job.cnt, job.todo, job.magic);
+    }
+  out->seek(0);
+  results[k] = out;
+}
+
+void
+DjVuToPS::Pipeline::
+waiting(void)
+{
+  if (ps.refresh_cb)
+    ps.refresh_cb(ps.refresh_cl_data);
+}
+
+void
+DjVuToPS::Pipeline::
+page(ByteStream &str, int page_num, int cnt, int todo, int magic)
+{
+  if (recording)
+    {
+      jobs.touch(njobs);
+      Job &job = jobs[njobs++];
+      job.page_num = page_num;
+      job.cnt = cnt;
+      job.todo = todo;
+      job.magic = magic;
+      return;
+    }
+  if (!ready() && ps.info_cb)
+    ps.info_cb(page_num, cnt, todo, DECODING, ps.info_cl_data);
+  int k = get();
+  if (k < 0)
+    G_THROW(ERR_MSG("DjVuToPS.no_image") + GUTF8String("\t")
+            + GUTF8String(page_num));
+  GP<ByteStream> out = results[k];
+  results[k] = 0;
+  if (ps.info_cb)
+    ps.info_cb(page_num, cnt, todo, PRINTING, ps.info_cl_data);
+  if (ps.prn_progress_cb)
+    ps.prn_progress_cb(0, ps.prn_progress_cl_data);
+  str.copy(*out);
+  if (ps.prn_progress_cb)
+    ps.prn_progress_cb(1, ps.prn_progress_cl_data);
+}
+
+
 void
 DjVuToPS::
 process_single_page(ByteStream &str, 
@@ -2358,6 +2826,11 @@ process_single_page(ByteStream &str,
                     int page_num, int cnt, int todo,
                     int magic)
 {
+  if (pipeline)
+    {
+      pipeline->page(str, page_num, cnt, todo, magic);
+      return;
+    }
   GP<DjVuTXT> txt;
   GP<DjVuImage> dimg;
   dimg = decode_page(doc, page_num, cnt, todo);
@@ -2505,7 +2978,45 @@ print(ByteStream &str,
       store_doc_setup(str);
       process_single_page(str, doc, page_num, 0, todo, 0);
     }
-  else if (options.get_bookletmode()==Options::OFF)
+  else
+    {
+      /* Multiple pages */
+      int nthreads = options.get_threads();
+      if (nthreads <= 0)
+        nthreads = GThread::ncpus();
+      if (nthreads > 1 && todo > 1)
+        {
+          pipeline = new Pipeline(*this, doc, nthreads);
+          G_TRY
+            {
+              GP<ByteStream> dummy = ByteStream::create();
+              print_pages(*dummy, doc, pages_todo);
+              pipeline->start();
+              print_pages(str, doc, pages_todo);
+            }
+          G_CATCH(ex)
+            {
+              pipeline = 0;
+              G_RETHROW;
+            }
+          G_ENDCATCH;
+          pipeline = 0;
+        }
+      else
+        print_pages(str, doc, pages_todo);
+    }
+}
+
+void
+DjVuToPS::
+print_pages(ByteStream &str, 
+            GP<DjVuDocument> doc, 
+            const GList<int> &pages)
+{
+  GList<int> pages_todo;
+  pages_todo = pages;
+  int todo = pages_todo.size();
+  if (options.get_bookletmode()==Options::OFF)
     {
       /* Normal mode */
       int cnt = 0;
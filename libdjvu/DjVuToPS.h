@@ -94,14 +94,17 @@ public:
              \item[Format] ({\em EPS} or {\em PS}). Use the {\em EPS}
                 format if you plan to embed the output image into another
                 document. Print {\em PS} otherwise.
-             \item[Language level] ({\em 1} or {\em 2}). Any PostScript
-                printer or interpreter should understand PostScript Level 1
-                files. Unfortunately we cannot efficiently compress and encode
-                data when generating Level 1 files. PostScript Level 2 allows
-                to employ an RLE compression and ASCII85 encoding scheme,
+             \item[Language level] ({\em 1}, {\em 2} or {\em 3}). Any
+                PostScript printer or interpreter should understand PostScript
+                Level 1 files. Unfortunately we cannot efficiently compress and
+                encode data when generating Level 1 files. PostScript Level 2
+                allows to employ an RLE compression and ASCII85 encoding scheme,
                 which makes output files significantly smaller. Most of
                 the printers and word processors nowadays support PostScript
-                Level 2.
+                Level 2. PostScript Level 3 output uses deflate compression
+                (#FlateDecode#) for the image data, the foreground colors
+                and the large glyphs. Background samples are first filtered
+                with PNG predictors.
              \item[Orientation] ({\em PORTRAIT} or {\em LANDSCAPE})
              \item[Zoom factor] ({\em FIT_PAGE} or {\em ONE_TO_ONE}).
                 {\em ONE_TO_ONE} mode is useful, if you want the output to
@@ -153,6 +156,7 @@ public:
     int bookletalign;
     int bookletfold;
     int bookletxfold;
+    int threads;
   public:
     /** Sets output image format to #PS# or #EPS# */
     void set_format(Format format);
@@ -189,11 +193,16 @@ public:
         the booklet (#fold# in points) and the margin 
         increase required for each sheet (#xfold# in millipoints). */
     void set_bookletfold(int fold, int xfold=0);
+    /** Sets the number of threads used to convert pages when printing a
+        document.  Zero selects the number of processors.  One, the
+        default, disables the page pipeline.  The output does not depend
+        on this setting. */
+    void set_threads(int threads);
 
     /** Returns output image format (#PS# or #EPS#) */
     Format get_format(void) const {
       return format; }
-    /** Returns PostScript level (#1# or #2#) */
+    /** Returns PostScript level (#1#, #2#, or #3#) */
     int get_level(void) const {
       return level; }
     /** Returns output image orientation (#PORTRAIT# or #LANDSCAPE#) */
@@ -240,6 +249,9 @@ public:
     /** Returns the folding margin for sheet number #n#. */
     int get_bookletfold(int n=0) {
       return bookletfold + (n*bookletxfold+500)/1000; }
+    /** Returns the number of page conversion threads. */
+    int get_threads(void) const {
+      return threads; }
     /* Constructor */
     Options(void);
   };
@@ -259,6 +271,8 @@ private:
   void  *info_cl_data;
   unsigned char ramp[256];
   GP<DecodePort> port;
+  class Pipeline;
+  GP<Pipeline> pipeline;
 protected:
   void store_doc_prolog(ByteStream&,int,int,GRect*);
   void store_doc_setup(ByteStream&);
@@ -277,6 +291,7 @@ protected:
   GP<DjVuImage> decode_page(GP<DjVuDocument>,int,int,int);
   void process_single_page(ByteStream&,GP<DjVuDocument>,int,int,int,int);
   void process_double_page(ByteStream&,GP<DjVuDocument>,void*,int,int);
+  void print_pages(ByteStream&,GP<DjVuDocument>,const GList<int>&);
   
 public:
   /** Options affecting the print result. Please refer to
@@ -0,0 +1,646 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C- 
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free, 
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of 
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the 
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU 
+//C- | General Public License.   This grant only confers the right to 
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to 
+//C- | the extent such infringement is reasonably necessary to enable 
+//C- | recipient to make, have made, practice, sell, or otherwise dispose 
+//C- | of the LIZARDTECH ORIGINAL CODE (or portions thereof) and not to 
+//C- | any greater extent that may be necessary to utilize further 
+//C- | modifications or combinations.
+//C- |
+//C- | The LIZARDTECH ORIGINAL CODE is provided "AS IS" WITHOUT WARRANTY
+//C- | OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//C- | TO ANY WARRANTY OF NON-INFRINGEMENT, OR ANY IMPLIED WARRANTY OF
+//C- | MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+//C- +------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "FlateByteStream.h"
+#include "GException.h"
+
+#include <string.h>
+
+
+namespace DJVU {
+
+
+// ---------------------------------------- TABLES
+
+// Base values and extra bits for length codes 257..285
+static const unsigned short len_base[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const unsigned char len_extra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+// Base values and extra bits for distance codes 0..29
+static const unsigned short dist_base[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+  8193, 12289, 16385, 24577 };
+static const unsigned char dist_extra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// Order of the code length code lengths
+static const unsigned char clen_order[19] = {
+  16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+static inline int
+find_code(const unsigned short *base, int n, int value)
+{
+  // Returns the last code whose base is not larger than value
+  int lo = 0;
+  int hi = n;
+  while (hi - lo > 1)
+    {
+      int mid = (lo + hi) / 2;
+      if (base[mid] <= value)
+        lo = mid;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+static inline int
+hash3(const unsigned char *p)
+{
+  return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) 
+    & ((1 << FlateByteStream::HBITS) - 1);
+}
+
+
+// ---------------------------------------- HUFFMAN CODES
+
+static void
+build_lengths(const unsigned int *xfreq, int n, int maxbits, 
+              unsigned char *len)
+{
+  // Computes Huffman code lengths not exceeding maxbits.
+  // When the tree is too deep, frequencies are halved and
+  // the tree is built again.
+  unsigned int freq[288];
+  int leaf[288];
+  unsigned int weight[2*288];
+  int parent[2*288];
+  int depth[2*288];
+  int m = 0;
+  for (int i=0; i<n; i++)
+    {
+      freq[i] = xfreq[i];
+      len[i] = 0;
+      if (freq[i])
+        leaf[m++] = i;
+    }
+  if (m == 0)
+    return;
+  if (m == 1)
+    {
+      len[leaf[0]] = 1;
+      return;
+    }
+  for(;;)
+    {
+      // Sort leaves by increasing frequency (insertion sort, n is small)
+      for (int i=1; i<m; i++)
+        {
+          int k = leaf[i];
+          int j = i;
+          for (; j>0 && freq[leaf[j-1]] > freq[k]; j--)
+            leaf[j] = leaf[j-1];
+          leaf[j] = k;
+        }
+      for (int i=0; i<m; i++)
+        weight[i] = freq[leaf[i]];
+      // Merge with two queues: leaves and internal nodes
+      int nl = 0;
+      int ni = m;
+      int nodes = m;
+      while (nodes < 2*m-1)
+        {
+          int pick[2];
+          for (int k=0; k<2; k++)
+            {
+              if (nl < m && (ni >= nodes || weight[nl] <= weight[ni]))
+                pick[k] = nl++;
+              else
+                pick[k] = ni++;
+            }
+          weight[nodes] = weight[pick[0]] + weight[pick[1]];
+          parent[pick[0]] = parent[pick[1]] = nodes;
+          nodes += 1;
+        }
+      int maxdepth = 0;
+      depth[nodes-1] = 0;
+      for (int k=nodes-2; k>=0; k--)
+        {
+          depth[k] = depth[parent[k]] + 1;
+          if (depth[k] > maxdepth)
+            maxdepth = depth[k];
+        }
+      if (maxdepth <= maxbits)
+        {
+          for (int i=0; i<m; i++)
+            len[leaf[i]] = depth[i];
+          return;
+        }
+      for (int i=0; i<m; i++)
+        freq[leaf[i]] = (freq[leaf[i]] + 1) / 2;
+    }
+}
+
+static void
+build_codes(const unsigned char *len, int n, unsigned short *code)
+{
+  // Computes canonical codes, bit reversed for LSB first output.
+  int count[16];
+  int next[16];
+  memset(count, 0, sizeof(count));
+  for (int i=0; i<n; i++)
+    count[len[i]] += 1;
+  count[0] = 0;
+  int c = 0;
+  for (int b=1; b<16; b++)
+    {
+      c = (c + count[b-1]) << 1;
+      next[b] = c;
+    }
+  for (int i=0; i<n; i++)
+    if (len[i])
+      {
+        unsigned int v = next[len[i]]++;
+        unsigned int r = 0;
+        for (int b=0; b<len[i]; b++, v>>=1)
+          r = (r << 1) | (v & 1);
+        code[i] = r;
+      }
+}
+
+
+// ---------------------------------------- CONSTRUCTION
+
+FlateByteStream::FlateByteStream(GP<ByteStream> xbs, int level)
+  : bs(xbs), chain(32), nice(MAXMATCH), offset(0), adler(1),
+    buf(0), gbuf(buf, WSIZE+BSIZE),
+    head(0), ghead(head, 1<<HBITS),
+    prev(0), gprev(prev, WSIZE+BSIZE),
+    pos(0), end(0), bstart(0),
+    slen(0), gslen(slen, BSIZE),
+    sval(0), gsval(sval, BSIZE),
+    nsym(0), bitbuf(0), bitcnt(0), optr(0)
+{
+  if (level < 1)
+    level = 1;
+  if (level > 9)
+    level = 9;
+  chain = 1 << (level + 1);
+  nice = (level < 4) ? 16 : (level < 7) ? 128 : MAXMATCH;
+  for (int i=0; i<(1<<HBITS); i++)
+    head[i] = NIL;
+  // zlib header: deflate with 32KB window, default compression
+  putbyte(0x78);
+  putbyte(0x9c);
+}
+
+GP<ByteStream>
+FlateByteStream::create(GP<ByteStream> bs, int level)
+{
+  return new FlateByteStream(bs, level);
+}
+
+FlateByteStream::~FlateByteStream()
+{
+  deflate(true);
+  emit_block(true);
+  align();
+  putbyte((adler >> 24) & 0xff);
+  putbyte((adler >> 16) & 0xff);
+  putbyte((adler >> 8) & 0xff);
+  putbyte(adler & 0xff);
+  bs->writall(obuf, optr);
+  optr = 0;
+  bs->flush();
+}
+
+
+// ---------------------------------------- OUTPUT
+
+inline void
+FlateByteStream::putbyte(int byte)
+{
+  if (optr >= (int)sizeof(obuf))
+    {
+      bs->writall(obuf, optr);
+      optr = 0;
+    }
+  obuf[optr++] = byte;
+}
+
+inline void
+FlateByteStream::putbits(unsigned int value, int nbits)
+{
+  bitbuf |= value << bitcnt;
+  bitcnt += nbits;
+  while (bitcnt >= 8)
+    {
+      putbyte(bitbuf & 0xff);
+      bitbuf >>= 8;
+      bitcnt -= 8;
+    }
+}
+
+void
+FlateByteStream::align(void)
+{
+  if (bitcnt > 0)
+    putbits(0, 8 - bitcnt);
+}
+
+void
+FlateByteStream::checksum(const unsigned char *data, int size)
+{
+  // Adler-32
+  unsigned int s1 = adler & 0xffff;
+  unsigned int s2 = (adler >> 16) & 0xffff;
+  while (size > 0)
+    {
+      int n = (size < 5552) ? size : 5552;
+      size -= n;
+      while (n-- > 0)
+        {
+          s1 += *data++;
+          s2 += s1;
+        }
+      s1 %= 65521;
+      s2 %= 65521;
+    }
+  adler = (s2 << 16) | s1;
+}
+
+
+// ---------------------------------------- COMPRESSION
+
+void
+FlateByteStream::deflate(bool finish)
+{
+  // Process bytes until pos reaches lim, keeping
+  // a full lookahead unless finishing.
+  int lim = (finish) ? end : end - MAXMATCH;
+  while (pos < lim)
+    {
+      int best = 0;
+      int bestdist = 0;
+      int maxlen = end - pos;
+      if (maxlen > MAXMATCH)
+        maxlen = MAXMATCH;
+      if (maxlen >= MINMATCH)
+        {
+          const unsigned char *p = buf + pos;
+          int h = hash3(p);
+          int cand = head[h];
+          int n = chain;
+          while (cand != NIL && pos - cand <= WSIZE && n-- > 0)
+            {
+              const unsigned char *q = buf + cand;
+              if (q[best] == p[best] && q[0] == p[0] && q[1] == p[1])
+                {
+                  int l = 2;
+                  while (l < maxlen && q[l] == p[l])
+                    l++;
+                  if (l > best)
+                    {
+                      best = l;
+                      bestdist = pos - cand;
+                      if (l >= maxlen || l >= nice)
+                        break;
+                    }
+                }
+              cand = prev[cand];
+            }
+          prev[pos] = head[h];
+          head[h] = pos;
+        }
+      if (best >= MINMATCH)
+        {
+          slen[nsym] = best;
+          sval[nsym] = bestdist;
+          nsym += 1;
+          // Index the positions covered by the match
+          int stop = pos + best;
+          if (stop > end - MINMATCH + 1)
+            stop = end - MINMATCH + 1;
+          for (int i=pos+1; i<stop; i++)
+            {
+              int h = hash3(buf + i);
+              prev[i] = head[h];
+              head[h] = i;
+            }
+          pos += best;
+        }
+      else
+        {
+          slen[nsym] = 0;
+          sval[nsym] = buf[pos];
+          nsym += 1;
+          pos += 1;
+        }
+      if (nsym >= BSIZE)
+        emit_block(false);
+    }
+}
+
+void
+FlateByteStream::emit_block(bool final)
+{
+  unsigned int lfreq[286];
+  unsigned int dfreq[30];
+  unsigned char llen[286];
+  unsigned char dlen[30];
+  unsigned short lcode[286];
+  unsigned short dcode[30];
+  memset(lfreq, 0, sizeof(lfreq));
+  memset(dfreq, 0, sizeof(dfreq));
+  long bits = 0;
+  for (int i=0; i<nsym; i++)
+    if (slen[i])
+      {
+        int lc = find_code(len_base, 29, slen[i]);
+        int dc = find_code(dist_base, 30, sval[i]);
+        lfreq[257 + lc] += 1;
+        dfreq[dc] += 1;
+        bits += len_extra[lc] + dist_extra[dc];
+      }
+    else
+      lfreq[sval[i]] += 1;
+  lfreq[256] = 1;
+  // Some decoders reject codes with a single symbol
+  const bool nol0 = (lfreq[0] == 0);
+  const bool nod0 = (dfreq[0] == 0);
+  const bool nod1 = (dfreq[1] == 0);
+  if (nol0)
+    lfreq[0] = 1;
+  if (nod0)
+    dfreq[0] = 1;
+  if (nod1)
+    dfreq[1] = 1;
+  build_lengths(lfreq, 286, 15, llen);
+  build_lengths(dfreq, 30, 15, dlen);
+  build_codes(llen, 286, lcode);
+  build_codes(dlen, 30, dcode);
+  for (int i=0; i<286; i++)
+    bits += lfreq[i] * llen[i];
+  for (int i=0; i<30; i++)
+    bits += dfreq[i] * dlen[i];
+  bits -= (nol0 ? llen[0] : 0) + (nod0 ? dlen[0] : 0) + (nod1 ? dlen[1] : 0);
+  int hlit = 286;
+  while (hlit > 257 && llen[hlit-1] == 0)
+    hlit--;
+  int hdist = 30;
+  while (hdist > 1 && dlen[hdist-1] == 0)
+    hdist--;
+  // Run length encode the code lengths
+  unsigned char lens[286+30];
+  unsigned char rsym[286+30];
+  unsigned char rext[286+30];
+  int nlens = 0;
+  int nr = 0;
+  for (int i=0; i<hlit; i++)
+    lens[nlens++] = llen[i];
+  for (int i=0; i<hdist; i++)
+    lens[nlens++] = dlen[i];
+  unsigned int cfreq[19];
+  memset(cfreq, 0, sizeof(cfreq));
+  for (int i=0; i<nlens; )
+    {
+      int l = lens[i];
+      int run = 1;
+      while (i+run < nlens && lens[i+run] == l)
+        run++;
+      if (l == 0 && run >= 11)
+        {
+          if (run > 138)
+            run = 138;
+          rsym[nr] = 18; rext[nr++] = run - 11;
+        }
+      else if (l == 0 && run >= 3)
+        {
+          rsym[nr] = 17; rext[nr++] = run - 3;
+        }
+      else if (l != 0 && run >= 4)
+        {
+          if (run > 7)
+            run = 7;
+          rsym[nr] = l; rext[nr++] = 0;
+          rsym[nr] = 16; rext[nr++] = run - 4;
+        }
+      else
+        {
+          run = 1;
+          rsym[nr] = l; rext[nr++] = 0;
+        }
+      i += run;
+    }
+  for (int i=0; i<nr; i++)
+    cfreq[rsym[i]] += 1;
+  unsigned char clen[19];
+  unsigned short ccode[19];
+  build_lengths(cfreq, 19, 7, clen);
+  build_codes(clen, 19, ccode);
+  int hclen = 19;
+  while (hclen > 4 && clen[clen_order[hclen-1]] == 0)
+    hclen--;
+  bits += 3 + 5 + 5 + 4 + 3 * hclen;
+  for (int i=0; i<nr; i++)
+    bits += clen[rsym[i]] + ((rsym[i] == 16) ? 2 :
+                             (rsym[i] == 17) ? 3 : (rsym[i] == 18) ? 7 : 0);
+  // Store the data instead when the block would expand it.
+  // Stored blocks hold at most 65535 bytes each.
+  int size = pos - bstart;
+  int nstored = (size > 0) ? (size + 0xfffe) / 0xffff : 1;
+  if (bstart != NIL && 
+      (8 - (bitcnt + 3) % 8) % 8 + 40 * nstored + 8 * (long)size < bits)
+    {
+      const unsigned char *data = buf + bstart;
+      for (int k=0; k<nstored; k++)
+        {
+          int n = (size > 0xffff) ? 0xffff : size;
+          putbits((final && k == nstored-1) ? 1 : 0, 1);
+          putbits(0, 2);
+          align();
+          putbyte(n & 0xff);
+          putbyte((n >> 8) & 0xff);
+          putbyte(~n & 0xff);
+          putbyte((~n >> 8) & 0xff);
+          for (int i=0; i<n; i++)
+            putbyte(data[i]);
+          data += n;
+          size -= n;
+        }
+      bstart = pos;
+      nsym = 0;
+      return;
+    }
+  // Block header
+  putbits(final ? 1 : 0, 1);
+  putbits(2, 2);
+  putbits(hlit - 257, 5);
+  putbits(hdist - 1, 5);
+  putbits(hclen - 4, 4);
+  for (int i=0; i<hclen; i++)
+    putbits(clen[clen_order[i]], 3);
+  for (int i=0; i<nr; i++)
+    {
+      int s = rsym[i];
+      putbits(ccode[s], clen[s]);
+      if (s == 16)
+        putbits(rext[i], 2);
+      else if (s == 17)
+        putbits(rext[i], 3);
+      else if (s == 18)
+        putbits(rext[i], 7);
+    }
+  // Symbols
+  for (int i=0; i<nsym; i++)
+    if (slen[i])
+      {
+        int l = slen[i];
+        int c = find_code(len_base, 29, l);
+        putbits(lcode[257+c], llen[257+c]);
+        if (len_extra[c])
+          putbits(l - len_base[c], len_extra[c]);
+        int d = sval[i];
+        c = find_code(dist_base, 30, d);
+        putbits(dcode[c], dlen[c]);
+        if (dist_extra[c])
+          putbits(d - dist_base[c], dist_extra[c]);
+      }
+    else
+      putbits(lcode[sval[i]], llen[sval[i]]);
+  putbits(lcode[256], llen[256]);
+  bstart = pos;
+  nsym = 0;
+}
+
+
+// ---------------------------------------- BYTESTREAM INTERFACE
+
+size_t
+FlateByteStream::write(const void *buffer, size_t sz)
+{
+  const unsigned char *data = (const unsigned char*)buffer;
+  size_t copied = 0;
+  while (sz > 0)
+    {
+      if (end >= WSIZE+BSIZE)
+        {
+          // Compress and slide the window.  Keep the data of the
+          // pending block when it may still have to be stored.
+          deflate(false);
+          int shift = pos - WSIZE;
+          if (bstart != NIL && bstart < shift)
+            {
+              if (pos - bstart <= BSIZE)
+                shift = bstart;
+              else
+                bstart = NIL;
+            }
+          if (shift > 0)
+            {
+              memmove(buf, buf+shift, end-shift);
+              memmove(prev, prev+shift, (end-shift)*sizeof(int));
+              end -= shift;
+              pos -= shift;
+              if (bstart != NIL)
+                bstart -= shift;
+              for (int i=0; i<(1<<HBITS); i++)
+                head[i] = (head[i] >= shift) ? head[i] - shift : NIL;
+              for (int i=0; i<pos; i++)
+                prev[i] = (prev[i] >= shift) ? prev[i] - shift : NIL;
+            }
+        }
+      int bytes = WSIZE + BSIZE - end;
+      if (bytes > (int)sz)
+        bytes = sz;
+      memcpy(buf+end, data, bytes);
+      checksum(data, bytes);
+      data += bytes;
+      end += bytes;
+      sz -= bytes;
+      copied += bytes;
+      offset += bytes;
+    }
+  return copied;
+}
+
+long 
+FlateByteStream::tell(void) const
+{
+  return offset;
+}
+
+void
+FlateByteStream::flush(void)
+{
+  // Compress all pending data and emit an empty stored
+  // block to align the output on a byte boundary.
+  deflate(true);
+  if (nsym > 0)
+    emit_block(false);
+  putbits(0, 3);
+  align();
+  putbyte(0x00);
+  putbyte(0x00);
+  putbyte(0xff);
+  putbyte(0xff);
+  bs->writall(obuf, optr);
+  optr = 0;
+  bs->flush();
+}
+
+
+}
+using namespace DJVU;
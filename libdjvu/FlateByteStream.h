@@ -0,0 +1,155 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C- 
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free, 
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of 
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the 
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU 
+//C- | General Public License.   This grant only confers the right to 
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to 
+//C- | the extent such infringement is reasonably necessary to enable 
+//C- | recipient to make, have made, practice, sell, or otherwise dispose 
+//C- | of the LIZARDTECH ORIGINAL CODE (or portions thereof) and not to 
+//C- | any greater extent that may be necessary to utilize further 
+//C- | modifications or combinations.
+//C- |
+//C- | The LIZARDTECH ORIGINAL CODE is provided "AS IS" WITHOUT WARRANTY
+//C- | OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//C- | TO ANY WARRANTY OF NON-INFRINGEMENT, OR ANY IMPLIED WARRANTY OF
+//C- | MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+//C- +------------------------------------------------------------------
+
+#ifndef _FLATEBYTESTREAM_H
+#define _FLATEBYTESTREAM_H
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/** @name FlateByteStream.h
+
+    Files #"FlateByteStream.h"# and #"FlateByteStream.cpp"# implement a
+    compressor producing the zlib format (RFC 1950) with deflate compressed
+    data (RFC 1951).  This is the format expected by the #FlateDecode#
+    filters of PostScript level 3 and PDF.  Only compression is supported.
+
+    {\bf Algorithms} --- Repeated strings are found with hash chains over a
+    32KB sliding window and are greedily replaced by back references.  The
+    resulting symbols are coded with dynamic Huffman codes computed for
+    each block of 64K symbols.  Blocks that would be larger than their
+    data are stored without compression.
+
+    @memo
+    Deflate compressor.
+*/
+//@{
+
+#include "ByteStream.h"
+
+namespace DJVU {
+
+/** Performs deflate compression.
+
+    Any data written to a #FlateByteStream# is compressed and written to
+    the ByteStream passed to function #create#.  The zlib header is written
+    when the object is created.  The last block and the checksum are
+    written when the object is destroyed.  Function #flush# writes all
+    pending data and aligns the output on a byte boundary, at the expense
+    of compression efficiency. */
+
+class DJVUAPI FlateByteStream : public ByteStream
+{
+public:
+  enum { WSIZE=32768, BSIZE=65536, HBITS=15,
+         MINMATCH=3, MAXMATCH=258, NIL=-1 };
+protected:
+  FlateByteStream(GP<ByteStream> bs, int level);
+public:
+  /** Creates a FlateByteStream writing compressed data into #bs#.
+      Argument #level# ranges from 1 (fastest) to 9 (best compression). */
+  static GP<ByteStream> create(GP<ByteStream> bs, int level=6);
+  ~FlateByteStream();
+  // ByteStream interface
+  virtual size_t write(const void *buffer, size_t size);
+  virtual long tell(void) const;
+  virtual void flush(void);
+private:
+  GP<ByteStream> bs;
+  int chain;
+  int nice;
+  long offset;
+  unsigned int adler;
+  // window
+  unsigned char *buf;
+  GPBuffer<unsigned char> gbuf;
+  int *head;
+  GPBuffer<int> ghead;
+  int *prev;
+  GPBuffer<int> gprev;
+  int pos;
+  int end;
+  int bstart;
+  // symbols
+  unsigned short *slen;
+  GPBuffer<unsigned short> gslen;
+  unsigned short *sval;
+  GPBuffer<unsigned short> gsval;
+  int nsym;
+  // output
+  unsigned int bitbuf;
+  int bitcnt;
+  unsigned char obuf[4096];
+  int optr;
+  void putbits(unsigned int value, int nbits);
+  void putbyte(int byte);
+  void align(void);
+  void deflate(bool finish);
+  void emit_block(bool final);
+  void checksum(const unsigned char *data, int size);
+private:
+  // Cancel C++ default stuff
+  FlateByteStream(const FlateByteStream &);
+  FlateByteStream & operator=(const FlateByteStream &);
+};
+
+//@}
+
+// ----- THE END
+
+}
+using namespace DJVU;
+#endif
@@ -59,6 +59,7 @@
 
 
 #include "GContainer.h"
+#include <stddef.h>
 
 
 namespace DJVU {
@@ -793,4 +794,234 @@ GSetBase::empty()
 }
 
 
+
+// ------------------------------------------------------------
+// FLAT ASSOCIATIVE MAPS
+// ------------------------------------------------------------
+
+
+// Size of the header preceding the nodes of a pool block.
+static const int blockhdr = (int)
+  ((sizeof(void*) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1));
+
+
+GFlatSetBase::GFlatSetBase(const Traits &traits)
+  : traits(traits), nelems(0), nslots(0), nbits(0), 
+    slots(0), gslots(slots), 
+    first(0), last(0), freelist(0), blocks(0), blocksize(8)
+{
+  rehash(4);
+}
+
+
+GFlatSetBase::GFlatSetBase(const GFlatSetBase &ref)
+  : traits(ref.traits), nelems(0), nslots(0), nbits(0), 
+    slots(0), gslots(slots), 
+    first(0), last(0), freelist(0), blocks(0), blocksize(8)
+{
+  rehash(4);
+  GFlatSetBase::operator= (ref);
+}
+
+
+GFlatSetBase::~GFlatSetBase()
+{
+  G_TRY { empty(); } G_CATCH_ALL { } G_ENDCATCH;
+  freeblocks();
+}
+
+
+GCont::HNode *
+GFlatSetBase::newnode()
+{
+  if (! freelist)
+    {
+      // Allocate a new block and thread its nodes on the free list
+      char *b = (char*) operator new (blockhdr + blocksize * traits.size);
+      *(void**)b = blocks;
+      blocks = (void*)b;
+      for (int i=blocksize-1; i>=0; i--)
+        {
+          Node *n = (Node*)(b + blockhdr + i * traits.size);
+          n->next = freelist;
+          freelist = n;
+        }
+      if (blocksize < 256)
+        blocksize *= 2;
+    }
+  Node *n = freelist;
+  freelist = n->next;
+  memset((void*)n, 0, traits.size);
+  return (HNode*)n;
+}
+
+
+void
+GFlatSetBase::freeblocks()
+{
+  while (blocks)
+    {
+      void *b = blocks;
+      blocks = *(void**)b;
+      operator delete (b);
+    }
+  freelist = 0;
+  blocksize = 8;
+}
+
+
+GCont::HNode *
+GFlatSetBase::hashnode(unsigned int hashcode, int &probe) const
+{
+  // Returns the next node with the right hashcode in the probe sequence.
+  // Argument probe must be negative on the first call.
+  const int mask = nslots - 1;
+  int i = (probe < 0) ? home(hashcode) : probe;
+  for (; slots[i].node; i = (i + 1) & mask)
+    if (slots[i].hashcode == hashcode)
+      {
+        probe = (i + 1) & mask;
+        return slots[i].node;
+      }
+  return 0;
+}
+
+
+void
+GFlatSetBase::insertslot(HNode *n)
+{
+  const int mask = nslots - 1;
+  int i = home(n->hashcode);
+  while (slots[i].node)
+    i = (i + 1) & mask;
+  slots[i].hashcode = n->hashcode;
+  slots[i].node = n;
+}
+
+
+GCont::HNode *
+GFlatSetBase::installnode(HNode *n)
+{
+  // Grow if table is more than 66% full
+  if ((nelems+1)*3 > nslots*2)
+    rehash(nbits + 1);
+  insertslot(n);
+  // Append to the iteration list
+  n->next = 0;
+  n->prev = last;
+  if (last)
+    last->next = n;
+  else
+    first = n;
+  last = n;
+  nelems += 1;
+  return n;
+}
+
+
+void   
+GFlatSetBase::deletenode(GCont::HNode *n)
+{
+  if (n == 0) 
+    return;
+  // Locate slot
+  const int mask = nslots - 1;
+  int i = home(n->hashcode);
+  while (slots[i].node != n)
+    i = (i + 1) & mask;
+  // Shift back the following entries of the cluster.
+  // An entry may fill the hole unless its home lies cyclically in ]i,j].
+  for (int j = (i + 1) & mask; slots[j].node; j = (j + 1) & mask)
+    {
+      int k = home(slots[j].hashcode);
+      if ((j > i) ? (k <= i || k > j) : (k <= i && k > j))
+        {
+          slots[i] = slots[j];
+          i = j;
+        }
+    }
+  slots[i].node = 0;
+  // Unlink
+  if (n->next)
+    n->next->prev = n->prev;
+  else
+    last = (HNode*)(n->prev);
+  if (n->prev)
+    n->prev->next = n->next;
+  else
+    first = (HNode*)(n->next);
+  // Recycle entry
+  traits.fini( (void*)n, 1 );
+  n->next = freelist;
+  freelist = n;
+  nelems -= 1;
+}
+
+
+void   
+GFlatSetBase::rehash(int newbits)
+{
+  nbits = newbits;
+  nslots = 1 << nbits;
+  gslots.resize(0);
+  gslots.resize(nslots);
+  gslots.clear();
+  for (Node *n = first; n; n = n->next)
+    insertslot((HNode*)n);
+}
+
+
+GFlatSetBase& 
+GFlatSetBase::operator=(const GFlatSetBase &ref)
+{
+  if (this == &ref) 
+    return *this;
+  empty();
+  if (ref.nbits > nbits)
+    rehash(ref.nbits);
+  for (Node *n = ref.first; n; n=n->next)
+    {
+      HNode *m = newnode();
+      traits.copy( (void*)m, (void*)n, 1, 0);
+      installnode(m);
+    }
+  return *this;
+}
+
+
+GPosition 
+GFlatSetBase::firstpos() const
+{
+  return GPosition(first, (void*)this);
+}
+
+
+void 
+GFlatSetBase::del(GPosition &pos)
+{
+  if (pos.ptr && pos.cont==(void*)this)
+    {
+      deletenode((HNode*)pos.ptr);
+      pos.ptr = 0;
+    }
+}
+
+
+void 
+GFlatSetBase::empty()
+{
+  HNode *n = first;
+  while (n)
+    {
+      HNode *p = (HNode*)(n->next);
+      traits.fini( (void*)n, 1 );
+      n = p;
+    }
+  first = last = 0;
+  nelems = 0;
+  gslots.clear();
+  freeblocks();
+}
+
+
 }
@@ -74,7 +74,9 @@ namespace DJVU {
     Class #GArray# (see \Ref{Dynamic Arrays}) implements an array of objects
     with variable bounds. Class #GList# (see \Ref{Doubly Linked Lists})
     implements a doubly linked list of objects.  Class #GMap# (see
-    \Ref{Associative Maps}) implements a hashed associative map.  The
+    \Ref{Associative Maps}) implements a hashed associative map.  Class
+    #GFlatMap# (see \Ref{Flat Associative Maps}) implements the same 
+    interface with an open-addressing hash table.  The
     container templates are not thread-safe. Thread safety can be implemented
     using the facilities provided in \Ref{GThreads.h}.
     
@@ -733,6 +735,7 @@ protected:
   void *cont;
   friend class GListBase;
   friend class GSetBase;
+  friend class GFlatSetBase;
   [[ noreturn ]] void throw_invalid(void *c) const;
 };
 
@@ -1034,6 +1037,8 @@ public:
     { return GPosition( get(key), (void*)this); }
   void del(const K &key) 
     { deletenode(get(key)); }
+  void del(GPosition &pos)
+    { GSetBase::del(pos); }
 };
 
 template<class K>
@@ -1123,10 +1128,12 @@ GMapImpl<K,TI>::get_or_create(const K &key)
     Class \Ref{GArrayTemplate} implements all methods for manipulating 
     associative maps with key type #KTYPE# and value type #VTYPE#. 
     You should not however create instances of this class.
-    You should instead use class \Ref{GMap} or \Ref{GPMap}. */
+    You should instead use class \Ref{GMap}, \Ref{GPMap}, \Ref{GFlatMap}
+    or \Ref{GFlatPMap}.  Template argument #IMPL# selects the hash table
+    implementation (see \Ref{Flat Associative Maps}). */
 
-template <class KTYPE, class VTYPE, class TI>
-class GMapTemplate : protected GMapImpl<KTYPE,TI>
+template <class KTYPE, class VTYPE, class TI, class IMPL=GMapImpl<KTYPE,TI> >
+class GMapTemplate : protected IMPL
 {
   typedef GCont::MapNode<KTYPE,TI> MNode;
 public:
@@ -1135,7 +1142,7 @@ public:
     { return this->nelems; }
   /** Returns the first position in the map. */
   GPosition firstpos() const
-    { return GMapImpl<KTYPE,TI>::firstpos(); }
+    { return IMPL::firstpos(); }
   /** Implicit notation for GMap::firstpos(). */
   operator GPosition() const
     { return firstpos(); }    
@@ -1148,15 +1155,15 @@ public:
       function returns its position.  Otherwise it returns an invalid
       position. */
   GPosition contains(const KTYPE &key) const
-    { return GMapImpl<KTYPE,TI>::contains(key); }
+    { return IMPL::contains(key); }
   /*  Compatibility */
   GPosition contains(const KTYPE &key, GPosition &pos) const
-    { return pos = GMapImpl<KTYPE,TI>::contains(key); }
+    { return pos = IMPL::contains(key); }
   // -- ALTERATION
   /** Erases the associative map contents.  All entries are destroyed and
       removed. The map is left with zero entries. */
   void empty()
-    { GMapImpl<KTYPE,TI>::empty(); }
+    { IMPL::empty(); }
   /** Returns a constant reference to the key of the map entry at position
       #pos#.  An exception \Ref{GException} is thrown if position #pos# is not
       valid.  There is no direct way to change the key of a map entry. */
@@ -1190,11 +1197,11 @@ public:
   /** Destroys the map entry for position #pos#.  
       Nothing is done if position #pos# is not a valid position. */
   void del(GPosition &pos)
-    { GSetBase::del(pos); }
+    { IMPL::del(pos); }
   /** Destroys the map entry for key #key#.  
       Nothing is done if there is no entry for key #key#. */
   void del(const KTYPE &key)
-    { GMapImpl<KTYPE,TI>::del(key); }
+    { IMPL::del(key); }
 };
 
 
@@ -1242,6 +1249,179 @@ public:
 
 
 
+
+// ------------------------------------------------------------
+// FLAT ASSOCIATIVE MAPS
+// ------------------------------------------------------------
+
+/** @name Flat Associative Maps
+
+    Template classes \Ref{GFlatMap} and \Ref{GFlatPMap} provide the same
+    interface as \Ref{GMap} and \Ref{GPMap} but use a different hash table.
+    Classes #GMap# and #GPMap# allocate one heap block per entry and chain
+    the entries sharing the same bucket.  Each lookup therefore follows a
+    chain of pointers scattered across the heap.  Flat maps instead keep an
+    open-addressing table (linear probing) of hash codes and entry
+    pointers. A lookup scans a few contiguous slots and only touches the
+    entry whose hash code matches.  Entries are carved from pooled blocks
+    that are recycled on deletion and released all at once by #empty()#
+    or by the destructor.
+
+    Entries are still linked together, in insertion order, so that
+    \Ref{GPosition} objects can be used exactly like with #GMap#.
+    As with #GMap#, a position remains valid until its entry is deleted.
+    Flat maps are preferable for frequently searched tables.  
+    @memo Open-addressing associative maps. */
+//@{
+
+class DJVUAPI GFlatSetBase : public GCont
+{
+protected:
+  GFlatSetBase(const Traits &traits);
+  GFlatSetBase(const GFlatSetBase &ref);
+  HNode *newnode();
+  HNode *hashnode(unsigned int hashcode, int &probe) const;
+  HNode *installnode(HNode *n);
+  void   deletenode(HNode *n);
+protected:
+  struct Slot 
+  {
+    unsigned int hashcode;
+    HNode *node;
+  };
+  const Traits &traits;
+  int nelems;
+  int nslots;
+  int nbits;
+  Slot *slots;
+  GPBuffer<Slot> gslots;
+  HNode *first;
+  HNode *last;
+  Node *freelist;
+  void *blocks;
+  int blocksize;
+private:
+  int home(unsigned int hashcode) const
+    { return (int)((hashcode * 0x9e3779b1U) >> (32 - nbits)); }
+  void insertslot(HNode *n);
+  void rehash(int newbits);
+  void freeblocks();
+public:
+  ~GFlatSetBase();
+  GFlatSetBase& operator=(const GFlatSetBase &ref);
+  GPosition firstpos() const;
+  void del(GPosition &pos); 
+  void empty();
+};
+
+template <class K>
+class GFlatSetImpl : public GFlatSetBase
+{
+  typedef GCont::SetNode<K> SNode;
+protected:
+  GFlatSetImpl(const Traits &traits);
+  HNode *get(const K &key) const;
+  HNode *get_or_throw(const K &key) const;
+public:
+  GPosition contains(const K &key) const 
+    { return GPosition( get(key), (void*)this); }
+  void del(const K &key) 
+    { deletenode(get(key)); }
+  void del(GPosition &pos)
+    { GFlatSetBase::del(pos); }
+};
+
+template<class K>
+GFlatSetImpl<K>::GFlatSetImpl(const Traits &traits)
+  : GFlatSetBase(traits) 
+{ 
+}
+
+template<class K> GCont::HNode *
+GFlatSetImpl<K>::get(const K &key) const
+{ 
+  unsigned int hashcode = hash(key);
+  int probe = -1;
+  SNode *s;
+  while ((s = (SNode*)hashnode(hashcode, probe)))
+    if (s->key == key) return s;
+  return 0;
+}
+
+template<class K> GCont::HNode *
+GFlatSetImpl<K>::get_or_throw(const K &key) const
+{ 
+  HNode *m = get(key);
+  if (!m)
+  {
+    G_THROW( ERR_MSG("GContainer.cannot_add") );
+  }
+  return m;
+}
+
+template <class K, class TI>
+class GFlatMapImpl : public GFlatSetImpl<K>
+{
+  typedef GCont::MapNode<K,TI> MNode;
+protected:
+  GFlatMapImpl();
+  GCont::HNode* get_or_create(const K &key);
+};
+
+template<class K, class TI>
+GFlatMapImpl<K,TI>::GFlatMapImpl()
+  : GFlatSetImpl<K> ( GCont::NormTraits<GCont::MapNode<K,TI> >::traits() ) 
+{ 
+}
+
+template<class K, class TI> GCont::HNode *
+GFlatMapImpl<K,TI>::get_or_create(const K &key)
+{
+  GCont::HNode *m = this->get(key);
+  if (m) return m;
+  MNode *n = (MNode*) this->newnode();
+  new ((void*)&(n->key)) K  (key);
+  new ((void*)&(n->val)) TI ();
+  n->hashcode = hash((const K&)(n->key));
+  this->installnode(n);
+  return n;
+}
+
+
+/** Flat associative maps.
+    Template class #GFlatMap<KTYPE,VTYPE># implements an associative map with
+    the same interface as \Ref{GMap}, using an open-addressing hash table.
+    This class only implement constructors.  See class \Ref{GMapTemplate} and
+    \Ref{GPosition} for a description of all access methods.*/
+
+template <class KTYPE, class VTYPE>
+class GFlatMap 
+  : public GMapTemplate<KTYPE,VTYPE,VTYPE,GFlatMapImpl<KTYPE,VTYPE> >
+{
+public:
+  GFlatMap() {}
+  GFlatMap& operator=(const GFlatMap &r) 
+    { GFlatSetBase::operator=(r); return *this; }
+};
+
+/** Flat associative maps for smart-pointers.
+    Template class #GFlatPMap<KTYPE,VTYPE># implements an associative map
+    for key type #KTYPE# and value type #GP<VTYPE># with the same interface
+    as \Ref{GPMap}, using an open-addressing hash table.
+    This class only implement constructors.  See class \Ref{GMapTemplate} and
+    \Ref{GPosition} for a description of all access methods.*/
+
+template <class KTYPE, class VTYPE>
+class GFlatPMap 
+  : public GMapTemplate<KTYPE,GP<VTYPE>,GPBase,GFlatMapImpl<KTYPE,GPBase> >
+{
+public:
+  GFlatPMap() {}
+  GFlatPMap& operator=(const GFlatPMap &r) 
+    { GFlatSetBase::operator=(r); return *this; }
+};
+
+
 //@}
 //@}
 //@}
@@ -73,6 +73,7 @@
 #include "GThreads.h"
 #include "Arrays.h"
 #include "JPEGDecoder.h"
+#include "DjVuProfile.h"
 
 #include <stddef.h>
 #include <stdlib.h>
@@ -635,7 +636,7 @@ GPixmap::save_ppm(ByteStream &bs, int raw) const
 //////////////////////////////////////////////////
 
 
-static void
+static bool
 color_correction_table(double gamma, GPixel white,
                        unsigned char gtable[256][3] )
 {
@@ -671,34 +672,93 @@ color_correction_table(double gamma, GPixel white,
       gtable[255][0] = white.b;
       gtable[255][1] = white.g;
       gtable[255][2] = white.r;
+      // Gamma values close to one often round to the identity
+      for (int i=0; i<256; i++)
+        if (gtable[i][0]!=i || gtable[i][1]!=i || gtable[i][2]!=i)
+          return true;
     }
+  return false;
 }
 
-static void
+static bool
 color_correction_table_cache(double gamma, GPixel white,
                              unsigned char gtable[256][3] )
 {
   // Compute color correction table
   if (gamma<1.001 && gamma>0.999 && white==GPixel::WHITE)
     {
-      color_correction_table(gamma, white, gtable);
+      return color_correction_table(gamma, white, gtable);
     }
   else
     {
       static double lgamma = -1.0;
       static GPixel lwhite = GPixel::BLACK;
+      static bool lcorrect = false;
       static unsigned char ctable[256][3];
       GMonitorLock lock(&pixmap_monitor());
       if (gamma != lgamma || white != lwhite)
         {
-          color_correction_table(gamma, white, ctable);
+          lcorrect = color_correction_table(gamma, white, ctable);
           lgamma = gamma;
           lwhite = white;
         }
       memcpy(gtable, ctable, 256*3*sizeof(unsigned char));
+      return lcorrect;
     }
 }
 
+bool
+GPixmap::color_correction_table(double gamma_correction, GPixel white,
+                                unsigned char gtable[256][3])
+{
+  return color_correction_table_cache(gamma_correction, white, gtable);
+}
+
+void 
+GPixmap::color_correct(const unsigned char gtable[256][3],
+                       GPixel *pix, int npixels)
+{
+  if (gtable[255][0] == gtable[255][1] && gtable[255][1] == gtable[255][2])
+    {
+      // Neutral white point: the three channels share the same
+      // table, so the pixels can be processed as a plain byte array.
+      unsigned char table[256];
+      for (int i=0; i<256; i++)
+        table[i] = gtable[i][0];
+      unsigned char *p = (unsigned char*)pix;
+      unsigned char *e = p + 3 * npixels;
+      for (; p+4 <= e; p+=4)
+        {
+          unsigned char a = table[p[0]];
+          unsigned char b = table[p[1]];
+          unsigned char c = table[p[2]];
+          unsigned char d = table[p[3]];
+          p[0] = a; p[1] = b; p[2] = c; p[3] = d;
+        }
+      for (; p < e; p++)
+        p[0] = table[p[0]];
+    }
+  else
+    {
+      for (GPixel *e = pix + npixels; pix < e; pix++)
+        {
+          pix->b = gtable[pix->b][0];
+          pix->g = gtable[pix->g][1];
+          pix->r = gtable[pix->r][2];
+        }
+    }
+}
+
+void 
+GPixmap::color_correct(const unsigned char gtable[256][3])
+{
+  if (nrows>0 && ncolumns>0 && nrowsize==ncolumns)
+    color_correct(gtable, (*this)[0], nrows * ncolumns);
+  else
+    for (int y=0; y<nrows; y++)
+      color_correct(gtable, (*this)[y], ncolumns);
+}
+
 void 
 GPixmap::color_correct(double gamma_correction, GPixel white)
 {
@@ -707,18 +767,8 @@ GPixmap::color_correct(double gamma_correction, GPixel white)
     return;
   // Compute correction table
   unsigned char gtable[256][3];
-  color_correction_table_cache(gamma_correction, white, gtable);
-  // Perform correction
-  for (int y=0; y<nrows; y++)
-  {
-    GPixel *pix = (*this)[y];
-    for (int x=0; x<ncolumns; x++, pix++)
-    {
-      pix->b = gtable[ pix->b ][0];
-      pix->g = gtable[ pix->g ][1];
-      pix->r = gtable[ pix->r ][2];
-    }
-  }
+  if (color_correction_table_cache(gamma_correction, white, gtable))
+    color_correct(gtable);
 }
 
 void 
@@ -739,15 +789,8 @@ GPixmap::color_correct(double gamma_correction, GPixel white,
     return;
   // Compute correction table
   unsigned char gtable[256][3];
-  color_correction_table_cache(gamma_correction, white, gtable);
-  // Perform correction
-  while (--npixels>=0)
-    {
-      pix->b = gtable[pix->b][0];
-      pix->g = gtable[pix->g][1];
-      pix->r = gtable[pix->r][2];
-      pix++;
-    }
+  if (color_correction_table_cache(gamma_correction, white, gtable))
+    color_correct(gtable, pix, npixels);
 }
 
 
@@ -878,6 +921,139 @@ GPixmap::ordered_32k_dither(int xmin, int ymin)
 //////////////////////////////////////////////////
 
 
+// Large images can be resampled by horizontal bands in several
+// threads.  Each band writes its own destination rows, so the
+// result does not depend on the number of threads.
+
+static int resample_threads = 1;
+
+void
+GPixmap::set_threads(int threads)
+{
+  resample_threads = (threads > 0) ? threads : GThread::ncpus();
+}
+
+int
+GPixmap::get_threads(void)
+{
+  return resample_threads;
+}
+
+namespace {
+  class BandJob : public GParallel
+  {
+  public:
+    void (*func)(void *arg, int ymin, int ymax);
+    void *arg;
+    int nrows;
+    int nbands;
+  protected:
+    virtual void work(int k);
+  };
+}
+
+void
+BandJob::work(int k)
+{
+  (*func)(arg, nrows * k / nbands, nrows * (k + 1) / nbands);
+}
+
+// Calls #func# on bands covering rows #0# to #nrows-1#.  Argument
+// #npixels# is the size of the output and decides whether threads
+// are worth starting.
+static void
+run_bands(void (*func)(void*, int, int), void *arg, int nrows, int npixels)
+{
+  int nbands = resample_threads;
+  if (npixels < 512*512)
+    nbands = 1;
+  if (nbands > nrows)
+    nbands = nrows;
+  if (nbands <= 1)
+    {
+      if (nrows > 0)
+        (*func)(arg, 0, nrows);
+      return;
+    }
+  BandJob job;
+  job.func = func;
+  job.arg = arg;
+  job.nrows = nrows;
+  job.nbands = nbands;
+  job.run(nbands, nbands);
+}
+
+
+namespace {
+  struct ResampleArgs
+  {
+    const GPixmap *src;
+    GPixmap *dst;
+    int factor;
+    int xmin;
+    int ymin;
+    const int *invmap;
+  };
+}
+
+static void
+downsample_band(void *arg, int ymin, int ymax)
+{
+  const ResampleArgs &a = *(const ResampleArgs*)arg;
+  const GPixmap &src = *a.src;
+  GPixmap &dst = *a.dst;
+  const int factor = a.factor;
+  const int ncolumns = dst.columns();
+  const int *invmap = a.invmap;
+  // Source columns
+  const int sxz = a.xmin * factor;
+  const int sw = mini(sxz + ncolumns * factor, src.columns()) - sxz;
+  int *sums;
+  GPBuffer<int> gsums(sums, 3 * sw);
+  for (int y=ymin; y<ymax; y++)
+    {
+      // Sum the source rows.  These loops run over plain byte 
+      // arrays and are easily vectorized by the compiler.
+      const int sy = (a.ymin + y) * factor;
+      const int lsy = mini(sy + factor, src.rows());
+      const unsigned char *row = (const unsigned char*)(src[sy] + sxz);
+      for (int i=0; i<3*sw; i++)
+        sums[i] = row[i];
+      for (int rsy=sy+1; rsy<lsy; rsy++)
+        {
+          row = (const unsigned char*)(src[rsy] + sxz);
+          for (int i=0; i<3*sw; i++)
+            sums[i] += row[i];
+        }
+      // Sum the columns and set the pixel colors
+      GPixel *dptr = dst[y];
+      for (int x=0, sx=0; x<ncolumns; x++, sx+=factor)
+        {
+          int lsx = mini(sx + factor, sw);
+          int r=0, g=0, b=0;
+          for (const int *p=sums+3*sx, *e=sums+3*lsx; p<e; p+=3)
+            {
+              b += p[0];
+              g += p[1];
+              r += p[2];
+            }
+          int s = (lsy - sy) * (lsx - sx);
+          if (s >= 256)
+            {
+              dptr[x].r = r / s;
+              dptr[x].g = g / s;
+              dptr[x].b = b / s;
+            }
+          else
+            {
+              dptr[x].r = (r*invmap[s] + 0x8000) >> 16;
+              dptr[x].g = (g*invmap[s] + 0x8000) >> 16;
+              dptr[x].b = (b*invmap[s] + 0x8000) >> 16;
+            }
+        }
+    }
+}
+
 void  
 GPixmap::downsample(const GPixmap *src, int factor, const GRect *pdr)
 {
@@ -898,70 +1074,61 @@ GPixmap::downsample(const GPixmap *src, int factor, const GRect *pdr)
   static int invmapok = 0;
   if (! invmapok)
   {
-    invmapok = 1;
     for (int i=1; i<(int)(sizeof(invmap)/sizeof(int)); i++)
       invmap[i] = 0x10000 / i;
+    invmapok = 1;
   }
   
   // initialise pixmap
   init(rect.height(), rect.width(), 0);
+  if (ncolumns == 0)
+    return;
 
-  // determine starting and ending points in source rectangle
-  int sy = rect.ymin_ * factor;
-  int sxz = rect.xmin_ * factor;
-
+  // process bands of rows
+  ResampleArgs args;
+  args.src = src;
+  args.dst = this;
+  args.factor = factor;
+  args.xmin = rect.xmin_;
+  args.ymin = rect.ymin_;
+  args.invmap = invmap;
+  run_bands(downsample_band, (void*)&args, nrows, nrows * ncolumns);
+}
 
-  // loop over source rows
-  const GPixel *sptr = (*src)[sy];
-  GPixel *dptr = (*this)[0];
-  for (int y=0; y<nrows; y++)
-  {
-    int sx = sxz;
-    // loop over source columns
-    for (int x=0; x<ncolumns; x++)
+static void
+upsample_band(void *arg, int ymin, int ymax)
+{
+  const ResampleArgs &a = *(const ResampleArgs*)arg;
+  const GPixmap &src = *a.src;
+  GPixmap &dst = *a.dst;
+  const int factor = a.factor;
+  const int ncolumns = dst.columns();
+  // compute starting point in source rectangle
+  int sxz, sx1z;
+  euclidian_ratio(a.xmin, factor, sxz, sx1z);
+  for (int y=ymin; y<ymax; y++)
     {
-      int r=0, g=0, b=0, s=0;
-      // compute average bounds
-      const GPixel *ksptr = sptr;
-      int lsy = sy + factor;
-      if (lsy > (int)src->rows())
-        lsy = (int)src->rows();
-      int lsx = sx + factor;
-      if (lsx > (int)src->columns())
-        lsx = (int)src->columns();
-      // compute average
-      for (int rsy=sy; rsy<lsy; rsy++)
-      {
-        for (int rsx = sx; rsx<lsx; rsx++)
+      int sy, sy1;
+      euclidian_ratio(a.ymin + y, factor, sy, sy1);
+      GPixel *dptr = dst[y];
+      // rows expanding the same source row are identical
+      if (sy1 > 0 && y > ymin)
         {
-          r += ksptr[rsx].r;
-          g += ksptr[rsx].g;
-          b += ksptr[rsx].b;
-          s += 1;
+          memcpy(dptr, dst[y-1], ncolumns * sizeof(GPixel));
+          continue;
+        }
+      // replicate source pixels
+      const GPixel *sptr = src[sy] + sxz;
+      int x = 0;
+      int xend = mini(factor - sx1z, ncolumns);
+      while (x < ncolumns)
+        {
+          const GPixel p = *sptr++;
+          for (; x<xend; x++)
+            dptr[x] = p;
+          xend = mini(x + factor, ncolumns);
         }
-        ksptr += src->rowsize();
-      }
-      // set pixel color
-      if (s >= (int)(sizeof(invmap)/sizeof(int)))
-      {
-        dptr[x].r = r / s;
-        dptr[x].g = g / s;
-        dptr[x].b = b / s;
-      }
-      else
-      {
-        dptr[x].r = (r*invmap[s] + 0x8000) >> 16;
-        dptr[x].g = (g*invmap[s] + 0x8000) >> 16;
-        dptr[x].b = (b*invmap[s] + 0x8000) >> 16;
-      }
-      // next column
-      sx = sx + factor;
     }
-    // next row
-    sy = sy + factor;
-    sptr = sptr + factor * src->rowsize();
-    dptr = dptr + rowsize();
-  }
 }
 
 void  
@@ -980,36 +1147,17 @@ GPixmap::upsample(const GPixmap *src, int factor, const GRect *pdr)
   }
   // initialise pixmap
   init(rect.height(), rect.width(), 0);
-  // compute starting point in source rectangle
-  int sy, sy1, sxz, sx1z;
-  euclidian_ratio(rect.ymin_, factor, sy, sy1);
-  euclidian_ratio(rect.xmin_, factor, sxz, sx1z);
-  // loop over rows
-  const GPixel *sptr = (*src)[sy];
-  GPixel *dptr = (*this)[0];
-  for (int y=0; y<nrows; y++)
-  {
-    // loop over columns
-    int sx = sxz;
-    int sx1 = sx1z;
-    for (int x=0; x<ncolumns; x++)
-    {
-      dptr[x] = sptr[sx];
-      // next column
-      if (++sx1 >= factor)
-      {
-        sx1 = 0;
-        sx += 1;
-      }
-    }
-    // next row
-    dptr += rowsize();
-    if (++sy1 >= factor)
-    {
-      sy1 = 0;
-      sptr += src->rowsize();
-    }
-  }
+  if (ncolumns == 0)
+    return;
+  // process bands of rows
+  ResampleArgs args;
+  args.src = src;
+  args.dst = this;
+  args.factor = factor;
+  args.xmin = rect.xmin_;
+  args.ymin = rect.ymin_;
+  args.invmap = 0;
+  run_bands(upsample_band, (void*)&args, nrows, nrows * ncolumns);
 }
 
 
@@ -1164,52 +1312,39 @@ copy_from_partial(int w, int h,
 
 
 
-void  
-GPixmap::downsample43(const GPixmap *src, const GRect *pdr)
-{
-  // check arguments
-  int srcwidth = src->columns();
-  int srcheight = src->rows();
-  int destwidth = (srcwidth * 3 + 3 ) / 4;
-  int destheight = (srcheight * 3 + 3) / 4;
-  GRect rect(0, 0, destwidth, destheight);
-  if (pdr != 0)
+namespace {
+  struct BlockArgs
   {
-    if (pdr->xmin_ < rect.xmin_ || 
-        pdr->ymin_ < rect.ymin_ || 
-        pdr->xmax_ > rect.xmax_ || 
-        pdr->ymax_ > rect.ymax_  )
-      G_THROW( ERR_MSG("GPixmap.overflow3") );
-    rect = *pdr;
-    destwidth = rect.width();
-    destheight = rect.height();
-  }
-  // initialize pixmap
-  init(destheight, destwidth, 0);
-
-  // compute bounds
-  int dxz, dy;   // location of bottomleft block in destination image
-  int sxz, sy;   // location of bottomleft block in source image
-  euclidian_ratio(rect.ymin_, 3, sy, dy);
-  euclidian_ratio(rect.xmin_, 3, sxz, dxz);
-  sxz = 4 * sxz;   
-  sy  = 4 * sy;
-  dxz = - dxz;
-  dy  = - dy;
+    const GPixmap *src;
+    GPixmap *dst;
+    int dxz, dyz;   // location of bottomleft block in destination image
+    int sxz, syz;   // location of bottomleft block in source image
+  };
+}
 
+static void
+downsample43_band(void *arg, int bmin, int bmax)
+{
+  const BlockArgs &a = *(const BlockArgs*)arg;
+  const int srcwidth = a.src->columns();
+  const int srcheight = a.src->rows();
+  const int destwidth = a.dst->columns();
+  const int destheight = a.dst->rows();
   // prepare variables
-  int sadd = src->rowsize();
-  int dadd = this->rowsize();
-  const GPixel *sptr = (*src)[0]  + sy * sadd;
-  GPixel *dptr = (*this)[0] + dy * dadd;
+  int sadd = a.src->rowsize();
+  int dadd = a.dst->rowsize();
+  int dy = a.dyz + 3 * bmin;
+  int sy = a.syz + 4 * bmin;
+  const GPixel *sptr = (*a.src)[0]  + sy * sadd;
+  GPixel *dptr = (*a.dst)[0] + dy * dadd;
   int s4add = 4 * sadd;
   int d3add = 3 * dadd;
 
   // iterate over row blocks
-  while (dy < destheight)
+  for (int b=bmin; b<bmax; b++)
   {
-    int sx = sxz;
-    int dx = dxz;
+    int sx = a.sxz;
+    int dx = a.dxz;
     // iterate over column blocks
     while (dx < destwidth)
     {
@@ -1253,15 +1388,14 @@ GPixmap::downsample43(const GPixmap *src, const GRect *pdr)
   }
 }
 
-
 void  
-GPixmap::upsample23(const GPixmap *src, const GRect *pdr)
+GPixmap::downsample43(const GPixmap *src, const GRect *pdr)
 {
   // check arguments
   int srcwidth = src->columns();
   int srcheight = src->rows();
-  int destwidth = (srcwidth * 3 + 1 ) / 2;
-  int destheight = (srcheight * 3 + 1) / 2;
+  int destwidth = (srcwidth * 3 + 3 ) / 4;
+  int destheight = (srcheight * 3 + 3) / 4;
   GRect rect(0, 0, destwidth, destheight);
   if (pdr != 0)
   {
@@ -1269,7 +1403,7 @@ GPixmap::upsample23(const GPixmap *src, const GRect *pdr)
         pdr->ymin_ < rect.ymin_ || 
         pdr->xmax_ > rect.xmax_ || 
         pdr->ymax_ > rect.ymax_  )
-      G_THROW( ERR_MSG("GPixmap.overflow4") );
+      G_THROW( ERR_MSG("GPixmap.overflow3") );
     rect = *pdr;
     destwidth = rect.width();
     destheight = rect.height();
@@ -1278,28 +1412,45 @@ GPixmap::upsample23(const GPixmap *src, const GRect *pdr)
   init(destheight, destwidth, 0);
 
   // compute bounds
-  int dxz, dy;   // location of bottomleft block in destination image
-  int sxz, sy;   // location of bottomleft block in source image
-  euclidian_ratio(rect.ymin_, 3, sy, dy);
-  euclidian_ratio(rect.xmin_, 3, sxz, dxz);
-  sxz = 2 * sxz;   
-  sy  = 2 * sy;
-  dxz = - dxz;
-  dy  = - dy;
+  BlockArgs args;
+  args.src = src;
+  args.dst = this;
+  euclidian_ratio(rect.ymin_, 3, args.syz, args.dyz);
+  euclidian_ratio(rect.xmin_, 3, args.sxz, args.dxz);
+  args.sxz = 4 * args.sxz;   
+  args.syz = 4 * args.syz;
+  args.dxz = - args.dxz;
+  args.dyz = - args.dyz;
+
+  // process bands of row blocks
+  int nblocks = (destheight - args.dyz + 2) / 3;
+  run_bands(downsample43_band, (void*)&args, nblocks, destheight * destwidth);
+}
 
+
+static void
+upsample23_band(void *arg, int bmin, int bmax)
+{
+  const BlockArgs &a = *(const BlockArgs*)arg;
+  const int srcwidth = a.src->columns();
+  const int srcheight = a.src->rows();
+  const int destwidth = a.dst->columns();
+  const int destheight = a.dst->rows();
   // prepare variables
-  int sadd = src->rowsize();
-  int dadd = this->rowsize();
-  const GPixel *sptr = (*src)[0]  + sy * sadd;
-  GPixel *dptr = (*this)[0] + dy * dadd;
+  int sadd = a.src->rowsize();
+  int dadd = a.dst->rowsize();
+  int dy = a.dyz + 3 * bmin;
+  int sy = a.syz + 2 * bmin;
+  const GPixel *sptr = (*a.src)[0]  + sy * sadd;
+  GPixel *dptr = (*a.dst)[0] + dy * dadd;
   int s2add = 2 * sadd;
   int d3add = 3 * dadd;
 
   // iterate over row blocks
-  while (dy < destheight)
+  for (int b=bmin; b<bmax; b++)
   {
-    int sx = sxz;
-    int dx = dxz;
+    int sx = a.sxz;
+    int dx = a.dxz;
     // iterate over column blocks
     while (dx < destwidth)
     {
@@ -1343,6 +1494,45 @@ GPixmap::upsample23(const GPixmap *src, const GRect *pdr)
   }
 }
 
+void  
+GPixmap::upsample23(const GPixmap *src, const GRect *pdr)
+{
+  // check arguments
+  int srcwidth = src->columns();
+  int srcheight = src->rows();
+  int destwidth = (srcwidth * 3 + 1 ) / 2;
+  int destheight = (srcheight * 3 + 1) / 2;
+  GRect rect(0, 0, destwidth, destheight);
+  if (pdr != 0)
+  {
+    if (pdr->xmin_ < rect.xmin_ || 
+        pdr->ymin_ < rect.ymin_ || 
+        pdr->xmax_ > rect.xmax_ || 
+        pdr->ymax_ > rect.ymax_  )
+      G_THROW( ERR_MSG("GPixmap.overflow4") );
+    rect = *pdr;
+    destwidth = rect.width();
+    destheight = rect.height();
+  }
+  // initialize pixmap
+  init(destheight, destwidth, 0);
+
+  // compute bounds
+  BlockArgs args;
+  args.src = src;
+  args.dst = this;
+  euclidian_ratio(rect.ymin_, 3, args.syz, args.dyz);
+  euclidian_ratio(rect.xmin_, 3, args.sxz, args.dxz);
+  args.sxz = 2 * args.sxz;   
+  args.syz = 2 * args.syz;
+  args.dxz = - args.dxz;
+  args.dyz = - args.dyz;
+
+  // process bands of row blocks
+  int nblocks = (destheight - args.dyz + 2) / 3;
+  run_bands(upsample23_band, (void*)&args, nblocks, destheight * destwidth);
+}
+
 
 //////////////////////////////////////////////////
 // Blitting and attenuating
@@ -1360,6 +1550,25 @@ compute_clip()
     clip[i] = (i<256 ? i : 255);
 }
 
+// Returns the position of the first nonzero alpha value in
+// #src[x]# to #src[xend-1]#, or #xend#.  Alpha maps are mostly
+// transparent, so zeros are skipped eight at a time.
+static inline int
+skip_transparent(const unsigned char *src, int x, int xend)
+{
+  while (x + 8 <= xend)
+    {
+      unsigned long long w;
+      memcpy(&w, src + x, sizeof(w));
+      if (w)
+        break;
+      x += 8;
+    }
+  while (x < xend && !src[x])
+    x++;
+  return x;
+}
+
 
 void 
 GPixmap::attenuate(const GBitmap *bm, int xpos, int ypos)
@@ -1377,32 +1586,31 @@ GPixmap::attenuate(const GBitmap *bm, int xpos, int ypos)
   for (unsigned int i=0; i<maxgray ; i++)
     multiplier[i] = 0x10000 * i / maxgray;
   // Compute starting point
-  const unsigned char *src = (*bm)[0] - mini(0,ypos)*bm->rowsize()-mini(0,xpos);
+  const unsigned char *src = (*bm)[0] - mini(0,ypos)*(int)bm->rowsize()-mini(0,xpos);
   GPixel *dst = (*this)[0] + maxi(0, ypos)*rowsize()+maxi(0, xpos);
   // Loop over rows
   for (int y=0; y<xrows; y++)
     {
-      // Loop over columns
-      for (int x=0; x<xcolumns; x++)
+      // Loop over nonzero alpha values
+      int x = 0;
+      while ((x = skip_transparent(src, x, xcolumns)) < xcolumns)
         {
           unsigned char srcpix = src[x];
           // Perform pixel operation
-          if (srcpix > 0)
+          if (srcpix >= maxgray)
             {
-              if (srcpix >= maxgray)
-                {
-                  dst[x].b = 0;
-                  dst[x].g = 0;
-                  dst[x].r = 0;
-                }
-              else
-                {
-                  unsigned int level = multiplier[srcpix];
-                  dst[x].b -=  (dst[x].b * level) >> 16;
-                  dst[x].g -=  (dst[x].g * level) >> 16;
-                  dst[x].r -=  (dst[x].r * level) >> 16;
-                }
+              dst[x].b = 0;
+              dst[x].g = 0;
+              dst[x].r = 0;
             }
+          else
+            {
+              unsigned int level = multiplier[srcpix];
+              dst[x].b -=  (dst[x].b * level) >> 16;
+              dst[x].g -=  (dst[x].g * level) >> 16;
+              dst[x].r -=  (dst[x].r * level) >> 16;
+            }
+          x++;
         }
       // Next line
       dst += rowsize();
@@ -1433,32 +1641,31 @@ GPixmap::blit(const GBitmap *bm, int xpos, int ypos, const GPixel *color)
   unsigned char gg = color->g;
   unsigned char gb = color->b;
   // Compute starting point
-  const unsigned char *src = (*bm)[0] - mini(0,ypos)*bm->rowsize()-mini(0,xpos);
+  const unsigned char *src = (*bm)[0] - mini(0,ypos)*(int)bm->rowsize()-mini(0,xpos);
   GPixel *dst = (*this)[0] + maxi(0, ypos)*rowsize()+maxi(0, xpos);
   // Loop over rows
   for (int y=0; y<xrows; y++)
     {
-      // Loop over columns
-      for (int x=0; x<xcolumns; x++)
+      // Loop over nonzero alpha values
+      int x = 0;
+      while ((x = skip_transparent(src, x, xcolumns)) < xcolumns)
         {
           unsigned char srcpix = src[x];
           // Perform pixel operation
-          if (srcpix > 0)
+          if (srcpix >= maxgray)
             {
-              if (srcpix >= maxgray)
-                {
-                  dst[x].b = clip[dst[x].b + gb];
-                  dst[x].g = clip[dst[x].g + gg];
-                  dst[x].r = clip[dst[x].r + gr];
-                }
-              else
-                {
-                  unsigned int level = multiplier[srcpix];
-                  dst[x].b = clip[dst[x].b + ((gb * level) >> 16)];
-                  dst[x].g = clip[dst[x].g + ((gg * level) >> 16)];
-                  dst[x].r = clip[dst[x].r + ((gr * level) >> 16)];
-                }
+              dst[x].b = clip[dst[x].b + gb];
+              dst[x].g = clip[dst[x].g + gg];
+              dst[x].r = clip[dst[x].r + gr];
+            }
+          else
+            {
+              unsigned int level = multiplier[srcpix];
+              dst[x].b = clip[dst[x].b + ((gb * level) >> 16)];
+              dst[x].g = clip[dst[x].g + ((gg * level) >> 16)];
+              dst[x].r = clip[dst[x].r + ((gr * level) >> 16)];
             }
+          x++;
         }
       // Next line
       dst += rowsize();
@@ -1488,33 +1695,32 @@ GPixmap::blit(const GBitmap *bm, int xpos, int ypos, const GPixmap *color)
     multiplier[i] = 0x10000 * i / maxgray;
   // Cache target color
   // Compute starting point
-  const unsigned char *src = (*bm)[0] - mini(0,ypos)*bm->rowsize()-mini(0,xpos);
+  const unsigned char *src = (*bm)[0] - mini(0,ypos)*(int)bm->rowsize()-mini(0,xpos);
   const GPixel *src2 = (*color)[0] + maxi(0, ypos)*color->rowsize()+maxi(0, xpos);
   GPixel *dst = (*this)[0] + maxi(0, ypos)*rowsize()+maxi(0, xpos);
   // Loop over rows
   for (int y=0; y<xrows; y++)
     {
-      // Loop over columns
-      for (int x=0; x<xcolumns; x++)
+      // Loop over nonzero alpha values
+      int x = 0;
+      while ((x = skip_transparent(src, x, xcolumns)) < xcolumns)
         {
           unsigned char srcpix = src[x];
           // Perform pixel operation
-          if (srcpix > 0)
+          if (srcpix >= maxgray)
             {
-              if (srcpix >= maxgray)
-                {
-                  dst[x].b = clip[dst[x].b + src2[x].b];
-                  dst[x].g = clip[dst[x].g + src2[x].g];
-                  dst[x].r = clip[dst[x].r + src2[x].r];
-                }
-              else
-                {
-                  unsigned int level = multiplier[srcpix];
-                  dst[x].b = clip[dst[x].b + ((src2[x].b * level) >> 16)];
-                  dst[x].g = clip[dst[x].g + ((src2[x].g * level) >> 16)];
-                  dst[x].r = clip[dst[x].r + ((src2[x].r * level) >> 16)];
-                }
+              dst[x].b = clip[dst[x].b + src2[x].b];
+              dst[x].g = clip[dst[x].g + src2[x].g];
+              dst[x].r = clip[dst[x].r + src2[x].r];
             }
+          else
+            {
+              unsigned int level = multiplier[srcpix];
+              dst[x].b = clip[dst[x].b + ((src2[x].b * level) >> 16)];
+              dst[x].g = clip[dst[x].g + ((src2[x].g * level) >> 16)];
+              dst[x].r = clip[dst[x].r + ((src2[x].r * level) >> 16)];
+            }
+          x++;
         }
       // Next line
       dst += rowsize();
@@ -1528,6 +1734,7 @@ GPixmap::blit(const GBitmap *bm, int xpos, int ypos, const GPixmap *color)
 void 
 GPixmap::blend(const GBitmap *bm, int xpos, int ypos, const GPixmap *color)
 {
+  DjVuProfile::Timer timer(DjVuProfile::COMPOSITE);
   // Check
   if (!bm) G_THROW( ERR_MSG("GPixmap.null_alpha") );
   if (!color) G_THROW( ERR_MSG("GPixmap.null_color") );
@@ -1546,33 +1753,32 @@ GPixmap::blend(const GBitmap *bm, int xpos, int ypos, const GPixmap *color)
     multiplier[i] = 0x10000 * i / maxgray;
   // Cache target color
   // Compute starting point
-  const unsigned char *src = (*bm)[0] - mini(0,ypos)*bm->rowsize()-mini(0,xpos);
+  const unsigned char *src = (*bm)[0] - mini(0,ypos)*(int)bm->rowsize()-mini(0,xpos);
   const GPixel *src2 = (*color)[0] + maxi(0, ypos)*color->rowsize()+maxi(0, xpos);
   GPixel *dst = (*this)[0] + maxi(0, ypos)*rowsize()+maxi(0, xpos);
   // Loop over rows
   for (int y=0; y<xrows; y++)
     {
-      // Loop over columns
-      for (int x=0; x<xcolumns; x++)
+      // Loop over nonzero alpha values
+      int x = 0;
+      while ((x = skip_transparent(src, x, xcolumns)) < xcolumns)
         {
           unsigned char srcpix = src[x];
           // Perform pixel operation
-          if (srcpix > 0)
+          if (srcpix >= maxgray)
             {
-              if (srcpix >= maxgray)
-                {
-                  dst[x].b = src2[x].b;
-                  dst[x].g = src2[x].g;
-                  dst[x].r = src2[x].r;
-                }
-              else
-                {
-                  unsigned int level = multiplier[srcpix];
-                  dst[x].b -= (((int)dst[x].b - (int)src2[x].b) * level) >> 16;
-                  dst[x].g -= (((int)dst[x].g - (int)src2[x].g) * level) >> 16;
-                  dst[x].r -= (((int)dst[x].r - (int)src2[x].r) * level) >> 16;
-                }
+              dst[x].b = src2[x].b;
+              dst[x].g = src2[x].g;
+              dst[x].r = src2[x].r;
             }
+          else
+            {
+              unsigned int level = multiplier[srcpix];
+              dst[x].b -= (((int)dst[x].b - (int)src2[x].b) * level) >> 16;
+              dst[x].g -= (((int)dst[x].g - (int)src2[x].g) * level) >> 16;
+              dst[x].r -= (((int)dst[x].r - (int)src2[x].r) * level) >> 16;
+            }
+          x++;
         }
       // Next line
       dst += rowsize();
@@ -1589,6 +1795,7 @@ GPixmap::stencil(const GBitmap *bm,
                 const GPixmap *pm, int pms, const GRect *pmr, 
                  double corr, GPixel white)
 {
+  DjVuProfile::Timer timer(DjVuProfile::COMPOSITE);
   // Check arguments
   GRect rect(0, 0, pm->columns()*pms, pm->rows()*pms);
   if (pmr != 0)
@@ -1612,6 +1819,8 @@ GPixmap::stencil(const GBitmap *bm,
     xcolumns = bm->columns();
   if (rect.width() < xcolumns)
     xcolumns = rect.width();
+  if (xrows <= 0 || xcolumns <= 0)
+    return;
   // Precompute multiplier map
   unsigned int multiplier[256];
   unsigned int maxgray = bm->get_grays() - 1;
@@ -1619,45 +1828,60 @@ GPixmap::stencil(const GBitmap *bm,
     multiplier[i] = 0x10000 * i / maxgray;
   // Prepare color correction table
   unsigned char gtable[256][3];
-  color_correction_table_cache(corr, white, gtable);
+  bool correct = color_correction_table_cache(corr, white, gtable);
   // Compute starting point in blown up foreground pixmap
   int fgy, fgy1, fgxz, fgx1z;
   euclidian_ratio(rect.ymin_, pms, fgy, fgy1);
   euclidian_ratio(rect.xmin_, pms, fgxz, fgx1z);
-  const GPixel *fg = (*pm)[fgy];
+  const GPixel *fg = (*pm)[fgy] + fgxz;
   const unsigned char *src = (*bm)[0];
   GPixel *dst = (*this)[0];
+  // Color corrected foreground pixels for the current row
+  int nfg = (fgx1z + xcolumns - 1) / pms + 1;
+  GPixel *cfg;
+  GPBuffer<GPixel> gcfg(cfg, nfg);
+  bool fgnew = true;
   // Loop over rows
   for (int y=0; y<xrows; y++)
   {
-    // Loop over columns
-    int fgx = fgxz;
-    int fgx1 = fgx1z;
-    for (int x=0; x<xcolumns; x++)
+    // Correct the foreground row once
+    if (fgnew)
+    {
+      memcpy(cfg, fg, nfg * sizeof(GPixel));
+      if (correct)
+        color_correct(gtable, cfg, nfg);
+      fgnew = false;
+    }
+    // Loop over nonzero alpha values
+    int x = 0;
+    while ((x = skip_transparent(src, x, xcolumns)) < xcolumns)
     {
-      unsigned char srcpix = src[x];
-      // Perform pixel operation
-      if (srcpix > 0)
+      int fgx, fgx1;
+      euclidian_ratio(fgx1z + x, pms, fgx, fgx1);
+      for (; x<xcolumns && src[x]; x++)
       {
+        unsigned char srcpix = src[x];
+        const GPixel &f = cfg[fgx];
+        // Perform pixel operation
         if (srcpix >= maxgray)
         {
-          dst[x].b = gtable[fg[fgx].b][0];
-          dst[x].g = gtable[fg[fgx].g][1];
-          dst[x].r = gtable[fg[fgx].r][2];
+          dst[x].b = f.b;
+          dst[x].g = f.g;
+          dst[x].r = f.r;
         }
         else
         {
           unsigned int level = multiplier[srcpix];
-          dst[x].b -= (((int)dst[x].b-(int)gtable[fg[fgx].b][0])*level) >> 16;
-          dst[x].g -= (((int)dst[x].g-(int)gtable[fg[fgx].g][1])*level) >> 16;
-          dst[x].r -= (((int)dst[x].r-(int)gtable[fg[fgx].r][2])*level) >> 16;
+          dst[x].b -= (((int)dst[x].b-(int)f.b)*level) >> 16;
+          dst[x].g -= (((int)dst[x].g-(int)f.g)*level) >> 16;
+          dst[x].r -= (((int)dst[x].r-(int)f.r)*level) >> 16;
+        }
+        // Next column
+        if (++fgx1 >= pms)
+        {
+          fgx1 = 0;
+          fgx += 1;
         }
-      }
-      // Next column
-      if (++fgx1 >= pms)
-      {
-        fgx1 = 0;
-        fgx += 1;
       }
     }
     // Next line
@@ -1667,6 +1891,7 @@ GPixmap::stencil(const GBitmap *bm,
     {
       fgy1 = 0;
       fg += pm->rowsize();
+      fgnew = true;
     } 
   }
 }
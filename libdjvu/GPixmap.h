@@ -284,6 +284,13 @@ public:
       operations are however performed together for efficiency reasons.  This
       function has been superseded by class \Ref{GPixmapScaler}. */
   void upsample23(const GPixmap *src, const GRect *rect=0);
+  /** Sets the number of threads used by the resampling functions above to
+      process large images by horizontal bands.  Zero selects the number
+      of processors.  The default value one disables the threads.  The
+      resampled images do not depend on this setting. */
+  static void set_threads(int threads);
+  /** Returns the number of threads used by the resampling functions. */
+  static int get_threads(void);
   //@}
 
   /** @name Blitting and applying stencils.  
@@ -367,6 +374,19 @@ public:
       This function is {\em static} and does not modify this pixmap. */
   static void color_correct(double corr, GPixel *pix, int npix);
   static void color_correct(double corr, GPixel white, GPixel *pix, int npix);
+  /** Computes the color correction table for gamma correction #corr# and
+      white point #white#.  Entry #gtable[i][c]# is the corrected value of
+      intensity #i# in channel #c# (blue, green, red).  Returns #false# when
+      the correction leaves all pixels unchanged.  Tables obtained this way
+      let callers apply the correction while the pixels are produced
+      instead of making another pass over the image. */
+  static bool color_correction_table(double corr, GPixel white,
+                                     unsigned char gtable[256][3]);
+  /** Applies color correction table #gtable# to this pixmap. */
+  void color_correct(const unsigned char gtable[256][3]);
+  /** Applies color correction table #gtable# to an array of pixels. */
+  static void color_correct(const unsigned char gtable[256][3],
+                            GPixel *pix, int npix);
 
   //@}
   
@@ -15,6 +15,7 @@
 #include <cstdint>
 
 #include "GScaler.h"
+#include "DjVuProfile.h"
 
 namespace DJVU {
 
@@ -254,6 +255,7 @@ unsigned char *GBitmapScaler::get_line(int fy, const GRect &required_red,
 
 void GBitmapScaler::scale(const GRect &provided_input, const GBitmap &input,
                           const GRect &desired_output, GBitmap &output) {
+  DjVuProfile::Timer timer(DjVuProfile::SCALE);
   // Compute rectangles
   GRect required_input;
   GRect required_red;
@@ -411,6 +413,13 @@ GPixel *GPixmapScaler::get_line(int fy, const GRect &required_red,
 
 void GPixmapScaler::scale(const GRect &provided_input, const GPixmap &input,
                           const GRect &desired_output, GPixmap &output) {
+  scale(provided_input, input, desired_output, output, 0);
+}
+
+void GPixmapScaler::scale(const GRect &provided_input, const GPixmap &input,
+                          const GRect &desired_output, GPixmap &output,
+                          const unsigned char gtable[256][3]) {
+  DjVuProfile::Timer timer(DjVuProfile::SCALE);
   // Compute rectangles
   GRect required_input;
   GRect required_red;
@@ -498,6 +507,10 @@ void GPixmapScaler::scale(const GRect &provided_input, const GPixmap &input,
         const int delta_b = deltas[(int)lower[1].b - lower_b];
         dest->b = lower_b + delta_b;
       }
+      // Color correct while the line is in the cache
+      if (gtable)
+        GPixmap::color_correct(gtable, output[y - desired_output.ymin_],
+                               desired_output.width());
     }
   }
   // Free temporaries
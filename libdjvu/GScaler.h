@@ -222,6 +222,14 @@ class DJVUAPI GPixmapScaler : public GScaler {
   void scale(const GRect &provided_input, const GPixmap &input,
              const GRect &desired_output, GPixmap &output);
 
+  /// Computes a segment of the rescaled output image like the function above,
+  /// and applies the color correction table #gtable# (see
+  /// \Ref{GPixmap::color_correction_table}) to each output line as soon as
+  /// it is computed.  No correction is performed when #gtable# is null.
+  void scale(const GRect &provided_input, const GPixmap &input,
+             const GRect &desired_output, GPixmap &output,
+             const unsigned char gtable[256][3]);
+
  protected:
   // Helpers
   GPixel *get_line(int, const GRect &, const GRect &, const GPixmap &);
@@ -180,6 +180,14 @@ GThread::current()
   return (void*) GetCurrentThreadId();
 }
 
+int
+GThread::ncpus()
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (info.dwNumberOfProcessors > 0) ? (int)info.dwNumberOfProcessors : 1;
+}
+
 struct thr_waiting {
   struct thr_waiting *next;
   struct thr_waiting *prev;
@@ -471,6 +479,17 @@ GThread::current()
 #endif
 }
 
+int
+GThread::ncpus()
+{
+#if defined(_SC_NPROCESSORS_ONLN)
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n > 0)
+    return (int)n;
+#endif
+  return 1;
+}
+
 // -- GMonitor
 
 GMonitor::GMonitor()
@@ -680,5 +699,310 @@ GSafeFlags::wait_and_modify(long set_mask, long clr_mask,
 
 
 
+// ----------------------------------------
+// GPIPELINE
+// ----------------------------------------
+
+
+// The state and the error of job k are kept in slot k%window.  Jobs
+// between current and next are running or complete, jobs after next
+// are queued.  Since the workers never start a job beyond current+window,
+// a slot is reused only after the consumer has collected its previous job.
+
+GPipeline::GPipeline()
+  : nthreads(0), window(1), njobs(0), next(0), current(0), 
+    running(0), assigned(0), stopping(false), 
+    state(new char[1]), errors(new GException*[1]), threads(0)
+{
+  state[0] = QUEUED;
+  errors[0] = 0;
+}
+
+GPipeline::~GPipeline()
+{
+  stop();
+  delete [] threads;
+  for (int i=0; i<window; i++)
+    delete errors[i];
+  delete [] errors;
+  delete [] state;
+}
+
+void
+GPipeline::start(int xnthreads, int xwindow)
+{
+  GMonitorLock lock(&monitor);
+  nthreads = (xnthreads > 1) ? xnthreads : 0;
+  window = (xwindow > 0) ? xwindow : 2 * nthreads;
+  if (window < 1)
+    window = 1;
+  delete [] state;
+  delete [] errors;
+  state = new char[window];
+  errors = new GException*[window];
+  for (int i=0; i<window; i++)
+    {
+      state[i] = QUEUED;
+      errors[i] = 0;
+    }
+  if (nthreads > 0)
+    {
+      threads = new GThread[nthreads];
+      for (int i=0; i<nthreads; i++)
+        if (threads[i].create(start_worker, (void*)this) == 0)
+          running += 1;
+    }
+}
+
+void
+GPipeline::stop()
+{
+  GMonitorLock lock(&monitor);
+  stopping = true;
+  monitor.broadcast();
+  while (running > 0)
+    monitor.wait(250);
+}
+
+void
+GPipeline::add(int n)
+{
+  GMonitorLock lock(&monitor);
+  njobs += n;
+  monitor.broadcast();
+}
+
+bool
+GPipeline::full()
+{
+  GMonitorLock lock(&monitor);
+  return njobs >= current + window;
+}
+
+bool
+GPipeline::ready()
+{
+  GMonitorLock lock(&monitor);
+  return current < next && state[current % window] == DONE;
+}
+
+void
+GPipeline::waiting()
+{
+}
+
+void
+GPipeline::start_worker(void *arg)
+{
+  ((GPipeline*)arg)->run();
+}
+
+void
+GPipeline::perform(int k, int worker)
+{
+  // Called without holding the monitor.
+  // Every exception is caught here so that the job
+  // always completes and the worker keeps running.
+  GException *error = 0;
+  G_TRY
+    {
+      work(k, worker);
+    }
+  G_CATCH(ex)
+    {
+      error = new GException(ex);
+    }
+  G_ENDCATCH
+  G_CATCH_ALL
+    {
+      error = new GException( ERR_MSG("GThreads.unrecognized") );
+    }
+  G_ENDCATCH;
+  GMonitorLock lock(&monitor);
+  errors[k % window] = error;
+  state[k % window] = DONE;
+  monitor.broadcast();
+}
+
+void
+GPipeline::run()
+{
+  monitor.enter();
+  int worker = assigned++;
+  for(;;)
+    {
+      while (!stopping && (next >= njobs || next >= current + window))
+        monitor.wait(250);
+      if (stopping)
+        break;
+      int k = next++;
+      state[k % window] = RUNNING;
+      monitor.leave();
+      perform(k, worker);
+      monitor.enter();
+    }
+  running -= 1;
+  monitor.broadcast();
+  monitor.leave();
+}
+
+int
+GPipeline::get()
+{
+  int k;
+  GException *error;
+  {
+    GMonitorLock lock(&monitor);
+    k = current;
+    if (k >= njobs)
+      return -1;
+    while (k >= next || state[k % window] != DONE)
+      {
+        if (k >= next && running < 1)
+          {
+            // No worker is left to run this job.
+            next = k + 1;
+            state[k % window] = RUNNING;
+            monitor.leave();
+            perform(k, -1);
+            monitor.enter();
+            continue;
+          }
+        monitor.wait(250);
+        if (k < next && state[k % window] == DONE)
+          break;
+        // Let the caller do something useful
+        monitor.leave();
+        waiting();
+        monitor.enter();
+      }
+    error = errors[k % window];
+    errors[k % window] = 0;
+    state[k % window] = QUEUED;
+    current = k + 1;
+    monitor.broadcast();
+  }
+  if (error)
+    {
+      GException ex(*error);
+      delete error;
+      G_RETHROW(ex);
+    }
+  return k;
+}
+
+
+
+// ----------------------------------------
+// GPARALLEL
+// ----------------------------------------
+
+
+GParallel::GParallel()
+  : ntasks(0), next(0), running(0), error(0)
+{
+}
+
+GParallel::~GParallel()
+{
+  delete error;
+}
+
+void
+GParallel::start_worker(void *arg)
+{
+  GParallel *self = (GParallel*)arg;
+  self->loop();
+  GMonitorLock lock(&self->monitor);
+  self->running -= 1;
+  self->monitor.broadcast();
+}
+
+void
+GParallel::loop()
+{
+  // Every exception is caught here so that
+  // the threads always reach the join.
+  for(;;)
+    {
+      int k;
+      {
+        GMonitorLock lock(&monitor);
+        if (next >= ntasks)
+          break;
+        k = next++;
+      }
+      GException *err = 0;
+      G_TRY
+        {
+          work(k);
+        }
+      G_CATCH(ex)
+        {
+          err = new GException(ex);
+        }
+      G_ENDCATCH
+      G_CATCH_ALL
+        {
+          err = new GException( ERR_MSG("GThreads.unrecognized") );
+        }
+      G_ENDCATCH;
+      if (err)
+        {
+          GMonitorLock lock(&monitor);
+          if (error)
+            delete err;
+          else
+            error = err;
+          next = ntasks;
+        }
+    }
+}
+
+void
+GParallel::run(int xntasks, int nthreads)
+{
+  int nworkers = ((nthreads < xntasks) ? nthreads : xntasks) - 1;
+  {
+    GMonitorLock lock(&monitor);
+    ntasks = xntasks;
+    next = 0;
+    running = 0;
+  }
+  GThread *threads = 0;
+  if (nworkers > 0)
+    {
+      threads = new GThread[nworkers];
+      for (int i=0; i<nworkers; i++)
+        {
+          {
+            GMonitorLock lock(&monitor);
+            running += 1;
+          }
+          if (threads[i].create(start_worker, (void*)this) != 0)
+            {
+              GMonitorLock lock(&monitor);
+              running -= 1;
+            }
+        }
+    }
+  loop();
+  {
+    GMonitorLock lock(&monitor);
+    while (running > 0)
+      monitor.wait();
+  }
+  delete [] threads;
+  if (error)
+    {
+      GException ex(*error);
+      delete error;
+      error = 0;
+      G_RETHROW(ex);
+    }
+}
+
+
+
 }
 using namespace DJVU;
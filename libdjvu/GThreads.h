@@ -179,6 +179,10 @@ public:
   static int yield();
   /** Returns a value which uniquely identifies the current thread. */
   static void *current();
+  /** Returns the number of processors available to the process.
+      This is useful to choose the number of worker threads. 
+      Returns one when this number cannot be determined. */
+  static int ncpus();
 #if WINTHREADS
 private:
   HANDLE hthr;
@@ -321,6 +325,125 @@ public:
 
 
 
+// ----------------------------------------
+// WORKER PIPELINE
+
+
+/** Ordered worker pipeline.  This abstract class runs numbered jobs in
+    worker threads and hands them back to a consumer thread in the order of
+    their numbers.  Jobs are made available with \Ref{add} and are collected
+    with \Ref{get}.  Derived classes implement the virtual function
+    \Ref{work} which performs job number #k# and saves its results for the
+    consumer.  The workers never run more than #window# jobs ahead of the
+    consumer, which bounds the memory used by the jobs in flight.
+
+    Exceptions thrown by \Ref{work} are caught by the worker and thrown again
+    by \Ref{get} when the consumer collects the job.  When no worker thread is
+    running, for instance because threads could not be created, function
+    \Ref{get} performs the jobs itself.  Derived classes must call \Ref{stop}
+    in their destructor before destroying the data used by \Ref{work}. */
+
+class GPipeline
+{
+public:
+  GPipeline();
+  virtual ~GPipeline();
+  /** Starts #nthreads# worker threads.  Argument #window# is the maximal
+      number of jobs processed ahead of the consumer. A negative value
+      selects twice the number of threads. No thread is started when
+      #nthreads# is smaller than two: jobs are then performed by \Ref{get}.
+      This function must be called once, before \Ref{add}. */
+  void start(int nthreads, int window=-1);
+  /** Tells the workers to stop and waits until they are gone.
+      Jobs that have not been started are abandoned. */
+  void stop();
+  /** Makes #n# more jobs available to the workers. */
+  void add(int n=1);
+  /** Returns #TRUE# when the workers already have #window# jobs
+      ahead of the consumer. */
+  bool full();
+  /** Returns #TRUE# when the next job is complete. */
+  bool ready();
+  /** Waits until the next job is complete and returns its number,
+      or returns #-1# when all jobs have been collected. An exception
+      thrown by the job is thrown again here. */
+  int get();
+protected:
+  /** Performs job #k#.  Argument #worker# is the number of the calling
+      worker thread, or #-1# when the job runs in the thread calling
+      \Ref{get}. */
+  virtual void work(int k, int worker) = 0;
+  /** Called by \Ref{get} from time to time while waiting. */
+  virtual void waiting();
+private:
+  enum { QUEUED, RUNNING, DONE };
+  int nthreads;
+  int window;
+  int njobs;
+  int next;
+  int current;
+  int running;
+  int assigned;
+  bool stopping;
+  char *state;
+  GException **errors;
+  GThread *threads;
+  GMonitor monitor;
+  static void start_worker(void *arg);
+  void run();
+  void perform(int k, int worker);
+private:
+  // Disable default members
+  GPipeline(const GPipeline&);
+  GPipeline& operator=(const GPipeline&);
+};
+
+
+// ----------------------------------------
+// PARALLEL LOOP
+
+
+/** Fork-join parallel loop.  Derived classes implement the virtual
+    function \Ref{work} which performs task number #k#.  Function
+    \Ref{run} distributes the tasks among the calling thread and
+    additional worker threads, and returns when all the tasks are
+    complete.  Tasks must write disjoint results, so that the outcome
+    does not depend on the number of threads.
+
+    Exceptions thrown by \Ref{work} are caught in the thread performing
+    the task.  No new task is started after an exception, and the first
+    exception is thrown again by \Ref{run} after all the threads have 
+    finished.  The object is therefore never referenced by a worker
+    after \Ref{run} returns. */
+
+class GParallel
+{
+public:
+  GParallel();
+  virtual ~GParallel();
+  /** Performs tasks #0# to #ntasks-1# using the calling thread and
+      at most #nthreads-1# additional threads.  When threads cannot
+      be created, the calling thread performs their tasks. */
+  void run(int ntasks, int nthreads);
+protected:
+  /** Performs task #k#. */
+  virtual void work(int k) = 0;
+private:
+  int ntasks;
+  int next;
+  int running;
+  GException *error;
+  GMonitor monitor;
+  static void start_worker(void *arg);
+  void loop();
+private:
+  // Disable default members
+  GParallel(const GParallel&);
+  GParallel& operator=(const GParallel&);
+};
+
+
+
 // ----------------------------------------
 // GSAFEFLAGS (LB: this is not foolproof-safe but can be used savely!)
 
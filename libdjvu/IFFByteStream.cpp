@@ -484,6 +484,26 @@ IFFByteStream::read(void *buffer, size_t size)
   return bytes;
 }
 
+size_t 
+IFFByteStream::readview(const void *&ptr, size_t size)
+{
+  if (! (ctx && dir < 0))
+    G_THROW( ERR_MSG("IFFByteStream.not_ready3") );
+  // Seek if necessary
+  if (seekto > offset) {
+    bs->seek(seekto);
+    offset = seekto;
+  }
+  // Ensure that the view does not extend beyond chunk
+  if (offset > ctx->offEnd)
+    G_THROW( ERR_MSG("IFFByteStream.bad_offset") );
+  if (offset + (long)size >  ctx->offEnd)
+    size = (size_t) (ctx->offEnd - offset);
+  size_t bytes = bs->readview(ptr, size);
+  offset += bytes;
+  return bytes;
+}
+
 
 // IFFByteStream::write
 // -- write bytes to IFF file chunk
@@ -184,6 +184,11 @@ public:
   virtual size_t read(void *buffer, size_t size);
   virtual size_t write(const void *buffer, size_t size);
   virtual long tell(void) const;
+  /** Reads chunk data without copying when the underlying ByteStream
+      keeps its data in memory (see \Ref{ByteStream::readview}).  Like
+      function #read#, this function never returns data located beyond
+      the end of the current chunk. */
+  virtual size_t readview(const void *&ptr, size_t size);
   // -- NAVIGATING CHUNKS
   /** Enters a chunk for reading.  Function #get_chunk# returns zero when the
       last chunk has already been accessed.  Otherwise it parses a chunk
@@ -73,6 +73,7 @@
 #include "GPixmap.h"
 #include "IFFByteStream.h"
 #include "GRect.h"
+#include "DjVuProfile.h"
 
 #include <stddef.h>
 #include <stdlib.h>
@@ -96,6 +97,7 @@ namespace DJVU {
 #define IWCODEC_MAJOR     1
 #define IWCODEC_MINOR     2
 #define DECIBEL_PRUNE   5.0
+#define IWLORES_QUANT   0x100
 
 
 //////////////////////////////////////////////////////
@@ -982,6 +984,29 @@ IW44Image::Codec::Decode::code_slice(ZPCodec &zp)
   return finish_code_slice(zp);
 }
 
+// is_precise
+// -- check whether the coefficients used for rendering
+//    with this subsampling factor are known within IWLORES_QUANT
+
+int
+IW44Image::Codec::is_precise(int subsample)
+{
+  // Rendering at subsample 32>>n uses the first 4^n coefficients
+  int ncoeff = 1;
+  while (subsample < 32)
+    {
+      ncoeff *= 4;
+      subsample += subsample;
+    }
+  for (int i=0; i<16 && i<ncoeff; i++)
+    if (quant_lo[i] > IWLORES_QUANT)
+      return 0;
+  for (int band=1; band<10; band++)
+    if (bandbuckets[band].start*16 < ncoeff && quant_hi[band] > IWLORES_QUANT)
+      return 0;
+  return 1;
+}
+
 // code_slice
 // -- read/write a slice of datafile
 
@@ -1320,11 +1345,24 @@ IW44Image::TertiaryHeader::decode(GP<ByteStream> gbs, int major, int minor)
 //////////////////////////////////////////////////////
 
 IW44Image::IW44Image(void)
-  : db_frac(1.0),
+  : db_frac(1.0), min_subsample(1),
     ymap(0), cbmap(0), crmap(0),
-    cslice(0), cserial(0), cbytes(0)
+    cslice(0), cserial(0), cbytes(0), precise(false)
 {}
 
+int
+IW44Image::parm_subsample(const int subsample)
+{
+  if (subsample > 0)
+    {
+      // Map::image() only accepts powers of two
+      min_subsample = 1;
+      while (min_subsample < 32 && min_subsample*2 <= subsample)
+        min_subsample += min_subsample;
+    }
+  return min_subsample;
+}
+
 IW44Image::~IW44Image()
 {
   delete ymap;
@@ -1366,6 +1404,7 @@ IWBitmap::close_codec(void)
   delete ycodec;
   ycodec = 0;
   cslice = cbytes = cserial = 0;
+  precise = false;
 }
 
 void 
@@ -1376,6 +1415,7 @@ IWPixmap::close_codec(void)
   delete crcodec;
   ycodec = crcodec = cbcodec = 0;
   cslice = cbytes = cserial = 0;
+  precise = false;
 }
 
 int 
@@ -1430,6 +1470,7 @@ IWBitmap::get_memory_usage(void) const
 GP<GBitmap> 
 IWBitmap::get_bitmap(void)
 {
+  DjVuProfile::Timer timer(DjVuProfile::IW44_RECONSTRUCT);
   // Check presence of data
   if (ymap == 0)
     return 0;
@@ -1454,6 +1495,7 @@ IWBitmap::get_bitmap(void)
 GP<GBitmap>
 IWBitmap::get_bitmap(int subsample, const GRect &rect)
 {
+  DjVuProfile::Timer timer(DjVuProfile::IW44_RECONSTRUCT);
   if (ymap == 0)
     return 0;
   // Allocate bitmap
@@ -1477,6 +1519,7 @@ IWBitmap::get_bitmap(int subsample, const GRect &rect)
 int
 IWBitmap::decode_chunk(GP<ByteStream> gbs)
 {
+  DjVuProfile::Timer timer(DjVuProfile::IW44_DECODE);
   // Open
   if (! ycodec)
   {
@@ -1490,6 +1533,13 @@ IWBitmap::decode_chunk(GP<ByteStream> gbs)
   if (primary.serial != cserial)
     G_THROW( ERR_MSG("IW44Image.wrong_serial") );
   int nslices = cslice + primary.slices;
+  // Skip data not needed at the requested resolution
+  if (precise)
+    {
+      cslice = nslices;
+      cserial += 1;
+      return nslices;
+    }
   // Read auxilliary headers
   if (cserial == 0)
     {
@@ -1522,6 +1572,12 @@ IWBitmap::decode_chunk(GP<ByteStream> gbs)
     {
       flag = ycodec->code_slice(zp);
       cslice++;
+      if (min_subsample>1 && ycodec->is_precise(min_subsample))
+        {
+          precise = true;
+          cslice = nslices;
+          break;
+        }
     }
   // Return
   cserial += 1;
@@ -1635,6 +1691,7 @@ IWPixmap::get_memory_usage(void) const
 GP<GPixmap> 
 IWPixmap::get_pixmap(void)
 {
+  DjVuProfile::Timer timer(DjVuProfile::IW44_RECONSTRUCT);
   // Check presence of data
   if (ymap == 0)
     return 0;
@@ -1676,6 +1733,7 @@ IWPixmap::get_pixmap(void)
 GP<GPixmap>
 IWPixmap::get_pixmap(int subsample, const GRect &rect)
 {
+  DjVuProfile::Timer timer(DjVuProfile::IW44_RECONSTRUCT);
   if (ymap == 0)
     return 0;
   // Allocate
@@ -1715,6 +1773,7 @@ IWPixmap::get_pixmap(int subsample, const GRect &rect)
 int
 IWPixmap::decode_chunk(GP<ByteStream> gbs)
 {
+  DjVuProfile::Timer timer(DjVuProfile::IW44_DECODE);
   // Open
   if (! ycodec)
   {
@@ -1729,6 +1788,13 @@ IWPixmap::decode_chunk(GP<ByteStream> gbs)
   if (primary.serial != cserial)
     G_THROW( ERR_MSG("IW44Image.wrong_serial2") );
   int nslices = cslice + primary.slices;
+  // Skip data not needed at the requested resolution
+  if (precise)
+    {
+      cslice = nslices;
+      cserial += 1;
+      return nslices;
+    }
   // Read secondary header
   if (cserial == 0)
     {
@@ -1780,6 +1846,15 @@ IWPixmap::decode_chunk(GP<ByteStream> gbs)
           flag |= crcodec->code_slice(zp);
         }
       cslice++;
+      if (min_subsample>1 && ycodec->is_precise(min_subsample) &&
+          (!crcodec || !cbcodec || 
+           (cbcodec->is_precise(min_subsample) &&
+            crcodec->is_precise(min_subsample))))
+        {
+          precise = true;
+          cslice = nslices;
+          break;
+        }
     }
   // Return
   cserial += 1;
@@ -358,14 +358,27 @@ public:
       misrepresented 32x32 pixel blocks.  Setting arguments #frac# to #1.0#
       restores the normal behavior.  */
   virtual void parm_dbfrac(float frac) = 0;
+  /** Sets the smallest subsampling factor the image will be rendered
+      with.  This function can be called before decoding the first IW44
+      data chunk.  When #subsample# is larger than #1#, function
+      #decode_chunk# stops decoding as soon as the wavelet coefficients
+      used by \Ref{get_pixmap} and \Ref{get_bitmap} at this subsampling
+      factor are known within a few gray levels, and skips all the
+      following chunks.  Rendering at a smaller subsampling factor
+      remains possible, but with a lower quality.  The default value #1#
+      decodes all the data.  Returns the current setting, which is left
+      unchanged when #subsample# is zero. */
+  int parm_subsample(const int subsample);
 protected:
   // Parameter
   float db_frac;
+  int min_subsample;
   // Data
   Map *ymap, *cbmap, *crmap;
   int cslice;
   int cserial;
   int cbytes;
+  bool precise;
 private:
   // Disable assignment semantic
   IW44Image(const IW44Image &ref);
@@ -647,6 +660,7 @@ public:
   // Coding
   int finish_code_slice(ZPCodec &zp);
   virtual int code_slice(ZPCodec &zp) = 0;
+  int is_precise(int subsample);
   // Data
   IW44Image::Map &map;                  // working map
   // status
@@ -66,6 +66,7 @@
 #include "GThreads.h"
 #include "GRect.h"
 #include "GBitmap.h"
+#include "DjVuProfile.h"
 #include <string.h>
 
 
@@ -223,6 +224,7 @@ JB2Dict::add_shape(const JB2Shape &shape)
 void 
 JB2Dict::decode(const GP<ByteStream> &gbs, JB2DecoderCallback *cb, void *arg)
 {
+  DjVuProfile::Timer timer(DjVuProfile::JB2_DECODE);
   init();
   JB2Codec::Decode codec;
   codec.init(gbs);
@@ -280,6 +282,7 @@ JB2Image::add_blit(const JB2Blit &blit)
 GP<GBitmap>
 JB2Image::get_bitmap(int subsample, int align) const
 {
+  DjVuProfile::Timer timer(DjVuProfile::JB2_BLIT);
   if (width==0 || height==0)
     G_THROW( ERR_MSG("JB2Image.cant_create") );
   int swidth = (width + subsample - 1) / subsample;
@@ -300,6 +303,7 @@ JB2Image::get_bitmap(int subsample, int align) const
 GP<GBitmap>
 JB2Image::get_bitmap(const GRect &rect, int subsample, int align, int dispy) const
 {
+  DjVuProfile::Timer timer(DjVuProfile::JB2_BLIT);
   if (width==0 || height==0)
     G_THROW( ERR_MSG("JB2Image.cant_create") );
   int rxmin = rect.xmin_ * subsample;
@@ -322,6 +326,7 @@ JB2Image::get_bitmap(const GRect &rect, int subsample, int align, int dispy) con
 void 
 JB2Image::decode(const GP<ByteStream> &gbs, JB2DecoderCallback *cb, void *arg)
 {
+  DjVuProfile::Timer timer(DjVuProfile::JB2_DECODE);
   init();
   JB2Codec::Decode codec;
   codec.init(gbs);
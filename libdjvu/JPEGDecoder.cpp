@@ -124,12 +124,26 @@ GP<GPixmap>
 JPEGDecoder::decode(ByteStream & bs )
 {
   GP<GPixmap> retval=GPixmap::create();
-  decode(bs,*retval);
+  decode(bs,*retval,1);
+  return retval;
+}
+
+GP<GPixmap>
+JPEGDecoder::decode(ByteStream & bs, int scale)
+{
+  GP<GPixmap> retval=GPixmap::create();
+  decode(bs,*retval,scale);
   return retval;
 }
 
 void
 JPEGDecoder::decode(ByteStream & bs,GPixmap &pix)
+{
+  decode(bs,pix,1);
+}
+
+void
+JPEGDecoder::decode(ByteStream & bs, GPixmap &pix, int scale)
 {
   struct jpeg_decompress_struct cinfo;
 
@@ -137,8 +151,6 @@ JPEGDecoder::decode(ByteStream & bs,GPixmap &pix)
   struct djvu_error_mgr jerr;
 
   JSAMPARRAY buffer;    /* Output row buffer */
-  int row_stride;   /* physical row width in output buffer */
-  int isGrey,i;
 
   cinfo.err = jpeg_std_error(&jerr.pub);
 
@@ -162,55 +174,86 @@ JPEGDecoder::decode(ByteStream & bs,GPixmap &pix)
 
   (void) jpeg_read_header(&cinfo, TRUE);
 
-  jpeg_start_decompress(&cinfo);
-  
-  /* We may need to do some setup of our own at this point before reading
-   * the data.  After jpeg_start_decompress() we have the correct scaled
-   * output image dimensions available, as well as the output colormap
-   * if we asked for color quantization.
-   * In this example, we need to make an output work buffer of the right size.
-   */
+  /* Let the library reduce the image while computing the inverse DCT */
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = (scale >= 8) ? 8 : (scale >= 4) ? 4 : (scale >= 2) ? 2 : 1;
 
-  /* JSAMPLEs per row in output buffer */
-  row_stride = cinfo.output_width * cinfo.output_components;
+  /* The library converts three component images to RGB.
+     Four component images are decoded as CMYK and converted below. */
+  if (cinfo.num_components == 3)
+    cinfo.out_color_space = JCS_RGB;
+  else if (cinfo.num_components == 4)
+    cinfo.out_color_space = JCS_CMYK;
+  const bool inverted = (cinfo.saw_Adobe_marker != 0);
 
+  jpeg_start_decompress(&cinfo);
+  
   /* Make a one-row-high sample array that will go away when done with image */
+  const int width = cinfo.output_width;
+  const int height = cinfo.output_height;
+  const int ncomp = cinfo.output_components;
   buffer = (*cinfo.mem->alloc_sarray)
-    ((j_common_ptr) &cinfo, JPOOL_IMAGE, row_stride, 1);
-
-  GP<ByteStream> goutputBlock=ByteStream::create();
-  ByteStream &outputBlock=*goutputBlock;
-  outputBlock.format("P6\n%d %d\n%d\n",cinfo.output_width, 
-                                 cinfo.output_height,255);
-
-  isGrey = ( cinfo.out_color_space == JCS_GRAYSCALE) ? 1 : 0; 
+    ((j_common_ptr) &cinfo, JPOOL_IMAGE, width * ncomp, 1);
 
+  /* Decode rows directly into the pixmap, whose first row is the bottom row */
+  pix.init(height, width, 0);
   while (cinfo.output_scanline < cinfo.output_height)
   {
+    GPixel *row = pix[height - 1 - cinfo.output_scanline];
     (void) jpeg_read_scanlines(&cinfo, buffer, 1);
-
-    if ( isGrey == 1 )
+    const JSAMPLE *src = buffer[0];
+    if (ncomp == 1)
+    {
+      for (int i=0; i<width; i++, src++)
+        row[i].b = row[i].g = row[i].r = src[0];
+    }else if (ncomp == 4)
     {
-      for (i=0; i<row_stride; i++)
+      /* Adobe applications write inverted CMYK values */
+      for (int i=0; i<width; i++, src+=ncomp)
       {
-        outputBlock.write8((char)buffer[0][i]); 
-        outputBlock.write8((char)buffer[0][i]); 
-        outputBlock.write8((char)buffer[0][i]); 
+        const int c = inverted ? src[0] : 255 - src[0];
+        const int m = inverted ? src[1] : 255 - src[1];
+        const int y = inverted ? src[2] : 255 - src[2];
+        const int k = inverted ? src[3] : 255 - src[3];
+        row[i].r = (c * k + 127) / 255;
+        row[i].g = (m * k + 127) / 255;
+        row[i].b = (y * k + 127) / 255;
       }
     }else
     {
-      for (i=0; i<row_stride; i++) 
-        outputBlock.write8((char)buffer[0][i]); 
+      for (int i=0; i<width; i++, src+=ncomp)
+      {
+        row[i].r = src[0];
+        row[i].g = src[1];
+        row[i].b = src[2];
+      }
     }
   }
 
   (void) jpeg_finish_decompress(&cinfo);   
 
   jpeg_destroy_decompress(&cinfo);
-  
-  outputBlock.seek(0,SEEK_SET);
+}
 
-  pix.init(outputBlock);
+bool
+JPEGDecoder::get_size(ByteStream & bs, int &width, int &height)
+{
+  struct jpeg_decompress_struct cinfo;
+  struct djvu_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = djvu_error_exit;
+  if (setjmp(jerr.setjmp_buffer))
+  {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  jpeg_create_decompress(&cinfo);
+  Impl::jpeg_byte_stream_src(&cinfo, bs);
+  (void) jpeg_read_header(&cinfo, TRUE);
+  width = cinfo.image_width;
+  height = cinfo.image_height;
+  jpeg_destroy_decompress(&cinfo);
+  return true;
 }         
 
 /*** From here onwards code is to make ByteStream as the data
@@ -95,6 +95,17 @@ public:
   /** Decodes the JPEG formated ByteStream */ 
   static GP<GPixmap> decode(ByteStream & bs);
   static void decode(ByteStream & bs,GPixmap &pix);
+  /** Decodes the JPEG formated ByteStream at a reduced resolution.
+      The image is reduced by a factor #scale# equal to #1#, #2#, #4#
+      or #8# using the DCT scaling of the JPEG library, which is much
+      faster than decoding the full image and downsampling it.  The
+      resulting pixmap has size #ceil(width/scale)# by
+      #ceil(height/scale)#. */
+  static GP<GPixmap> decode(ByteStream & bs, int scale);
+  static void decode(ByteStream & bs, GPixmap &pix, int scale);
+  /** Reads the image size from the header of the JPEG formated
+      ByteStream. Returns false if the header cannot be read. */
+  static bool get_size(ByteStream & bs, int &width, int &height);
 #ifdef LIBJPEGNAME
   static void *jpeg_lookup(const GUTF8String &name);
   static jpeg_error_mgr *jpeg_std_error(jpeg_error_mgr *x);
@@ -325,7 +325,7 @@ static const VLCode bcodes[] = {
 // ----------------------------------------
 // SOURCE OF BITS
 
-#define VLSBUFSIZE    64
+#define VLSBUFSIZE    256
 
 class MMRDecoder::VLSource : public GPEnabled
 {
@@ -339,18 +339,19 @@ public:
   // Synchronize on the next stripe
   void nextstripe(void);
   // Returns a 32 bits integer with at least the 
-  // next sixteen code bits in the high order bits.
+  // next 24 code bits in the high order bits.
   inline unsigned int peek(void);
   // Ensures that next #peek()# contains at least
-  // the next 24 code bits.
+  // the next 32 code bits.
   void preload(void);
   // Consumes #n# bits.
-  void shift(const int n);
+  inline void shift(const int n);
 private:
+  typedef unsigned long long word_t;
   GP<ByteStream> ginp;
   ByteStream &inp;
   unsigned char buffer[ VLSBUFSIZE ];
-  unsigned int codeword;
+  word_t codeword;
   int lowbits;
   int bufpos;
   int bufmax;
@@ -368,7 +369,7 @@ MMRDecoder::VLSource::init(const bool striped)
 {
   if (striped)
     readmax = inp.read32();
-  lowbits = 32;
+  lowbits = 64;
   preload();
 }
 
@@ -381,19 +382,19 @@ MMRDecoder::VLSource::create(GP<ByteStream> &inp, const bool striped)
   return retval;
 }
 
-void 
+inline void 
 MMRDecoder::VLSource::shift(const int n)
 { 
   codeword<<=n;
   lowbits+=n;
-  if (lowbits>=16)
+  if (lowbits>32)
     preload();
 }
 
 inline unsigned int
 MMRDecoder::VLSource::peek(void)
 {
-  return codeword;
+  return (unsigned int)(codeword >> 32);
 }
 
 
@@ -412,13 +413,29 @@ MMRDecoder::VLSource::nextstripe(void)
   memset(buffer,0,sizeof(buffer));
   readmax = inp.read32();
   codeword = 0; 
-  lowbits = 32;
+  lowbits = 64;
   preload();
 }
 
 void
 MMRDecoder::VLSource::preload(void)
 {
+  // Common case: read eight bytes at once and insert all 
+  // the whole bytes that fit.  The low order bits then hold
+  // the first bits of the next byte, which the next refill
+  // inserts again at the same position.
+  if (lowbits>=8 && bufpos+8 <= bufmax)
+    {
+      const unsigned char *p = buffer + bufpos;
+      word_t w = ((word_t)p[0] << 56) | ((word_t)p[1] << 48) |
+        ((word_t)p[2] << 40) | ((word_t)p[3] << 32) |
+        ((word_t)p[4] << 24) | ((word_t)p[5] << 16) |
+        ((word_t)p[6] << 8) | (word_t)p[7];
+      codeword |= w >> (64-lowbits);
+      bufpos += lowbits>>3;
+      lowbits &= 7;
+      return;
+    }
   while (lowbits>=8) 
     {
       if (bufpos >= bufmax) 
@@ -435,7 +452,7 @@ MMRDecoder::VLSource::preload(void)
             return;
 	}
       lowbits -= 8;
-      codeword |= buffer[bufpos++] << lowbits;
+      codeword |= (word_t)buffer[bufpos++] << lowbits;
     }
 }
 
@@ -445,48 +462,64 @@ MMRDecoder::VLSource::preload(void)
 // VARIABLE LENGTH CODES
 
 
+// Table entries hold a decoded value and its code length.  Entries
+// with a negative code length point to a second level table 
+// indexed by the next code bits.
+struct VLEntry
+{
+  short value;
+  short codelen;
+};
 
 class MMRDecoder::VLTable : public GPEnabled
 {
 protected:
   VLTable(const VLCode *codes);
-  void init(const int nbits);
+  void init(const int nbits, const int nbits1);
 public:
   // Construct a VLTable given a codebook with #nbits# long codes.
-  static GP<VLTable> create(VLCode const * const codes, const int nbits);
+  // The first level table is indexed by #nbits1# bits.
+  static GP<VLTable> create(VLCode const * const codes, 
+                            const int nbits, const int nbits1);
 
   // Reads one symbol from a VLSource
-  int decode(MMRDecoder::VLSource *src);
+  inline int decode(MMRDecoder::VLSource *src);
 
   const VLCode *code;
-  int codewordshift;
-  unsigned char *index;
-  GPBuffer<unsigned char> gindex;
+  int nbits1;
+  int shift1;
+  int shift2;
+  VLEntry *entry;
+  GPBuffer<VLEntry> gentry;
 };
 
 GP<MMRDecoder::VLTable>
-MMRDecoder::VLTable::create(VLCode const * const codes, const int nbits)
+MMRDecoder::VLTable::create(VLCode const * const codes, 
+                            const int nbits, const int nbits1)
 {
   VLTable *table=new VLTable(codes);
   GP<VLTable> retval=table;
-  table->init(nbits);
+  table->init(nbits, nbits1);
   return retval;
 }
 
 inline int
 MMRDecoder::VLTable::decode(MMRDecoder::VLSource *src)    
 { 
-  const VLCode &c = code[ index[ src->peek() >> codewordshift ] ];
-  src->shift(c.codelen); 
-  return c.value; 
+  const unsigned int m = src->peek();
+  const VLEntry *e = entry + (m >> shift1);
+  if (e->codelen < 0)
+    e = entry + e->value + ((m << nbits1) >> shift2);
+  src->shift(e->codelen); 
+  return e->value; 
 }
 
 MMRDecoder::VLTable::VLTable(const VLCode *codes)
-: code(codes), codewordshift(0), gindex(index,0)
+: code(codes), nbits1(0), shift1(0), shift2(0), gentry(entry,0)
 {}
 
 void
-MMRDecoder::VLTable::init(const int nbits)
+MMRDecoder::VLTable::init(const int nbits, const int xnbits1)
 {
   // count entries
   int ncodes = 0;
@@ -497,12 +530,15 @@ MMRDecoder::VLTable::init(const int nbits)
     G_THROW(invalid_mmr_data);
   if (ncodes>=256)
     G_THROW(invalid_mmr_data);
-  codewordshift = 32 - nbits;
-  // allocate table
+  nbits1 = (xnbits1>0 && xnbits1<nbits) ? xnbits1 : nbits;
+  const int nbits2 = nbits - nbits1;
+  shift1 = 32 - nbits1;
+  shift2 = 32 - nbits2;
+  // fill a temporary index with all the code bits
   int size = (1<<nbits);
-  gindex.resize(size);
+  unsigned char *index;
+  GPBuffer<unsigned char> gindex(index,size);
   gindex.set(ncodes);
-  // process codes
   for (int i=0; i<ncodes; i++) {
     const int c = code[i].code;
     const int b = code[i].codelen;
@@ -518,6 +554,38 @@ MMRDecoder::VLTable::init(const int nbits)
       index[n] = i;
     }
   }
+  // count the first level entries needing a second level table
+  const int size1 = (1<<nbits1);
+  const int size2 = (1<<nbits2);
+  int nsub = 0;
+  for (int p=0; p<size; p+=size2)
+    for (int n=p+1; n<p+size2; n++)
+      if (index[n] != index[p]) 
+        { nsub++; break; }
+  // build the tables
+  gentry.resize(size1 + nsub*size2);
+  int next = size1;
+  for (int p=0, k=0; k<size1; p+=size2, k++)
+    {
+      int n = p+1;
+      while (n<p+size2 && index[n]==index[p])
+        n++;
+      if (n == p+size2)
+        {
+          entry[k].value = code[index[p]].value;
+          entry[k].codelen = code[index[p]].codelen;
+        }
+      else
+        {
+          entry[k].value = next;
+          entry[k].codelen = -1;
+          for (n=0; n<size2; n++, next++)
+            {
+              entry[next].value = code[index[p+n]].value;
+              entry[next].codelen = code[index[p+n]].codelen;
+            }
+        }
+    }
 }
 
 // ----------------------------------------
@@ -544,9 +612,9 @@ MMRDecoder::init(GP<ByteStream> gbs, const bool striped)
 {
   rowsperstrip = (striped ? gbs->read16() : height);
   src = VLSource::create(gbs, striped);
-  mrtable = VLTable::create(mrcodes, 7);
-  btable = VLTable::create(bcodes, 13);
-  wtable = VLTable::create(wcodes, 13);
+  mrtable = VLTable::create(mrcodes, 7, 7);
+  btable = VLTable::create(bcodes, 13, 9);
+  wtable = VLTable::create(wcodes, 13, 9);
 }
 
 GP<MMRDecoder> 
@@ -570,6 +638,8 @@ MMRDecoder::scanruns(const unsigned short **endptr)
     {
       striplineno=0;
       lineruns[0] = prevruns[0] = width;
+      lineruns[1] = prevruns[1] = 0;
+      lineruns[2] = prevruns[2] = 0;
       src->nextstripe();
     }
   // Swap run buffers
@@ -878,59 +948,100 @@ MMRDecoder::decode(GP<ByteStream> gbs)
   // Prepare decoder
   GP<MMRDecoder> gdcd=MMRDecoder::create(gbs, width, height, striped);
   MMRDecoder &dcd=*gdcd;
+  // The runs of each block are directly written in the RLE format
+  // of GBitmap. A block line never needs more than blocksize+3 bytes.
+  // Blocks only start at the first line containing black pixels.
+  const int blockmax = (blocksize+3)*blocksize;
+  unsigned char *rle;
+  GPBuffer<unsigned char> grle(rle, blockmax*blocksperline);
+  int *rlesize;
+  GPBuffer<int> grlesize(rlesize, blocksperline);
+  int *rlerows;
+  GPBuffer<int> grlerows(rlerows, blocksperline);
+  const unsigned short whiteline[2] = { (unsigned short)width, 0 };
   // Loop on JB2 bands
   int line = height-1;
   while (line >= 0)
     {
       int bandline = MIN(blocksize-1,line);
-      GPArray<GBitmap> blocks(0,blocksperline-1);
+      grlesize.clear();
+      grlerows.clear();
       // Loop on scanlines
       for(; bandline >= 0; bandline--,line--)
       {
         // Decode one scanline
         const unsigned short *s = dcd.scanruns();
-        if (s)
-        {
-	  // Loop on blocks
-          int x = 0;
-          int b = 0;
-          int firstx = 0;
-          bool c = !!invert;
-          while (x < width)
-            {
-              int xend = x + *s++;
-              while (b<blocksperline)
-                {
-                  int lastx = MIN(firstx+blocksize,width);
-                  if (c)
-                    {
-                      if (!blocks[b])
-                        blocks[b] = GBitmap::create(bandline+1, lastx-firstx);
-                      unsigned char *bptr = (*blocks[b])[bandline] - firstx;
-                      int x1 = MAX(x,firstx);
-                      int x2 = MIN(xend,lastx);
-                      while (x1 < x2)
-                        bptr[x1++] = 1;
-                    }
-                  if (xend < lastx)
-                    break;
-                  firstx = lastx;
-                  b ++;
-                }
-              x = xend;
-              c = !c; 
-            }
-	}
+        if (! s)
+          s = whiteline;
+        // Loop on runs
+        int x = 0;
+        int b = 0;
+        int lastx = MIN(blocksize,width);
+        unsigned char *p = rle + rlesize[0];
+        int run = 0;
+        bool rc = false;
+        bool black = false;
+        bool c = (s != whiteline) && invert;
+        while (x < width)
+          {
+            int xend = MIN(x + *s++, width);
+            // Runs reaching the end of a block
+            while (xend >= lastx)
+              {
+                if (lastx > x && c != rc)
+                  {
+                    GBitmap::append_run(p, run);
+                    black = black || c;
+                    rc = c;
+                    run = 0;
+                  }
+                run += lastx - x;
+                GBitmap::append_run(p, run);
+                if (black || rlerows[b])
+                  {
+                    rlesize[b] = p - rle - b*blockmax;
+                    rlerows[b] += 1;
+                  }
+                x = lastx;
+                if (++b >= blocksperline)
+                  break;
+                lastx = MIN(lastx+blocksize,width);
+                p = rle + b*blockmax + rlesize[b];
+                run = 0;
+                rc = false;
+                black = false;
+              }
+            // Runs ending inside a block
+            if (xend > x)
+              {
+                if (c != rc)
+                  {
+                    GBitmap::append_run(p, run);
+                    black = black || c;
+                    rc = c;
+                    run = 0;
+                  }
+                run += xend - x;
+                x = xend;
+              }
+            c = !c; 
+          }
       }
       // Insert blocks into JB2Image
       for (int b=0; b<blocksperline; b++)
 	{
-	  JB2Shape shape;
-	  shape.bits = blocks[b];
-	  if (shape.bits) 
+	  if (rlerows[b])
 	    {
+              // GBitmap releases its RLE data with operator delete
+              const int size = rlesize[b];
+              unsigned char *data = (unsigned char*)::operator new(size);
+              memcpy(data, rle + b*blockmax, size);
+	      JB2Shape shape;
+              shape.bits = GBitmap::create();
+              shape.bits->donate_rle(data, size, 
+                                     MIN(blocksize,width-b*blocksize),
+                                     rlerows[b]);
 	      shape.parent = -1;
-	      shape.bits->compress();
 	      JB2Blit blit;
 	      blit.left = b*blocksize;
 	      blit.bottom = line+1;
@@ -0,0 +1,392 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C- 
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free, 
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of 
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the 
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU 
+//C- | General Public License.   This grant only confers the right to 
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to 
+//C- | the extent such infringement is reasonably necessary to enable 
+//C- | recipient to make, have made, practice, sell, or otherwise dispose 
+//C- | of the LIZARDTECH ORIGINAL CODE (or portions thereof) and not to 
+//C- | any greater extent that may be necessary to utilize further 
+//C- | modifications or combinations.
+//C- |
+//C- | The LIZARDTECH ORIGINAL CODE is provided "AS IS" WITHOUT WARRANTY
+//C- | OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//C- | TO ANY WARRANTY OF NON-INFRINGEMENT, OR ANY IMPLIED WARRANTY OF
+//C- | MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+//C- +------------------------------------------------------------------
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "MMREncoder.h"
+#include "ByteStream.h"
+#include "GBitmap.h"
+
+
+namespace DJVU {
+
+
+// ----------------------------------------
+// MMR CODEBOOKS
+
+struct MMRCode
+{
+  unsigned short code;
+  short codelen;
+};
+
+static const MMRCode white_codes[] = {
+  // Terminating codes for runs 0 to 63
+  { 0x035,  8 }, { 0x007,  6 }, { 0x007,  4 }, { 0x008,  4 },
+  { 0x00b,  4 }, { 0x00c,  4 }, { 0x00e,  4 }, { 0x00f,  4 },
+  { 0x013,  5 }, { 0x014,  5 }, { 0x007,  5 }, { 0x008,  5 },
+  { 0x008,  6 }, { 0x003,  6 }, { 0x034,  6 }, { 0x035,  6 },
+  { 0x02a,  6 }, { 0x02b,  6 }, { 0x027,  7 }, { 0x00c,  7 },
+  { 0x008,  7 }, { 0x017,  7 }, { 0x003,  7 }, { 0x004,  7 },
+  { 0x028,  7 }, { 0x02b,  7 }, { 0x013,  7 }, { 0x024,  7 },
+  { 0x018,  7 }, { 0x002,  8 }, { 0x003,  8 }, { 0x01a,  8 },
+  { 0x01b,  8 }, { 0x012,  8 }, { 0x013,  8 }, { 0x014,  8 },
+  { 0x015,  8 }, { 0x016,  8 }, { 0x017,  8 }, { 0x028,  8 },
+  { 0x029,  8 }, { 0x02a,  8 }, { 0x02b,  8 }, { 0x02c,  8 },
+  { 0x02d,  8 }, { 0x004,  8 }, { 0x005,  8 }, { 0x00a,  8 },
+  { 0x00b,  8 }, { 0x052,  8 }, { 0x053,  8 }, { 0x054,  8 },
+  { 0x055,  8 }, { 0x024,  8 }, { 0x025,  8 }, { 0x058,  8 },
+  { 0x059,  8 }, { 0x05a,  8 }, { 0x05b,  8 }, { 0x04a,  8 },
+  { 0x04b,  8 }, { 0x032,  8 }, { 0x033,  8 }, { 0x034,  8 },
+  // Makeup codes for runs 64 to 2560
+  { 0x01b,  5 }, { 0x012,  5 }, { 0x017,  6 }, { 0x037,  7 },
+  { 0x036,  8 }, { 0x037,  8 }, { 0x064,  8 }, { 0x065,  8 },
+  { 0x068,  8 }, { 0x067,  8 }, { 0x0cc,  9 }, { 0x0cd,  9 },
+  { 0x0d2,  9 }, { 0x0d3,  9 }, { 0x0d4,  9 }, { 0x0d5,  9 },
+  { 0x0d6,  9 }, { 0x0d7,  9 }, { 0x0d8,  9 }, { 0x0d9,  9 },
+  { 0x0da,  9 }, { 0x0db,  9 }, { 0x098,  9 }, { 0x099,  9 },
+  { 0x09a,  9 }, { 0x018,  6 }, { 0x09b,  9 }, { 0x008, 11 },
+  { 0x00c, 11 }, { 0x00d, 11 }, { 0x012, 12 }, { 0x013, 12 },
+  { 0x014, 12 }, { 0x015, 12 }, { 0x016, 12 }, { 0x017, 12 },
+  { 0x01c, 12 }, { 0x01d, 12 }, { 0x01e, 12 }, { 0x01f, 12 }
+};
+
+static const MMRCode black_codes[] = {
+  // Terminating codes for runs 0 to 63
+  { 0x037, 10 }, { 0x002,  3 }, { 0x003,  2 }, { 0x002,  2 },
+  { 0x003,  3 }, { 0x003,  4 }, { 0x002,  4 }, { 0x003,  5 },
+  { 0x005,  6 }, { 0x004,  6 }, { 0x004,  7 }, { 0x005,  7 },
+  { 0x007,  7 }, { 0x004,  8 }, { 0x007,  8 }, { 0x018,  9 },
+  { 0x017, 10 }, { 0x018, 10 }, { 0x008, 10 }, { 0x067, 11 },
+  { 0x068, 11 }, { 0x06c, 11 }, { 0x037, 11 }, { 0x028, 11 },
+  { 0x017, 11 }, { 0x018, 11 }, { 0x0ca, 12 }, { 0x0cb, 12 },
+  { 0x0cc, 12 }, { 0x0cd, 12 }, { 0x068, 12 }, { 0x069, 12 },
+  { 0x06a, 12 }, { 0x06b, 12 }, { 0x0d2, 12 }, { 0x0d3, 12 },
+  { 0x0d4, 12 }, { 0x0d5, 12 }, { 0x0d6, 12 }, { 0x0d7, 12 },
+  { 0x06c, 12 }, { 0x06d, 12 }, { 0x0da, 12 }, { 0x0db, 12 },
+  { 0x054, 12 }, { 0x055, 12 }, { 0x056, 12 }, { 0x057, 12 },
+  { 0x064, 12 }, { 0x065, 12 }, { 0x052, 12 }, { 0x053, 12 },
+  { 0x024, 12 }, { 0x037, 12 }, { 0x038, 12 }, { 0x027, 12 },
+  { 0x028, 12 }, { 0x058, 12 }, { 0x059, 12 }, { 0x02b, 12 },
+  { 0x02c, 12 }, { 0x05a, 12 }, { 0x066, 12 }, { 0x067, 12 },
+  // Makeup codes for runs 64 to 2560
+  { 0x00f, 10 }, { 0x0c8, 12 }, { 0x0c9, 12 }, { 0x05b, 12 },
+  { 0x033, 12 }, { 0x034, 12 }, { 0x035, 12 }, { 0x06c, 13 },
+  { 0x06d, 13 }, { 0x04a, 13 }, { 0x04b, 13 }, { 0x04c, 13 },
+  { 0x04d, 13 }, { 0x072, 13 }, { 0x073, 13 }, { 0x074, 13 },
+  { 0x075, 13 }, { 0x076, 13 }, { 0x077, 13 }, { 0x052, 13 },
+  { 0x053, 13 }, { 0x054, 13 }, { 0x055, 13 }, { 0x05a, 13 },
+  { 0x05b, 13 }, { 0x064, 13 }, { 0x065, 13 }, { 0x008, 11 },
+  { 0x00c, 11 }, { 0x00d, 11 }, { 0x012, 12 }, { 0x013, 12 },
+  { 0x014, 12 }, { 0x015, 12 }, { 0x016, 12 }, { 0x017, 12 },
+  { 0x01c, 12 }, { 0x01d, 12 }, { 0x01e, 12 }, { 0x01f, 12 }
+};
+
+// Vertical mode codes for a1-b1 ranging from -3 to 3
+static const MMRCode vertical_codes[] = {
+  { 0x02, 7 }, { 0x02, 6 }, { 0x02, 3 }, { 0x01, 1 },
+  { 0x03, 3 }, { 0x03, 6 }, { 0x03, 7 }
+};
+
+
+// ----------------------------------------
+// MMR ENCODER
+
+
+MMREncoder::MMREncoder(GP<ByteStream> gbs, const int width)
+  : gbs(gbs), width(width), buffer(0), nbits(0),
+    bufa(0, width + 3), bufb(0, width + 3)
+{
+  ref = bufa;
+  cur = bufb;
+  // The first row is coded relative to a white row
+  ref[0] = ref[1] = ref[2] = width;
+}
+
+MMREncoder::~MMREncoder()
+{
+}
+
+GP<MMREncoder>
+MMREncoder::create(GP<ByteStream> gbs, const int width)
+{
+  return new MMREncoder(gbs, width);
+}
+
+inline void
+MMREncoder::put(unsigned int code, int codelen)
+{
+  buffer = (buffer << codelen) | code;
+  nbits += codelen;
+  while (nbits >= 8)
+    {
+      nbits -= 8;
+      gbs->write8((buffer >> nbits) & 0xff);
+    }
+}
+
+void
+MMREncoder::put_run(bool black, int run)
+{
+  const MMRCode *codes = (black) ? black_codes : white_codes;
+  while (run >= 2560)
+    {
+      put(codes[103].code, codes[103].codelen);
+      run -= 2560;
+    }
+  if (run >= 64)
+    {
+      put(codes[63 + run / 64].code, codes[63 + run / 64].codelen);
+      run &= 63;
+    }
+  put(codes[run].code, codes[run].codelen);
+}
+
+void
+MMREncoder::encode(const unsigned char *row)
+{
+  // Changing elements of the row, followed by three sentinels
+  int n = 0;
+  unsigned char color = 0;
+  for (int x=0; x<width; x++)
+    if ((row[x] != 0) != color)
+      {
+        cur[n++] = x;
+        color = !color;
+      }
+  cur[n] = cur[n+1] = cur[n+2] = width;
+  encode_changes();
+}
+
+void
+MMREncoder::encode_packed(const unsigned char *row)
+{
+  // Bytes without changing elements are skipped
+  int n = 0;
+  int color = 0;
+  for (int x=0; x<width; x+=8)
+    {
+      unsigned char c = *row++;
+      if (c == (color ? 0xff : 0x00))
+        continue;
+      int m = (width - x < 8) ? width - x : 8;
+      for (int i=0; i<m; i++)
+        if (((c >> (7 - i)) & 1) != color)
+          {
+            cur[n++] = x + i;
+            color = !color;
+          }
+    }
+  cur[n] = cur[n+1] = cur[n+2] = width;
+  encode_changes();
+}
+
+void
+MMREncoder::encode_runs(const int *runs, const int nruns)
+{
+  // Empty runs cancel the previous changing element
+  int n = 0;
+  int x = 0;
+  for (int i=0; i<nruns-1; i++)
+    {
+      x += runs[i];
+      if (x >= width)
+        break;
+      if (n > 0 && cur[n-1] == x)
+        n -= 1;
+      else
+        cur[n++] = x;
+    }
+  cur[n] = cur[n+1] = cur[n+2] = width;
+  encode_changes();
+}
+
+void
+MMREncoder::encode_changes(void)
+{
+  int a0 = -1;
+  int ia = 0;
+  int ib = 0;
+  while (a0 < width)
+    {
+      // Changing elements a1 and b1 are the first ones after a0
+      // with the same parity, b1 can move back after a VL code.
+      while (cur[ia] <= a0 && cur[ia] < width)
+        ia += 1;
+      while (ib > 0 && ref[ib-1] > a0)
+        ib -= 1;
+      while (ref[ib] <= a0 && ref[ib] < width)
+        ib += 1;
+      if (((ib ^ ia) & 1) && ref[ib] < width)
+        ib += 1;
+      int a1 = cur[ia];
+      int b1 = ref[ib];
+      int b2 = ref[ib+1];
+      if (b2 < a1)
+        {
+          // Pass mode
+          put(0x1, 4);
+          a0 = b2;
+        }
+      else if (a1 - b1 >= -3 && a1 - b1 <= 3)
+        {
+          // Vertical mode
+          const MMRCode &vc = vertical_codes[a1 - b1 + 3];
+          put(vc.code, vc.codelen);
+          a0 = a1;
+        }
+      else
+        {
+          // Horizontal mode
+          int a2 = cur[ia+1];
+          int start = (a0 < 0) ? 0 : a0;
+          put(0x1, 3);
+          put_run((ia & 1) != 0, a1 - start);
+          put_run((ia & 1) == 0, a2 - a1);
+          a0 = a2;
+        }
+    }
+  int *tmp = ref;
+  ref = cur;
+  cur = tmp;
+}
+
+void
+MMREncoder::close(const bool eofb)
+{
+  if (eofb)
+    {
+      put(0x001, 12);
+      put(0x001, 12);
+    }
+  if (nbits > 0)
+    put(0, 8 - nbits);
+}
+
+// Encodes rows #top# to #bottom# of a bitmap, using the
+// run lengths when the bitmap is RLE encoded.
+static void
+encode_rows(MMREncoder &enc, const GBitmap &bm, int top, int bottom)
+{
+  const int w = bm.columns();
+  int *runs;
+  GPBuffer<int> gruns(runs, w + 2);
+  for (int row = top; row >= bottom; row--)
+    {
+      int nruns = bm.rle_get_runs(row, runs);
+      if (nruns > 0)
+        enc.encode_runs(runs, nruns);
+      else
+        enc.encode(bm[row]);
+    }
+}
+
+void
+MMREncoder::encode(const GBitmap &bm, GP<ByteStream> gbs)
+{
+  GP<MMREncoder> enc = MMREncoder::create(gbs, bm.columns());
+  encode_rows(*enc, bm, bm.rows() - 1, 0);
+  enc->close();
+}
+
+void
+MMREncoder::encode_header(ByteStream &bs, const int width, const int height,
+                          const bool invert, const int rowsperstrip)
+{
+  if (width <= 0 || height <= 0 || width > 0xffff || height > 0xffff)
+    G_THROW( ERR_MSG("MMRDecoder.bad_header") );
+  unsigned int magic = 0x4d4d5200;
+  if (invert)
+    magic |= 0x1;
+  if (rowsperstrip > 0)
+    magic |= 0x2;
+  bs.write32(magic);
+  bs.write16(width);
+  bs.write16(height);
+  if (rowsperstrip > 0)
+    bs.write16((rowsperstrip < height) ? rowsperstrip : height);
+}
+
+void
+MMREncoder::encode_chunk(const GBitmap &bm, GP<ByteStream> gbs,
+                         const int rowsperstrip)
+{
+  const int w = bm.columns();
+  const int h = bm.rows();
+  encode_header(*gbs, w, h, false, rowsperstrip);
+  if (rowsperstrip <= 0)
+    {
+      encode(bm, gbs);
+      return;
+    }
+  // Each stripe is preceded by its size
+  for (int top = h - 1; top >= 0; top -= rowsperstrip)
+    {
+      GP<ByteStream> stripe = ByteStream::create();
+      GP<MMREncoder> enc = MMREncoder::create(stripe, w);
+      int bottom = top - rowsperstrip + 1;
+      encode_rows(*enc, bm, top, (bottom > 0) ? bottom : 0);
+      enc->close();
+      gbs->write32(stripe->size());
+      stripe->seek(0);
+      gbs->copy(*stripe);
+    }
+}
+
+
+}
+using namespace DJVU;
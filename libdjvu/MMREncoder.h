@@ -0,0 +1,157 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C- 
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free, 
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of 
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the 
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU 
+//C- | General Public License.   This grant only confers the right to 
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to 
+//C- | the extent such infringement is reasonably necessary to enable 
+//C- | recipient to make, have made, practice, sell, or otherwise dispose 
+//C- | of the LIZARDTECH ORIGINAL CODE (or portions thereof) and not to 
+//C- | any greater extent that may be necessary to utilize further 
+//C- | modifications or combinations.
+//C- |
+//C- | The LIZARDTECH ORIGINAL CODE is provided "AS IS" WITHOUT WARRANTY
+//C- | OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//C- | TO ANY WARRANTY OF NON-INFRINGEMENT, OR ANY IMPLIED WARRANTY OF
+//C- | MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+//C- +------------------------------------------------------------------
+
+#ifndef _MMRENCODER_H_
+#define _MMRENCODER_H_
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+#include "GSmartPointer.h"
+#include "Arrays.h"
+
+namespace DJVU {
+
+class ByteStream;
+class GBitmap;
+
+/** @name MMREncoder.h
+    Files #"MMREncoder.h"# and #"MMREncoder.cpp"# implement a CCITT-G4/MMR
+    encoder producing the data understood by \Ref{MMRDecoder}, by the
+    #CCITTFaxDecode# filters of PostScript and PDF (with #K=-1#), and by
+    TIFF readers (with #Compression=4#).  Each row is coded relative to
+    the previous row with the two-dimensional modes of ITU-T
+    Recommendation T.6.  The first row is coded relative to an
+    imaginary white row.
+
+    Static function \Ref{MMREncoder::encode_chunk} produces the complete
+    contents of a #"Smmr"# chunk, including the header described in
+    \Ref{MMRDecoder.h}, in either the regular or the striped format.
+    Function \Ref{MMREncoder::encode_header} only writes the header.  This
+    is useful for copying existing G4 data, such as the strips of a TIFF
+    file, without decoding it.
+
+    @memo
+    CCITT-G4/MMR encoder. */
+//@{
+
+
+/** Class for G4/MMR encoding.  Rows are passed to \Ref{MMREncoder::encode}
+    from the top of the image to the bottom, and the last partial byte is
+    written by \Ref{MMREncoder::close}. */
+class DJVUAPI MMREncoder : public GPEnabled
+{
+protected:
+  MMREncoder(GP<ByteStream> gbs, const int width);
+public:
+  /** Creates an encoder writing rows of #width# pixels into #gbs#. */
+  static GP<MMREncoder> create(GP<ByteStream> gbs, const int width);
+  /// Non-virtual destructor.
+  ~MMREncoder();
+  /** Encodes a row of pixels containing one byte per pixel.  Nonzero
+      bytes represent black pixels. */
+  void encode(const unsigned char *row);
+  /** Encodes a row of pixels packed eight pixels per byte, most
+      significant bit first.  One bits represent black pixels. */
+  void encode_packed(const unsigned char *row);
+  /** Encodes a row of pixels represented by the lengths of alternate
+      white and black runs, starting with a possibly empty white run, 
+      as returned by \Ref{GBitmap::rle_get_runs}. */
+  void encode_runs(const int *runs, const int nruns);
+  /** Terminates the data.  This writes the end-of-facsimile-block
+      code when #eofb# is set and pads the last byte with zeroes. */
+  void close(const bool eofb=false);
+  /** Encodes all rows of bitmap #bm# without header.  Note that
+      the rows of a \Ref{GBitmap} are numbered from the bottom. */
+  static void encode(const GBitmap &bm, GP<ByteStream> gbs);
+  /** Writes the header of a #"Smmr"# chunk for an image of size #width#
+      by #height#.  Flag #invert# indicates reverse video data.  A positive
+      #rowsperstrip# selects the striped format and is written after the
+      header.  The caller then writes the size and the data of each
+      stripe. */
+  static void encode_header(ByteStream &bs, const int width, const int height,
+                            const bool invert, const int rowsperstrip=0);
+  /** Encodes bitmap #bm# as the contents of a #"Smmr"# chunk.  When
+      #rowsperstrip# is positive, the image is split into stripes of
+      #rowsperstrip# rows that are coded independently. */
+  static void encode_chunk(const GBitmap &bm, GP<ByteStream> gbs,
+                           const int rowsperstrip=0);
+private:
+  GP<ByteStream> gbs;
+  int width;
+  unsigned int buffer;
+  int nbits;
+  TArray<int> bufa;
+  TArray<int> bufb;
+  int *ref;
+  int *cur;
+  void put(unsigned int code, int codelen);
+  void put_run(bool black, int run);
+  void encode_changes(void);
+private:
+  // Cancel C++ default stuff
+  MMREncoder(const MMREncoder &);
+  MMREncoder & operator=(const MMREncoder &);
+};
+
+
+//@}
+
+// -----------
+
+}
+using namespace DJVU;
+#endif
@@ -674,7 +674,8 @@ ZPCodec::Decode::Decode(GP<ByteStream> gbs, const bool djvucompat)
 ZPCodec::Decode::~Decode() {}
 
 ZPCodec::ZPCodec(GP<ByteStream> xgbs, const bool xencoding, const bool djvucompat)
-: gbs(xgbs), bs(xgbs), encoding(xencoding), fence(0), subend(0), buffer(0), nrun(0)
+: gbs(xgbs), bs(xgbs), encoding(xencoding), fence(0), subend(0), buffer(0), nrun(0),
+  bptr(0), bend(0), views(true)
 {
   // Create machine independent ffz table
   for (int i=0; i<256; i++)
@@ -731,10 +732,10 @@ ZPCodec::Decode::init(void)
   assert(sizeof(unsigned short)==2);
   a = 0;
   /* Read first 16 bits of code */
-  if (! bs->read((void*)&byte, 1))
+  if (! nextbyte())
     byte = 0xff;
   code = (byte<<8);
-  if (! bs->read((void*)&byte, 1))
+  if (! nextbyte())
     byte = 0xff;
   code = code | byte;
   /* Preload buffer */
@@ -748,12 +749,48 @@ ZPCodec::Decode::init(void)
 }
 
 
+// Code bytes are taken from views into the ByteStream buffers
+// when the ByteStream supports them (see ByteStream::readview).
+// Otherwise they are read one at a time as the decoder never
+// reads more than a few bytes beyond the last code byte.
+
+bool
+ZPCodec::refill(void)
+{
+  if (views)
+    {
+      const void *ptr;
+      const size_t n = bs->readview(ptr, 4096);
+      if (ptr)
+        {
+          bptr = (const unsigned char*)ptr;
+          bend = bptr + n;
+          return (n > 0);
+        }
+      views = false;
+    }
+  if (bs->read((void*)&byte, 1) < 1)
+    return false;
+  bptr = &byte;
+  bend = bptr + 1;
+  return true;
+}
+
+inline bool
+ZPCodec::nextbyte(void)
+{
+  if (bptr >= bend && !refill())
+    return false;
+  byte = *bptr++;
+  return true;
+}
+
 void
 ZPCodec::preload(void)
 {
   while (scount<=24)
     {
-      if (bs->read((void*)&byte, 1) < 1) 
+      if (! nextbyte())
         {
           byte = 0xff;
           if (--delay < 1)
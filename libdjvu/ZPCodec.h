@@ -221,7 +221,9 @@ typedef unsigned char  BitContext;
     ZPCodec object.  Note that the encoder always flushes its internal buffers
     and writes a few final code bytes when the ZPCodec object is destroyed.
     Note also that the decoder often reads a few bytes beyond the last code byte
-    written by the encoder.  This lag means that you must reposition the
+    written by the encoder, and consumes whole buffers at once when the
+    ByteStream gives direct access to its data (see
+    \Ref{ByteStream::readview}).  This lag means that you must reposition the
     ByteStream after the destruction of the ZPCodec object and before re-using
     the ByteStream object (see \Ref{IFFByteStream}.)
 
@@ -310,6 +312,10 @@ protected:
   unsigned int  subend;
   unsigned int  buffer;
   unsigned int  nrun;
+  // decoder input
+  const unsigned char *bptr;
+  const unsigned char *bend;
+  bool          views;
   // table
   unsigned int  p[256];
   unsigned int  m[256];
@@ -331,6 +337,8 @@ protected:
   // decoder private
   void dinit(void);
   void preload(void);
+  bool nextbyte(void);
+  bool refill(void);
   int  ffz(unsigned int x);
   int  decode_sub(BitContext &ctx, unsigned int z);
   int  decode_sub_simple(int mps, unsigned int z);
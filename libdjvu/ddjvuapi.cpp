@@ -102,12 +102,14 @@ using namespace DJVU;
 #include "DjVuMessage.h"
 #include "DjVmNav.h"
 #include "DjVuText.h"
+#include "DjVuTextIndex.h"
 #include "DjVuAnno.h"
 #include "DjVuToPS.h"
 #include "DjVmDir.h"
 #include "DjVmDir0.h"
 #include "DjVuNavDir.h"
 #include "DjVmDoc.h"
+#include "DjVuProfile.h"
 
 
 #include "miniexp.h"
@@ -144,6 +146,7 @@ struct DJVU::ddjvu_context_s : public GPEnabled
 {
   GMonitor monitor;
   GP<DjVuFileCache> cache;
+  GP<DjVuProfile> profile;
   GPList<ddjvu_message_p> mlist;
   GP<ddjvu_message_p> mpeeked;
   int uniqueid;
@@ -175,6 +178,10 @@ struct DJVU::ddjvu_document_s : public ddjvu_job_s
   GPMap<int,DataPool> streams;
   GMap<GUTF8String, int> names;
   GPMap<int,ddjvu_thumbnail_p> thumbnails;
+  GP<DjVuTextIndex> textindex;
+  GUTF8String textindexname;
+  ddjvu_status_t textindexstatus;
+  GP<DjVuProfile> profile;
   int streamid;
   bool fileflag;
   bool urlflag;
@@ -197,6 +204,7 @@ struct DJVU::ddjvu_document_s : public ddjvu_job_s
 struct DJVU::ddjvu_page_s : public ddjvu_job_s
 {
   GP<DjVuImage> img;
+  GP<DjVuProfile> profile;
   ddjvu_job_t *job;
   bool pageinfoflag;            // was the first m_pageinfo sent?
   bool pagedoneflag;            // was the final m_pageinfo sent?
@@ -367,6 +375,7 @@ ddjvu_context_create(const char *programname)
       ctx->callbackfun = 0;
       ctx->callbackarg = 0;
       ctx->cache = DjVuFileCache::create();
+      ctx->profile = DjVuProfile::create(0, "context");
     }
   G_CATCH_ALL
     {
@@ -960,10 +969,13 @@ ddjvu_document_create(ddjvu_context_t *ctx,
       d->streamid = -1;
       d->fileflag = false;
       d->docinfoflag = false;
+      d->textindexstatus = DDJVU_JOB_NOTSTARTED;
       d->pageinfoflag = false;
       d->myctx = ctx;
       d->mydoc = 0;
       d->doc = DjVuDocument::create_noinit();
+      d->profile = DjVuProfile::create(ctx->profile, "document");
+      DjVuProfile::Attach attach(d->profile);
       if (url)
         {
           GURL gurl = GUTF8String(url);
@@ -1014,9 +1026,12 @@ ddjvu_document_create_by_filename_imp(ddjvu_context_t *ctx,
       d->pageinfoflag = false;
       d->urlflag = false;
       d->docinfoflag = false;
+      d->textindexstatus = DDJVU_JOB_NOTSTARTED;
       d->myctx = ctx;
       d->mydoc = 0;
       d->doc = DjVuDocument::create_noinit();
+      d->profile = DjVuProfile::create(ctx->profile, "document");
+      DjVuProfile::Attach attach(d->profile);
       d->doc->start_init(gurl, d, xcache);
     }
   G_CATCH(ex)
@@ -1550,7 +1565,7 @@ ddjvu_document_get_filedump(ddjvu_document_t *document, int fileno)
 
 static ddjvu_page_t *
 ddjvu_page_create(ddjvu_document_t *document, ddjvu_job_t *job,
-                  const char *pageid, int pageno)
+                  const char *pageid, int pageno, int subsample=1)
 {
   ddjvu_page_t *p = 0;
   G_TRY
@@ -1567,8 +1582,14 @@ ddjvu_page_create(ddjvu_document_t *document, ddjvu_job_t *job,
       if (! job)
         job = p;
       p->job = job;
+      GUTF8String name = (pageid) ? GUTF8String(GNativeString(pageid))
+        : GUTF8String("page ") + GUTF8String(pageno + 1);
+      p->profile = DjVuProfile::create(document->profile, name);
+      DjVuProfile::Attach attach(p->profile);
       if (pageid)
         p->img = doc->get_page(GNativeString(pageid), false, job);
+      else if (subsample > 1)
+        p->img = doc->get_preview_page(pageno, subsample, false, job);
       else
         p->img = doc->get_page(pageno, false, job);
       // synthetize msgs for pages found in the cache
@@ -1601,6 +1622,13 @@ ddjvu_page_create_by_pageid(ddjvu_document_t *document, const char *pageid)
   return ddjvu_page_create(document, 0, pageid, 0);
 }
 
+ddjvu_page_t *
+ddjvu_page_create_preview(ddjvu_document_t *document, 
+                          int pageno, int subsample)
+{
+  return ddjvu_page_create(document, 0, 0, pageno, subsample);
+}
+
 ddjvu_job_t *
 ddjvu_page_job(ddjvu_page_t *page)
 {
@@ -2446,6 +2474,7 @@ ddjvu_page_render(ddjvu_page_t *page,
           rrect.ymax_ = rrect.ymin_ + renderrect->h;
         }
 
+      DjVuProfile::Attach attach(page->profile);
       DjVuImage *img = page->img;
       if (img) 
         {
@@ -2481,12 +2510,14 @@ ddjvu_page_render(ddjvu_page_t *page,
         {
           int dx = rrect.xmin_ - prect.xmin_;
           int dy = rrect.ymin_ - prect.xmin_;
+          DjVuProfile::Timer timer(DjVuProfile::CONVERT);
           fmt_dither(pm, format, dx, dy);
           fmt_convert(pm, format, imagebuffer, rowsize);
           return 2;
         }
       else if (bm)
         {
+          DjVuProfile::Timer timer(DjVuProfile::CONVERT);
           fmt_convert(bm, format, imagebuffer, rowsize);
           return 1;
         }
@@ -2600,6 +2631,7 @@ ddjvu_thumbnail_render(ddjvu_document_t *document, int pagenum,
         return FALSE;
       if (! (thumb->data.size() > 0))
         return FALSE;
+      DjVuProfile::Attach attach(document->profile);
       /* Decode wavelet data */
       int size = thumb->data.size();
       char *data = (char*)thumb->data;
@@ -2625,6 +2657,7 @@ ddjvu_thumbnail_render(ddjvu_document_t *document, int pagenum,
       GRect scaledrect(0, 0, *wptr, *hptr);
       scaler->scale(GRect(0, 0, w, h), *pm, scaledrect, *scaledpm);
       /* Convert */
+      DjVuProfile::Timer timer(DjVuProfile::CONVERT);
       fmt_dither(scaledpm, format, 0, 0);
       fmt_convert(scaledpm, format, imagebuffer, rowsize);
       return TRUE;
@@ -2638,6 +2671,115 @@ ddjvu_thumbnail_render(ddjvu_document_t *document, int pagenum,
 }
 
 
+
+
+// ----------------------------------------
+// Profiling
+
+void
+ddjvu_profile_enable(ddjvu_context_t *ctx, int flags)
+{
+  G_TRY
+    {
+      DjVuProfile::enable(flags);
+    }
+  G_CATCH(ex)
+    {
+      ERROR1(ctx, ex);
+    }
+  G_ENDCATCH;
+}
+
+const char *
+ddjvu_profile_stage_name(ddjvu_profile_stage_t stage)
+{
+  return DjVuProfile::stage_name(stage);
+}
+
+static int
+get_profile(const GP<DjVuProfile> &profile, 
+            ddjvu_profile_t *info, unsigned int infosz)
+{
+  memset(info, 0, infosz);
+  if (infosz > sizeof(ddjvu_profile_t))
+    return FALSE;
+  if (! profile)
+    return FALSE;
+  int nstages = infosz / sizeof(info->stage[0]);
+  for (int i=0; i<nstages; i++)
+    {
+      info->stage[i].count = profile->get_count(i);
+      info->stage[i].seconds = profile->get_time(i);
+    }
+  return TRUE;
+}
+
+int
+ddjvu_context_get_profile_imp(ddjvu_context_t *ctx,
+                              ddjvu_profile_t *info, unsigned int infosz)
+{
+  G_TRY
+    {
+      return get_profile(ctx->profile, info, infosz);
+    }
+  G_CATCH(ex)
+    {
+      ERROR1(ctx, ex);
+    }
+  G_ENDCATCH;
+  return FALSE;
+}
+
+int
+ddjvu_page_get_profile_imp(ddjvu_page_t *page,
+                           ddjvu_profile_t *info, unsigned int infosz)
+{
+  G_TRY
+    {
+      return get_profile(page->profile, info, infosz);
+    }
+  G_CATCH(ex)
+    {
+      ERROR1(page, ex);
+    }
+  G_ENDCATCH;
+  return FALSE;
+}
+
+void
+ddjvu_profile_reset(ddjvu_context_t *ctx)
+{
+  G_TRY
+    {
+      if (ctx->profile)
+        ctx->profile->reset();
+      DjVuProfile::clear_trace();
+    }
+  G_CATCH(ex)
+    {
+      ERROR1(ctx, ex);
+    }
+  G_ENDCATCH;
+}
+
+int
+ddjvu_profile_save_trace(ddjvu_context_t *ctx, FILE *output)
+{
+  G_TRY
+    {
+      GP<ByteStream> obs = ByteStream::create(output, "wb", false);
+      DjVuProfile::save_trace(obs);
+      obs->flush();
+      return TRUE;
+    }
+  G_CATCH(ex)
+    {
+      ERROR1(ctx, ex);
+    }
+  G_ENDCATCH;
+  return FALSE;
+}
+
 // ----------------------------------------
 // Threaded jobs
 
@@ -2992,6 +3134,14 @@ ddjvu_document_print(ddjvu_document_t *document, FILE *output,
                 complain(uarg,"Invalid number of copies.");
               options.set_copies(n);
             }
+          else if (s == "threads")
+            {
+              int endpos;
+              int n = arg.toLong(0, endpos);
+              if (endpos != (int)arg.length() || n < 0 || n > 256)
+                complain(uarg,"Invalid number of threads.");
+              options.set_threads(n);
+            }
           else if (s == "frame")
             {
               if (arg == "yes" || arg == "")
@@ -3553,29 +3703,48 @@ static struct zone_names_s {
   { 0, (DjVuTXT::ZoneType)0 ,0 }
 };
 
-static miniexp_t
-pagetext_sub(const GP<DjVuTXT> &txt, DjVuTXT::Zone &zone, 
-             DjVuTXT::ZoneType detail)
+static int
+pagetext_zinfo(const DjVuTXT::Zone &zone)
 {
   int zinfo;
   for (zinfo=0; zone_names[zinfo].name; zinfo++)
     if (zone.ztype == zone_names[zinfo].ztype)
       break;
+  return zinfo;
+}
+
+static bool
+pagetext_gather(const DjVuTXT::Zone &zone, DjVuTXT::ZoneType detail)
+{
+  // Tells whether the zone text is output instead of its children
+  bool gather = zone.children.isempty();
+  for (GPosition pos=zone.children; pos; ++pos)
+    if (zone.children[pos].ztype > detail)
+      gather = true;
+  return gather;
+}
+
+static int
+pagetext_length(const GP<DjVuTXT> &txt, const DjVuTXT::Zone &zone, int zinfo)
+{
+  const char *data = (const char*)(txt->textUTF8) + zone.text_start;
+  int length = zone.text_length;
+  if (length>0 && data[length-1]==zone_names[zinfo].separator)
+    length -= 1;
+  return length;
+}
+
+static miniexp_t
+pagetext_sub(const GP<DjVuTXT> &txt, DjVuTXT::Zone &zone, 
+             DjVuTXT::ZoneType detail)
+{
+  int zinfo = pagetext_zinfo(zone);
   minivar_t p;
   minivar_t a;
-  bool gather = zone.children.isempty();
-  { // extra nesting for windows
-    for (GPosition pos=zone.children; pos; ++pos)
-      if (zone.children[pos].ztype > detail)
-        gather = true;
-  }
-  if (gather)
+  if (pagetext_gather(zone, detail))
     {
       const char *data = (const char*)(txt->textUTF8) + zone.text_start;
-      int length = zone.text_length;
-      if (length>0 && data[length-1]==zone_names[zinfo].separator)
-        length -= 1;
-      a = miniexp_substring(data, length);
+      a = miniexp_substring(data, pagetext_length(txt, zone, zinfo));
       p = miniexp_cons(a, p);
     }
   else
@@ -3600,41 +3769,244 @@ pagetext_sub(const GP<DjVuTXT> &txt, DjVuTXT::Zone &zone,
   return miniexp_nil;
 }
 
+static bool
+pagetext_visit(const GP<DjVuTXT> &txt, const DjVuTXT::Zone &zone, 
+               DjVuTXT::ZoneType detail, 
+               const ddjvu_pagetext_visitor_t *visitor, void *closure)
+{
+  // Same traversal as pagetext_sub, without building s-expressions.
+  // Returns false when a callback requests to stop.
+  int zinfo = pagetext_zinfo(zone);
+  const char *s = zone_names[zinfo].name;
+  if (! s)
+    return true;
+  const GRect &r = zone.rect;
+  if (visitor->begin_zone && 
+      (*visitor->begin_zone)(closure, s, r.xmin_, r.ymin_, r.xmax_, r.ymax_))
+    return false;
+  if (pagetext_gather(zone, detail))
+    {
+      const char *data = (const char*)(txt->textUTF8) + zone.text_start;
+      int length = pagetext_length(txt, zone, zinfo);
+      if (visitor->text && (*visitor->text)(closure, data, length))
+        return false;
+    }
+  else
+    {
+      for (GPosition pos=zone.children; pos; ++pos)
+        if (! pagetext_visit(txt, zone.children[pos], detail, 
+                             visitor, closure))
+          return false;
+    }
+  if (visitor->end_zone && (*visitor->end_zone)(closure, s))
+    return false;
+  return true;
+}
+
+static DjVuTXT::ZoneType
+pagetext_detail(const char *maxdetail)
+{
+  DjVuTXT::ZoneType detail = DjVuTXT::CHARACTER;
+  for (int i=0; zone_names[i].name; i++)
+    if (maxdetail && !strcmp(maxdetail, zone_names[i].name))
+      detail = zone_names[i].ztype;
+  return detail;
+}
+
+static ddjvu_status_t
+pagetext_get_txt(ddjvu_document_t *document, int pageno, GP<DjVuTXT> &txt)
+{
+  // Decodes the hidden text of a page into txt.
+  ddjvu_status_t status = document->status();
+  if (status != DDJVU_JOB_OK)
+    return status;
+  DjVuDocument *doc = document->doc;
+  if (! doc)
+    return DDJVU_JOB_FAILED;
+  document->pageinfoflag = true;
+  GP<DjVuFile> file = doc->get_djvu_file(pageno);
+  if (! file || ! file->is_data_present() )
+    return DDJVU_JOB_STARTED;
+  GP<ByteStream> bs = file->get_text();
+  if (bs)
+    {
+      GP<DjVuText> text = DjVuText::create();
+      text->decode(bs);
+      txt = text->txt;
+    }
+  return DDJVU_JOB_OK;
+}
+
 miniexp_t
 ddjvu_document_get_pagetext(ddjvu_document_t *document, int pageno,
                             const char *maxdetail)
 {
   G_TRY
     {
-      ddjvu_status_t status = document->status();
+      GP<DjVuTXT> txt;
+      ddjvu_status_t status = pagetext_get_txt(document, pageno, txt);
+      if (status == DDJVU_JOB_STARTED)
+        return miniexp_dummy;
       if (status != DDJVU_JOB_OK)
         return miniexp_status(status);
-      DjVuDocument *doc = document->doc;
+      if (! txt)
+        return miniexp_nil;
+      minivar_t result;
+      result = pagetext_sub(txt, txt->page_zone, pagetext_detail(maxdetail));
+      miniexp_protect(document, result);
+      return result;
+    }
+  G_CATCH(ex)
+    {
+      ERROR1(document, ex);
+    }
+  G_ENDCATCH;
+  return miniexp_status(DDJVU_JOB_FAILED);
+}
+
+ddjvu_status_t
+ddjvu_document_visit_pagetext(ddjvu_document_t *document, int pageno,
+                              const char *maxdetail,
+                              const ddjvu_pagetext_visitor_t *visitor,
+                              void *closure)
+{
+  G_TRY
+    {
+      GP<DjVuTXT> txt;
+      ddjvu_status_t status = pagetext_get_txt(document, pageno, txt);
+      if (status != DDJVU_JOB_OK || !txt)
+        return status;
+      if (! pagetext_visit(txt, txt->page_zone, pagetext_detail(maxdetail),
+                           visitor, closure))
+        return DDJVU_JOB_STOPPED;
+      return DDJVU_JOB_OK;
+    }
+  G_CATCH(ex)
+    {
+      ERROR1(document, ex);
+    }
+  G_ENDCATCH;
+  return DDJVU_JOB_FAILED;
+}
+
+
+// ----------------------------------------
+// Text index
+
+
+static void
+textindex_run(void *arg)
+{
+  // Builds the text index of the document and
+  // releases the reference taken by textindex_get.
+  GP<ddjvu_document_s> document = (ddjvu_document_s*)arg;
+  unref(document);
+  ddjvu_status_t status = DDJVU_JOB_FAILED;
+  GP<DjVuDocument> doc;
+  {
+    GMonitorLock lock(&document->monitor);
+    doc = document->doc;
+    document->monitor.signal();
+  }
+  G_TRY
+    {
       if (doc)
         {
-          document->pageinfoflag = true;
-          GP<DjVuFile> file = doc->get_djvu_file(pageno);
-          if (! file || ! file->is_data_present() )
-            return miniexp_dummy;
-          GP<ByteStream> bs = file->get_text();
-          if (! bs)
-            return miniexp_nil;
-          GP<DjVuText> text = DjVuText::create();
-          text->decode(bs);
-          GP<DjVuTXT> txt = text->txt;
-          if (! txt)
-            return miniexp_nil;
-          minivar_t result;
-          DjVuTXT::ZoneType detail = DjVuTXT::CHARACTER;
-          { // extra nesting for windows
-            for (int i=0; zone_names[i].name; i++)
-              if (maxdetail && !strcmp(maxdetail, zone_names[i].name))
-                detail = zone_names[i].ztype;
-          }
-          result = pagetext_sub(txt, txt->page_zone, detail);
-          miniexp_protect(document, result);
-          return result;
+          DjVuProfile::Attach attach(document->profile);
+          GP<DjVuTextIndex> index = DjVuTextIndex::create();
+          index->add_document(*doc);
+          GMonitorLock lock(&document->monitor);
+          if (! document->textindex)
+            {
+              document->textindex = index;
+              document->textindexname = GUTF8String();
+            }
+          status = DDJVU_JOB_OK;
+        }
+    }
+  G_CATCH(ex)
+    {
+      if (document->doc)
+        ERROR1(document, ex);
+    }
+  G_ENDCATCH;
+  GMonitorLock lock(&document->monitor);
+  document->textindexstatus = status;
+  if (document->doc)
+    msg_push_nothrow(xhead(DDJVU_PAGEINFO, document));
+}
+
+static ddjvu_status_t
+textindex_get(ddjvu_document_t *document, const char *indexfile,
+              GP<DjVuTextIndex> &index)
+{
+  // Obtains the index, starting to build it if needed.
+  if (indexfile && document->textindexname != indexfile)
+    {
+      GP<ByteStream> bs = 
+        ByteStream::create(GURL::Filename::UTF8(indexfile), "rb");
+      GP<DjVuTextIndex> xindex = DjVuTextIndex::create();
+      xindex->decode(bs);
+      GMonitorLock lock(&document->monitor);
+      document->textindex = xindex;
+      document->textindexname = indexfile;
+    }
+  GMonitorLock lock(&document->monitor);
+  index = document->textindex;
+  if (index)
+    return DDJVU_JOB_OK;
+  if (document->textindexstatus == DDJVU_JOB_NOTSTARTED)
+    {
+      // Decoding the text of all pages takes a while:
+      // build the index in a separate thread when possible.
+      document->textindexstatus = DDJVU_JOB_STARTED;
+      ref(document);
+      GThread thr;
+      if (thr.create(textindex_run, (void*)document) == 0)
+        document->monitor.wait();
+      else
+        textindex_run((void*)document);
+    }
+  index = document->textindex;
+  return (index) ? DDJVU_JOB_OK : document->textindexstatus;
+}
+
+miniexp_t
+ddjvu_document_search_text(ddjvu_document_t *document, const char *indexfile,
+                           const char *phrase, int maxhits)
+{
+  G_TRY
+    {
+      DjVuDocument *doc = document->doc;
+      if (! doc)
+        return miniexp_status(DDJVU_JOB_FAILED);
+      if (! indexfile && ! document->textindex)
+        {
+          ddjvu_status_t status = document->status();
+          if (status != DDJVU_JOB_OK)
+            return miniexp_status(status);
+        }
+      GP<DjVuTextIndex> index;
+      ddjvu_status_t status = textindex_get(document, indexfile, index);
+      if (status != DDJVU_JOB_OK)
+        return miniexp_status(status);
+      GList<DjVuTextIndex::Hit> hits;
+      index->search(GUTF8String(phrase ? phrase : ""), hits, maxhits);
+      minivar_t result;
+      for (GPosition pos=hits; pos; ++pos)
+        {
+          const DjVuTextIndex::Hit &hit = hits[pos];
+          miniexp_t a = miniexp_nil;
+          a = miniexp_cons(miniexp_number(hit.rect.ymax_), a);
+          a = miniexp_cons(miniexp_number(hit.rect.xmax_), a);
+          a = miniexp_cons(miniexp_number(hit.rect.ymin_), a);
+          a = miniexp_cons(miniexp_number(hit.rect.xmin_), a);
+          a = miniexp_cons(miniexp_number(hit.page), a);
+          result = miniexp_cons(a, result);
         }
+      result = miniexp_reverse(result);
+      miniexp_protect(document, result);
+      return result;
     }
   G_CATCH(ex)
     {
@@ -111,6 +111,18 @@ extern "C" {
 
    Version   Change
    -----------------------------
+     27    Added:
+              ddjvu_profile_enable()
+              ddjvu_profile_stage_name()
+              ddjvu_context_get_profile()
+              ddjvu_page_get_profile()
+              ddjvu_profile_reset()
+              ddjvu_profile_save_trace()
+     26    Added:
+              ddjvu_page_create_preview()
+     25    Added:
+              ddjvu_document_visit_pagetext()
+              ddjvu_document_search_text()
      24    Added:
               miniexp_lstring()
               miniexp_to_lstr()
@@ -149,7 +161,7 @@ extern "C" {
      14    Initial version.
 */
 
-#define DDJVUAPI_VERSION 23
+#define DDJVUAPI_VERSION 27
 
 typedef struct ddjvu_context_s    ddjvu_context_t;
 typedef union  ddjvu_message_s    ddjvu_message_t;
@@ -850,6 +862,19 @@ ddjvu_page_create_by_pageid(ddjvu_document_t *document,
                             const char *pageid);
 
 
+/* ddjvu_page_create_preview ---
+   This function is similar to <ddjvu_page_create_by_pageno>
+   for pages that will only be rendered with a reduction factor
+   of at least <subsample>.  The layers of such pages may be
+   decoded at a lower resolution, which is faster.  Rendering 
+   at a larger size remains possible with a lower image quality.
+   Pages already decoded at full resolution are simply reused. */
+
+DDJVUAPI ddjvu_page_t *
+ddjvu_page_create_preview(ddjvu_document_t *document,
+                          int pageno, int subsample);
+
+
 /* ddjvu_page_job ---
    Access the job object in charge of decoding the document header. 
    In fact <ddjvu_page_t> is a subclass of <ddjvu_job_t>
@@ -1339,6 +1364,108 @@ ddjvu_thumbnail_render(ddjvu_document_t *document, int pagenum,
 
 
 
+/* -------------------------------------------------- */
+/* PROFILING                                          */
+/* -------------------------------------------------- */
+
+
+/* The decoding and rendering code contains timers that measure
+   the time spent in the main stages listed below.  Profiling is
+   disabled by default.  The timers then cost a single test.
+   When profiling is enabled, the time spent decoding or rendering
+   a page is accumulated in the counters of this page and in the
+   counters of its context. */
+
+typedef enum {
+  DDJVU_PROFILE_IW44_DECODE,      /* ZP decoding of IW44 coefficients */
+  DDJVU_PROFILE_IW44_RECONSTRUCT, /* IW44 wavelet reconstruction */
+  DDJVU_PROFILE_JB2_DECODE,       /* JB2 shape and dictionary decoding */
+  DDJVU_PROFILE_JB2_BLIT,         /* rendering JB2 shapes */
+  DDJVU_PROFILE_BZZ_DECODE,       /* BZZ decoding */
+  DDJVU_PROFILE_SCALE,            /* scaling images */
+  DDJVU_PROFILE_COMPOSITE,        /* stenciling foreground over background */
+  DDJVU_PROFILE_CONVERT,          /* dithering and pixel format conversion */
+  DDJVU_PROFILE_DATA_WAIT,        /* waiting for data not yet available */
+  DDJVU_PROFILE_CACHE_HIT,        /* page files found in the cache */
+  DDJVU_PROFILE_CACHE_MISS,       /* page files decoded from scratch */
+  DDJVU_PROFILE_NUM_STAGES
+} ddjvu_profile_stage_t;
+
+
+/* ddjvu_profile_enable ---
+   Enables profiling when argument <flags> is nonzero.
+   Flag <DDJVU_PROFILE_COUNTERS> enables the counters.
+   Flag <DDJVU_PROFILE_TRACE> also records trace events
+   for <ddjvu_profile_save_trace>.  Profiling is enabled
+   or disabled for all contexts of the process. */
+
+#define DDJVU_PROFILE_COUNTERS 1
+#define DDJVU_PROFILE_TRACE    2
+
+DDJVUAPI void
+ddjvu_profile_enable(ddjvu_context_t *context, int flags);
+
+
+/* ddjvu_profile_stage_name ---
+   Returns a short name for a profiled stage. */
+
+DDJVUAPI const char *
+ddjvu_profile_stage_name(ddjvu_profile_stage_t stage);
+
+
+/* ddjvu_context_get_profile ---
+   ddjvu_page_get_profile ---
+   Copy the counters of a context or of a page into <*info>.
+   Field <count> is the number of times a stage was executed.
+   Field <seconds> is the total time spent in this stage.
+   Stages can be nested, e.g. decoding a JB2 dictionary
+   may wait for data.  The times are inclusive.
+   Return <TRUE> on success. */
+
+typedef struct ddjvu_profile_s {
+  struct {
+    unsigned long count;
+    double        seconds;
+  } stage[DDJVU_PROFILE_NUM_STAGES];
+} ddjvu_profile_t;
+
+#define ddjvu_context_get_profile(c,i) \
+   ddjvu_context_get_profile_imp(c,i,sizeof(ddjvu_profile_t))
+
+DDJVUAPI int
+ddjvu_context_get_profile_imp(ddjvu_context_t *context,
+                              ddjvu_profile_t *info, 
+                              unsigned int infosz);
+
+#define ddjvu_page_get_profile(p,i) \
+   ddjvu_page_get_profile_imp(p,i,sizeof(ddjvu_profile_t))
+
+DDJVUAPI int
+ddjvu_page_get_profile_imp(ddjvu_page_t *page,
+                           ddjvu_profile_t *info, 
+                           unsigned int infosz);
+
+
+/* ddjvu_profile_reset ---
+   Resets the counters of a context 
+   and discards the recorded trace events. */
+
+DDJVUAPI void
+ddjvu_profile_reset(ddjvu_context_t *context);
+
+
+/* ddjvu_profile_save_trace ---
+   Writes the recorded trace events into stdio file <output>
+   using the JSON trace event format understood by the Chrome 
+   trace viewer (chrome://tracing) and by Perfetto.  The events
+   are then discarded.  Each event names the page whose decoding
+   or rendering produced it.  Returns <TRUE> on success. */
+
+DDJVUAPI int
+ddjvu_profile_save_trace(ddjvu_context_t *context, FILE *output);
+
+
+
 /* -------------------------------------------------- */
 /* SAVE AND PRINT JOBS                                */
 /* -------------------------------------------------- */
@@ -1517,6 +1644,78 @@ ddjvu_document_get_pagetext(ddjvu_document_t *document, int pageno,
                             const char *maxdetail);
 
 
+/* ddjvu_document_visit_pagetext -- 
+   This function walks the text information for page <pageno>
+   and reports it to the callbacks of <visitor> instead of
+   building a s-expression. The sequence of callbacks follows
+   the structure of the s-expression returned by function
+   <ddjvu_document_get_pagetext> for the same arguments.
+   Callback <begin_zone> is invoked with the zone type
+   ("page", "column", ..., "char") and the zone rectangle.
+   The zone is then described either by a single invocation
+   of callback <text>, or by the callbacks for its subzones.
+   Callback <end_zone> terminates the zone.  Null callbacks 
+   are ignored.  Strings passed to the callbacks are only 
+   valid during the callback.  Argument <closure> is passed 
+   as the first argument of all callbacks.  
+   This function does not allocate s-expressions.
+
+   This function returns <DDJVU_JOB_STARTED> if the page data 
+   is not yet available. It then starts fetching the page data 
+   and causes the emission of <m_pageinfo> messages 
+   with zero in the <m_any.page> field.
+   This function returns <DDJVU_JOB_OK> after walking the
+   text information or when the page contains no text.  
+   It returns <DDJVU_JOB_STOPPED> as soon as a callback 
+   returns a nonzero value, and <DDJVU_JOB_FAILED> 
+   when an error occurs.
+   Typical synchronous usage:
+
+    ddjvu_status_t r;
+    while ((r=ddjvu_document_visit_pagetext(doc,pageno,0,&v,0))
+           ==DDJVU_JOB_STARTED)
+      handle_ddjvu_messages(ctx, TRUE); 
+*/
+
+typedef struct ddjvu_pagetext_visitor_s {
+  int (*begin_zone)(void *closure, const char *zone, 
+                    int xmin, int ymin, int xmax, int ymax);
+  int (*text)(void *closure, const char *data, size_t length);
+  int (*end_zone)(void *closure, const char *zone);
+} ddjvu_pagetext_visitor_t;
+
+DDJVUAPI ddjvu_status_t
+ddjvu_document_visit_pagetext(ddjvu_document_t *document, int pageno,
+                              const char *maxdetail,
+                              const ddjvu_pagetext_visitor_t *visitor,
+                              void *closure);
+
+
+/* ddjvu_document_search_text -- 
+   This function searches the hidden text of the document
+   for the occurrences of the words of <phrase>. Words are
+   compared after conversion to lower case and removal of the
+   leading and trailing punctuation.  Argument <indexfile> names
+   a text index file created by the <save-txt-index> command of
+   program <djvused>.  The index is loaded once and cached in the
+   document.  When <indexfile> is null, the cached index is used
+   when available.  Otherwise an index is built in memory by
+   decoding the text of all pages of the document in a 
+   separate thread.  This causes the emission of a <m_pageinfo>
+   message with zero in the <m_any.page> field when the index
+   is ready.  This function returns a list of at most <maxhits>
+   entries (all entries when <maxhits> is negative) in page order.
+   Each entry has the form <(pageno xmin ymin xmax ymax)>
+   where <pageno> starts with zero and the rectangle covers 
+   the words of the phrase.  It returns <miniexp_dummy>
+   while the document is not yet decoded or the index is
+   being built, and symbol <failed> when an error occurs. */
+
+DDJVUAPI miniexp_t
+ddjvu_document_search_text(ddjvu_document_t *document, const char *indexfile,
+                           const char *phrase, int maxhits);
+
+
 /* ddjvu_document_get_pageanno -- 
    This function tries to obtain the annotations for
    page <pageno>. If this information is available, it
@@ -237,11 +237,26 @@ miniexp_symbol(const char *name)
 /* MEMORY AND GARBAGE COLLECTION                      */
 /* -------------------------------------------------- */
 
-// A simple mark-and-sweep garbage collector.
+// A simple generational mark-and-sweep garbage collector.
 //
 // Memory is managed in chunks of nptrs_chunk pointers.
 // The first two pointers are used to hold mark bytes for the rest.
 // Chunks are carved from blocks of nptrs_block pointers.
+// Each block keeps its own list of free cells.
+//
+// Marks are sticky: cells that survive a collection stay marked
+// and form the old generation. A minor collection only traces
+// from the roots through unmarked (young) cells and only sweeps 
+// the blocks that served allocations since the last collection.
+// Old cells modified by miniexp_mutate() to point to young cells 
+// are kept in a remembered set and scanned by minor collections.
+// A major collection clears all marks and traces everything.
+// It happens when the old generation has doubled since 
+// the previous major collection.
+//
+// Each thread allocates from its own blocks (the nursery),
+// so that short lived cells of a thread are clustered and 
+// are reclaimed by sweeping a few blocks.
 //
 // Dirty hack: The sixteen most recently created pairs are 
 // not destroyed by automatic garbage collection, in order
@@ -250,41 +265,58 @@ miniexp_symbol(const char *name)
 
 #define nptrs_chunk  (4*sizeof(void*))
 #define sizeof_chunk (nptrs_chunk*sizeof(void*))
-#define nptrs_block  (16384-8)
+#define nptrs_block  (16384-16)
 #define recentlog    (4)
 #define recentsize   (1<<recentlog)
 
 BEGIN_ANONYMOUS_NAMESPACE
 
-struct gctls_t {
-  gctls_t  *next;
-  gctls_t **pprev;
-  void    **recent[recentsize];
-  int       recentindex;
-  gctls_t();
-  ~gctls_t();
-};
+struct gctls_t;
 
 struct block_t 
 {
   block_t *next;
   void **lo;
   void **hi;
+  void **freelist;
+  int nfree;
+  bool young;
+  gctls_t *owner;
   void *ptrs[nptrs_block];
 };
 
+struct space_t
+{
+  int      total;
+  int      free;
+  block_t *blocks;
+  block_t *scan;
+};
+
+struct gctls_t {
+  gctls_t  *next;
+  gctls_t **pprev;
+  void    **recent[recentsize];
+  int       recentindex;
+  block_t  *pairs;
+  block_t  *objs;
+  gctls_t();
+  ~gctls_t();
+};
+
 static struct {
   int lock;
   int request;
   int debug;
-  int      pairs_total;
-  int      pairs_free;
-  void   **pairs_freelist;
-  block_t *pairs_blocks;
-  int      objs_total;
-  int      objs_free;
-  void   **objs_freelist;
-  block_t *objs_blocks;
+  bool major;
+  int minors;
+  int majors;
+  int oldlimit;
+  space_t pairs;
+  space_t objs;
+  miniexp_t *remset;
+  int remcount;
+  int remsize;
   gctls_t *tls;
 } gc;
 
@@ -294,6 +326,7 @@ gctls_t::gctls_t()
   recentindex = 0;
   for (int i=0; i<recentsize; i++)
     recent[i] = 0;
+  pairs = objs = 0;
   if ((next = gc.tls))
     next->pprev = &next;
   pprev = &gc.tls;
@@ -305,6 +338,10 @@ gctls_t::~gctls_t()
 {
   //CSLOCK(locker); [already locked]
   //fprintf(stderr,"Deleting gctls %p\n", this);
+  if (pairs)
+    pairs->owner = 0;
+  if (objs)
+    objs->owner = 0;
   if  ((*pprev = next))
     next->pprev = pprev;
 }
@@ -416,16 +453,6 @@ markbyte(void **p)
   return base + ((p - (void**)base)>>1);
 }
 
-static block_t *
-new_block(void)
-{
-  block_t *b = new block_t;
-  memset(b, 0, sizeof(block_t));
-  b->lo = (void**)markbase(b->ptrs+nptrs_chunk-1);
-  b->hi = (void**)markbase(b->ptrs+nptrs_block);
-  return b;
-}
-
 static void
 clear_marks(block_t *b)
 {
@@ -434,8 +461,13 @@ clear_marks(block_t *b)
 }
 
 static void
-collect_free(block_t *b, void **&freelist, int &count, bool destroy)
+collect_free(block_t *b, space_t &s, bool destroy)
 {
+  // Rebuilds the free list of a block from its unmarked cells.
+  s.free -= b->nfree;
+  b->freelist = 0;
+  b->nfree = 0;
+  b->young = false;
   for (void **m=b->lo; m<b->hi; m+=nptrs_chunk)
     {
       char *c = (char*)m;
@@ -445,38 +477,28 @@ collect_free(block_t *b, void **&freelist, int &count, bool destroy)
             miniobj_t *obj = (miniobj_t*)m[i+i];
             if (destroy && obj && m[i+i]==m[i+i+1]) 
               obj->destroy();
-            m[i+i] = (void*)freelist;
+            m[i+i] = (void*)b->freelist;
             m[i+i+1] = 0;
-            freelist = &m[i+i];
-            count += 1;
+            b->freelist = &m[i+i];
+            b->nfree += 1;
           }
     }
+  s.free += b->nfree;
 }
 
-static void
-new_pair_block(void)
-{
-  int count = 0;
-  block_t *b = new_block();
-  b->next = gc.pairs_blocks;
-  gc.pairs_blocks = b;
-  clear_marks(b);
-  collect_free(b, gc.pairs_freelist, count, false);
-  gc.pairs_total += count;
-  gc.pairs_free += count;
-}
-
-static void
-new_obj_block(void)
+static block_t *
+new_block(space_t &s)
 {
-  int count = 0;
-  block_t *b = new_block();
-  b->next = gc.objs_blocks;
-  gc.objs_blocks = b;
+  block_t *b = new block_t;
+  memset(b, 0, sizeof(block_t));
+  b->lo = (void**)markbase(b->ptrs+nptrs_chunk-1);
+  b->hi = (void**)markbase(b->ptrs+nptrs_block);
+  b->next = s.blocks;
+  s.blocks = b;
   clear_marks(b);
-  collect_free(b, gc.objs_freelist, count, false);
-  gc.objs_total += count;
-  gc.objs_free += count;
+  collect_free(b, s, false);
+  s.total += b->nfree;
+  return b;
 }
 
 #if defined(__GNUC__) && (__GNUC__ >= 3)
@@ -538,72 +560,167 @@ gc_mark_object(void **v)
 }
 
 static void
-gc_run(void)
+gc_remember(miniexp_t p, miniexp_t x)
+{
+  // Called when old cell p is changed to point to cell x.
+  if (((size_t)x) & 2)
+    return;
+  void **w = (void**)(((size_t)x) & ~(size_t)3);
+  if (! w || *markbyte(w))
+    return;
+  void **v = (void**)(((size_t)p) & ~(size_t)3);
+  if ((((size_t)p) & 2) || !v)
+    {
+      // Unknown container: only a major collection is safe.
+      gc.major = true;
+      return;
+    }
+  char *m = markbyte(v);
+  if (*m != 1)
+    return;
+  *m = 2;
+  if (gc.remcount >= gc.remsize)
+    {
+      int nsize = (gc.remsize < 256) ? 256 : 2 * gc.remsize;
+      miniexp_t *nset = new miniexp_t[nsize];
+      if (gc.remcount)
+        memcpy(nset, gc.remset, gc.remcount*sizeof(miniexp_t));
+      delete [] gc.remset;
+      gc.remset = nset;
+      gc.remsize = nsize;
+    }
+  gc.remset[gc.remcount++] = p;
+}
+
+static void
+gc_collect(bool major)
+{
+  block_t *b;
+  // clear marks
+  if (major)
+    {
+      for (b=gc.objs.blocks; b; b=b->next)
+        clear_marks(b);
+      for (b=gc.pairs.blocks; b; b=b->next)
+        clear_marks(b);
+    }
+  else
+    {
+      // scan remembered set
+      for (int i=0; i<gc.remcount; i++)
+        {
+          void **v = (void**)(((size_t)gc.remset[i]) & ~(size_t)3);
+          *markbyte(v) = 1;
+          if (((size_t)gc.remset[i]) & 1)
+            gc_mark_object(v);
+          else
+            {
+              gc_mark((miniexp_t*)&v[0]);
+              gc_mark((miniexp_t*)&v[1]);
+            }
+        }
+    }
+  gc.remcount = 0;
+  // mark recents
+  for (gctls_t *tls = gc.tls; tls; tls=tls->next)
+    for (int i=0; i<recentsize; i++)
+      gc_mark((miniexp_t*)(char*)&(tls->recent[i]));
+  // mark roots
+  minivar_t::mark(gc_mark);
+  // sweep
+  for (b=gc.objs.blocks; b; b=b->next)
+    if (major || b->young)
+      collect_free(b, gc.objs, true);
+  for (b=gc.pairs.blocks; b; b=b->next)
+    if (major || b->young)
+      collect_free(b, gc.pairs, false);
+  gc.objs.scan = gc.objs.blocks;
+  gc.pairs.scan = gc.pairs.blocks;
+  if (major)
+    {
+      gc.majors += 1;
+      gc.major = false;
+      gc.oldlimit = 2 * (gc.pairs.total - gc.pairs.free 
+                         + gc.objs.total - gc.objs.free);
+      if (gc.oldlimit < (int)nptrs_block)
+        gc.oldlimit = nptrs_block;
+    }
+  else
+    gc.minors += 1;
+}
+
+static void
+gc_run(bool major)
 {
   gc.request++;
   if (gc.lock == 0)
     {
-      block_t *b;
       gc.request = 0;
-      // clear marks
-      for (b=gc.objs_blocks; b; b=b->next)
-        clear_marks(b);
-      for (b=gc.pairs_blocks; b; b=b->next)
-        clear_marks(b);
-      // mark recents
-      for (gctls_t *tls = gc.tls; tls; tls=tls->next)
-        for (int i=0; i<recentsize; i++)
-          gc_mark((miniexp_t*)(char*)&(tls->recent[i]));
-      // mark roots
-      minivar_t::mark(gc_mark);
-      // sweep
-      gc.objs_free = gc.pairs_free = 0;
-      gc.objs_freelist = gc.pairs_freelist = 0;
-      for (b=gc.objs_blocks; b; b=b->next)
-        collect_free(b, gc.objs_freelist, gc.objs_free, true);
-      for (b=gc.pairs_blocks; b; b=b->next)
-        collect_free(b, gc.pairs_freelist, gc.pairs_free, false);
+      major = major || gc.major;
+      gc_collect(major);
+      // collect old generation when it has doubled
+      if (! major)
+        if (gc.pairs.total - gc.pairs.free 
+            + gc.objs.total - gc.objs.free > gc.oldlimit)
+          gc_collect(true);
       // alloc 33% extra space
-      while (gc.objs_free*4 < gc.objs_total)
-        new_obj_block();
-      while (gc.pairs_free*4 < gc.pairs_total)
-        new_pair_block();
+      while (gc.objs.free*4 < gc.objs.total)
+        new_block(gc.objs);
+      while (gc.pairs.free*4 < gc.pairs.total)
+        new_block(gc.pairs);
+      gc.objs.scan = gc.objs.blocks;
+      gc.pairs.scan = gc.pairs.blocks;
     }
 }
 
+static block_t *
+find_block(space_t &s)
+{
+  // Returns the next block with free cells owned by no thread.
+  for (; s.scan; s.scan = s.scan->next)
+    if (s.scan->freelist && !s.scan->owner)
+      return s.scan;
+  return 0;
+}
+
 static void **
-gc_alloc_pair(void *a, void *d)
+gc_alloc(space_t &s, block_t *&cur, gctls_t *tls)
 {
-  if (!gc.pairs_freelist)
+  if (!cur || !cur->freelist)
     {
-      gc_run();
-      if (!gc.pairs_freelist)
-        new_pair_block();
+      if (cur)
+        cur->owner = 0;
+      if (! (cur = find_block(s)))
+        {
+          gc_run(false);
+          if (! (cur = find_block(s)))
+            cur = new_block(s);
+        }
+      cur->owner = tls;
     }
   else if (gc.debug)
-    gc_run();
-  void **p = gc.pairs_freelist;
-  gc.pairs_freelist = (void**)p[0];
-  gc.pairs_free -= 1;
+    gc_run(false);
+  void **p = cur->freelist;
+  cur->freelist = (void**)p[0];
+  cur->nfree -= 1;
+  cur->young = true;
+  s.free -= 1;
+  return p;
+}
+
+static void **
+gc_alloc_pair(gctls_t *tls, void *a, void *d)
+{
+  void **p = gc_alloc(gc.pairs, tls->pairs, tls);
   p[0] = a;
   p[1] = d;
   return p;
 }
 
 static void **
-gc_alloc_object(void *obj)
+gc_alloc_object(gctls_t *tls, void *obj)
 {
-  if (!gc.objs_freelist)
-    {
-      gc_run();
-      if (!gc.objs_freelist)
-        new_obj_block();
-    }
-  else if (gc.debug)
-    gc_run();
-  void **p = gc.objs_freelist;
-  gc.objs_freelist = (void**)p[0];
-  gc.objs_free -= 1;
+  void **p = gc_alloc(gc.objs, tls->objs, tls);
   p[0] = p[1] = obj;
   return p;
 }
@@ -631,7 +748,7 @@ minilisp_release_gc_lock(miniexp_t x)
     if (gc.lock > 0)
       if (--gc.lock == 0)
         if (gc.request > 0)
-          gc_run();
+          gc_run(false);
   }
   return x;
 }
@@ -643,7 +760,7 @@ minilisp_gc(void)
   for (gctls_t *tls = gc.tls; tls; tls=tls->next)
     for (int i=0; i<recentsize; i++)
       tls->recent[i] = 0;
-  gc_run();
+  gc_run(true);
 }
 
 void 
@@ -665,16 +782,19 @@ minilisp_info(void)
     printf("gc.debug: true\n");
   if (gc.lock)
     printf("gc.locked: true, %d requests\n", gc.request);
-  printf("gc.pairs: %d free, %d total\n", gc.pairs_free, gc.pairs_total);
-  printf("gc.objects: %d free, %d total\n", gc.objs_free, gc.objs_total);
+  printf("gc.pairs: %d free, %d total\n", gc.pairs.free, gc.pairs.total);
+  printf("gc.objects: %d free, %d total\n", gc.objs.free, gc.objs.total);
+  printf("gc.collections: %d minor, %d major, %d remembered\n", 
+         gc.minors, gc.majors, gc.remcount);
   printf("--- end info -- %s", dat);
 }
 
 miniexp_t
-miniexp_mutate(miniexp_t, miniexp_t *var, miniexp_t val)
+miniexp_mutate(miniexp_t obj, miniexp_t *var, miniexp_t val)
 {
   CSLOCK(locker);
   *var = val;
+  gc_remember(obj, val);
   return val;
 }
 
@@ -828,8 +948,8 @@ miniexp_t
 miniexp_cons(miniexp_t a, miniexp_t d)
 {
   CSLOCK(locker);
-  miniexp_t r = (miniexp_t)gc_alloc_pair((void*)a, (void*)d); 
   gctls_t *tls = gctls();
+  miniexp_t r = (miniexp_t)gc_alloc_pair(tls, (void*)a, (void*)d); 
   tls->recent[(++(tls->recentindex)) & (recentsize-1)] = (void**)r;
   return r;
 }
@@ -917,9 +1037,9 @@ miniexp_t
 miniexp_object(miniobj_t *obj)
 {
   CSLOCK(locker);
-  void **v = gc_alloc_object((void*)obj);
-  v = (void**)(((size_t)v)|((size_t)1));
   gctls_t *tls = gctls();
+  void **v = gc_alloc_object(tls, (void*)obj);
+  v = (void**)(((size_t)v)|((size_t)1));
   tls->recent[(++(tls->recentindex)) & (recentsize-1)] = (void**)v;
   return (miniexp_t)(v);
 }
@@ -2117,22 +2237,30 @@ minilisp_finish(void)
     for (int i=0; i<recentsize; i++)
       tls->recent[i] = 0;
   // collect everything
-  gc_run();
+  gc_run(true);
   // deallocate everything
-  ASSERT(gc.pairs_free == gc.pairs_total);
-  while (gc.pairs_blocks)
+  ASSERT(gc.pairs.free == gc.pairs.total);
+  while (gc.pairs.blocks)
     {
-      block_t *b = gc.pairs_blocks;
-      gc.pairs_blocks = b->next;
+      block_t *b = gc.pairs.blocks;
+      gc.pairs.blocks = b->next;
       delete b;
     }
-  ASSERT(gc.objs_free == gc.objs_total);
-  while (gc.objs_blocks)
+  ASSERT(gc.objs.free == gc.objs.total);
+  while (gc.objs.blocks)
     {
-      block_t *b = gc.objs_blocks;
-      gc.objs_blocks = b->next;
+      block_t *b = gc.objs.blocks;
+      gc.objs.blocks = b->next;
       delete b;
     }
+  for (gctls_t *tls = gc.tls; tls; tls=tls->next)
+    tls->pairs = tls->objs = 0;
+  gc.pairs.scan = gc.objs.scan = 0;
+  gc.pairs.total = gc.objs.total = 0;
+  gc.pairs.free = gc.objs.free = 0;
+  delete [] gc.remset;
+  gc.remset = 0;
+  gc.remcount = gc.remsize = 0;
   delete symbols;
   symbols = 0;
 }
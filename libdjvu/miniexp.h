@@ -354,6 +354,14 @@ MINILISPAPI miniexp_t miniexp_double(double x);
    garbage collection also preserves the sixteen most recently 
    created miniexps in order to make sure that temporaries do 
    not vanish in the middle of complicated C expressions.
+
+   The collector is generational. Expressions that survive
+   a collection are considered old and are not traced again 
+   by the frequent minor collections, which only reclaim 
+   recently allocated expressions.  This is why pairs and
+   objects must only be modified with <miniexp_rplaca()>,
+   <miniexp_rplacd()> or <miniexp_mutate()>.  Occasional 
+   major collections reclaim everything else.
      
    The minivar class is designed such that C++ program can
    directly use instances of <minivar_t> as normal
@@ -398,7 +406,7 @@ MINILISPAPI miniexp_t miniexp_double(double x);
    
 
 /* minilisp_gc --
-   Invokes the garbage collector now. */
+   Invokes a major garbage collection now. */
 
 MINILISPAPI void minilisp_gc(void);
 
@@ -777,6 +785,10 @@ MINILISPAPI miniexp_t miniexp_object(miniobj_t *obj);
    Atomically modifies a member of a garbage collected object. 
    The object implementation must call this function to change 
    the contents of a member variable <v> of object <obj>.
+   This lets the garbage collector remember that an old object
+   refers to a younger expression. When the object expression
+   is not known, passing <miniexp_nil> as <obj> is allowed
+   but forces the next collection to be a major one.
    Returns <p>*/
 
 MINILISPAPI miniexp_t miniexp_mutate(miniexp_t obj, miniexp_t *v, miniexp_t p);
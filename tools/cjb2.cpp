@@ -79,10 +79,14 @@
     \item[-clean]       Quasi-lossless compression (same as -losslevel 1).
     \item[-lossy]       Lossy compression (same as -losslevel 100).
     \item[-losslevel n] Set loss level (0 to 200)
+    \item[-mmr]         Fast lossless MMR/G4 compression.
     \item[-verbose]     Display additional messages.
     \end{description}
     Encoding is lossless unless one or several lossy options are selected.
     The #dpi# argument mostly affects the cleaning thresholds.
+    Option #-mmr# produces a #"Smmr"# chunk instead of a #"Sjbz"# chunk
+    and cannot be combined with the lossy options.  The G4 strips of TIFF
+    files without T6 options are then copied without decoding.
 
     {\bf Bugs}
 
@@ -110,6 +114,7 @@
 #include "GRect.h"
 #include "GBitmap.h"
 #include "JB2Image.h"
+#include "MMREncoder.h"
 #include "DjVuInfo.h"
 #include "GOS.h"
 #include "GURL.h"
@@ -685,6 +690,7 @@ struct cjb2opts {
   int  dpi;
   int  forcedpi;
   int  losslevel;
+  bool mmr;
   bool verbose;
 };
 
@@ -735,8 +741,8 @@ static int mapproc(thandle_t, tdata_t*, toff_t*) {
 static void unmapproc(thandle_t, tdata_t, toff_t) { 
 }
 
-static void
-read_tiff(CCImage &rimg, ByteStream *bs, cjb2opts &opts)
+static TIFF *
+open_tiff(ByteStream *bs, cjb2opts &opts, uint32 &w, uint32 &h, uint16 &photo)
 {
   TIFF *tiff = TIFFClientOpen("libtiff", "rm", (thandle_t)bs,
                               readproc, writeproc, seekproc,
@@ -751,10 +757,9 @@ read_tiff(CCImage &rimg, ByteStream *bs, cjb2opts &opts)
   if (bps != 1 || spp != 1)
     G_THROW("Tiff image is not bitonal");
   // photometric
-  uint16 photo = PHOTOMETRIC_MINISWHITE;
+  photo = PHOTOMETRIC_MINISWHITE;
   TIFFGetFieldDefaulted(tiff, TIFFTAG_PHOTOMETRIC, &photo);
   // image size
-  uint32 w, h;
   if (!TIFFGetFieldDefaulted(tiff, TIFFTAG_IMAGEWIDTH, &w) ||
       !TIFFGetFieldDefaulted(tiff, TIFFTAG_IMAGELENGTH, &h) )
     G_THROW("Tiff image size is not defined");
@@ -768,6 +773,15 @@ read_tiff(CCImage &rimg, ByteStream *bs, cjb2opts &opts)
       if (! opts.forcedpi)
         opts.dpi = (int) (xres + yres) / 2;
     }
+  return tiff;
+}
+
+static void
+read_tiff(CCImage &rimg, ByteStream *bs, cjb2opts &opts)
+{
+  uint32 w, h;
+  uint16 photo;
+  TIFF *tiff = open_tiff(bs, opts, w, h, photo);
   // init rimg
   rimg.init(w, h, opts.dpi);
   // allocate scanline
@@ -815,13 +829,144 @@ read_tiff(CCImage &rimg, ByteStream *bs, cjb2opts &opts)
   TIFFClose(tiff);
 }
 
+static void
+mmr_tiff(GP<ByteStream> smmr, ByteStream *bs, cjb2opts &opts, int &w, int &h)
+{
+  uint32 tw, th;
+  uint16 photo;
+  TIFF *tiff = open_tiff(bs, opts, tw, th, photo);
+  w = tw;
+  h = th;
+  uint16 compression = COMPRESSION_NONE;
+  uint16 fillorder = FILLORDER_MSB2LSB;
+  uint16 orientation = ORIENTATION_TOPLEFT;
+  TIFFGetFieldDefaulted(tiff, TIFFTAG_COMPRESSION, &compression);
+  TIFFGetFieldDefaulted(tiff, TIFFTAG_FILLORDER, &fillorder);
+  TIFFGetFieldDefaulted(tiff, TIFFTAG_ORIENTATION, &orientation);
+  // Option bits such as the uncompressed mode are not supported 
+  // by our MMR decoder.
+  uint32 t6options = 0;
+  if (compression == COMPRESSION_CCITTFAX4)
+    TIFFGetField(tiff, TIFFTAG_T6OPTIONS, &t6options);
+  if (compression == COMPRESSION_CCITTFAX4 && t6options == 0 &&
+      orientation == ORIENTATION_TOPLEFT && !TIFFIsTiled(tiff))
+    {
+      // Copy the G4 strips without decoding them.
+      // Several strips become the stripes of a striped Smmr chunk.
+      uint32 rowsperstrip = th;
+      TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &rowsperstrip);
+      int nstrips = TIFFNumberOfStrips(tiff);
+      if (nstrips > 1 && 
+          (rowsperstrip < 1 || (th + rowsperstrip - 1) / rowsperstrip != (uint32)nstrips))
+        G_THROW("Tiff file is corrupted (strips do not match image size)");
+      if (opts.verbose)
+        DjVuPrintErrorUTF8("cjb2: copying %d G4 strip(s)\n", nstrips);
+      MMREncoder::encode_header(*smmr, w, h, photo != PHOTOMETRIC_MINISWHITE,
+                                (nstrips > 1) ? (int)rowsperstrip : 0);
+      unsigned char *data = 0;
+      GPBuffer<unsigned char> gdata(data, 0);
+      for (int s=0; s<nstrips; s++)
+        {
+          tsize_t size = TIFFRawStripSize(tiff, s);
+          if (size <= 0)
+            G_THROW("Tiff file is corrupted (TIFFRawStripSize)");
+          gdata.resize(size);
+          size = TIFFReadRawStrip(tiff, s, (tdata_t)data, size);
+          if (size < 0)
+            G_THROW("Tiff file is corrupted (TIFFReadRawStrip)");
+          if (fillorder == FILLORDER_LSB2MSB)
+            for (int i=0; i<(int)size; i++)
+              {
+                unsigned char b = data[i];
+                b = (unsigned char)(((b & 0xf0) >> 4) | ((b & 0x0f) << 4));
+                b = (unsigned char)(((b & 0xcc) >> 2) | ((b & 0x33) << 2));
+                data[i] = (unsigned char)(((b & 0xaa) >> 1) | ((b & 0x55) << 1));
+              }
+          if (nstrips > 1)
+            smmr->write32(size);
+          smmr->writall((void*)data, size);
+        }
+    }
+  else
+    {
+      // Encode the packed scanlines
+      MMREncoder::encode_header(*smmr, w, h, false);
+      GP<MMREncoder> enc = MMREncoder::create(smmr, w);
+      tsize_t scanlinesize = TIFFScanlineSize(tiff);
+      scanlinesize = MAX(scanlinesize,1);
+      unsigned char *scanline = 0;
+      GPBuffer<unsigned char> gscanline(scanline, scanlinesize);
+      for (int y=0; y<h; y++)
+        {
+          if (TIFFReadScanline(tiff, (tdata_t)scanline, y) < 0)
+            G_THROW("Tiff file is corrupted (TIFFReadScanline)");
+          if (photo != PHOTOMETRIC_MINISWHITE)
+            for (int i=0; i<(int)scanlinesize; i++)
+              scanline[i] ^= 0xff;
+          enc->encode_packed(scanline);
+        }
+      enc->close();
+    }
+  TIFFClose(tiff);
+}
+
 #endif // HAVE_TIFF
 
 
+static void
+put_info(IFFByteStream &iff, int width, int height, int dpi)
+{
+  GP<DjVuInfo> ginfo=DjVuInfo::create();
+  DjVuInfo &info=*ginfo;
+  info.height = height;
+  info.width = width;
+  info.dpi = dpi;
+  iff.put_chunk("INFO");
+  info.encode(*iff.get_bytestream());
+  iff.close_chunk();
+}
+
+// Fast lossless encoding with a ``Smmr'' chunk
+static void
+cjb2_mmr(GP<ByteStream> ibs, const GURL &urlout, cjb2opts &opts)
+{
+  GP<ByteStream> smmr = ByteStream::create();
+  int w, h;
+#if HAVE_TIFF
+  if (is_tiff(ibs))
+    mmr_tiff(smmr, ibs, opts, w, h);
+  else
+#endif
+    {
+      GP<GBitmap> input=GBitmap::create(*ibs);
+      w = input->columns();
+      h = input->rows();
+      MMREncoder::encode_chunk(*input, smmr);
+    }
+  if (opts.verbose)
+    DjVuPrintErrorUTF8("cjb2: %d bytes of MMR data\n", (int)smmr->size());
+  GP<ByteStream> obs=ByteStream::create(urlout, "wb");
+  GP<IFFByteStream> giff=IFFByteStream::create(obs);
+  IFFByteStream &iff=*giff;
+  iff.put_chunk("FORM:DJVU", 1);
+  put_info(iff, w, h, opts.dpi);
+  iff.put_chunk("Smmr");
+  smmr->seek(0);
+  iff.get_bytestream()->copy(*smmr);
+  iff.close_chunk();
+  iff.close_chunk();
+}
+
+
 void 
 cjb2(const GURL &urlin, const GURL &urlout, cjb2opts &opts)
 {
   GP<ByteStream> ibs=ByteStream::create(urlin, "rb");
+  if (opts.mmr)
+    {
+      cjb2_mmr(ibs, urlout, opts);
+      return;
+    }
   CCImage rimg;
 
 #if HAVE_TIFF
@@ -879,14 +1024,7 @@ cjb2(const GURL &urlin, const GURL &urlout, cjb2opts &opts)
   // -- main composite chunk
   iff.put_chunk("FORM:DJVU", 1);
   // -- ``INFO'' chunk
-  GP<DjVuInfo> ginfo=DjVuInfo::create();
-  DjVuInfo &info=*ginfo;
-  info.height = rimg.height;
-  info.width = rimg.width;
-  info.dpi = opts.dpi;
-  iff.put_chunk("INFO");
-  info.encode(*iff.get_bytestream());
-  iff.close_chunk();
+  put_info(iff, rimg.width, rimg.height, opts.dpi);
   // -- ``Sjbz'' chunk
   iff.put_chunk("Sjbz");
   jimg->encode(iff.get_bytestream());
@@ -920,6 +1058,7 @@ usage()
          " -clean          Cleanup image by removing small flyspecks.\n"
          " -lossy          Lossy compression (implies -clean as well)\n"
          " -losslevel <n>  Loss factor (implies -lossy, default 100)\n"
+         " -mmr            Fast lossless MMR/G4 encoding into a Smmr chunk.\n"
          "Encoding is lossless unless a lossy options is selected.\n" );
   exit(10);
 }
@@ -941,6 +1080,7 @@ main(int argc, const char **argv)
       opts.forcedpi = 0;
       opts.dpi = 300;
       opts.losslevel = 0;
+      opts.mmr = false;
       opts.verbose = false;
       // Parse options
       for (int i=1; i<argc; i++)
@@ -966,6 +1106,8 @@ main(int argc, const char **argv)
             opts.losslevel = 100;
           else if (arg == "-clean") // almost deprecated
             opts.losslevel = 1;
+          else if (arg == "-mmr")
+            opts.mmr = true;
           else if (arg == "-verbose" || arg == "-v")
             opts.verbose = true;
           else if (arg[0] == '-' && arg[1])
@@ -979,6 +1121,8 @@ main(int argc, const char **argv)
         }
       if (inputpbmurl.is_empty() || outputdjvuurl.is_empty())
         usage();
+      if (opts.mmr && opts.losslevel > 0)
+        G_THROW("cjb2: option -mmr cannot be combined with lossy options");
       // Execute
       cjb2(inputpbmurl, outputdjvuurl, opts);
     }
@@ -697,7 +697,10 @@ cpaldjvu(ByteStream *ibs, GURL &urlout, const cpaldjvuopts &opts)
       const GPixel *row = (*ginput)[y];
       for(x=0;x<w;x++)
         {
-          line[x] = pal.color_to_index(row[x]);
+          if (x>0 && row[x]==row[x-1])
+            line[x] = line[x-1];
+          else
+            line[x] = pal.color_to_index(row[x]);
           if (opts.bgwhite && row[x]==GPixel::WHITE)
             line[x] = bgindex;
         }
@@ -854,6 +857,7 @@ usage()
          "   -dpi [25-6000]   Resolution written into the output file (default 100).\n"
          "   -verbose         Displays additional messages.\n"
          "   -bgwhite         Use the lightest color for background (usually white).\n"
+         "   -threads [0-256] Threads computing the color histogram (default 1, 0=all cpus).\n"
          );
   exit(10);
 }
@@ -898,6 +902,14 @@ main(int argc, const char **argv)
             opts.verbose = true;
           else if (arg == "-bgwhite")
             opts.bgwhite = true;
+          else if (arg == "-threads" && i+1<argc)
+            {
+              char *end;
+              int threads = strtol(dargv[++i], &end, 10);
+              if (*end || threads<0 || threads>256)
+                usage();
+              DjVuPalette::set_threads(threads);
+            }
           else if (arg[0] == '-' && arg[1])
             usage();
           else if (inputppmurl.is_empty())
@@ -96,6 +96,7 @@
     \item[-d n] Resolution written into the output file (default: 300).
     \item[-q <spec>] Quality level for background (default: 72+11+10+10).
                      See option #"-slice"# in program \Ref{c44} for details.
+    \item[-threads n] Encodes up to n pages in parallel (default: 1).
     \item[-v] Displays a brief message per page.
     \item[-vv] Displays lots of additional messages.
     \end{description}
@@ -154,6 +155,7 @@
 #include "DjVuMessage.h"
 #include "DjVuText.h"
 #include "BSByteStream.h"
+#include "GThreads.h"
 
 #include "miniexp.h"
 #include "jb2tune.h"
@@ -177,6 +179,7 @@ struct csepdjvuopts
   int verbose;              // verbosity level
   DjVuTXT::ZoneType text;   // level of text detail
   unsigned char slice[16];  // background quality spec
+  int threads;              // number of encoding threads
   csepdjvuopts();
 };
 
@@ -190,6 +193,7 @@ csepdjvuopts::csepdjvuopts()
       slice[2] =  93;
       slice[3] = 103;
       slice[4] =   0;
+      threads = 1;
 }
 
 
@@ -1508,24 +1512,53 @@ Comments::get_pagetitle()
 // --------------------------------------------------
 
 
-// -- Compresses one page:
-//    - bytestream bs contains the input separated file.
-//    - bytestream obs will receive the output djvu file.
-void 
-csepdjvu_page(BufferByteStream &bs, 
-              GP<ByteStream> obs, 
-              GP<DjVmNav> &nav,
-	      GUTF8String &pagetitle,
-              const csepdjvuopts &opts)
+// -- A page of a separated file.
+//    The constructor reads the page from the separated file.
+//    Function encode() performs the analysis and encodes the 
+//    JB2 and IW44 layers.  Function finish() completes the
+//    output djvu file with the text and annotation chunks.
+class SepPage : public GPEnabled
+{
+public:
+  SepPage(BufferByteStream &bs, const csepdjvuopts &opts);
+  void encode(void);
+  void finish(GP<DjVmNav> &nav, GUTF8String &pagetitle);
+  GP<ByteStream> obs;     // output djvu file
+  int pageno;             // page number
+  GUTF8String source;     // name of the separated file
+private:
+  csepdjvuopts opts;
+  CRLEImage rimg;
+  Comments coms;
+  int bgred;
+  GP<GPixmap> bgpix;
+  GP<IFFByteStream> giff;
+};
+
+SepPage::SepPage(BufferByteStream &bs, const csepdjvuopts &opts)
+  : pageno(0), opts(opts), 
+    rimg(bs), coms(rimg.width, rimg.height, opts), bgred(1)
 {
   // Read rle data from separation file
-  CRLEImage rimg(bs);
   int w = rimg.width;
   int h = rimg.height;
   if (opts.verbose > 1)
     DjVuFormatErrorUTF8( "%s\t%d\t%d\t%d\t%d",
                      ERR_MSG("csepdjvu.summary"), 
                      w, h, rimg.pal->size(), rimg.runs.size());
+  // Obtain background image
+  bgpix = read_background(bs, w, h, bgred);
+  if (opts.verbose > 1 && bgpix)
+    DjVuFormatErrorUTF8( "%s\t%d", ERR_MSG("csepdjvu.reduction"), bgred);
+  // Process comments
+  coms.process_comments(bs, opts.verbose);
+}
+
+void 
+SepPage::encode(void)
+{
+  int w = rimg.width;
+  int h = rimg.height;
   
   // Perform Color Connected Component Analysis
   rimg.make_ccids_by_analysis();                  // Obtain ccids
@@ -1567,6 +1600,8 @@ csepdjvu_page(BufferByteStream &bs,
       rimg.pal->colordata.touch(blitno);
       rimg.pal->colordata[blitno] = cc.color;
     }
+  rimg.runs.empty();
+  rimg.ccs.empty();
   
   // Organize JB2Image
   tune_jb2image_lossless(&jimg);
@@ -1584,16 +1619,6 @@ csepdjvu_page(BufferByteStream &bs,
                        nshape, nrefine);
     }
   
-  // Obtain background image
-  int bgred;
-  GP<GPixmap> bgpix = read_background(bs, w, h, bgred);
-  if (opts.verbose > 1 && bgpix)
-    DjVuFormatErrorUTF8( "%s\t%d", ERR_MSG("csepdjvu.reduction"), bgred);
-
-  // Process comments
-  Comments coms(w, h, opts);
-  coms.process_comments(bs, opts.verbose);
-  
   // Compute flags for simplifying output format
   bool white_background = (bgpix ? false : true);
   bool gray_background = white_background;
@@ -1640,7 +1665,8 @@ csepdjvu_page(BufferByteStream &bs,
     }
   
   // Assemble DJVU file
-  GP<IFFByteStream> giff=IFFByteStream::create(obs);
+  obs = ByteStream::create();
+  giff=IFFByteStream::create(obs);
   IFFByteStream &iff=*giff;
   // -- main composite chunk
   iff.put_chunk("FORM:DJVU", 1);
@@ -1684,6 +1710,15 @@ csepdjvu_page(BufferByteStream &bs,
             }
         }
     }
+  rimg.pal = 0;
+}  
+
+void
+SepPage::finish(GP<DjVmNav> &nav, GUTF8String &pagetitle)
+{
+  // The text and annotation chunks are made by the main
+  // thread because the miniexp library is not thread safe.
+  IFFByteStream &iff=*giff;
   // -- terminate main composite chunk
   coms.make_chunks(iff);
   iff.close_chunk();
@@ -1691,7 +1726,82 @@ csepdjvu_page(BufferByteStream &bs,
   pagetitle = coms.get_pagetitle();
   if (! nav) 
     nav = coms.get_djvm_nav();
-}  
+}
+
+
+// --------------------------------------------------
+// PAGE PIPELINE
+// --------------------------------------------------
+
+
+// -- Encodes pages in worker threads.
+//    The main thread reads the pages and queues them with put().
+//    The workers encode the queued pages in any order, while get()
+//    returns them in input order.  Function full() tells when the
+//    queue holds enough pages to keep all the workers busy, which
+//    bounds the memory used by the pages in flight.  Since each
+//    page is encoded independently, the output does not depend on
+//    the number of threads.
+class SepPipeline : public GPEnabled, protected GPipeline
+{
+public:
+  SepPipeline(int nthreads);
+  ~SepPipeline();
+  void put(GP<SepPage> page);
+  bool full(void);
+  GP<SepPage> get(void);
+protected:
+  virtual void work(int k, int worker);
+private:
+  int window;
+  int count;
+  GPArray<SepPage> pages;
+};
+
+SepPipeline::SepPipeline(int nthreads)
+  : window((nthreads > 1) ? 2 * nthreads : 1), count(0), 
+    pages(0, window - 1)
+{
+  start(nthreads, window);
+}
+
+SepPipeline::~SepPipeline()
+{
+  stop();
+}
+
+void
+SepPipeline::work(int k, int)
+{
+  // Page k stays in slot k%window until get() collects it.
+  pages[k % window]->encode();
+}
+
+void
+SepPipeline::put(GP<SepPage> page)
+{
+  pages[count % window] = page;
+  count += 1;
+  add();
+}
+
+bool
+SepPipeline::full(void)
+{
+  return GPipeline::full();
+}
+
+GP<SepPage>
+SepPipeline::get(void)
+{
+  int k = GPipeline::get();
+  if (k < 0)
+    return 0;
+  GP<SepPage> page = pages[k % window];
+  pages[k % window] = 0;
+  return page;
+}
+
 
 // -- Checks whether there is another page in the same file
 bool
@@ -1710,6 +1820,31 @@ check_for_another_page(BufferByteStream &bs, const csepdjvuopts &opts)
 }
 
 
+// -- Completes a page and inserts it into the document
+static void
+insert_page(DjVmDoc &doc, SepPage &page, GP<DjVmNav> &nav, 
+            GUTF8String &pagetitle, const csepdjvuopts &opts)
+{
+  char pagename[20];
+  sprintf(pagename, "p%04d.djvu", page.pageno);
+  page.finish(nav, pagetitle);
+  ByteStream &outputpage=*page.obs;
+  if (opts.verbose) {
+    DjVuPrintErrorUTF8("csepdjvu: %d bytes for page %d",
+                       outputpage.size(), page.pageno);
+    if (page.source == "-")
+      DjVuPrintErrorUTF8("%s"," (from stdin)\n");
+    else
+      DjVuPrintErrorUTF8(" (from file '%s')\n", 
+                         (const char*)page.source);
+  }
+  // Insert page into document
+  outputpage.seek(0);
+  doc.insert_file(outputpage, DjVmDir::File::PAGE, 
+                  pagename, pagename, pagetitle);
+}
+
+
 // -- Prints usage message
 void
 usage()
@@ -1726,6 +1861,8 @@ usage()
     "   -t         Restricts text information to lines only.\n"
     "   -q <spec>  Select quality for background (default: 72+11+10+10);\n"
     "              see option -slice in program c44 for more information.\n"
+    "   -threads <n>  Encode up to <n> pages in parallel (default: 1,\n"
+    "              0 for one thread per processor).\n"
     "Each separated files contain one or more pages\n"
     "Each page is composed of:\n"
     " (1) a B&W-RLE or Color-RLE image representing the foreground,\n"
@@ -1786,6 +1923,8 @@ main(int argc, const char **argv)
       DjVmDoc &doc=*gdoc;
       GURL outputurl;
       GP<ByteStream> goutputpage=ByteStream::create();
+      GP<SepPage> page;
+      GP<SepPipeline> pipeline;
       csepdjvuopts opts;
       int pageno = 0;
       // Read outputurl name
@@ -1814,6 +1953,16 @@ main(int argc, const char **argv)
               // Specify background quality
               parse_slice(dargv[++i], opts);
             }
+          else if (arg == "-threads" && i+1 < argc)
+            {
+              // Specify number of encoding threads
+              char *end;
+              opts.threads = strtol(dargv[++i], &end, 10);
+              if (*end || opts.threads<0 || opts.threads>256)
+                usage();
+              if (opts.threads == 0)
+                opts.threads = GThread::ncpus();
+            }
           else if (arg == "-l" || arg == "-t" || arg == "-h")
             {
               DjVuPrintErrorUTF8("csepdjvu: option %s not yet supported\n",
@@ -1831,31 +1980,33 @@ main(int argc, const char **argv)
               GP<ByteStream> fbs = 
                 ByteStream::create(GURL::Filename::UTF8(arg),"rb");
               BufferByteStream ibs(*fbs);
+              if (! pipeline)
+                pipeline = new SepPipeline(opts.threads);
               do {
-                char pagename[20];
-                sprintf(pagename, "p%04d.djvu", ++pageno);
                 if (opts.verbose > 1)
                   DjVuPrintErrorUTF8("%s","--------------------\n");
-                // Compress page 
-                goutputpage=ByteStream::create();
-                ByteStream &outputpage=*goutputpage;
-                csepdjvu_page(ibs, goutputpage, gnav, pagetitle, opts);
-                if (opts.verbose) {
-                  DjVuPrintErrorUTF8("csepdjvu: %d bytes for page %d",
-                                     outputpage.size(), pageno);
-                  if (arg == "-")
-                    DjVuPrintErrorUTF8("%s"," (from stdin)\n");
-                  else
-                    DjVuPrintErrorUTF8(" (from file '%s')\n", 
-                                       (const char*)arg);
-                }
-                // Insert page into document
-                outputpage.seek(0);
-                doc.insert_file(outputpage, DjVmDir::File::PAGE, 
-                                pagename, pagename, pagetitle);
+                // Read page and queue it for compression
+                page = new SepPage(ibs, opts);
+                page->pageno = ++pageno;
+                page->source = arg;
+                pipeline->put(page);
+                // Insert compressed pages into document
+                while (pipeline->full())
+                  {
+                    page = pipeline->get();
+                    insert_page(doc, *page, gnav, pagetitle, opts);
+                    goutputpage = page->obs;
+                  }
               } while (check_for_another_page(ibs, opts));
             }
         } 
+      // Insert remaining pages
+      while (pipeline && (page = pipeline->get()))
+        {
+          insert_page(doc, *page, gnav, pagetitle, opts);
+          goutputpage = page->obs;
+        }
+      pipeline = 0;
       // Save file
       if (pageno == 1 && ! gnav && ! pagetitle) 
         {
@@ -84,7 +84,7 @@
 #endif
 
 #include "libdjvu/ddjvuapi.h"
-#include "tiff2pdf.h"
+#include "pdfwriter.h"
 
 
 #if HAVE_PUTC_UNLOCKED
@@ -133,6 +133,7 @@ int          flag_quality = -1; /* 1-100 jpg, 900 zip, 901 lzw, 1000 raw */
 int          flag_skipcorrupted = 0;
 int          flag_eachpage = 0;
 const char  *flag_pagespec = 0; 
+const char  *flag_profile = 0;
 ddjvu_rect_t info_size;
 ddjvu_rect_t info_segment;
 const char  *programname = 0;
@@ -140,10 +141,7 @@ const char  *inputfilename = 0;
 const char  *outputfilename = 0;
 
 char *pagefilename = 0;
-#if HAVE_TIFF2PDF
-char *tempfilename = 0;
-int tiffd = -1;
-#endif
+pdfwriter_t *pdf = 0;
 #if HAVE_TIFF
 TIFF *tiff = 0;
 #endif
@@ -190,18 +188,22 @@ die(const char *fmt, ...)
   vfprintf(stderr, fmt, args);
   va_end(args);
   fprintf(stderr,"\n");
-  /* Cleanup */
-#if HAVE_TIFF2PDF
-  if (tiffd >= 0)
-    close(tiffd);
-  if (tempfilename)
-    remove(tempfilename);
-#endif
   /* Terminates */
   exit(10);
 }
 
 
+void
+print_profile(const ddjvu_profile_t *profile)
+{
+  for (int i=0; i<DDJVU_PROFILE_NUM_STAGES; i++)
+    if (profile->stage[i].count > 0)
+      fprintf(stderr, "  %-18s %8lu %10.3f ms\n",
+              ddjvu_profile_stage_name((ddjvu_profile_stage_t)i),
+              profile->stage[i].count, profile->stage[i].seconds * 1000);
+}
+
+
 void
 inform(ddjvu_page_t *page, int pageno)
 {
@@ -232,25 +234,28 @@ inform(ddjvu_page_t *page, int pageno)
 
 
 void
-render(ddjvu_page_t *page, int pageno)
+report(ddjvu_page_t *page, int pageno)
 {
-  ddjvu_rect_t prect;
-  ddjvu_rect_t rrect;
-  ddjvu_format_style_t style;
-  ddjvu_render_mode_t mode;
-  ddjvu_format_t *fmt;
-  int iw = ddjvu_page_get_width(page);
-  int ih = ddjvu_page_get_height(page);
-  int dpi = ddjvu_page_get_resolution(page);
-  ddjvu_page_type_t type = ddjvu_page_get_type(page);
-  char *image = 0;
-  char white = (char)0xFF;
-  int rowsize;
-#if HAVE_TIFF
-  int compression = COMPRESSION_NONE;
-#endif
-  
-  /* Process size specification */
+  if (flag_verbose)
+    if (timingdata[2] != timingdata[3])
+      fprintf(stderr,"Rendering time: %5ld ms\n",
+	      timingdata[3] - timingdata[2] );
+  if (flag_verbose && flag_profile)
+    {
+      ddjvu_profile_t profile;
+      if (ddjvu_page_get_profile(page, &profile))
+        {
+          fprintf(stderr,i18n("Profile for page %d:\n"), pageno);
+          print_profile(&profile);
+        }
+    }
+}
+
+
+void
+pagerect(int iw, int ih, int dpi, ddjvu_rect_t &prect)
+{
+  /* Size of the rendered page for the size options */
   prect.x = 0;
   prect.y = 0;
   if (flag_size > 0)
@@ -288,6 +293,30 @@ render(ddjvu_page_t *page, int pageno)
       else
         prect.w = (int)(iw / dh);
     }
+}
+
+
+void
+render(ddjvu_page_t *page, int pageno)
+{
+  ddjvu_rect_t prect;
+  ddjvu_rect_t rrect;
+  ddjvu_format_style_t style;
+  ddjvu_render_mode_t mode;
+  ddjvu_format_t *fmt;
+  int iw = ddjvu_page_get_width(page);
+  int ih = ddjvu_page_get_height(page);
+  int dpi = ddjvu_page_get_resolution(page);
+  ddjvu_page_type_t type = ddjvu_page_get_type(page);
+  char *image = 0;
+  char white = (char)0xFF;
+  int rowsize;
+#if HAVE_TIFF
+  int compression = COMPRESSION_NONE;
+#endif
+  
+  /* Process size specification */
+  pagerect(iw, ih, dpi, prect);
 
   /* Process segment specification */
   rrect = prect;
@@ -327,7 +356,6 @@ render(ddjvu_page_t *page, int pageno)
     }
   switch(flag_format)
     {
-    case 'f':
     case 't':
 #if HAVE_TIFF
       compression = COMPRESSION_NONE;
@@ -347,9 +375,8 @@ render(ddjvu_page_t *page, int pageno)
 # endif
 # ifdef ZIP_SUPPORT
       if (compression == COMPRESSION_NONE
-          && (flag_format == 'f' || flag_quality == 900)
+          && flag_quality == 900
           && TIFFFindCODEC(COMPRESSION_DEFLATE))
-        /* All pdf engines understand deflate. */
         compression = COMPRESSION_DEFLATE;
 # endif
 # ifdef LZW_SUPPORT
@@ -383,6 +410,19 @@ render(ddjvu_page_t *page, int pageno)
     default:
       break;
     }
+  /* PDF output renders and compresses the page by bands */
+  if (flag_format == 'f')
+    {
+      const char *err;
+      timingdata[2] = ticks();
+      err = pdfwriter_page(pdf, page, mode, style, &prect, &rrect, 
+                           flag_quality, flag_verbose);
+      if (err)
+        die(i18n("Error while writing PDF file: %s"), err);
+      timingdata[3] = ticks();
+      report(page, pageno);
+      return;
+    }
   if (! (fmt = ddjvu_format_create(style, 0, 0)))
     die(i18n("Cannot determine pixel style for page %d"), pageno);
   ddjvu_format_set_row_order(fmt, 1);
@@ -402,10 +442,7 @@ render(ddjvu_page_t *page, int pageno)
   if (! ddjvu_page_render(page, mode, &prect, &rrect, fmt, rowsize, image))
     memset(image, white, rowsize * rrect.h);
   timingdata[3] = ticks();
-  if (flag_verbose)
-    if (timingdata[2] != timingdata[3])
-      fprintf(stderr,"Rendering time: %5ld ms\n",
-	      timingdata[3] - timingdata[2] );
+  report(page, pageno);
 
   /* Output */
   switch (flag_format)
@@ -473,9 +510,8 @@ render(ddjvu_page_t *page, int pageno)
           die(i18n("writing rle file: %s"), strerror(errno));
         break;
       }
-      /* -------------- TIFF or PDF output */
+      /* -------------- TIFF output */
     case 't':
-    case 'f':
       {
 #if HAVE_TIFF
         int i;
@@ -593,41 +629,6 @@ openfile(int pageno)
       die(i18n("TIFF output is not compiled"));
 #endif
     }
-  else if (flag_format == 'f') /* temporary tiff, later converted to pdf */
-    {
-#if HAVE_TIFF2PDF
-      if (tiff) 
-        {
-          if (! TIFFWriteDirectory(tiff))
-            die(i18n("Problem writing directory in temporary TIFF file."));
-        }
-      else
-        {
-          if (! strcmp(filename,"-"))
-            die(i18n("PDF output requires a valid output file name."));
-          if (! (tempfilename = (char*)malloc(strlen(outputfilename) + 8)))
-            die(i18n("Out of memory."));
-          strcpy(tempfilename, outputfilename);
-          strcat(tempfilename, ".XXXXXX");
-          tiff = 0;
-# ifdef _WIN32
-          if (_mktemp(tempfilename))
-            tiff = TIFFOpen(tempfilename,"w");
-# elif HAVE_MKSTEMP
-          if ((tiffd = mkstemp(tempfilename)) >= 0)
-            tiff = TIFFFdOpen(tiffd, tempfilename, "w");
-# else
-          if (mktemp(tempfilename))
-            if ((tiffd = open(tempfilename, O_RDWR|O_CREAT)) >= 0)
-              tiff = TIFFFdOpen(tiffd, tempfilename, "w");
-# endif
-          if (! tiff)
-            die(i18n("Cannot create temporary TIFF file '%s'."), tempfilename);
-        }
-#else
-      die(i18n("PDF output is not compiled"));
-#endif
-    } 
   else if (! fout) /* file output */
     {
       if (! strcmp(filename,"-")) {
@@ -640,6 +641,11 @@ openfile(int pageno)
       } else if (! (fout = fopen(filename, "wb")))
         die(i18n("Cannot open output file '%s'."), filename);
     }
+  if (flag_format == 'f' && ! pdf) /* pdf file */
+    {
+      if (! (pdf = pdfwriter_create(fout)))
+        die(i18n("Cannot create PDF file '%s'."), filename);
+    }
 }
 
 void
@@ -649,60 +655,15 @@ closefile(int pageno)
   if (pageno > 0 && ! flag_eachpage)
     return;
 
-  /* Compute filename */
-  const char *filename = outputfilename;
-  if (flag_eachpage && pageno > 0)
+  /* Finish pdf */
+  if (pdf)
     {
-      sprintf(pagefilename, filename, pageno);
-      filename = pagefilename;
+      const char *err = pdfwriter_finish(pdf);
+      pdfwriter_release(pdf);
+      pdf = 0;
+      if (err)
+        die(i18n("Error while writing PDF file: %s"), err);
     }
-
-  /* Close temporary tiff and generate pdf */
-#if HAVE_TIFF2PDF
-  if (tiff && tempfilename)
-    {
-      const char *args[3];
-      if (! TIFFFlush(tiff))
-        die(i18n("Error while flushing TIFF file."));
-      if (flag_verbose)
-        fprintf(stderr,i18n("Converting temporary TIFF to PDF.\n"));
-#ifndef _WIN32
-      if (tiffd >= 0)
-        {
-          int fd = dup(tiffd);
-          TIFFClose(tiff);
-          close(tiffd);
-          tiffd = fd;
-          lseek(tiffd, 0, SEEK_SET);
-          if (! (tiff = TIFFFdOpen(tiffd, tempfilename, "r")))
-            die(i18n("Cannot reopen temporary TIFF file '%s'."), tempfilename);
-        }
-      else
-#endif
-        {
-          TIFFClose(tiff);
-          if (!(tiff = TIFFOpen(tempfilename, "r")))
-            die(i18n("Cannot reopen temporary TIFF file '%s'."), tempfilename);
-        }
-      // Convert
-      if (! (fout = fopen(filename, "wb")))
-        die(i18n("Cannot open output file '%s'."), filename);
-      args[0] = programname;
-      args[1] = "-o";
-      args[2] = filename;
-      if (tiff2pdf(tiff, fout, 3, args) != EXIT_SUCCESS)
-        die(i18n("Error occurred while creating PDF file."));
-      TIFFClose(tiff);
-      tiff = 0;
-#ifndef _WIN32
-      close(tiffd);
-      tiffd = -1;
-#endif
-      remove(tempfilename);
-      free(tempfilename);
-      tempfilename = 0;
-    }
-#endif
   /* Close tiff */
 #if HAVE_TIFF
   if (tiff)
@@ -730,7 +691,28 @@ dopage(int pageno)
   ddjvu_page_t *page;
   /* Decode page */
   timingdata[0] = ticks();
-  if (! (page = ddjvu_page_create_by_pageno(doc, pageno-1)))
+  /* Pages rendered at a reduced size can decode their layers
+     at a lower resolution */
+  int subsample = 1;
+  ddjvu_pageinfo_t info;
+  ddjvu_status_t r;
+  while ((r = ddjvu_document_get_pageinfo(doc, pageno-1, &info)) < DDJVU_JOB_OK)
+    handle(TRUE);
+  if (r == DDJVU_JOB_OK && info.width > 0 && info.height > 0 && info.dpi > 0)
+    {
+      ddjvu_rect_t prect;
+      int iw = (info.rotation & 1) ? info.height : info.width;
+      int ih = (info.rotation & 1) ? info.width : info.height;
+      pagerect(iw, ih, info.dpi, prect);
+      if (prect.w > 0 && prect.h > 0)
+        subsample = (iw / prect.w < ih / prect.h) ? 
+          iw / prect.w : ih / prect.h;
+    }
+  if (subsample > 1)
+    page = ddjvu_page_create_preview(doc, pageno-1, subsample);
+  else
+    page = ddjvu_page_create_by_pageno(doc, pageno-1);
+  if (! page)
     die(i18n("Cannot access page %d."), pageno);
   while (! ddjvu_page_decoding_done(page))
     handle(TRUE);
@@ -885,7 +867,7 @@ usage()
          "Usage: ddjvu [options] [<djvufile> [<outputfile>]]\n\n"
          "Options:\n"
          "  -verbose          Print various informational messages.\n"
-         "  -format=FMT       Select output format: pbm,pgm,ppm,pnm,rle,tiff.\n"
+         "  -format=FMT       Select output format: pbm,pgm,ppm,pnm,rle,tiff,pdf.\n"
          "  -scale=N          Select display scale.\n"
          "  -size=WxH         Select size of rendered image.\n"
          "  -subsample=N      Select direct subsampling factor.\n"
@@ -898,7 +880,8 @@ usage()
          "  -page=PAGESPEC    Select page(s) to be decoded.\n"
          "  -skip             Skip corrupted pages instead of aborting.\n"
          "  -eachpage         Produce one file per page (using %d in outputfile).\n"
-         "  -quality=QUALITY  Specify jpeg quality for lossy tiff output.\n"
+         "  -quality=QUALITY  Specify jpeg quality for lossy tiff or pdf output.\n"
+         "  -profile[=FILE]   Print profiling counters, save trace events.\n"
          "\n"
          "If <outputfile> is a single dash or omitted, the decompressed image\n"
          "is sent to the standard output.  If <djvufile> is a single dash or\n"
@@ -990,6 +973,12 @@ parse_option(int argc, char **argv, int i)
         die(i18n(errarg), opt);
       flag_eachpage = 1;
     }
+  else if (! strcmp(opt,"profile"))
+    {
+      if (flag_profile)
+        die(i18n(errdupl), opt);
+      flag_profile = (arg) ? arg : "";
+    }
   else if (!strcmp(opt,"scale"))
     {
       if (!arg) 
@@ -1202,6 +1191,10 @@ main(int argc, char **argv)
   programname = argv[0];
   if (! (ctx = ddjvu_context_create(programname)))
     die(i18n("Cannot create djvu context."));
+  if (flag_profile)
+    ddjvu_profile_enable(ctx, (flag_profile[0]) ?
+                         DDJVU_PROFILE_COUNTERS | DDJVU_PROFILE_TRACE :
+                         DDJVU_PROFILE_COUNTERS);
   if (! (doc = ddjvu_document_create_by_filename(ctx, inputfilename, TRUE)))
     die(i18n("Cannot open djvu document '%s'."), inputfilename);
   while (! ddjvu_document_decoding_done(doc))
@@ -1216,6 +1209,26 @@ main(int argc, char **argv)
   /* Close output file */
   closefile(0);
 
+  /* Report profile */
+  if (flag_profile)
+    {
+      ddjvu_profile_t profile;
+      if (ddjvu_context_get_profile(ctx, &profile))
+        {
+          fprintf(stderr,i18n("Profile:\n"));
+          print_profile(&profile);
+        }
+      if (flag_profile[0])
+        {
+          FILE *f = fopen(flag_profile, "w");
+          if (! f)
+            die(i18n("Cannot open output file '%s'."), flag_profile);
+          if (! ddjvu_profile_save_trace(ctx, f))
+            die(i18n("Cannot write trace file '%s'."), flag_profile);
+          fclose(f);
+        }
+    }
+
   /* Release */
   if (doc)
     ddjvu_document_release(doc);
@@ -86,6 +86,9 @@ ddjvu_context_t *ctx;
 ddjvu_document_t *doc;
 ddjvu_job_t *job;
 
+/* Unlike the library, use one thread per processor by default. */
+char threads_default[] = "-threads=0";
+
 void
 progress(int p)
 {
@@ -165,6 +168,7 @@ const char *options[] = {
   I18N("-colormatch=<yes|no>                (default: yes)"),
   I18N("-gamma=<0.3...5.0>                  (default: 2.2)"),
   I18N("-copies=<1...999999>                (default: 1)"),
+  I18N("-threads=<0...256>                  (default: 0)"),
   I18N("-frame=<yes|no>                     (default: no)"),
   I18N("-cropmarks=<yes|no>                 (default: no)"),
 #ifdef THIS_THING_DOES_NOT_WORK_WITH_UTF8_STRINGS
@@ -232,8 +236,9 @@ main(int argc, char **argv)
   _setmbcp(_MB_CP_OEM);
 #endif
   /* Sort options */
-  if (! (optv = (char**)malloc(argc*sizeof(char*))))
+  if (! (optv = (char**)malloc((argc+1)*sizeof(char*))))
     die(i18n("Out of memory"));
+  optv[optc++] = threads_default;
   for (i=1; i<argc; i++)
     {
       char *s = argv[i];
@@ -67,6 +67,7 @@
 #include "DjVuMessageLite.h"
 #include "BSByteStream.h"
 #include "DjVuText.h"
+#include "DjVuTextIndex.h"
 #include "DjVuAnno.h"
 #include "DjVuInfo.h"
 #include "IFFByteStream.h"
@@ -2104,7 +2105,27 @@ command_save_indirect(ParsingByteStream &pbs)
 }
 
 void
-command_save(void)
+command_save_txt_index(ParsingByteStream &pbs)
+{
+  GUTF8String fname = pbs.get_token();
+  if (! fname) 
+    verror("empty filename");
+  GP<DjVuTextIndex> index = DjVuTextIndex::create();
+  index->add_document(*g().doc);
+  if (nosave) 
+    vprint("save-txt-index: not saving anything (-n was specified)");
+  else
+    {
+      GP<ByteStream> out = 
+        ByteStream::create(GURL::Filename::UTF8(fname), "wb");
+      index->encode(out);
+    }
+  vprint("save-txt-index: %d words in %d pages", 
+         index->get_words_num(), index->get_pages_num());
+}
+
+void
+command_save(bool incremental=false)
 {
   if (!g().doc->can_be_saved())
     verror("cannot save old format (use save-bundled or save-indirect)");
@@ -2112,6 +2133,8 @@ command_save(void)
     vprint("save: not saving anything (-n was specified)");
   else if (!modified)
     vprint("save: document was not modified");
+  else if (incremental)
+    g().doc->save_incremental();
   else 
     g().doc->save();
   modified = false;
@@ -2123,6 +2146,12 @@ command_save(ParsingByteStream &)
   command_save();
 }
 
+void
+command_save_incremental(ParsingByteStream &)
+{
+  command_save(true);
+}
+
 void
 command_help(void)
 {
@@ -2174,7 +2203,9 @@ command_help(void)
           " . save-page-with <name>  -- saves selected page/file, inserting all included files\n"
           " _ save-bundled <name>    -- saves as bundled document under fname\n"
           " _ save-indirect <name>   -- saves as indirect document under fname\n"
+          " _ save-txt-index <name>  -- saves a full text index of the hidden text\n"
           " _ save                   -- saves in-place\n"
+          " _ save-incremental       -- saves in-place, writing only what has changed\n"
           " _ help                   -- prints this message\n"
           "\n"
           "Interactive example:\n"
@@ -2243,7 +2274,9 @@ static GMap<GUTF8String,CommandFunc> &command_map() {
     xcommand_map["save-page-with"] = command_save_page_with;
     xcommand_map["save-bundled"] = command_save_bundled;
     xcommand_map["save-indirect"] = command_save_indirect;
+    xcommand_map["save-txt-index"] = command_save_txt_index;
     xcommand_map["save"] = command_save;
+    xcommand_map["save-incremental"] = command_save_incremental;
     xcommand_map["help"] = command_help;
   }
   return xcommand_map;
@@ -73,6 +73,24 @@
 
 #include <sys/stat.h>
 #include <time.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifdef UNIX
+# include <sys/types.h>
+# include <sys/socket.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <arpa/inet.h>
+# include <netdb.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <signal.h>
+# include <unistd.h>
+# ifdef __linux__
+#  include <sys/sendfile.h>
+# endif
+#endif
 
 
 static bool cgi = false;
@@ -113,7 +131,14 @@ usage(void)
           "directory pointing to the other component files.\n"
           "This program is designed to be used as a CGI executable.\n"
           "It uses environment variable PATH_TRANSLATED when executed\n"
-          "without arguments.\n\n" );
+          "without arguments.\n"
+#ifdef UNIX
+          "\n"
+          "Usage: djvuserve -listen=[<addr>:]<port> [<directory>]\n"
+          "Runs a standalone HTTP/1.1 server for the files located\n"
+          "under <directory> (default: current directory).\n"
+#endif
+          "\n" );
    exit(10);
 }
 
@@ -140,16 +165,22 @@ month_name(int d)
    return "???";
 }
 
-void
-fprintdate(FILE *f, const char *fmt, const time_t *tim)
+static void
+formatdate(char *ctim, const time_t *tim)
 {
-  char ctim[128];
   struct tm *ttim = gmtime(tim);
   /* strftime(ctim, sizeof(ctim)-1, "%a, %d %b %Y %H:%M:%S GMT", ttim); */
   sprintf(ctim,"%3s, %02d %3s %04d %02d:%02d:%02d GMT",
 	  day_name(ttim->tm_wday), ttim->tm_mday,
 	  month_name(ttim->tm_mon), 1900+ttim->tm_year,
 	  ttim->tm_hour, ttim->tm_min, ttim->tm_sec);
+}
+
+void
+fprintdate(FILE *f, const char *fmt, const time_t *tim)
+{
+  char ctim[128];
+  formatdate(ctim, tim);
   fprintf(stdout, fmt, ctim);
 }
 
@@ -226,6 +257,21 @@ djvuserver_file(GURL pathurl, bool bundled, bool download)
   out->copy(*in);
 }
 
+static GP<ByteStream>
+make_index(const GP<DjVmDir> &dir)
+{
+  GP<ByteStream> temp;
+  GP<ByteStream> bsdir = ByteStream::create();
+  GP<IFFByteStream> iff = IFFByteStream::create(bsdir);
+  iff->put_chunk("FORM:DJVM",1);
+  iff->put_chunk("DIRM");
+  temp = iff->get_bytestream();
+  dir->encode(temp, false, false);
+  iff->close_chunk();
+  iff->close_chunk();
+  return bsdir;
+}
+
 void 
 djvuserver_directory(GURL pathurl)
 {
@@ -253,16 +299,7 @@ djvuserver_directory(GURL pathurl)
       G_THROW( "This is not a bundled DjVu document" );
   }
   // Assemble index of indirect multipage file
-  GP<ByteStream> bsdir = ByteStream::create();
-  {
-    GP<IFFByteStream> iff = IFFByteStream::create(bsdir);
-    iff->put_chunk("FORM:DJVM",1);
-    iff->put_chunk("DIRM");
-    temp = iff->get_bytestream();
-    dir->encode(temp, false, false);
-    iff->close_chunk();
-    iff->close_chunk();
-  }
+  GP<ByteStream> bsdir = make_index(dir);
   // HTTP output
   statbuf.st_size = bsdir->tell();
   headers(&statbuf);
@@ -343,12 +380,646 @@ search_cgi_arg(const char *name)
 }
 
 
+#ifdef UNIX
+
+// ----------------------------------------
+// Standalone HTTP server.
+// Serves the same urls as the CGI program over persistent HTTP/1.1
+// connections handled by a single poll() loop.  The directories of
+// the bundled documents are decoded once and kept in memory together
+// with an open file descriptor used to send the component files.
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+static const int max_documents = 64;
+static const int max_request = 16384;
+static const int keepalive_timeout = 30;
+
+class ServedDocument : public GPEnabled
+{
+public:
+  ~ServedDocument();
+  static GP<ServedDocument> create(const GURL &url);
+  int fd;
+  time_t mtime;
+  long size;
+  ino_t ino;
+  GP<DjVmDir> dir;              // Bundled documents only
+  GP<ByteStream> index;         // Bundled documents only
+private:
+  ServedDocument(void) : fd(-1), mtime(0), size(0), ino(0) {}
+};
+
+ServedDocument::~ServedDocument()
+{
+  if (fd >= 0)
+    close(fd);
+}
+
+GP<ServedDocument>
+ServedDocument::create(const GURL &url)
+{
+  ServedDocument *doc = new ServedDocument();
+  GP<ServedDocument> gdoc = doc;
+  GNativeString fname = url.NativeFilename();
+  struct stat statbuf;
+  doc->fd = open((const char *)fname, O_RDONLY);
+  if (doc->fd < 0 || fstat(doc->fd, &statbuf) < 0)
+    G_THROW(strerror(errno));
+  doc->mtime = statbuf.st_mtime;
+  doc->size = statbuf.st_size;
+  doc->ino = statbuf.st_ino;
+  // Decode the directory of bundled documents
+  if (is_djvu_file_bundled(const_cast<GURL&>(url)))
+    {
+      GP<ByteStream> bsin = ByteStream::create(url,"rb");
+      GP<IFFByteStream> iffin = IFFByteStream::create(bsin);
+      GUTF8String chkid;
+      iffin->get_chunk(chkid);
+      while (iffin->get_chunk(chkid) && chkid!="DIRM")
+        iffin->close_chunk();
+      doc->dir = DjVmDir::create();
+      doc->dir->decode(iffin->get_bytestream());
+      doc->index = make_index(doc->dir);
+    }
+  return gdoc;
+}
+
+static GPMap<GUTF8String,ServedDocument> &
+documents(void)
+{
+  static GPMap<GUTF8String,ServedDocument> m;
+  return m;
+}
+
+static GP<ServedDocument>
+get_document(const GURL &url)
+{
+  GNativeString fname = url.NativeFilename();
+  struct stat statbuf;
+  if (stat((const char *)fname, &statbuf) < 0)
+    G_THROW(strerror(errno));
+  const GUTF8String key = url.get_string();
+  GPosition pos = documents().contains(key);
+  if (pos)
+    {
+      GP<ServedDocument> doc = documents()[pos];
+      if (doc->mtime == statbuf.st_mtime && doc->size == statbuf.st_size
+          && doc->ino == statbuf.st_ino)
+        return doc;
+    }
+  if (documents().size() >= max_documents)
+    documents().empty();
+  GP<ServedDocument> doc = ServedDocument::create(url);
+  documents()[key] = doc;
+  return doc;
+}
+
+static time_t
+parsedate(const char *s)
+{
+  char wday[4], mon[4];
+  int d, y, hh, mm, ss, m;
+  if (sscanf(s, "%3s, %d %3s %d %d:%d:%d", wday, &d, mon, &y, &hh, &mm, &ss) < 7)
+    return 0;
+  for (m=0; m<12; m++)
+    if (! strcmp(mon, month_name(m)))
+      break;
+  if (m >= 12 || y < 1970)
+    return 0;
+  // Days since the epoch in the proleptic gregorian calendar
+  m += 1;
+  y -= (m <= 2);
+  long yoe = y % 400;
+  long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  long days = (y / 400) * 146097 + doe - 719468;
+  return (time_t)(days * 86400 + hh * 3600 + mm * 60 + ss);
+}
+
+struct ServedReply
+{
+  ServedReply(void) : status(200), foff(0), flen(0), mtime(0) {}
+  int status;
+  GUTF8String headers;          // Additional header lines
+  GP<ByteStream> body;          // Data sent first
+  GP<ServedDocument> doc;       // File data sent after the body
+  long foff;
+  long flen;
+  time_t mtime;
+};
+
+class ServedConnection : public GPEnabled
+{
+public:
+  ServedConnection(int xfd)
+    : fd(xfd), last(time(0)), inlen(0), outpos(0),
+      foff(0), flen(0), keepalive(true) {}
+  ~ServedConnection() { close(fd); }
+  bool pending(void) const { return outpos < out.size() || flen > 0; }
+  int fd;
+  time_t last;
+  char in[max_request];
+  int inlen;
+  TArray<char> out;
+  int outpos;
+  GP<ServedDocument> doc;
+  long foff;
+  long flen;
+  bool keepalive;
+};
+
+static const char *
+status_name(int status)
+{
+  switch(status)
+    {
+    case 200: return "OK";
+    case 206: return "Partial Content";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 416: return "Range Not Satisfiable";
+    default:  return "Bad Request";
+    }
+}
+
+static void
+serve_error(ServedReply &reply, int status, const GUTF8String &cause,
+            const GUTF8String &target)
+{
+  reply = ServedReply();
+  reply.status = status;
+  reply.headers = "Content-Type: text/html\r\n";
+  reply.body = ByteStream::create();
+  reply.body->writestring(GUTF8String(
+      "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\n"
+      "<HTML><HEAD><TITLE>") + GUTF8String(status) + " "
+      + status_name(status) + "</TITLE></HEAD><BODY>\n<H1>"
+      + cause.toEscaped() + "</H1>The requested URL '"
+      + target.toEscaped() + "' cannot be processed.<P>\n"
+#ifdef DJVULIBRE_VERSION
+      "<HR><ADDRESS>djvuserve/DjVuLibre-" DJVULIBRE_VERSION "</ADDRESS>\n"
+#endif
+      "</BODY></HTML>\n");
+}
+
+static void
+serve_path(ServedReply &reply, const GUTF8String &path)
+{
+  bool bundled = search_cgi_arg("bundled");
+  bool download = false;
+  if (search_cgi_arg("download") || search_cgi_arg("bundle"))
+    bundled = download = true;
+  GURL pathurl = GURL::Filename::UTF8(g().pathtranslated + path);
+  GUTF8String id;
+  if (! pathurl.is_file())
+    {
+      id = pathurl.fname();
+      pathurl = pathurl.base();
+      if (! pathurl.is_file())
+        G_THROW("File not found");
+    }
+  GP<ServedDocument> doc = get_document(pathurl);
+  reply.mtime = doc->mtime;
+  reply.headers = "Content-Type: image/x.djvu\r\n";
+  if (id.length() && !doc->dir)
+    G_THROW( "This is not a bundled DjVu document" );
+  if (id.length() && id != "index" && id != "index.djvu")
+    {
+      GP<DjVmDir::File> frec = doc->dir->id_to_file(id);
+      if (!frec)
+        G_THROW( "Cannot locate requested component file" );
+      if (!frec->size || !frec->offset || frec->offset + frec->size > doc->size)
+        G_THROW( "Corrupted DjVu directory" );
+      reply.body = ByteStream::create("AT&T", 4);
+      reply.doc = doc;
+      reply.foff = frec->offset;
+      reply.flen = frec->size;
+    }
+  else if (id.length() && !bundled)
+    {
+      reply.body = doc->index;
+    }
+  else if (doc->dir && !bundled)
+    {
+      reply.status = 302;
+      reply.headers = "Location: " + pathurl.name() + "/index.djvu";
+      if (g().querystring.length())
+        reply.headers += "?" + g().querystring;
+      reply.headers += "\r\n";
+      reply.mtime = 0;
+    }
+  else
+    {
+      if (download)
+        reply.headers += "Content-Disposition: attachment; filename=\""
+          + pathurl.fname() + "\"\r\n";
+      reply.doc = doc;
+      reply.foff = 0;
+      reply.flen = doc->size;
+    }
+}
+
+static GUTF8String
+longstring(long n)
+{
+  // GUTF8String(int) would truncate sizes above 2GB
+  char buffer[32];
+  sprintf(buffer, "%ld", n);
+  return GUTF8String(buffer);
+}
+
+static bool
+parse_range(const char *s, long total, long &first, long &last)
+{
+  while (isspace(*s))
+    s++;
+  if (strncmp(s, "bytes=", 6) || strchr(s, ','))
+    return false;
+  s += 6;
+  char *e;
+  if (*s == '-')
+    {
+      long n = strtol(s+1, &e, 10);
+      if (e == s+1 || n <= 0)
+        return false;
+      first = (n < total) ? total - n : 0;
+      last = total - 1;
+      return true;
+    }
+  long f = strtol(s, &e, 10);
+  if (e == s || *e != '-')
+    return false;
+  s = e + 1;
+  long l = total - 1;
+  if (isdigit(*s))
+    {
+      long n = strtol(s, &e, 10);
+      // An invalid range is ignored (RFC 7233, section 3.1)
+      if (n < f)
+        return false;
+      if (n < l)
+        l = n;
+    }
+  first = f;
+  last = l;
+  return true;
+}
+
+static void
+send_reply(ServedConnection &c, ServedReply &reply, bool head,
+           const char *range, const char *ims)
+{
+  long blen = (reply.body) ? reply.body->size() : 0;
+  long total = blen + reply.flen;
+  long first = 0;
+  long last = total - 1;
+  if (reply.status == 200 && ims && reply.mtime && parsedate(ims) >= reply.mtime)
+    {
+      reply.status = 304;
+      head = true;
+    }
+  else if (reply.status == 200 && range && parse_range(range, total, first, last))
+    {
+      if (first > last)
+        {
+          reply.status = 416;
+          reply.headers = GUTF8String("Content-Range: bytes */") + longstring(total) + "\r\n";
+          reply.body = 0;
+          reply.flen = 0;
+          total = blen = first = 0;
+          last = -1;
+        }
+      else
+        {
+          reply.status = 206;
+          reply.headers += GUTF8String("Content-Range: bytes ") + longstring(first)
+            + "-" + longstring(last) + "/" + longstring(total) + "\r\n";
+        }
+    }
+  // Header
+  char date[128];
+  time_t now = time(0);
+  GP<ByteStream> out = ByteStream::create();
+  out->writestring(GUTF8String("HTTP/1.1 ") + GUTF8String(reply.status)
+                   + " " + status_name(reply.status) + "\r\n");
+  formatdate(date, &now);
+  out->writestring(GUTF8String("Date: ") + date + "\r\n");
+#ifdef DJVULIBRE_VERSION
+  out->writestring(GUTF8String("Server: djvuserve/DjVuLibre-" DJVULIBRE_VERSION "\r\n"));
+#endif
+  out->writestring(GUTF8String(c.keepalive ? "Connection: keep-alive\r\n"
+                               : "Connection: close\r\n"));
+  if (reply.mtime)
+    {
+      time_t tim = now + 360 * 24 * 3600;
+      formatdate(date, &reply.mtime);
+      out->writestring(GUTF8String("Last-Modified: ") + date + "\r\n");
+      formatdate(date, &tim);
+      out->writestring(GUTF8String("Expires: ") + date + "\r\n");
+      out->writestring(GUTF8String("Accept-Ranges: bytes\r\n"));
+    }
+  if (reply.status != 304)
+    out->writestring(GUTF8String("Content-Length: ")
+                     + longstring(last + 1 - first) + "\r\n");
+  out->writestring(reply.headers);
+  out->writestring(GUTF8String("\r\n"));
+  // Data from memory
+  if (! head && first < blen)
+    {
+      reply.body->seek(first);
+      out->copy(*reply.body, ((last < blen) ? last + 1 : blen) - first);
+    }
+  out->seek(0);
+  c.out = out->get_data();
+  c.outpos = 0;
+  // Data from file
+  c.doc = 0;
+  c.flen = 0;
+  if (! head && last >= blen)
+    {
+      c.doc = reply.doc;
+      c.foff = reply.foff + ((first > blen) ? first - blen : 0);
+      c.flen = reply.foff + (last + 1 - blen) - c.foff;
+    }
+}
+
+static void
+serve_request(ServedConnection &c, char *request)
+{
+  // Request line
+  char *line = request;
+  char *next = strchr(line, '\n');
+  *next++ = 0;
+  char *method = strtok(line, " \t\r");
+  char *target = strtok(0, " \t\r");
+  char *version = strtok(0, " \t\r");
+  if (!version || strncmp(version, "HTTP/1.", 7))
+    c.keepalive = false;
+  else if (version[7] == '0')
+    c.keepalive = false;
+  // Header lines
+  const char *range = 0;
+  const char *ims = 0;
+  for (line = next; line && *line; line = next)
+    {
+      next = strchr(line, '\n');
+      if (next)
+        *next++ = 0;
+      char *value = strchr(line, ':');
+      if (! value)
+        continue;
+      *value++ = 0;
+      while (isspace(*value))
+        value++;
+      char *e = value + strlen(value);
+      while (e > value && isspace(e[-1]))
+        *--e = 0;
+      if (! strcasecmp(line, "Range"))
+        range = value;
+      else if (! strcasecmp(line, "If-Modified-Since"))
+        ims = value;
+      else if (! strcasecmp(line, "Connection"))
+        {
+          if (! strcasecmp(value, "close"))
+            c.keepalive = false;
+          else if (! strcasecmp(value, "keep-alive"))
+            c.keepalive = true;
+        }
+    }
+  // Reply
+  ServedReply reply;
+  GUTF8String path;
+  bool head = (method && !strcmp(method, "HEAD"));
+  G_TRY
+    {
+      if (!method || !target || target[0] != '/')
+        {
+          c.keepalive = false;
+          G_THROW("Malformed request");
+        }
+      if (!head && strcmp(method, "GET"))
+        {
+          serve_error(reply, 405, "Only serve HEAD and GET requests", target);
+          reply.headers += "Allow: GET, HEAD\r\n";
+        }
+      else
+        {
+          char *query = strchr(target, '?');
+          g().querystring = (query) ? query + 1 : "";
+          path = GURL::decode_reserved((query) ? GUTF8String(target, query - target)
+                                       : GUTF8String(target));
+          if (path.search("/../") >= 0 || path.rsearch("/..") == (int)path.length() - 3)
+            serve_error(reply, 404, "File not found", target);
+          else
+            serve_path(reply, path);
+        }
+    }
+  G_CATCH(ex)
+    {
+      GUTF8String cause = DjVuMessageLite::LookUpUTF8(ex.get_cause());
+      serve_error(reply, (cause == "File not found") ? 404 : 400,
+                  cause, (target) ? target : "");
+    }
+  G_ENDCATCH;
+  send_reply(c, reply, head, range, ims);
+}
+
+static void
+serve_requests(ServedConnection &c)
+{
+  while (c.keepalive && !c.pending())
+    {
+      // Locate the end of the request header
+      int n = 0;
+      for (int i = 0; i + 1 < c.inlen && !n; i++)
+        if (c.in[i] == '\n')
+          {
+            if (c.in[i+1] == '\n')
+              n = i + 2;
+            else if (c.in[i+1] == '\r' && i + 2 < c.inlen && c.in[i+2] == '\n')
+              n = i + 3;
+          }
+      if (! n)
+        {
+          if (c.inlen >= max_request)
+            {
+              ServedReply reply;
+              c.keepalive = false;
+              serve_error(reply, 400, "Request too long", "");
+              send_reply(c, reply, false, 0, 0);
+            }
+          return;
+        }
+      char request[max_request+1];
+      memcpy(request, c.in, n);
+      request[n] = 0;
+      memmove(c.in, c.in + n, c.inlen - n);
+      c.inlen -= n;
+      serve_request(c, request);
+    }
+}
+
+// Returns false when the connection must be closed.
+static bool
+serve_output(ServedConnection &c)
+{
+  for (;;)
+    {
+      while (c.outpos < c.out.size())
+        {
+          ssize_t n = send(c.fd, &c.out[c.outpos], c.out.size() - c.outpos, MSG_NOSIGNAL);
+          if (n < 0)
+            return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+          c.outpos += n;
+        }
+      if (c.flen <= 0)
+        break;
+#ifdef __linux__
+      off_t off = c.foff;
+      ssize_t n = sendfile(c.fd, c.doc->fd, &off, (c.flen < 0x100000) ? c.flen : 0x100000);
+      if (n < 0)
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+#else
+      char buffer[65536];
+      ssize_t n = pread(c.doc->fd, buffer, (c.flen < (long)sizeof(buffer))
+                        ? c.flen : sizeof(buffer), c.foff);
+      if (n > 0)
+        {
+          c.out.resize(0, n - 1);
+          memcpy(&c.out[0], buffer, n);
+          c.outpos = 0;
+        }
+#endif
+      if (n <= 0)
+        return false;
+      c.foff += n;
+      c.flen -= n;
+    }
+  c.doc = 0;
+  if (! c.keepalive)
+    return false;
+  serve_requests(c);
+  return c.keepalive || c.pending();
+}
+
+static void
+djvuserver_listen(const GUTF8String &spec)
+{
+  GUTF8String host, port = spec;
+  int colon = spec.rsearch(':');
+  if (colon >= 0)
+    {
+      host = spec.substr(0, colon);
+      port = spec.substr(colon + 1, -1);
+    }
+  struct addrinfo hints, *ai = 0;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  int err = getaddrinfo(host.length() ? (const char*)host : 0, port, &hints, &ai);
+  if (err)
+    G_THROW(gai_strerror(err));
+  int lfd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+  int one = 1;
+  if (lfd >= 0)
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (lfd < 0 || bind(lfd, ai->ai_addr, ai->ai_addrlen) < 0 || listen(lfd, 128) < 0)
+    {
+      freeaddrinfo(ai);
+      G_THROW(strerror(errno));
+    }
+  freeaddrinfo(ai);
+  fcntl(lfd, F_SETFL, fcntl(lfd, F_GETFL) | O_NONBLOCK);
+  signal(SIGPIPE, SIG_IGN);
+  // Event loop
+  GPList<ServedConnection> conns;
+  TArray<struct pollfd> fds;
+  for (;;)
+    {
+      int nfds = 1;
+      fds.resize(0, conns.size());
+      fds[0].fd = lfd;
+      fds[0].events = POLLIN;
+      for (GPosition p = conns; p; ++p, ++nfds)
+        {
+          fds[nfds].fd = conns[p]->fd;
+          fds[nfds].events = (conns[p]->pending()) ? POLLOUT : POLLIN;
+          fds[nfds].revents = 0;
+        }
+      if (poll(&fds[0], nfds, 1000) < 0 && errno != EINTR)
+        G_THROW(strerror(errno));
+      time_t now = time(0);
+      // Existing connections
+      GPosition p = conns;
+      for (int i = 1; i < nfds; i++)
+        {
+          GPosition cur = p;
+          ++p;
+          ServedConnection &c = *conns[cur];
+          bool keep = true;
+          if (fds[i].revents & POLLIN)
+            {
+              ssize_t n = recv(c.fd, c.in + c.inlen, max_request - c.inlen, 0);
+              if (n > 0)
+                {
+                  c.inlen += n;
+                  c.last = now;
+                  serve_requests(c);
+                  keep = (c.keepalive || c.pending());
+                }
+              else if (n == 0 || (errno != EAGAIN && errno != EINTR))
+                keep = false;
+            }
+          if (keep && c.pending())
+            {
+              keep = serve_output(c);
+              c.last = now;
+            }
+          else if (fds[i].revents & (POLLERR|POLLHUP|POLLNVAL))
+            keep = false;
+          if (! keep || (!c.pending() && now - c.last > keepalive_timeout))
+            conns.del(cur);
+        }
+      // New connections
+      if (fds[0].revents & POLLIN)
+        for (;;)
+          {
+            int fd = accept(lfd, 0, 0);
+            if (fd < 0)
+              break;
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            conns.append(new ServedConnection(fd));
+          }
+    }
+}
+
+#endif /* UNIX */
+
+
 int
 main(int argc, char ** argv)
 {
   DJVU_LOCALE;
   G_TRY 
     {
+#ifdef UNIX
+      // Standalone server
+      if ((argc == 2 || argc == 3) && !strncmp(argv[1], "-listen=", 8))
+        {
+          g().pathtranslated = GNativeString((argc == 3) ? argv[2] : ".");
+          int l = g().pathtranslated.length();
+          if (l > 1 && g().pathtranslated[l-1] == '/')
+            g().pathtranslated = g().pathtranslated.substr(0, l-1);
+          djvuserver_listen(GNativeString(argv[1] + 8));
+        }
+#endif
       // Obtain path
       bool bundled = false;
       bool download = false;
@@ -91,6 +91,7 @@ const char *outputfilename = 0;
 const char *detail = 0;
 const char *pagespec = 0;
 int escape = 0;
+int stream = 0;
 
 ddjvu_context_t *ctx;
 ddjvu_document_t *doc;
@@ -140,7 +141,32 @@ die(const char *fmt, ...)
 
 
 void
-dopage(int pageno)
+print_text(const char *s, size_t len)
+{
+  if (! escape)
+    fwrite(s, 1, len, stdout);
+  else
+    {
+      unsigned char c;
+      while (len-- > 0)
+        {
+          bool esc = false;
+          c = *(unsigned char*)s++;
+          if (c == '\\' || c >= 0x7f)
+            esc = true; /* non-ascii */
+          if (c < 0x20 && !strchr("\013\035\037\012", c))
+            esc = true; /* non-printable other than separators */
+          if (esc)
+            printf("\\%03o", c);
+          else
+            putc(c, stdout);
+        }
+    }
+}
+
+
+void
+dopage_miniexp(int pageno)
 {
   miniexp_t r = miniexp_nil;
   const char *lvl = (detail) ? detail : "page";
@@ -160,30 +186,110 @@ dopage(int pageno)
     }
   else if ((r = miniexp_nth(5, r)) && miniexp_stringp(r))
     {
-      const char *s = miniexp_to_str(r); 
-      if (! escape)
-        fputs(s, stdout);
-      else
-        {
-          unsigned char c;
-          while ((c = *(unsigned char*)s++))
-            {
-              bool esc = false;
-              if (c == '\\' || c >= 0x7f)
-                esc = true; /* non-ascii */
-              if (c < 0x20 && !strchr("\013\035\037\012", c))
-                esc = true; /* non-printable other than separators */
-              if (esc)
-                printf("\\%03o", c);
-              else
-                putc(c, stdout);
-            }
-        }
+      const char *s = 0;
+      size_t len = miniexp_to_lstr(r, &s);
+      print_text(s, len);
       fputs("\n\f", stdout);
     }
 }
 
 
+/* Streaming output with ddjvu_document_visit_pagetext().
+   No s-expression is allocated. Option -detail prints 
+   one zone per line with the same syntax as the
+   s-expressions produced by ddjvu_document_get_pagetext(). */
+
+int streamdepth = 0;
+int streamtext = 0;
+
+int
+stream_begin(void *, const char *zone, int xmin, int ymin, int xmax, int ymax)
+{
+  if (streamdepth > 0)
+    putc('\n', stdout);
+  for (int i=0; i<streamdepth; i++)
+    putc(' ', stdout);
+  printf("(%s %d %d %d %d", zone, xmin, ymin, xmax, ymax);
+  streamdepth += 1;
+  return ferror(stdout);
+}
+
+int
+stream_string(void *, const char *data, size_t len)
+{
+  static const char *tr1 = "\"\\tnrbf";
+  static const char *tr2 = "\"\\\t\n\r\b\f";
+  putc(' ', stdout);
+  putc('\"', stdout);
+  while (len-- > 0)
+    {
+      unsigned char c = *(unsigned char*)data++;
+      const char *t = (c) ? strchr(tr2, c) : 0;
+      if (t)
+        printf("\\%c", tr1[t - tr2]);
+      else if (c < 0x20 || c == 0x7f || (escape && c >= 0x80))
+        printf("\\%03o", c);
+      else
+        putc(c, stdout);
+    }
+  putc('\"', stdout);
+  return ferror(stdout);
+}
+
+int
+stream_end(void *, const char *)
+{
+  putc(')', stdout);
+  streamdepth -= 1;
+  if (streamdepth == 0)
+    putc('\n', stdout);
+  return ferror(stdout);
+}
+
+int
+stream_text(void *, const char *data, size_t len)
+{
+  print_text(data, len);
+  streamtext = 1;
+  return ferror(stdout);
+}
+
+void
+dopage_stream(int pageno)
+{
+  ddjvu_status_t r;
+  ddjvu_pagetext_visitor_t visitor;
+  memset(&visitor, 0, sizeof(visitor));
+  if (detail)
+    {
+      visitor.begin_zone = stream_begin;
+      visitor.text = stream_string;
+      visitor.end_zone = stream_end;
+    }
+  else
+    visitor.text = stream_text;
+  const char *lvl = (detail) ? detail : "page";
+  streamdepth = streamtext = 0;
+  while ((r = ddjvu_document_visit_pagetext(doc,pageno-1,lvl,&visitor,0))
+         == DDJVU_JOB_STARTED)
+    handle(TRUE);
+  if (r == DDJVU_JOB_STOPPED)
+    die(i18n("cannot write output."));
+  if (streamtext)
+    fputs("\n\f", stdout);
+}
+
+
+void
+dopage(int pageno)
+{
+  if (stream)
+    dopage_stream(pageno);
+  else
+    dopage_miniexp(pageno);
+}
+
+
 void
 parse_pagespec(const char *s, int max_page, void (*dopage)(int))
 {
@@ -268,7 +374,10 @@ usage()
          "                   <line>,<word>, or <char> specify the finest\n"
          "                   level of detail. Default is <char>.\n"
          " -escape           Output octal escape sequences for all\n"
-         "                   non ASCII UTF-8 characters.\n\n") );
+         "                   non ASCII UTF-8 characters.\n"
+         " -stream           Write the text while walking the text zones\n"
+         "                   without building S-expressions. This uses\n"
+         "                   constant memory on large documents.\n\n") );
   /* Terminate */
   exit(10);
 }
@@ -326,6 +435,8 @@ main(int argc, char **argv)
             }
           else if (!strcmp(opt, "escape") && !arg)
             escape = 1;
+          else if (!strcmp(opt, "stream") && !arg)
+            stream = 1;
           else
             die(i18n("unrecognized option %s."), s);
         }
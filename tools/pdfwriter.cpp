@@ -0,0 +1,1266 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C-
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free,
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU
+//C- | General Public License.   This grant only confers the right to
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to
+//C- | the extent such infringement is reasonably necessary to enable
+//C- | recipient to make, have made, practice, sell, or otherwise dispose
+//C- | of the LIZARDTECH ORIGINAL CODE, and not to infringe any patent
+//C- | claims of any other party.   In no event shall this grant
+//C- | constitute the rights to relicense this code or any part of it.
+//C- | See the GNU General Public License, Version 2, for more details.
+//C- +------------------------------------------------------------------
+
+
+/* Streaming PDF writer for ddjvu (see pdfwriter.h).
+
+   Objects are written in order of creation.  The length of each
+   stream is written as a separate object after the stream data, so
+   that image data can be compressed directly into the output file
+   without knowing its size in advance.  The page tree is written
+   when the file is finished, followed by the cross reference table. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+// The ddjvuapi structures are declared in the DJVU namespace
+// like in ddjvuapi.cpp, so that ddjvu_get_DjVuImage() links.
+namespace DJVU {
+  struct ddjvu_context_s;
+  struct ddjvu_document_s;
+  struct ddjvu_page_s;
+  struct ddjvu_format_s;
+}
+using namespace DJVU;
+
+#include "GString.h"
+#include "GException.h"
+#include "GContainer.h"
+#include "Arrays.h"
+#include "ByteStream.h"
+#include "FlateByteStream.h"
+#include "MMREncoder.h"
+#include "GBitmap.h"
+#include "GPixmap.h"
+#include "JB2Image.h"
+#include "IW44Image.h"
+#include "DjVuPalette.h"
+#include "DjVuInfo.h"
+#include "DjVuImage.h"
+
+// Included after DjVuImage.h to declare ddjvu_get_DjVuImage()
+#include "pdfwriter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#if HAVE_JPEG
+# include <setjmp.h>
+extern "C" {
+# undef HAVE_STDLIB_H
+# undef HAVE_STDDEF_H
+# define INT32 jpeg_INT32
+# define INT16 jpeg_INT16
+# include <jconfig.h>
+# include <jpeglib.h>
+# include <jerror.h>
+# undef FAR
+# undef INT32
+# undef INT16
+}
+#endif
+
+
+// Background layers of compound pages are rendered
+// with this subsampling, like the DjVu encoders do.
+static const int bg_subsample = 3;
+
+// Foreground colors of compound pages are averaged 
+// over cells of this size.
+static const int fg_subsample = 4;
+
+// Approximate size of the band buffers.
+static const int band_bytes = 1 << 20;
+
+// JPEG quality used when option -quality does not specify one.
+static const int jpeg_quality = 80;
+
+// Continuous tone images with at most this many colors are deflated.
+static const int few_colors = 256;
+
+enum { PDF_RAW, PDF_FLATE, PDF_DCT, PDF_G4 };
+
+// Chooses the compression of a continuous tone image.  Photographic
+// images are JPEG compressed and images with few colors are deflated,
+// unless option -quality explicitly selects a compression.
+static int
+tone_filter(int quality, bool fewcolors)
+{
+  if (quality >= 1000)
+    return PDF_RAW;
+#if HAVE_JPEG
+  if (quality > 0 && quality < 900)
+    return PDF_DCT;
+  if (quality <= 0 && !fewcolors)
+    return PDF_DCT;
+#endif
+  return PDF_FLATE;
+}
+
+// Tells whether a pixmap contains at most n distinct colors.
+static bool
+has_few_colors(const GPixmap &pm, int n)
+{
+  GMap<unsigned int,int> seen;
+  unsigned int last = 0xffffffff;
+  for (int y=0; y<(int)pm.rows(); y++)
+    {
+      const GPixel *p = pm[y];
+      for (int x=0; x<(int)pm.columns(); x++)
+        {
+          unsigned int c = (p[x].r << 16) | (p[x].g << 8) | p[x].b;
+          if (c == last || seen.contains(c))
+            continue;
+          if (seen.size() >= n)
+            return false;
+          seen[c] = 1;
+          last = c;
+        }
+    }
+  return true;
+}
+
+
+
+// ----------------------------------------
+// OUTPUT
+
+
+// A ByteStream writing into the output file.  Write errors are
+// recorded instead of throwing exceptions because this stream 
+// is also used from within libjpeg callbacks.
+class PdfOutput : public ByteStream
+{
+public:
+  PdfOutput(FILE *f) : f(f), offset(0), error(0) {}
+  virtual size_t write(const void *buffer, size_t size);
+  virtual long tell(void) const { return offset; }
+  FILE *f;
+  long offset;
+  int error;
+};
+
+size_t
+PdfOutput::write(const void *buffer, size_t size)
+{
+  if (fwrite(buffer, 1, size, f) < size && !error)
+    error = (errno) ? errno : EIO;
+  offset += size;
+  return size;
+}
+
+
+// Formats a real number independently of the locale.
+static GUTF8String
+num(double x)
+{
+  char buffer[32];
+  long n = (long)floor(x * 10000 + 0.5);
+  char *s = buffer;
+  if (n < 0)
+    {
+      *s++ = '-';
+      n = -n;
+    }
+  s += sprintf(s, "%ld", n / 10000);
+  if (n % 10000)
+    {
+      sprintf(s, ".%04ld", n % 10000);
+      for (s += strlen(s); s[-1] == '0'; s--)
+        s[-1] = 0;
+    }
+  return GUTF8String(buffer);
+}
+
+
+
+// ----------------------------------------
+// JPEG COMPRESSION
+
+#if HAVE_JPEG
+
+extern "C" {
+
+struct pdf_jpeg_error_mgr
+{
+  struct jpeg_error_mgr pub;
+  jmp_buf setjmp_buffer;
+};
+
+struct pdf_jpeg_dest_mgr
+{
+  struct jpeg_destination_mgr pub;
+  ByteStream *out;
+  JOCTET buffer[4096];
+};
+
+METHODDEF(void)
+pdf_jpeg_error_exit(j_common_ptr cinfo)
+{
+  struct pdf_jpeg_error_mgr *err = (struct pdf_jpeg_error_mgr*) cinfo->err;
+  longjmp(err->setjmp_buffer, 1);
+}
+
+METHODDEF(void)
+pdf_jpeg_init_destination(j_compress_ptr cinfo)
+{
+  struct pdf_jpeg_dest_mgr *dest = (struct pdf_jpeg_dest_mgr*) cinfo->dest;
+  dest->pub.next_output_byte = dest->buffer;
+  dest->pub.free_in_buffer = sizeof(dest->buffer);
+}
+
+METHODDEF(boolean)
+pdf_jpeg_empty_output_buffer(j_compress_ptr cinfo)
+{
+  struct pdf_jpeg_dest_mgr *dest = (struct pdf_jpeg_dest_mgr*) cinfo->dest;
+  dest->out->writall(dest->buffer, sizeof(dest->buffer));
+  dest->pub.next_output_byte = dest->buffer;
+  dest->pub.free_in_buffer = sizeof(dest->buffer);
+  return TRUE;
+}
+
+METHODDEF(void)
+pdf_jpeg_term_destination(j_compress_ptr cinfo)
+{
+  struct pdf_jpeg_dest_mgr *dest = (struct pdf_jpeg_dest_mgr*) cinfo->dest;
+  dest->out->writall(dest->buffer, 
+                     sizeof(dest->buffer) - dest->pub.free_in_buffer);
+}
+
+}
+
+
+// Compresses rows of 8 bit gray or RGB pixels with libjpeg.
+class JPEGWriter : public GPEnabled
+{
+public:
+  JPEGWriter(ByteStream &out, int width, int height, int ncomp, int quality);
+  ~JPEGWriter();
+  void write_row(const unsigned char *row);
+  void close(void);
+private:
+  struct jpeg_compress_struct cinfo;
+  struct pdf_jpeg_error_mgr jerr;
+  struct pdf_jpeg_dest_mgr dest;
+  bool created;
+  void fail(void);
+};
+
+JPEGWriter::JPEGWriter(ByteStream &out, int width, int height, 
+                       int ncomp, int quality)
+  : created(false)
+{
+  memset(&cinfo, 0, sizeof(cinfo));
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = pdf_jpeg_error_exit;
+  if (setjmp(jerr.setjmp_buffer))
+    fail();
+  jpeg_create_compress(&cinfo);
+  created = true;
+  dest.out = &out;
+  dest.pub.init_destination = pdf_jpeg_init_destination;
+  dest.pub.empty_output_buffer = pdf_jpeg_empty_output_buffer;
+  dest.pub.term_destination = pdf_jpeg_term_destination;
+  cinfo.dest = &dest.pub;
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  cinfo.input_components = ncomp;
+  cinfo.in_color_space = (ncomp == 3) ? JCS_RGB : JCS_GRAYSCALE;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, (quality > 0) ? quality : jpeg_quality, TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+}
+
+JPEGWriter::~JPEGWriter()
+{
+  if (created)
+    jpeg_destroy_compress(&cinfo);
+}
+
+void
+JPEGWriter::fail(void)
+{
+  char msg[JMSG_LENGTH_MAX + 100];
+  strcpy(msg, "LibJpeg error: ");
+  (*cinfo.err->format_message)((j_common_ptr)&cinfo, msg + strlen(msg));
+  jpeg_destroy_compress(&cinfo);
+  created = false;
+  G_THROW(msg);
+}
+
+void
+JPEGWriter::write_row(const unsigned char *row)
+{
+  JSAMPROW rows[1];
+  rows[0] = (JSAMPROW)row;
+  if (setjmp(jerr.setjmp_buffer))
+    fail();
+  jpeg_write_scanlines(&cinfo, rows, 1);
+}
+
+void
+JPEGWriter::close(void)
+{
+  if (setjmp(jerr.setjmp_buffer))
+    fail();
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  created = false;
+}
+
+#endif
+
+
+
+// ----------------------------------------
+// IMAGE STREAMS
+
+
+// Compresses the rows of an image into the output stream.  Bitonal
+// images (ncomp=0) have packed rows with one bits for black pixels.
+class ImageWriter
+{
+public:
+  ImageWriter(GP<ByteStream> out, int filter, 
+              int width, int height, int ncomp, int quality);
+  void write_row(const unsigned char *row);
+  void write_bits(const unsigned char *row);
+  void close(void);
+private:
+  GP<ByteStream> out;
+  GP<ByteStream> zout;
+  GP<MMREncoder> mmr;
+#if HAVE_JPEG
+  GP<JPEGWriter> jpeg;
+#endif
+  int rowbytes;
+  int width;
+  TArray<unsigned char> packed;
+};
+
+ImageWriter::ImageWriter(GP<ByteStream> out, int filter, 
+                         int width, int height, int ncomp, int quality)
+  : out(out), width(width)
+{
+  rowbytes = (ncomp > 0) ? width * ncomp : (width + 7) / 8;
+  if (filter == PDF_FLATE)
+    zout = FlateByteStream::create(out, 6);
+  else if (filter == PDF_G4)
+    mmr = MMREncoder::create(out, width);
+#if HAVE_JPEG
+  else if (filter == PDF_DCT)
+    jpeg = new JPEGWriter(*out, width, height, ncomp, quality);
+#endif
+}
+
+void
+ImageWriter::write_row(const unsigned char *row)
+{
+  if (mmr)
+    mmr->encode_packed(row);
+  else if (zout)
+    zout->writall(row, rowbytes);
+#if HAVE_JPEG
+  else if (jpeg)
+    jpeg->write_row(row);
+#endif
+  else
+    out->writall(row, rowbytes);
+}
+
+// Writes a bitonal row with one byte per pixel.
+void
+ImageWriter::write_bits(const unsigned char *row)
+{
+  if (mmr)
+    {
+      mmr->encode(row);
+      return;
+    }
+  packed.touch(rowbytes - 1);
+  unsigned char *p = &packed[0];
+  memset(p, 0, rowbytes);
+  for (int x=0; x<width; x++)
+    if (row[x])
+      p[x >> 3] |= 0x80 >> (x & 7);
+  write_row(p);
+}
+
+void
+ImageWriter::close(void)
+{
+  if (mmr)
+    mmr->close(true);
+#if HAVE_JPEG
+  if (jpeg)
+    jpeg->close();
+  jpeg = 0;
+#endif
+  // Deleting the deflate stream writes the last block
+  zout = 0;
+  mmr = 0;
+}
+
+
+// Number of rows of the band buffers.
+static int
+band_rows(int rowsize, int height, int multiple)
+{
+  int rows = band_bytes / rowsize;
+  rows -= rows % multiple;
+  if (rows < multiple)
+    rows = multiple;
+  return (rows < height) ? rows : height;
+}
+
+
+// Renders rows [top,top+rows) of rectangle rrect, counted from the top.
+static bool
+render_band(ddjvu_page_t *page, ddjvu_render_mode_t mode,
+            const ddjvu_rect_t &prect, const ddjvu_rect_t &rrect,
+            int top, int rows, ddjvu_format_t *fmt, 
+            int rowsize, char *buffer, int white)
+{
+  ddjvu_rect_t band = rrect;
+  band.y = rrect.y + rrect.h - top - rows;
+  band.h = rows;
+  if (ddjvu_page_render(page, mode, &prect, &band, fmt, rowsize, buffer))
+    return true;
+  memset(buffer, white, rowsize * rows);
+  return false;
+}
+
+
+// Holds a format created with the ddjvuapi.
+class Format
+{
+public:
+  Format(ddjvu_format_style_t style)
+    : fmt(ddjvu_format_create(style, 0, 0))
+    { 
+      if (! fmt)
+        G_THROW("Cannot create pixel format");
+      ddjvu_format_set_row_order(fmt, 1); 
+    }
+  ~Format() 
+    { ddjvu_format_release(fmt); }
+  operator ddjvu_format_t*() 
+    { return fmt; }
+private:
+  ddjvu_format_t *fmt;
+};
+
+
+
+// ----------------------------------------
+// PDF WRITER
+
+
+struct pdfwriter_s
+{
+  pdfwriter_s(FILE *f);
+  void print(const char *fmt, ...);
+  int new_object(void);
+  void begin_object(int obj);
+  int begin_image(int obj, int filter, int width, int height, 
+                  int ncomp, bool mask, const char *extra=0);
+  void end_stream(int lenobj);
+  bool write_image(int obj, ddjvu_page_t *page, ddjvu_render_mode_t mode,
+                   ddjvu_format_style_t style, const ddjvu_rect_t &prect,
+                   const ddjvu_rect_t &rrect, int filter, int quality);
+  bool write_layers(ddjvu_page_t *page, const ddjvu_rect_t &prect,
+                    const ddjvu_rect_t &rrect, int quality, int verbose,
+                    GUTF8String &resources, GUTF8String &contents);
+  void write_pixmap(int obj, const GPixmap &pm, int filter, int quality,
+                    const char *extra=0);
+  void write_bitmap(int obj, const GBitmap &bm, int width, int height);
+  void write_jb2_mask(int obj, const JB2Image &jimg, int width, int height);
+  bool write_djvu_layers(ddjvu_page_t *page, int quality, int verbose,
+                         GUTF8String &resources, GUTF8String &contents);
+  void write_page(ddjvu_page_t *page, ddjvu_render_mode_t mode,
+                  ddjvu_format_style_t style, const ddjvu_rect_t &prect,
+                  const ddjvu_rect_t &rrect, int quality, int verbose);
+  void finish(void);
+  GP<ByteStream> gout;
+  PdfOutput *out;
+  TArray<long> xref;
+  TArray<int> pages;
+  int nobjs;
+  int npages;
+  long stream_start;
+  GUTF8String error;
+};
+
+pdfwriter_s::pdfwriter_s(FILE *f)
+  : nobjs(0), npages(0), stream_start(0)
+{
+  out = new PdfOutput(f);
+  gout = out;
+  // Header with binary comment
+  print("%%PDF-1.4\n%%\xe2\xe3\xcf\xd3\n");
+  // Catalog (object 1) and page tree (object 2)
+  int catalog = new_object();
+  new_object();
+  begin_object(catalog);
+  print("<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+}
+
+void
+pdfwriter_s::print(const char *fmt, ...)
+{
+  char buffer[1024];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buffer, sizeof(buffer), fmt, args);
+  va_end(args);
+  if (n < 0 || n >= (int)sizeof(buffer))
+    G_THROW("PDF object too large");
+  out->writall(buffer, n);
+}
+
+int
+pdfwriter_s::new_object(void)
+{
+  nobjs += 1;
+  xref.touch(nobjs);
+  xref[nobjs] = 0;
+  return nobjs;
+}
+
+void
+pdfwriter_s::begin_object(int obj)
+{
+  xref[obj] = out->tell();
+  print("%d 0 obj\n", obj);
+}
+
+// Writes the dictionary of an image object and starts its stream.
+// Returns the number of the object holding the stream length.
+int
+pdfwriter_s::begin_image(int obj, int filter, int width, int height,
+                         int ncomp, bool mask, const char *extra)
+{
+  int lenobj = new_object();
+  begin_object(obj);
+  print("<< /Type /XObject /Subtype /Image /Width %d /Height %d",
+         width, height);
+  if (mask)
+    print(" /ImageMask true /BitsPerComponent 1");
+  else if (ncomp == 0)
+    print(" /ColorSpace /DeviceGray /BitsPerComponent 1");
+  else if (ncomp == 1)
+    print(" /ColorSpace /DeviceGray /BitsPerComponent 8");
+  else
+    print(" /ColorSpace /DeviceRGB /BitsPerComponent 8");
+  if (ncomp == 0 && filter != PDF_G4)
+    print(" /Decode [1 0]");
+  if (filter == PDF_FLATE)
+    print(" /Filter /FlateDecode");
+  else if (filter == PDF_DCT)
+    print(" /Filter /DCTDecode");
+  else if (filter == PDF_G4)
+    print(" /Filter /CCITTFaxDecode"
+           " /DecodeParms << /K -1 /Columns %d /Rows %d >>",
+           width, height);
+  if (extra)
+    print("%s", extra);
+  print(" /Length %d 0 R >>\nstream\n", lenobj);
+  stream_start = out->tell();
+  return lenobj;
+}
+
+void
+pdfwriter_s::end_stream(int lenobj)
+{
+  long length = out->tell() - stream_start;
+  print("\nendstream\nendobj\n");
+  begin_object(lenobj);
+  print("%ld\nendobj\n", length);
+}
+
+// Renders rectangle rrect of the page and writes it as image
+// object obj.  Returns false when nothing could be rendered.
+bool
+pdfwriter_s::write_image(int obj, ddjvu_page_t *page, 
+                         ddjvu_render_mode_t mode, 
+                         ddjvu_format_style_t style, 
+                         const ddjvu_rect_t &prect, 
+                         const ddjvu_rect_t &rrect, 
+                         int filter, int quality)
+{
+  const int w = rrect.w;
+  const int h = rrect.h;
+  int ncomp = 3;
+  int rowsize = 3 * w;
+  int white = 0xff;
+  if (style == DDJVU_FORMAT_MSBTOLSB)
+    {
+      ncomp = 0;
+      rowsize = (w + 7) / 8;
+      white = 0;
+    }
+  else if (style == DDJVU_FORMAT_GREY8)
+    {
+      ncomp = 1;
+      rowsize = w;
+    }
+  Format fmt(style);
+  const int rows = band_rows(rowsize, h, 1);
+  char *band;
+  GPBuffer<char> gband(band, rowsize * rows);
+  int lenobj = begin_image(obj, filter, w, h, ncomp, false);
+  ImageWriter iw(gout, filter, w, h, ncomp, quality);
+  bool rendered = false;
+  for (int top=0; top<h; top+=rows)
+    {
+      int n = (rows < h - top) ? rows : h - top;
+      if (render_band(page, mode, prect, rrect, top, n, 
+                      fmt, rowsize, band, white))
+        rendered = true;
+      for (int i=0; i<n; i++)
+        iw.write_row((const unsigned char*)band + i * rowsize);
+    }
+  iw.close();
+  end_stream(lenobj);
+  return rendered;
+}
+
+// Writes the layers of a compound page.
+bool
+pdfwriter_s::write_layers(ddjvu_page_t *page, 
+                          const ddjvu_rect_t &prect,
+                          const ddjvu_rect_t &rrect, 
+                          int quality, int verbose,
+                          GUTF8String &resources, 
+                          GUTF8String &contents)
+{
+  const int w = rrect.w;
+  const int h = rrect.h;
+  const int bgfilter = tone_filter(quality, false);
+  
+  // Background at a lower resolution
+  ddjvu_rect_t bprect;
+  bprect.x = bprect.y = 0;
+  bprect.w = (prect.w + bg_subsample - 1) / bg_subsample;
+  bprect.h = (prect.h + bg_subsample - 1) / bg_subsample;
+  const double sx = (double)prect.w / bprect.w;
+  const double sy = (double)prect.h / bprect.h;
+  int bx0 = (int)floor(rrect.x / sx);
+  int by0 = (int)floor(rrect.y / sy);
+  int bx1 = (int)ceil((rrect.x + rrect.w) / sx);
+  int by1 = (int)ceil((rrect.y + rrect.h) / sy);
+  ddjvu_rect_t brect;
+  brect.x = bx0;
+  brect.y = by0;
+  brect.w = bx1 - bx0;
+  brect.h = by1 - by0;
+  int bgobj = new_object();
+  write_image(bgobj, page, DDJVU_RENDER_BACKGROUND, DDJVU_FORMAT_RGB24,
+              bprect, brect, bgfilter, quality);
+  resources += GUTF8String(" /Bg ") + GUTF8String(bgobj) + " 0 R";
+  contents += "q " + num(brect.w * sx) + " 0 0 " + num(brect.h * sy) + " "
+    + num(bx0 * sx - rrect.x) + " " + num(by0 * sy - rrect.y) 
+    + " cm /Bg Do Q\n";
+
+  // Mask at full resolution, while collecting the foreground colors
+  const int mrowsize = (w + 7) / 8;
+  const int crowsize = 3 * w;
+  const int cw = (w + fg_subsample - 1) / fg_subsample;
+  const int ch = (h + fg_subsample - 1) / fg_subsample;
+  Format mfmt(DDJVU_FORMAT_MSBTOLSB);
+  Format cfmt(DDJVU_FORMAT_RGB24);
+  const int rows = band_rows(crowsize, h, fg_subsample);
+  char *mband;
+  GPBuffer<char> gmband(mband, mrowsize * rows);
+  char *cband;
+  GPBuffer<char> gcband(cband, crowsize * rows);
+  unsigned char *fg;
+  GPBuffer<unsigned char> gfg(fg, 3 * cw * ch);
+  unsigned int *sums;
+  GPBuffer<unsigned int> gsums(sums, 4 * cw);
+  memset(sums, 0, 4 * cw * sizeof(unsigned int));
+  bool black = false;
+  bool uniform = true;
+  unsigned char color[3] = { 0, 0, 0 };
+  int mobj = new_object();
+  int lenobj = begin_image(mobj, PDF_G4, w, h, 0, true);
+  ImageWriter mw(gout, PDF_G4, w, h, 0, quality);
+  for (int top=0; top<h; top+=rows)
+    {
+      int n = (rows < h - top) ? rows : h - top;
+      render_band(page, DDJVU_RENDER_MASKONLY, prect, rrect, top, n,
+                  mfmt, mrowsize, mband, 0);
+      bool any = false;
+      for (int i=0; i<mrowsize*n && !any; i++)
+        any = (mband[i] != 0);
+      if (any)
+        render_band(page, DDJVU_RENDER_FOREGROUND, prect, rrect, top, n,
+                    cfmt, crowsize, cband, 0xff);
+      for (int i=0; i<n; i++)
+        {
+          const unsigned char *mrow = (unsigned char*)mband + i * mrowsize;
+          const unsigned char *crow = (unsigned char*)cband + i * crowsize;
+          mw.write_row(mrow);
+          if (any)
+            for (int x=0; x<w; x++)
+              if (mrow[x>>3] & (0x80 >> (x & 7)))
+                {
+                  const unsigned char *c = crow + 3 * x;
+                  unsigned int *s = sums + 4 * (x / fg_subsample);
+                  s[0] += c[0];
+                  s[1] += c[1];
+                  s[2] += c[2];
+                  s[3] += 1;
+                  if (! black)
+                    memcpy(color, c, 3);
+                  else if (memcmp(color, c, 3))
+                    uniform = false;
+                  black = true;
+                }
+          // Average the colors of a complete row of cells.  Cells
+          // without black pixels are filled with their left neighbor
+          // to help compression.
+          int y = top + i;
+          if ((y + 1) % fg_subsample == 0 || y + 1 == h)
+            {
+              unsigned char *d = fg + 3 * cw * (y / fg_subsample);
+              unsigned char last[3] = { 0, 0, 0 };
+              for (int cx=0; cx<cw; cx++, d+=3)
+                {
+                  unsigned int *s = sums + 4 * cx;
+                  if (s[3])
+                    for (int k=0; k<3; k++)
+                      last[k] = (s[k] + s[3] / 2) / s[3];
+                  memcpy(d, last, 3);
+                }
+              memset(sums, 0, 4 * cw * sizeof(unsigned int));
+            }
+        }
+    }
+  mw.close();
+  end_stream(lenobj);
+
+  // Foreground
+  if (! black)
+    {
+      if (verbose)
+        fprintf(stderr, "Producing PDF page with a %s background.\n",
+                (bgfilter == PDF_DCT) ? "JPEG" : "deflate");
+    }
+  else if (uniform)
+    {
+      resources += GUTF8String(" /Mk ") + GUTF8String(mobj) + " 0 R";
+      contents += "q " + num(color[0] / 255.0) + " " + num(color[1] / 255.0)
+        + " " + num(color[2] / 255.0) + " rg "
+        + GUTF8String(w) + " 0 0 " + GUTF8String(h) + " 0 0 cm /Mk Do Q\n";
+      if (verbose)
+        fprintf(stderr, "Producing PDF page with a G4 mask over a %s"
+                " background.\n", (bgfilter == PDF_DCT) ? "JPEG" : "deflate");
+    }
+  else
+    {
+      int fgobj = new_object();
+      GUTF8String extra = GUTF8String(" /Mask ") + GUTF8String(mobj) + " 0 R";
+      int fglenobj = begin_image(fgobj, PDF_FLATE, cw, ch, 3, false, extra);
+      ImageWriter fw(gout, PDF_FLATE, cw, ch, 3, quality);
+      for (int cy=0; cy<ch; cy++)
+        fw.write_row(fg + 3 * cw * cy);
+      fw.close();
+      end_stream(fglenobj);
+      resources += GUTF8String(" /Fg ") + GUTF8String(fgobj) + " 0 R";
+      contents += "q " + GUTF8String(w) + " 0 0 " + GUTF8String(h)
+        + " 0 0 cm /Fg Do Q\n";
+      if (verbose)
+        fprintf(stderr, "Producing PDF page with a masked foreground"
+                " over a %s background.\n", 
+                (bgfilter == PDF_DCT) ? "JPEG" : "deflate");
+    }
+  return true;
+}
+
+// Writes a pixmap as an interpolated RGB image.
+void
+pdfwriter_s::write_pixmap(int obj, const GPixmap &pm, int filter, 
+                          int quality, const char *extra)
+{
+  const int w = pm.columns();
+  const int h = pm.rows();
+  GUTF8String ext = GUTF8String(" /Interpolate true") + (extra ? extra : "");
+  int lenobj = begin_image(obj, filter, w, h, 3, false, ext);
+  ImageWriter iw(gout, filter, w, h, 3, quality);
+  TArray<unsigned char> rgb(0, 3 * w - 1);
+  for (int y=h-1; y>=0; y--)
+    {
+      const GPixel *p = pm[y];
+      unsigned char *d = &rgb[0];
+      for (int x=0; x<w; x++, d+=3)
+        {
+          d[0] = p[x].r;
+          d[1] = p[x].g;
+          d[2] = p[x].b;
+        }
+      iw.write_row(&rgb[0]);
+    }
+  iw.close();
+  end_stream(lenobj);
+}
+
+// Writes a bitmap as a G4 image mask of the specified size.
+// Extra rows are added at the top and extra columns on the right.
+void
+pdfwriter_s::write_bitmap(int obj, const GBitmap &bm, int width, int height)
+{
+  const int w = bm.columns();
+  const int h = bm.rows();
+  int lenobj = begin_image(obj, PDF_G4, width, height, 0, true);
+  ImageWriter iw(gout, PDF_G4, width, height, 0, 0);
+  TArray<unsigned char> row(0, width - 1);
+  memset(&row[0], 0, width);
+  for (int y=height; y>h; y--)
+    iw.write_bits(&row[0]);
+  for (int y=h-1; y>=0; y--)
+    {
+      memcpy(&row[0], bm[y], w);
+      iw.write_bits(&row[0]);
+    }
+  iw.close();
+  end_stream(lenobj);
+}
+
+// Writes the JB2 mask as a G4 image mask of the specified size.
+// Extra rows are added at the top and extra columns on the right.
+void
+pdfwriter_s::write_jb2_mask(int obj, const JB2Image &jimg, 
+                            int width, int height)
+{
+  const int w = jimg.get_width();
+  const int h = jimg.get_height();
+  int lenobj = begin_image(obj, PDF_G4, width, height, 0, true);
+  ImageWriter iw(gout, PDF_G4, width, height, 0, 0);
+  TArray<unsigned char> row(0, width - 1);
+  memset(&row[0], 0, width);
+  for (int y=height; y>h; y--)
+    iw.write_bits(&row[0]);
+  const int rows = band_rows(w, h, 1);
+  for (int top=0; top<h; top+=rows)
+    {
+      int n = (rows < h - top) ? rows : h - top;
+      GP<GBitmap> bm = jimg.get_bitmap(GRect(0, h - top - n, w, n));
+      for (int i=n-1; i>=0; i--)
+        {
+          memcpy(&row[0], (*bm)[i], w);
+          iw.write_bits(&row[0]);
+        }
+    }
+  iw.close();
+  end_stream(lenobj);
+}
+
+static int
+compute_red(int w, int h, int rw, int rh)
+{
+  for (int red=1; red<16; red++)
+    if (((w+red-1)/red==rw) && ((h+red-1)/red==rh))
+      return red;
+  return 16;
+}
+
+// Writes the layers of a compound or bitonal page directly from
+// the DjVu image components: the background at its native
+// resolution, and the JB2 shapes as image masks filled with the
+// foreground colors.  Returns false without writing anything when
+// the page cannot be represented this way.
+bool
+pdfwriter_s::write_djvu_layers(ddjvu_page_t *page, int quality, int verbose,
+                               GUTF8String &resources, GUTF8String &contents)
+{
+  GP<DjVuImage> img = ddjvu_get_DjVuImage(page);
+  if (! img || img->get_rotate())
+    return false;
+  GP<DjVuInfo> info = img->get_info();
+  GP<JB2Image> fgjb = img->get_fgjb();
+  const int w = img->get_real_width();
+  const int h = img->get_real_height();
+  if (!info || !fgjb || w <= 0 || h <= 0 ||
+      fgjb->get_width() != w || fgjb->get_height() != h)
+    return false;
+  GP<IW44Image> bg44 = img->get_bg44();
+  GP<GPixmap> bgpm = img->get_bgpm();
+  GP<GPixmap> fgpm = img->get_fgpm();
+  GP<DjVuPalette> fgbc = img->get_fgbc();
+  int bgred = 0;
+  if (bg44)
+    bgred = compute_red(w, h, bg44->get_width(), bg44->get_height());
+  else if (bgpm)
+    bgred = compute_red(w, h, bgpm->columns(), bgpm->rows());
+  if (bgred > 12)
+    return false;
+  int fgred = 0;
+  if (fgpm && !fgbc)
+    fgred = compute_red(w, h, fgpm->columns(), fgpm->rows());
+  if (fgred > 12)
+    return false;
+  
+  // Gamma correction as in DjVuImage::get_pixmap()
+  double corr = 1.0;
+  if (info->gamma > 0)
+    corr = 2.2 / info->gamma;
+  if (corr < 0.1)
+    corr = 0.1;
+  else if (corr > 10)
+    corr = 10;
+
+  // Chain the blits of each palette color
+  const int nblits = fgjb->get_blit_count();
+  const int ncolors = (fgbc) ? fgbc->size() : 0;
+  TArray<int> first;
+  TArray<int> next;
+  GArray<GRect> boxes;
+  GTArray<GPixel> colors;
+  if (fgbc)
+    {
+      if (ncolors <= 0 || fgbc->colordata.size() != nblits)
+        return false;
+      first.resize(0, ncolors - 1);
+      next.resize(0, nblits - 1);
+      boxes.resize(0, ncolors - 1);
+      colors.resize(0, ncolors - 1);
+      for (int c=0; c<ncolors; c++)
+        {
+          first[c] = -1;
+          fgbc->index_to_color(c, colors[c]);
+        }
+      if (corr != 1.0)
+        GPixmap::color_correct(corr, &colors[0], ncolors);
+      for (int b=nblits-1; b>=0; b--)
+        {
+          const JB2Blit *blit = fgjb->get_blit(b);
+          const JB2Shape &shape = fgjb->get_shape(blit->shapeno);
+          const int c = fgbc->colordata[b];
+          if (c < 0 || c >= ncolors)
+            return false;
+          if (! shape.bits)
+            continue;
+          GRect rect(blit->left, blit->bottom, 
+                     shape.bits->columns(), shape.bits->rows());
+          boxes[c].recthull(boxes[c], rect);
+          next[b] = first[c];
+          first[c] = b;
+        }
+    }
+
+  // Background
+  int bgfilter = PDF_FLATE;
+  if (bgred)
+    {
+      GP<GPixmap> pm = (bg44) ? bg44->get_pixmap() : GPixmap::create(*bgpm);
+      bgfilter = tone_filter(quality, has_few_colors(*pm, few_colors));
+      if (corr != 1.0)
+        pm->color_correct(corr);
+      int bgobj = new_object();
+      write_pixmap(bgobj, *pm, bgfilter, quality);
+      resources += GUTF8String(" /Bg ") + GUTF8String(bgobj) + " 0 R";
+      contents += "q " + GUTF8String((int)pm->columns() * bgred) + " 0 0 "
+        + GUTF8String((int)pm->rows() * bgred) + " 0 0 cm /Bg Do Q\n";
+    }
+  
+  // Foreground
+  int nmasks = 0;
+  if (fgbc)
+    {
+      // One mask per palette color.  All masks cover the page
+      // because viewers resample masks whose edges do not fall
+      // exactly between two device pixels.
+      const GRect page_rect(0, 0, w, h);
+      for (int c=0; c<ncolors; c++)
+        {
+          GRect rect;
+          if (first[c] < 0 || !rect.intersect(boxes[c], page_rect))
+            continue;
+          GP<GBitmap> bm = GBitmap::create(rect.ymax_, rect.xmax_);
+          for (int b=first[c]; b>=0; b=next[b])
+            {
+              const JB2Blit *blit = fgjb->get_blit(b);
+              const JB2Shape &shape = fgjb->get_shape(blit->shapeno);
+              bm->blit(shape.bits, blit->left, blit->bottom);
+            }
+          int mobj = new_object();
+          write_bitmap(mobj, *bm, w, h);
+          GUTF8String name = GUTF8String("/M") + GUTF8String(c);
+          resources += " " + name + " " + GUTF8String(mobj) + " 0 R";
+          contents += "q " + num(colors[c].r / 255.0) + " " 
+            + num(colors[c].g / 255.0) + " " + num(colors[c].b / 255.0) 
+            + " rg " + GUTF8String(w) + " 0 0 " + GUTF8String(h) 
+            + " 0 0 cm " + name + " Do Q\n";
+          nmasks += 1;
+        }
+    }
+  else
+    {
+      // Single mask filled with a color or with the foreground image
+      bool uniform = true;
+      GPixel color = GPixel::BLACK;
+      if (fgpm)
+        {
+          const int fw = fgpm->columns();
+          const int fh = fgpm->rows();
+          color = (*fgpm)[0][0];
+          for (int y=0; y<fh && uniform; y++)
+            {
+              const GPixel *p = (*fgpm)[y];
+              for (int x=0; x<fw && uniform; x++)
+                uniform = (p[x] == color);
+            }
+          if (uniform && corr != 1.0)
+            GPixmap::color_correct(corr, &color, 1);
+        }
+      if (uniform)
+        {
+          int mobj = new_object();
+          write_jb2_mask(mobj, *fgjb, w, h);
+          resources += GUTF8String(" /Mk ") + GUTF8String(mobj) + " 0 R";
+          contents += "q " + num(color.r / 255.0) + " " + num(color.g / 255.0)
+            + " " + num(color.b / 255.0) + " rg " + GUTF8String(w) 
+            + " 0 0 " + GUTF8String(h) + " 0 0 cm /Mk Do Q\n";
+        }
+      else
+        {
+          // The mask covers the foreground image exactly
+          const int mw = fgpm->columns() * fgred;
+          const int mh = fgpm->rows() * fgred;
+          int mobj = new_object();
+          write_jb2_mask(mobj, *fgjb, mw, mh);
+          GP<GPixmap> pm = GPixmap::create(*fgpm);
+          if (corr != 1.0)
+            pm->color_correct(corr);
+          int fgobj = new_object();
+          GUTF8String extra = GUTF8String(" /Mask ") + GUTF8String(mobj) + " 0 R";
+          write_pixmap(fgobj, *pm, PDF_FLATE, quality, extra);
+          resources += GUTF8String(" /Fg ") + GUTF8String(fgobj) + " 0 R";
+          contents += "q " + GUTF8String(mw) + " 0 0 " + GUTF8String(mh)
+            + " 0 0 cm /Fg Do Q\n";
+        }
+      nmasks = 1;
+    }
+  if (verbose)
+    fprintf(stderr, "Producing PDF page with %d G4 mask(s)%s%s.\n", nmasks,
+            (bgred) ? " over a " : "", 
+            (!bgred) ? "" : (bgfilter == PDF_DCT) ? "JPEG background" 
+            : "deflate background");
+  return true;
+}
+
+void
+pdfwriter_s::write_page(ddjvu_page_t *page, ddjvu_render_mode_t mode,
+                        ddjvu_format_style_t style, 
+                        const ddjvu_rect_t &prect, 
+                        const ddjvu_rect_t &rrect, 
+                        int quality, int verbose)
+{
+  const int iw = ddjvu_page_get_width(page);
+  const int ih = ddjvu_page_get_height(page);
+  const int dpi = ddjvu_page_get_resolution(page);
+  const ddjvu_page_type_t type = ddjvu_page_get_type(page);
+  if (iw <= 0 || ih <= 0 || rrect.w <= 0 || rrect.h <= 0)
+    G_THROW("Cannot write an empty page");
+  
+  // The page size in points follows from the output resolution
+  const double xscale = 72.0 * iw / ((dpi > 0) ? dpi : 300) / prect.w;
+  const double yscale = 72.0 * ih / ((dpi > 0) ? dpi : 300) / prect.h;
+  GUTF8String resources;
+  GUTF8String contents = "q " + num(xscale) + " 0 0 " 
+    + num(yscale) + " 0 0 cm\n";
+  
+  // Pages rendered at full resolution have separate layers
+  bool done = false;
+  const bool full = ((int)prect.w == iw && (int)prect.h == ih);
+  if (mode == DDJVU_RENDER_COLOR && full && quality < 1000
+      && (type == DDJVU_PAGETYPE_COMPOUND || type == DDJVU_PAGETYPE_BITONAL)
+      && rrect.x == 0 && rrect.y == 0 && rrect.w == prect.w 
+      && rrect.h == prect.h)
+    done = write_djvu_layers(page, quality, verbose, resources, contents);
+  if (! done && mode == DDJVU_RENDER_COLOR && full && quality < 1000
+      && type == DDJVU_PAGETYPE_COMPOUND)
+    done = write_layers(page, prect, rrect, quality, verbose, 
+                        resources, contents);
+  
+  // Other pages are a single image
+  if (! done)
+    {
+      // Bitonal pages rendered as gray images have few colors
+      const bool fewcolors = (type == DDJVU_PAGETYPE_BITONAL 
+                              || mode == DDJVU_RENDER_BLACK
+                              || mode == DDJVU_RENDER_MASKONLY);
+      int filter = tone_filter(quality, fewcolors);
+      if (quality < 1000 && style == DDJVU_FORMAT_MSBTOLSB)
+        filter = PDF_G4;
+      if (verbose)
+        fprintf(stderr, "Producing PDF page with a %s image.\n",
+                (filter == PDF_G4) ? "G4" : (filter == PDF_DCT) ? "JPEG" :
+                (filter == PDF_FLATE) ? "deflate" : "uncompressed");
+      int imobj = new_object();
+      write_image(imobj, page, mode, style, prect, rrect, filter, quality);
+      resources += GUTF8String(" /Im ") + GUTF8String(imobj) + " 0 R";
+      contents += GUTF8String("q ") + GUTF8String((int)rrect.w) 
+        + " 0 0 " + GUTF8String((int)rrect.h) + " 0 0 cm /Im Do Q\n";
+    }
+  contents += "Q\n";
+
+  // Contents
+  int cobj = new_object();
+  int lenobj = new_object();
+  begin_object(cobj);
+  print("<< /Length %d 0 R >>\nstream\n", lenobj);
+  stream_start = out->tell();
+  out->writestring(contents);
+  end_stream(lenobj);
+  
+  // Page
+  int pobj = new_object();
+  begin_object(pobj);
+  print("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 %s %s]",
+         (const char*)num(rrect.w * xscale), 
+         (const char*)num(rrect.h * yscale));
+  out->writestring("\n   /Resources << /XObject <<" + resources + " >> >>");
+  print("\n   /Contents %d 0 R >>\nendobj\n", cobj);
+  pages.touch(npages);
+  pages[npages++] = pobj;
+}
+
+void
+pdfwriter_s::finish(void)
+{
+  // Page tree
+  begin_object(2);
+  print("<< /Type /Pages /Count %d\n   /Kids [", npages);
+  for (int i=0; i<npages; i++)
+    print((i % 8 == 7) ? " %d 0 R\n  " : " %d 0 R", pages[i]);
+  print(" ] >>\nendobj\n");
+  // Cross reference table
+  long start = out->tell();
+  print("xref\n0 %d\n0000000000 65535 f \n", nobjs + 1);
+  for (int i=1; i<=nobjs; i++)
+    print("%010ld 00000 n \n", xref[i]);
+  print("trailer\n<< /Size %d /Root 1 0 R >>\n", nobjs + 1);
+  print("startxref\n%ld\n%%%%EOF\n", start);
+}
+
+
+
+// ----------------------------------------
+// C INTERFACE
+
+
+pdfwriter_t *
+pdfwriter_create(FILE *f)
+{
+  pdfwriter_t *pdf = 0;
+  G_TRY
+    {
+      pdf = new pdfwriter_s(f);
+    }
+  G_CATCH_ALL
+    {
+      pdf = 0;
+    }
+  G_ENDCATCH;
+  return pdf;
+}
+
+const char *
+pdfwriter_page(pdfwriter_t *pdf, ddjvu_page_t *page,
+               ddjvu_render_mode_t mode, ddjvu_format_style_t style,
+               const ddjvu_rect_t *prect, const ddjvu_rect_t *rrect,
+               int quality, int verbose)
+{
+  G_TRY
+    {
+      pdf->write_page(page, mode, style, *prect, *rrect, quality, verbose);
+    }
+  G_CATCH(ex)
+    {
+      pdf->error = ex.get_cause();
+      return pdf->error;
+    }
+  G_ENDCATCH;
+  if (pdf->out->error)
+    return strerror(pdf->out->error);
+  return 0;
+}
+
+const char *
+pdfwriter_finish(pdfwriter_t *pdf)
+{
+  G_TRY
+    {
+      pdf->finish();
+    }
+  G_CATCH(ex)
+    {
+      pdf->error = ex.get_cause();
+      return pdf->error;
+    }
+  G_ENDCATCH;
+  if (pdf->out->error)
+    return strerror(pdf->out->error);
+  return 0;
+}
+
+void
+pdfwriter_release(pdfwriter_t *pdf)
+{
+  delete pdf;
+}
@@ -0,0 +1,103 @@
+//C-  -*- C++ -*-
+//C- -------------------------------------------------------------------
+//C- DjVuLibre-3.5
+//C- Copyright (c) 2002  Leon Bottou and Yann Le Cun.
+//C- Copyright (c) 2001  AT&T
+//C-
+//C- This software is subject to, and may be distributed under, the
+//C- GNU General Public License, either Version 2 of the license,
+//C- or (at your option) any later version. The license should have
+//C- accompanied the software or you may obtain a copy of the license
+//C- from the Free Software Foundation at http://www.fsf.org .
+//C-
+//C- This program is distributed in the hope that it will be useful,
+//C- but WITHOUT ANY WARRANTY; without even the implied warranty of
+//C- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//C- GNU General Public License for more details.
+//C-
+//C- DjVuLibre-3.5 is derived from the DjVu(r) Reference Library from
+//C- Lizardtech Software.  Lizardtech Software has authorized us to
+//C- replace the original DjVu(r) Reference Library notice by the following
+//C- text (see doc/lizard2002.djvu and doc/lizardtech2007.djvu):
+//C-
+//C-  ------------------------------------------------------------------
+//C- | DjVu (r) Reference Library (v. 3.5)
+//C- | Copyright (c) 1999-2001 LizardTech, Inc. All Rights Reserved.
+//C- | The DjVu Reference Library is protected by U.S. Pat. No.
+//C- | 6,058,214 and patents pending.
+//C- |
+//C- | This software is subject to, and may be distributed under, the
+//C- | GNU General Public License, either Version 2 of the license,
+//C- | or (at your option) any later version. The license should have
+//C- | accompanied the software or you may obtain a copy of the license
+//C- | from the Free Software Foundation at http://www.fsf.org .
+//C- |
+//C- | The computer code originally released by LizardTech under this
+//C- | license and unmodified by other parties is deemed "the LIZARDTECH
+//C- | ORIGINAL CODE."  Subject to any third party intellectual property
+//C- | claims, LizardTech grants recipient a worldwide, royalty-free,
+//C- | non-exclusive license to make, use, sell, or otherwise dispose of
+//C- | the LIZARDTECH ORIGINAL CODE or of programs derived from the
+//C- | LIZARDTECH ORIGINAL CODE in compliance with the terms of the GNU
+//C- | General Public License.   This grant only confers the right to
+//C- | infringe patent claims underlying the LIZARDTECH ORIGINAL CODE to
+//C- | the extent such infringement is reasonably necessary to enable
+//C- | recipient to make, have made, practice, sell, or otherwise dispose
+//C- | of the LIZARDTECH ORIGINAL CODE, and not to infringe any patent
+//C- | claims of any other party.   In no event shall this grant
+//C- | constitute the rights to relicense this code or any part of it.
+//C- | See the GNU General Public License, Version 2, for more details.
+//C- +------------------------------------------------------------------
+
+
+#ifndef PDFWRITER_H
+# define PDFWRITER_H
+# if HAVE_CONFIG_H
+#  include "config.h"
+# endif
+# include <stdio.h>
+# include "libdjvu/ddjvuapi.h"
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/* Streaming PDF writer for ddjvu.
+
+   Each page is rendered in horizontal bands that are compressed
+   directly into the PDF image streams.  Bitonal images are encoded
+   with CCITT G4, other images with JPEG when a quality factor between
+   1 and 100 is given, and with deflate otherwise.  Compound pages
+   rendered at full resolution in color mode are written as a G4 mask
+   painted over a background image at one third of the resolution.
+   The mask is either filled with a single color, or used as an
+   explicit mask for a low resolution foreground color image.
+   Quality factor 1000 disables all compression.
+
+   Functions returning a string return a null pointer on success
+   and an error message otherwise. */
+
+typedef struct pdfwriter_s pdfwriter_t;
+
+/* Starts a PDF file written into <f> and writes its header. */
+pdfwriter_t *pdfwriter_create(FILE *f);
+
+/* Renders rectangle <rrect> of page <page> scaled into rectangle
+   <prect> and writes it as a new page of the PDF file. */
+const char *pdfwriter_page(pdfwriter_t *pdf, ddjvu_page_t *page,
+                           ddjvu_render_mode_t mode, 
+                           ddjvu_format_style_t style,
+                           const ddjvu_rect_t *prect, 
+                           const ddjvu_rect_t *rrect,
+                           int quality, int verbose);
+
+/* Writes the page tree, the cross reference table 
+   and the trailer of the PDF file. */
+const char *pdfwriter_finish(pdfwriter_t *pdf);
+
+/* Releases the writer. This does not close the file. */
+void pdfwriter_release(pdfwriter_t *pdf);
+
+# ifdef __cplusplus
+}
+# endif
+#endif /* PDFWRITER_H */